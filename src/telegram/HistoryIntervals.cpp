@@ -0,0 +1,67 @@
+#include "HistoryIntervals.h"
+
+#include <algorithm>
+
+void HistoryIntervals::Add(int64_t first, int64_t last) {
+  if (first > last) {
+    std::swap(first, last);
+  }
+
+  // Ranges ending before `first` stay; everything overlapping merges in
+  auto begin = std::lower_bound(
+      m_intervals.begin(), m_intervals.end(), first,
+      [](const Interval &interval, int64_t id) { return interval.last < id; });
+  auto end = begin;
+  while (end != m_intervals.end() && end->first <= last) {
+    first = std::min(first, end->first);
+    last = std::max(last, end->last);
+    ++end;
+  }
+
+  // A page above the newest range means the newest range no longer ends at
+  // the newest message
+  if (m_reachesNewest && end == m_intervals.end() && begin == end) {
+    m_reachesNewest = false;
+  }
+
+  auto pos = m_intervals.erase(begin, end);
+  m_intervals.insert(pos, Interval{first, last});
+}
+
+void HistoryIntervals::AddNewest(int64_t first, int64_t last) {
+  Add(first, last);
+  // Nothing can be newer than this page
+  while (!m_intervals.empty() &&
+         m_intervals.back().first > std::max(first, last)) {
+    m_intervals.pop_back();
+  }
+  m_reachesNewest = true;
+}
+
+void HistoryIntervals::ExtendNewest(int64_t messageId) {
+  if (m_reachesNewest && !m_intervals.empty() &&
+      messageId > m_intervals.back().last) {
+    m_intervals.back().last = messageId;
+  }
+}
+
+const HistoryIntervals::Interval *
+HistoryIntervals::Find(int64_t messageId) const {
+  auto it = std::lower_bound(
+      m_intervals.begin(), m_intervals.end(), messageId,
+      [](const Interval &interval, int64_t id) { return interval.last < id; });
+  if (it == m_intervals.end() || it->first > messageId) {
+    return nullptr;
+  }
+  return &*it;
+}
+
+bool HistoryIntervals::IsNewest(const Interval *interval) const {
+  return interval && m_reachesNewest && !m_intervals.empty() &&
+         interval == &m_intervals.back();
+}
+
+void HistoryIntervals::Clear() {
+  m_intervals.clear();
+  m_reachesNewest = false;
+}
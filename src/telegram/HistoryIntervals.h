@@ -0,0 +1,42 @@
+#ifndef HISTORYINTERVALS_H
+#define HISTORYINTERVALS_H
+
+#include <cstdint>
+#include <vector>
+
+// Message id ranges of one chat whose messages are all in the cache. A
+// history page is contiguous by construction, so each page adds one range
+// and ranges that overlap merge; whatever lies between two ranges is a gap
+// that is only fetched once the user scrolls into it.
+//
+// The last range may be marked as reaching the chat's newest message; live
+// messages then extend it instead of opening a gap above it.
+//
+// Not synchronised; TelegramClient guards it with m_dataMutex.
+class HistoryIntervals {
+public:
+  struct Interval {
+    int64_t first = 0;
+    int64_t last = 0;
+  };
+
+  void Add(int64_t first, int64_t last);
+  // A page that ends at the chat's newest message
+  void AddNewest(int64_t first, int64_t last);
+  // A new message arrived; grows the newest range if there is one
+  void ExtendNewest(int64_t messageId);
+
+  // The range containing messageId, or nullptr
+  const Interval *Find(int64_t messageId) const;
+  bool IsNewest(const Interval *interval) const;
+  bool ReachesNewest() const { return m_reachesNewest; }
+
+  bool IsEmpty() const { return m_intervals.empty(); }
+  void Clear();
+
+private:
+  std::vector<Interval> m_intervals; // Sorted, disjoint
+  bool m_reachesNewest = false;
+};
+
+#endif // HISTORYINTERVALS_H
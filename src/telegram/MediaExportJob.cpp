@@ -0,0 +1,520 @@
+#include "MediaExportJob.h"
+#include "TelegramClient.h"
+
+#include <wx/datetime.h>
+#include <wx/ffile.h>
+#include <wx/filefn.h>
+#include <wx/filename.h>
+#include <wx/textfile.h>
+#include <wx/tokenzr.h>
+
+#ifndef __WXMSW__
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef __linux__
+// In-kernel copy: the data never passes through user space, and filesystems
+// with reflink support (btrfs, xfs) share the extents instead of copying
+static bool CopyWithCopyFileRange(const wxString &source,
+                                  const wxString &target) {
+  int in = open(source.fn_str(), O_RDONLY | O_CLOEXEC);
+  if (in < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(in, &st) != 0) {
+    close(in);
+    return false;
+  }
+
+  int out = open(target.fn_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                 0644);
+  if (out < 0) {
+    close(in);
+    return false;
+  }
+
+  bool ok = true;
+  off_t remaining = st.st_size;
+  while (remaining > 0) {
+    ssize_t copied = copy_file_range(in, nullptr, out, nullptr,
+                                     static_cast<size_t>(remaining), 0);
+    if (copied < 0 && errno == EINTR)
+      continue;
+    if (copied <= 0) {
+      // ENOSYS/EXDEV/EINVAL on older kernels - caller falls back
+      ok = false;
+      break;
+    }
+    remaining -= copied;
+  }
+
+  close(in);
+  if (close(out) != 0)
+    ok = false;
+  return ok;
+}
+#endif
+
+MediaExportJob::MediaExportJob(TelegramClient *client, int64_t chatId,
+                               const wxString &chatTitle,
+                               const wxString &targetDir,
+                               const std::vector<SearchMediaFilter> &filters)
+    : m_client(client), m_targetDir(targetDir), m_filters(filters),
+      m_pumpTimer(this), m_alive(std::make_shared<bool>(true)) {
+  m_progress.chatId = chatId;
+  m_progress.chatTitle = chatTitle;
+  m_progress.targetDir = targetDir;
+
+  Bind(wxEVT_TIMER, &MediaExportJob::OnPumpTimer, this, m_pumpTimer.GetId());
+}
+
+MediaExportJob::~MediaExportJob() {
+  m_pumpTimer.Stop();
+  Unbind(wxEVT_TIMER, &MediaExportJob::OnPumpTimer, this, m_pumpTimer.GetId());
+  m_alive.reset();
+
+  {
+    std::lock_guard<std::mutex> lock(m_exportMutex);
+    m_stopExport = true;
+    m_exportTasks.clear();
+  }
+  m_exportCond.notify_all();
+  if (m_exportThread.joinable()) {
+    m_exportThread.join();
+  }
+}
+
+bool MediaExportJob::ParseFilters(const wxString &spec,
+                                  std::vector<SearchMediaFilter> &filters) {
+  filters.clear();
+
+  wxStringTokenizer tokens(spec.Lower(), " ,", wxTOKEN_STRTOK);
+  while (tokens.HasMoreTokens()) {
+    wxString token = tokens.GetNextToken();
+    if (token == "all") {
+      filters.clear();
+      break;
+    } else if (token == "photo" || token == "photos") {
+      filters.push_back(SearchMediaFilter::Photo);
+    } else if (token == "video" || token == "videos") {
+      filters.push_back(SearchMediaFilter::Video);
+    } else if (token == "doc" || token == "docs" || token == "document" ||
+               token == "documents" || token == "files") {
+      filters.push_back(SearchMediaFilter::Document);
+    } else if (token == "audio" || token == "music") {
+      filters.push_back(SearchMediaFilter::Audio);
+    } else if (token == "voice") {
+      filters.push_back(SearchMediaFilter::Voice);
+    } else if (token == "gif" || token == "gifs" || token == "animations") {
+      filters.push_back(SearchMediaFilter::Animation);
+    } else {
+      return false;
+    }
+  }
+
+  if (filters.empty()) {
+    filters = {SearchMediaFilter::Photo,     SearchMediaFilter::Video,
+               SearchMediaFilter::Animation, SearchMediaFilter::Document,
+               SearchMediaFilter::Audio,     SearchMediaFilter::Voice};
+  }
+  return true;
+}
+
+void MediaExportJob::Start() {
+  if (!m_client || m_filters.empty()) {
+    m_progress.scanning = false;
+    m_progress.finished = true;
+    NotifyProgress();
+    return;
+  }
+
+  if (!wxFileName::DirExists(m_targetDir) &&
+      !wxFileName::Mkdir(m_targetDir, wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL)) {
+    m_progress.lastError = "Cannot create " + m_targetDir;
+    m_progress.scanning = false;
+    m_progress.finished = true;
+    NotifyProgress();
+    return;
+  }
+
+  LoadManifest();
+
+  m_exportThread = std::thread(&MediaExportJob::ExportLoop, this);
+  m_pumpTimer.Start(PUMP_INTERVAL_MS);
+
+  RequestNextPage();
+  NotifyProgress();
+}
+
+void MediaExportJob::Cancel() {
+  if (m_progress.finished)
+    return;
+
+  m_pumpTimer.Stop();
+
+  // Release the download slots we hold; the export in progress (if any) is
+  // allowed to finish so the manifest never points at a partial file
+  for (const auto &[fileId, items] : m_inFlight) {
+    if (m_ownedDownloads.count(fileId)) {
+      m_client->CancelDownload(fileId);
+    }
+  }
+  m_inFlight.clear();
+  m_ownedDownloads.clear();
+  m_queue.clear();
+  {
+    std::lock_guard<std::mutex> lock(m_exportMutex);
+    m_exportTasks.clear();
+  }
+
+  m_progress.scanning = false;
+  m_progress.cancelled = true;
+  m_progress.finished = true;
+  NotifyProgress();
+}
+
+void MediaExportJob::RequestNextPage() {
+  if (m_pageRequested || m_filterIndex >= m_filters.size())
+    return;
+
+  m_pageRequested = true;
+  std::weak_ptr<bool> alive = m_alive;
+  m_client->SearchChatMessages(
+      m_progress.chatId, wxString(), m_filters[m_filterIndex],
+      m_nextFromMessageId, PAGE_SIZE,
+      [this, alive](bool success, const std::vector<MessageInfo> &messages,
+                    int64_t nextFromMessageId, const wxString &error) {
+        if (alive.expired())
+          return;
+        OnPageLoaded(success, messages, nextFromMessageId, error);
+      });
+}
+
+void MediaExportJob::OnPageLoaded(bool success,
+                                  const std::vector<MessageInfo> &messages,
+                                  int64_t nextFromMessageId,
+                                  const wxString &error) {
+  m_pageRequested = false;
+  if (m_progress.finished)
+    return;
+
+  bool filterDone = !success || messages.empty() || nextFromMessageId == 0;
+  if (!success) {
+    // Skip the rest of this filter rather than abort the whole archive
+    m_progress.lastError = error;
+  }
+
+  for (const auto &msg : messages) {
+    if (msg.mediaFileId == 0 || !m_seenMessageIds.insert(msg.id).second)
+      continue;
+
+    m_progress.found++;
+    if (m_exportedMessageIds.count(msg.id)) {
+      m_progress.skipped++;
+      continue;
+    }
+
+    Item item;
+    item.messageId = msg.id;
+    item.date = msg.date;
+    item.fileId = msg.mediaFileId;
+    item.fileName = msg.mediaFileName;
+    item.fileSize = msg.mediaFileSize;
+
+    if (!msg.mediaLocalPath.IsEmpty()) {
+      QueueExport(item, msg.mediaLocalPath); // Already in TDLib's cache
+    } else {
+      m_queue.push_back(item);
+    }
+  }
+
+  if (filterDone) {
+    m_filterIndex++;
+    m_nextFromMessageId = 0;
+  } else {
+    m_nextFromMessageId = nextFromMessageId;
+  }
+  m_progress.scanning = m_filterIndex < m_filters.size();
+
+  Pump();
+}
+
+void MediaExportJob::OnPumpTimer(wxTimerEvent &event) { Pump(); }
+
+void MediaExportJob::Pump() {
+  if (m_progress.finished)
+    return;
+
+  DrainExportResults();
+
+  // DownloadFile would turn every request away until the cooldown ends
+  bool coolingDown = m_client->IsInStartupCooldown(DOWNLOAD_PRIORITY);
+
+  // Poll the downloads we are waiting on
+  for (auto it = m_inFlight.begin(); it != m_inFlight.end();) {
+    int32_t fileId = it->first;
+    DownloadInfo info;
+    bool tracked = m_client->GetDownloadInfo(fileId, info);
+
+    if (tracked && info.state == DownloadState::Completed &&
+        !info.localPath.IsEmpty()) {
+      for (const auto &item : it->second) {
+        QueueExport(item, info.localPath);
+      }
+      m_ownedDownloads.erase(fileId);
+      it = m_inFlight.erase(it);
+      continue;
+    }
+
+    if (tracked && info.state == DownloadState::Failed && !info.CanRetry()) {
+      m_progress.failed += static_cast<int>(it->second.size());
+      m_progress.lastError = info.errorMessage;
+      m_ownedDownloads.erase(fileId);
+      it = m_inFlight.erase(it);
+      continue;
+    }
+
+    if (!coolingDown && (!tracked || info.state == DownloadState::Cancelled)) {
+      // Turned away (startup cooldown, capacity gate) or cancelled by the
+      // viewport - ask again
+      RequestDownload(it->second.front());
+    }
+    ++it;
+  }
+
+  // Fill free download slots
+  while (!coolingDown && m_inFlight.size() < MAX_IN_FLIGHT &&
+         !m_queue.empty()) {
+    Item item = m_queue.front();
+    m_queue.pop_front();
+
+    auto existing = m_inFlight.find(item.fileId);
+    if (existing != m_inFlight.end()) {
+      existing->second.push_back(item); // Same file forwarded again
+      continue;
+    }
+
+    DownloadInfo info;
+    if (m_client->GetDownloadInfo(item.fileId, info) &&
+        info.state == DownloadState::Completed && !info.localPath.IsEmpty()) {
+      QueueExport(item, info.localPath);
+      continue;
+    }
+
+    m_inFlight[item.fileId].push_back(item);
+    RequestDownload(item);
+  }
+
+  // Page lazily so a huge channel doesn't sit in memory as one long queue
+  if (m_queue.size() < static_cast<size_t>(PAGE_SIZE)) {
+    RequestNextPage();
+  }
+
+  NotifyProgress();
+  FinishIfDone();
+}
+
+void MediaExportJob::RequestDownload(const Item &item) {
+  // A download someone else already has running is shared, not taken over
+  DownloadInfo info;
+  bool running = m_client->GetDownloadInfo(item.fileId, info) &&
+                 (info.state == DownloadState::Pending ||
+                  info.state == DownloadState::Downloading);
+  m_client->DownloadFile(item.fileId, DOWNLOAD_PRIORITY, item.fileName,
+                         item.fileSize);
+  if (!running) {
+    m_ownedDownloads.insert(item.fileId);
+  }
+}
+
+void MediaExportJob::QueueExport(const Item &item,
+                                 const wxString &sourcePath) {
+  ExportTask task;
+  task.messageId = item.messageId;
+  task.sourcePath = sourcePath;
+  task.targetName = BuildTargetName(item, sourcePath);
+
+  m_exportsOutstanding++;
+  {
+    std::lock_guard<std::mutex> lock(m_exportMutex);
+    m_exportTasks.push_back(task);
+  }
+  m_exportCond.notify_one();
+}
+
+void MediaExportJob::DrainExportResults() {
+  std::vector<ExportResult> results;
+  {
+    std::lock_guard<std::mutex> lock(m_exportMutex);
+    results.swap(m_exportResults);
+  }
+
+  for (const auto &result : results) {
+    m_exportsOutstanding--;
+    if (result.success) {
+      m_progress.exported++;
+      m_progress.bytesExported += result.bytes;
+    } else {
+      m_progress.failed++;
+      m_progress.lastError = result.error;
+    }
+  }
+}
+
+void MediaExportJob::FinishIfDone() {
+  if (m_progress.finished || m_progress.scanning || m_pageRequested ||
+      !m_queue.empty() || !m_inFlight.empty() || m_exportsOutstanding > 0) {
+    return;
+  }
+
+  m_pumpTimer.Stop();
+  m_progress.finished = true;
+  NotifyProgress();
+}
+
+void MediaExportJob::NotifyProgress() {
+  if (m_progressCallback) {
+    m_progressCallback(m_progress);
+  }
+}
+
+void MediaExportJob::LoadManifest() {
+  wxFileName manifest(m_targetDir, MANIFEST_NAME);
+  if (!manifest.FileExists())
+    return;
+
+  wxTextFile file;
+  if (!file.Open(manifest.GetFullPath()))
+    return;
+
+  // "<messageId>\t<file name>" per line; only trust entries whose file is
+  // still there, so deleting an exported file re-exports it
+  for (size_t i = 0; i < file.GetLineCount(); i++) {
+    const wxString &line = file.GetLine(i);
+    long long messageId = 0;
+    wxString name = line.AfterFirst('\t');
+    if (!line.BeforeFirst('\t').ToLongLong(&messageId) || name.IsEmpty())
+      continue;
+    if (wxFileName(m_targetDir, name).FileExists()) {
+      m_exportedMessageIds.insert(messageId);
+    }
+  }
+}
+
+wxString MediaExportJob::SanitizeFileName(const wxString &name) {
+  wxString result = name;
+  wxString forbidden = wxFileName::GetForbiddenChars() + "/\\";
+  for (size_t i = 0; i < result.length(); i++) {
+    if (forbidden.Find(result[i]) != wxNOT_FOUND) {
+      result[i] = '_';
+    }
+  }
+  return result;
+}
+
+wxString MediaExportJob::BuildTargetName(const Item &item,
+                                         const wxString &sourcePath) const {
+  wxString name = item.fileName;
+  if (name.IsEmpty()) {
+    name = wxFileName(sourcePath).GetFullName(); // Photos have no name
+  }
+
+  name = SanitizeFileName(name);
+
+  // Date first so the directory sorts chronologically; the message id keeps
+  // names unique and stable across runs
+  wxString date = item.date > 0
+                      ? wxDateTime(static_cast<time_t>(item.date))
+                            .Format("%Y%m%d")
+                      : wxString("00000000");
+  return wxString::Format("%s_%lld_%s", date, (long long)item.messageId,
+                          name);
+}
+
+void MediaExportJob::ExportLoop() {
+  while (true) {
+    ExportTask task;
+    {
+      std::unique_lock<std::mutex> lock(m_exportMutex);
+      m_exportCond.wait(
+          lock, [this]() { return m_stopExport || !m_exportTasks.empty(); });
+      if (m_stopExport)
+        break;
+      task = m_exportTasks.front();
+      m_exportTasks.pop_front();
+    }
+
+    ExportResult result;
+    result.messageId = task.messageId;
+    result.bytes = 0;
+
+    wxString target = wxFileName(m_targetDir, task.targetName).GetFullPath();
+    if (wxFileName::FileExists(target)) {
+      // Written by an earlier run that stopped before updating the manifest
+      // (exports are renamed into place, so it is complete)
+      result.success = true;
+    } else {
+      result.success = ExportFile(task.sourcePath, target, result.error);
+    }
+
+    if (result.success) {
+      wxULongLong size = wxFileName::GetSize(target);
+      if (size != wxInvalidSize) {
+        result.bytes = static_cast<int64_t>(size.GetValue());
+      }
+      AppendManifest(task.messageId, task.targetName);
+    }
+
+    std::lock_guard<std::mutex> lock(m_exportMutex);
+    m_exportResults.push_back(result);
+  }
+}
+
+bool MediaExportJob::ExportFile(const wxString &source, const wxString &target,
+                                wxString &error) {
+  wxLogNull noLog; // Failures are reported through the job progress
+
+  if (!wxFileName::FileExists(source)) {
+    error = "Source file missing: " + source;
+    return false;
+  }
+
+#ifndef __WXMSW__
+  // Same filesystem as TDLib's cache: share the inode, no data is copied,
+  // and the export survives TDLib evicting its copy
+  if (link(source.fn_str(), target.fn_str()) == 0) {
+    return true;
+  }
+#endif
+
+  // Copy under a temporary name so a crash never leaves a truncated file
+  // that a later run would mistake for a finished export
+  wxString partial = target + ".part";
+  bool copied = false;
+#ifdef __linux__
+  copied = CopyWithCopyFileRange(source, partial);
+#endif
+  if (!copied) {
+    copied = wxCopyFile(source, partial, true);
+  }
+  if (!copied || !wxRenameFile(partial, target, false)) {
+    wxRemoveFile(partial);
+    error = "Could not export " + wxFileName(target).GetFullName();
+    return false;
+  }
+  return true;
+}
+
+void MediaExportJob::AppendManifest(int64_t messageId, const wxString &name) {
+  wxFFile manifest(wxFileName(m_targetDir, MANIFEST_NAME).GetFullPath(), "a");
+  if (manifest.IsOpened()) {
+    manifest.Write(wxString::Format("%lld\t%s\n", (long long)messageId, name),
+                   wxConvUTF8);
+  }
+}
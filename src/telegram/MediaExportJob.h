@@ -0,0 +1,167 @@
+#ifndef MEDIAEXPORTJOB_H
+#define MEDIAEXPORTJOB_H
+
+#include <wx/timer.h>
+#include <wx/wx.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "Types.h"
+
+class TelegramClient;
+
+// Snapshot of a media export job, handed to the progress callback
+struct MediaExportProgress {
+  int64_t chatId = 0;
+  wxString chatTitle;
+  wxString targetDir;
+  int found = 0;    // Media messages discovered so far
+  int exported = 0; // Written to the target directory this run
+  int skipped = 0;  // Already exported by an earlier run
+  int failed = 0;
+  int64_t bytesExported = 0;
+  bool scanning = true; // Still paging through the chat history
+  bool finished = false;
+  bool cancelled = false;
+  wxString lastError;
+
+  int GetDone() const { return exported + skipped + failed; }
+  int GetPercent() const {
+    return found > 0 ? static_cast<int>((GetDone() * 100LL) / found) : 0;
+  }
+};
+
+// Archives every photo/video/document of a chat into a directory.
+//
+// The job pages through searchChatMessages (one media filter at a time),
+// keeps at most MAX_IN_FLIGHT downloads queued in TelegramClient, and hands
+// each finished file to a worker thread which exports it into the target
+// directory - a hardlink when TDLib's cache is on the same filesystem,
+// otherwise an in-kernel copy_file_range (Linux), with wxCopyFile as the last
+// resort. Exported messages are appended to a manifest in the target
+// directory, so running the job again resumes where the last run stopped.
+//
+// Lives on the main thread; download state is polled on a timer like the
+// rest of the reactive UI.
+class MediaExportJob : public wxEvtHandler {
+public:
+  using ProgressCallback = std::function<void(const MediaExportProgress &)>;
+
+  MediaExportJob(TelegramClient *client, int64_t chatId,
+                 const wxString &chatTitle, const wxString &targetDir,
+                 const std::vector<SearchMediaFilter> &filters);
+  ~MediaExportJob();
+
+  void SetProgressCallback(ProgressCallback callback) {
+    m_progressCallback = std::move(callback);
+  }
+
+  void Start();
+  void Cancel();
+
+  bool IsFinished() const { return m_progress.finished; }
+  int64_t GetChatId() const { return m_progress.chatId; }
+  const MediaExportProgress &GetProgress() const { return m_progress; }
+
+  // Parse "photos", "videos", "docs", "all"... into search filters
+  static bool ParseFilters(const wxString &spec,
+                           std::vector<SearchMediaFilter> &filters);
+
+  // Replace characters that are not allowed in file names
+  static wxString SanitizeFileName(const wxString &name);
+
+  static constexpr const char *MANIFEST_NAME = ".teleliter-export";
+
+private:
+  struct Item {
+    int64_t messageId = 0;
+    int64_t date = 0;
+    int32_t fileId = 0;
+    wxString fileName;
+    int64_t fileSize = 0;
+  };
+
+  struct ExportTask {
+    int64_t messageId;
+    wxString sourcePath;
+    wxString targetName;
+  };
+
+  struct ExportResult {
+    int64_t messageId;
+    bool success;
+    int64_t bytes;
+    wxString error;
+  };
+
+  void RequestNextPage();
+  void OnPageLoaded(bool success, const std::vector<MessageInfo> &messages,
+                    int64_t nextFromMessageId, const wxString &error);
+  void Pump();
+  void RequestDownload(const Item &item);
+  void OnPumpTimer(wxTimerEvent &event);
+  void QueueExport(const Item &item, const wxString &sourcePath);
+  void DrainExportResults();
+  void FinishIfDone();
+  void NotifyProgress();
+
+  void LoadManifest();
+  wxString BuildTargetName(const Item &item,
+                           const wxString &sourcePath) const;
+
+  // Export worker thread
+  void ExportLoop();
+  static bool ExportFile(const wxString &source, const wxString &target,
+                         wxString &error);
+  void AppendManifest(int64_t messageId, const wxString &name);
+
+  TelegramClient *m_client;
+  const wxString m_targetDir; // Read by the export thread
+  std::vector<SearchMediaFilter> m_filters;
+  size_t m_filterIndex = 0;
+  int64_t m_nextFromMessageId = 0;
+  bool m_pageRequested = false;
+
+  MediaExportProgress m_progress;
+  ProgressCallback m_progressCallback;
+
+  std::set<int64_t> m_seenMessageIds;     // Dedup across filters/pages
+  std::set<int64_t> m_exportedMessageIds; // From the manifest
+  std::deque<Item> m_queue;               // Waiting for a download slot
+  std::map<int32_t, std::vector<Item>> m_inFlight; // fileId -> messages
+  // Downloads this job started, as opposed to ones the chat view or a
+  // popup already had running; only these are cancelled with the job
+  std::set<int32_t> m_ownedDownloads;
+  int m_exportsOutstanding = 0;
+
+  wxTimer m_pumpTimer;
+
+  // Callbacks from TelegramClient may outlive the job - they hold a weak
+  // reference to this token and bail out once it is gone
+  std::shared_ptr<bool> m_alive;
+
+  std::thread m_exportThread;
+  std::mutex m_exportMutex;
+  std::condition_variable m_exportCond;
+  std::deque<ExportTask> m_exportTasks;
+  std::vector<ExportResult> m_exportResults;
+  bool m_stopExport = false;
+
+  static constexpr size_t MAX_IN_FLIGHT = 4;
+  static constexpr int PAGE_SIZE = 100;
+  static constexpr int PUMP_INTERVAL_MS = 500;
+  // Below the chat viewport (12/24) so browsing stays responsive, but high
+  // enough to pass DownloadFile's capacity gate. Still below the startup
+  // cooldown threshold: the job waits the cooldown out
+  static constexpr int DOWNLOAD_PRIORITY = 8;
+};
+
+#endif // MEDIAEXPORTJOB_H
@@ -0,0 +1,366 @@
+#include "MessageSearchIndex.h"
+#include "Types.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+void MessageSearchIndex::Add(const MessageInfo &message) {
+  std::unique_lock<std::shared_mutex> lock(m_mutex);
+  AddLocked(message.chatId, message.id, message.date,
+            GetIndexedText(message));
+  CompactIfNeeded();
+}
+
+void MessageSearchIndex::AddAll(const std::vector<MessageInfo> &messages) {
+  std::unique_lock<std::shared_mutex> lock(m_mutex);
+  for (const auto &message : messages) {
+    AddLocked(message.chatId, message.id, message.date,
+              GetIndexedText(message));
+  }
+  CompactIfNeeded();
+}
+
+void MessageSearchIndex::Remove(int64_t chatId, int64_t messageId) {
+  std::unique_lock<std::shared_mutex> lock(m_mutex);
+  RemoveLocked(chatId, messageId);
+  CompactIfNeeded();
+}
+
+void MessageSearchIndex::UpdateText(int64_t chatId, int64_t messageId,
+                                    const wxString &text) {
+  std::unique_lock<std::shared_mutex> lock(m_mutex);
+  int64_t date = 0;
+  auto it = m_docIds.find({chatId, messageId});
+  if (it != m_docIds.end()) {
+    date = m_docs[it->second].date;
+  }
+  AddLocked(chatId, messageId, date, text);
+  CompactIfNeeded();
+}
+
+void MessageSearchIndex::Rename(int64_t chatId, int64_t oldMessageId,
+                                int64_t newMessageId) {
+  std::unique_lock<std::shared_mutex> lock(m_mutex);
+  auto it = m_docIds.find({chatId, oldMessageId});
+  if (it == m_docIds.end()) {
+    return;
+  }
+  uint32_t docId = it->second;
+  m_docIds.erase(it);
+  RemoveLocked(chatId, newMessageId); // Already indexed under the new id
+  m_docs[docId].messageId = newMessageId;
+  m_docIds[{chatId, newMessageId}] = docId;
+}
+
+void MessageSearchIndex::Clear() {
+  std::unique_lock<std::shared_mutex> lock(m_mutex);
+  m_docs.clear();
+  m_docIds.clear();
+  m_postings.clear();
+  m_aliveCount = 0;
+  m_deadCount = 0;
+}
+
+size_t MessageSearchIndex::GetDocumentCount() const {
+  std::shared_lock<std::shared_mutex> lock(m_mutex);
+  return m_aliveCount;
+}
+
+std::vector<std::string> MessageSearchIndex::Tokenize(const wxString &text) {
+  std::vector<std::string> tokens;
+  wxString lower = text.Lower();
+  wxString current;
+
+  for (wxString::const_iterator it = lower.begin(); it != lower.end(); ++it) {
+    wxUniChar ch = *it;
+    if (wxIsalnum(static_cast<wchar_t>(ch.GetValue())) || ch == '_') {
+      if (current.length() < MAX_TOKEN_LENGTH) {
+        current += ch;
+      }
+    } else if (!current.IsEmpty()) {
+      tokens.push_back(std::string(current.ToUTF8()));
+      current.clear();
+    }
+  }
+  if (!current.IsEmpty()) {
+    tokens.push_back(std::string(current.ToUTF8()));
+  }
+  return tokens;
+}
+
+wxString MessageSearchIndex::GetIndexedText(const MessageInfo &message) {
+  wxString text = message.text;
+  if (!message.mediaCaption.IsEmpty() && message.mediaCaption != text) {
+    text += "\n" + message.mediaCaption;
+  }
+  if (!message.mediaFileName.IsEmpty()) {
+    text += "\n" + message.mediaFileName;
+  }
+  return text;
+}
+
+void MessageSearchIndex::AddLocked(int64_t chatId, int64_t messageId,
+                                   int64_t date, const wxString &text) {
+  std::string utf8(text.ToUTF8());
+  size_t textHash = std::hash<std::string>()(utf8);
+
+  auto existing = m_docIds.find({chatId, messageId});
+  if (existing != m_docIds.end()) {
+    Document &doc = m_docs[existing->second];
+    if (doc.textHash == textHash) {
+      if (date != 0) {
+        doc.date = date;
+      }
+      return; // Seen again (history reload) - nothing changed
+    }
+    RemoveLocked(chatId, messageId);
+  }
+
+  std::vector<std::string> tokens = Tokenize(text);
+  if (tokens.empty()) {
+    return; // Media without caption, service messages...
+  }
+  std::sort(tokens.begin(), tokens.end());
+  tokens.erase(std::unique(tokens.begin(), tokens.end()), tokens.end());
+
+  uint32_t docId = static_cast<uint32_t>(m_docs.size());
+  Document doc;
+  doc.chatId = chatId;
+  doc.messageId = messageId;
+  doc.date = date;
+  doc.textHash = textHash;
+  doc.alive = true;
+  wxString preview = text.Left(PREVIEW_LENGTH);
+  preview.Replace("\n", " ");
+  doc.preview = std::string(preview.ToUTF8());
+  m_docs.push_back(std::move(doc));
+  m_docIds[{chatId, messageId}] = docId;
+  m_aliveCount++;
+
+  // Doc ids only grow, so appending keeps every posting list sorted
+  for (const auto &token : tokens) {
+    m_postings[token].push_back(docId);
+  }
+}
+
+void MessageSearchIndex::RemoveLocked(int64_t chatId, int64_t messageId) {
+  auto it = m_docIds.find({chatId, messageId});
+  if (it == m_docIds.end()) {
+    return;
+  }
+  Document &doc = m_docs[it->second];
+  doc.alive = false;
+  std::string().swap(doc.preview);
+  m_docIds.erase(it);
+  m_aliveCount--;
+  m_deadCount++;
+}
+
+void MessageSearchIndex::CompactIfNeeded() {
+  if (m_deadCount < COMPACT_MIN_DEAD || m_deadCount < m_aliveCount) {
+    return;
+  }
+
+  // Renumber the live documents in order; keeping the order keeps every
+  // posting list sorted without a re-sort
+  const uint32_t DEAD = UINT32_MAX;
+  std::vector<uint32_t> remap(m_docs.size(), DEAD);
+  std::vector<Document> docs;
+  docs.reserve(m_aliveCount);
+  for (size_t docId = 0; docId < m_docs.size(); ++docId) {
+    if (m_docs[docId].alive) {
+      remap[docId] = static_cast<uint32_t>(docs.size());
+      docs.push_back(std::move(m_docs[docId]));
+    }
+  }
+  m_docs.swap(docs);
+
+  for (auto &[key, docId] : m_docIds) {
+    docId = remap[docId];
+  }
+
+  for (auto it = m_postings.begin(); it != m_postings.end();) {
+    auto &list = it->second;
+    size_t kept = 0;
+    for (uint32_t docId : list) {
+      if (remap[docId] != DEAD) {
+        list[kept++] = remap[docId];
+      }
+    }
+    list.resize(kept);
+    if (list.empty()) {
+      it = m_postings.erase(it);
+    } else {
+      list.shrink_to_fit();
+      ++it;
+    }
+  }
+  m_deadCount = 0;
+}
+
+std::vector<MessageSearchHit>
+MessageSearchIndex::Search(const wxString &query, size_t limit,
+                           int64_t chatId) const {
+  std::vector<MessageSearchHit> hits;
+
+  // Split into terms; "foo*" and the word being typed are prefix matches
+  struct Term {
+    std::string text;
+    bool prefix;
+  };
+  std::vector<Term> terms;
+  wxString piece;
+  auto flushPiece = [&terms, &piece]() {
+    if (piece.IsEmpty()) {
+      return;
+    }
+    bool star = piece.EndsWith("*");
+    for (auto &token : Tokenize(piece)) {
+      terms.push_back({std::move(token), star});
+    }
+    piece.clear();
+  };
+  for (wxString::const_iterator it = query.begin(); it != query.end(); ++it) {
+    if (wxIsspace(static_cast<wchar_t>((*it).GetValue()))) {
+      flushPiece();
+    } else {
+      piece += *it;
+    }
+  }
+  bool typing = !piece.IsEmpty();
+  flushPiece();
+  if (terms.empty()) {
+    return hits;
+  }
+  if (typing) {
+    terms.back().prefix = true;
+  }
+  for (auto &term : terms) {
+    size_t characters = 0;
+    for (char c : term.text) {
+      if ((static_cast<unsigned char>(c) & 0xC0) != 0x80) {
+        characters++;
+      }
+    }
+    if (characters < MIN_PREFIX_LENGTH) {
+      term.prefix = false;
+    }
+  }
+
+  std::shared_lock<std::shared_mutex> lock(m_mutex);
+
+  double docCount = static_cast<double>(std::max<size_t>(m_aliveCount, 1));
+  auto idf = [docCount](size_t df) {
+    return static_cast<float>(
+        std::log(1.0 + docCount / static_cast<double>(std::max<size_t>(df, 1))));
+  };
+
+  // Per term: (doc id, weight) sorted by doc id
+  using Postings = std::vector<std::pair<uint32_t, float>>;
+  std::vector<Postings> perTerm;
+  perTerm.reserve(terms.size());
+
+  for (const auto &term : terms) {
+    Postings postings;
+    if (term.prefix) {
+      for (auto it = m_postings.lower_bound(term.text);
+           it != m_postings.end() &&
+           it->first.compare(0, term.text.size(), term.text) == 0;
+           ++it) {
+        // A completed word ranks above a mere prefix of a longer one
+        float weight = idf(it->second.size()) *
+                       (it->first.size() == term.text.size() ? 1.0f : 0.6f);
+        for (uint32_t docId : it->second) {
+          postings.emplace_back(docId, weight);
+        }
+      }
+      std::sort(postings.begin(), postings.end(),
+                [](const auto &a, const auto &b) {
+                  return a.first < b.first ||
+                         (a.first == b.first && a.second > b.second);
+                });
+      // Keep the best-weighted match per document
+      postings.erase(std::unique(postings.begin(), postings.end(),
+                                 [](const auto &a, const auto &b) {
+                                   return a.first == b.first;
+                                 }),
+                     postings.end());
+    } else {
+      auto it = m_postings.find(term.text);
+      if (it != m_postings.end()) {
+        float weight = idf(it->second.size());
+        postings.reserve(it->second.size());
+        for (uint32_t docId : it->second) {
+          postings.emplace_back(docId, weight);
+        }
+      }
+    }
+
+    if (postings.empty()) {
+      return hits; // AND semantics - one missing term means no hits
+    }
+    perTerm.push_back(std::move(postings));
+  }
+
+  // Intersect starting from the rarest term
+  std::sort(perTerm.begin(), perTerm.end(),
+            [](const Postings &a, const Postings &b) {
+              return a.size() < b.size();
+            });
+  Postings result = std::move(perTerm.front());
+  for (size_t t = 1; t < perTerm.size() && !result.empty(); ++t) {
+    const Postings &other = perTerm[t];
+    Postings merged;
+    size_t i = 0, j = 0;
+    while (i < result.size() && j < other.size()) {
+      if (result[i].first < other[j].first) {
+        ++i;
+      } else if (other[j].first < result[i].first) {
+        ++j;
+      } else {
+        merged.emplace_back(result[i].first,
+                            result[i].second + other[j].second);
+        ++i;
+        ++j;
+      }
+    }
+    result.swap(merged);
+  }
+
+  hits.reserve(std::min(result.size(), limit * 2));
+  for (const auto &[docId, score] : result) {
+    const Document &doc = m_docs[docId];
+    if (!doc.alive || (chatId != 0 && doc.chatId != chatId)) {
+      continue;
+    }
+    MessageSearchHit hit;
+    hit.chatId = doc.chatId;
+    hit.messageId = doc.messageId;
+    hit.date = doc.date;
+    hit.score = score;
+    hits.push_back(hit);
+  }
+
+  auto better = [](const MessageSearchHit &a, const MessageSearchHit &b) {
+    if (a.score != b.score) {
+      return a.score > b.score;
+    }
+    return a.date > b.date;
+  };
+  if (hits.size() > limit) {
+    std::partial_sort(hits.begin(), hits.begin() + limit, hits.end(), better);
+    hits.resize(limit);
+  } else {
+    std::sort(hits.begin(), hits.end(), better);
+  }
+
+  // Only the returned hits pay for the UTF-8 conversion
+  for (auto &hit : hits) {
+    auto it = m_docIds.find({hit.chatId, hit.messageId});
+    if (it != m_docIds.end()) {
+      hit.preview = wxString::FromUTF8(m_docs[it->second].preview);
+    }
+  }
+  return hits;
+}
@@ -0,0 +1,103 @@
+#ifndef MESSAGESEARCHINDEX_H
+#define MESSAGESEARCHINDEX_H
+
+#include <wx/wx.h>
+
+#include <cstdint>
+#include <map>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct MessageInfo;
+
+struct MessageSearchHit {
+  int64_t chatId = 0;
+  int64_t messageId = 0;
+  int64_t date = 0;
+  wxString preview;
+  float score = 0.0f;
+};
+
+// In-memory inverted index over the text of every message the client has
+// seen (token -> posting list of documents). Queries AND their terms; the
+// last term is a prefix match so results can follow the user's typing, and
+// "term*" forces a prefix match anywhere. Prefixes shorter than
+// MIN_PREFIX_LENGTH characters match whole words only; expanding them would
+// walk most of the index on every keystroke. Hits are ranked by an idf-weighted
+// score (exact matches weigh more than prefix matches), newest first on ties.
+//
+// Documents are append-only: edits and deletions tombstone the old document.
+// Once tombstones make up half of the documents, the index is compacted:
+// live documents are renumbered and the dead ones dropped from both the
+// document table and the posting lists. Thread-safe; searches only take a
+// shared lock.
+class MessageSearchIndex {
+public:
+  // Index or re-index a message; unchanged text is a no-op
+  void Add(const MessageInfo &message);
+  void AddAll(const std::vector<MessageInfo> &messages);
+  void Remove(int64_t chatId, int64_t messageId);
+  void UpdateText(int64_t chatId, int64_t messageId, const wxString &text);
+  // Sent messages get their server id once the send succeeds
+  void Rename(int64_t chatId, int64_t oldMessageId, int64_t newMessageId);
+  void Clear();
+
+  // chatId limits the hits to one chat; 0 searches every chat
+  std::vector<MessageSearchHit> Search(const wxString &query, size_t limit,
+                                       int64_t chatId = 0) const;
+
+  size_t GetDocumentCount() const;
+
+  // Lowercased alphanumeric runs, UTF-8 encoded
+  static std::vector<std::string> Tokenize(const wxString &text);
+
+private:
+  struct Document {
+    int64_t chatId = 0;
+    int64_t messageId = 0;
+    int64_t date = 0;
+    size_t textHash = 0;
+    std::string preview; // UTF-8, truncated
+    bool alive = false;
+  };
+
+  struct DocKey {
+    int64_t chatId;
+    int64_t messageId;
+    bool operator==(const DocKey &other) const {
+      return chatId == other.chatId && messageId == other.messageId;
+    }
+  };
+
+  struct DocKeyHash {
+    size_t operator()(const DocKey &key) const {
+      return std::hash<int64_t>()(key.chatId) * 31 +
+             std::hash<int64_t>()(key.messageId);
+    }
+  };
+
+  // Caller holds the unique lock
+  void AddLocked(int64_t chatId, int64_t messageId, int64_t date,
+                 const wxString &text);
+  void RemoveLocked(int64_t chatId, int64_t messageId);
+  void CompactIfNeeded();
+
+  static wxString GetIndexedText(const MessageInfo &message);
+
+  std::vector<Document> m_docs; // Indexed by document id
+  std::unordered_map<DocKey, uint32_t, DocKeyHash> m_docIds;
+  // Sorted by term for prefix scans; posting lists are ascending doc ids
+  std::map<std::string, std::vector<uint32_t>> m_postings;
+  size_t m_aliveCount = 0;
+  size_t m_deadCount = 0; // Tombstones in m_docs
+  mutable std::shared_mutex m_mutex;
+
+  static constexpr size_t PREVIEW_LENGTH = 160;
+  static constexpr size_t MAX_TOKEN_LENGTH = 64;
+  static constexpr size_t COMPACT_MIN_DEAD = 4096;
+  static constexpr size_t MIN_PREFIX_LENGTH = 3; // Characters, not bytes
+};
+
+#endif // MESSAGESEARCHINDEX_H
@@ -0,0 +1,185 @@
+#include "NickIndex.h"
+#include "QuickSwitchIndex.h"
+#include "Types.h"
+
+#include <algorithm>
+
+void NickIndex::AddMember(const UserInfo &user) {
+  if (user.isSelf || user.id == 0) {
+    return;
+  }
+  Upsert(user.id, user.GetDisplayName(), user.username, 0);
+}
+
+void NickIndex::AddMembers(const std::vector<UserInfo> &users) {
+  m_entries.reserve(m_entries.size() + users.size());
+  m_keys.reserve(m_keys.size() + users.size() * 2);
+  for (const auto &user : users) {
+    AddMember(user);
+  }
+}
+
+void NickIndex::AddSender(const MessageInfo &message) {
+  if (message.isOutgoing || message.senderId == 0) {
+    return;
+  }
+  Upsert(message.senderId, message.senderName, wxString(), message.date);
+}
+
+void NickIndex::Clear() {
+  m_entries.clear();
+  m_entryById.clear();
+  m_keys.clear();
+  m_sortedKeys = 0;
+  m_staleKeys = 0;
+  m_nextSequence = 0;
+}
+
+void NickIndex::Upsert(int64_t id, const wxString &displayName,
+                       const wxString &username, int64_t activity) {
+  auto found = m_entryById.find(id);
+  if (found == m_entryById.end()) {
+    if (displayName.IsEmpty() && username.IsEmpty()) {
+      return;
+    }
+    uint32_t index = static_cast<uint32_t>(m_entries.size());
+    Entry entry;
+    entry.id = id;
+    entry.displayName = displayName;
+    entry.username = username;
+    entry.lastActive = activity;
+    entry.sequence = m_nextSequence++;
+    m_entries.push_back(std::move(entry));
+    m_entryById[id] = index;
+    AddKey(displayName, index, false);
+    AddKey(username, index, true);
+    return;
+  }
+
+  Entry &entry = m_entries[found->second];
+  entry.lastActive = std::max(entry.lastActive, activity);
+
+  // Senders carry no username; an empty field never erases a known one
+  bool nameChanged = !displayName.IsEmpty() && displayName != entry.displayName;
+  bool usernameChanged = !username.IsEmpty() && username != entry.username;
+  if (!nameChanged && !usernameChanged) {
+    return;
+  }
+
+  // Rename: retire both old keys instead of searching for them
+  m_staleKeys += (entry.displayName.IsEmpty() ? 0 : 1) +
+                 (entry.username.IsEmpty() ? 0 : 1);
+  entry.generation++;
+  if (nameChanged) {
+    entry.displayName = displayName;
+  }
+  if (usernameChanged) {
+    entry.username = username;
+  }
+  AddKey(entry.displayName, found->second, false);
+  AddKey(entry.username, found->second, true);
+}
+
+void NickIndex::AddKey(const wxString &text, uint32_t entry,
+                       bool isUsername) {
+  if (text.IsEmpty()) {
+    return;
+  }
+  Key key;
+  key.text = QuickSwitchIndex::Fold(text);
+  key.entry = entry;
+  key.generation = m_entries[entry].generation;
+  key.isUsername = isUsername;
+  m_keys.push_back(std::move(key));
+}
+
+void NickIndex::MergePending() {
+  auto byText = [](const Key &a, const Key &b) { return a.text < b.text; };
+
+  if (m_staleKeys > m_keys.size() / 2) {
+    m_keys.erase(std::remove_if(m_keys.begin(), m_keys.end(),
+                                [this](const Key &key) {
+                                  return key.generation !=
+                                         m_entries[key.entry].generation;
+                                }),
+                 m_keys.end());
+    m_staleKeys = 0;
+    std::sort(m_keys.begin(), m_keys.end(), byText);
+    m_sortedKeys = m_keys.size();
+    return;
+  }
+
+  if (m_sortedKeys == m_keys.size()) {
+    return;
+  }
+  // A member page or a few senders: sort just the tail and merge it in
+  auto middle = m_keys.begin() + m_sortedKeys;
+  std::sort(middle, m_keys.end(), byText);
+  std::inplace_merge(m_keys.begin(), middle, m_keys.end(), byText);
+  m_sortedKeys = m_keys.size();
+}
+
+std::vector<wxString> NickIndex::Complete(const wxString &prefix,
+                                          size_t limit) {
+  std::vector<wxString> names;
+
+  bool usernameOnly = prefix.StartsWith("@");
+  std::wstring folded =
+      QuickSwitchIndex::Fold(usernameOnly ? prefix.Mid(1) : prefix);
+  if (folded.empty() || limit == 0) {
+    return names;
+  }
+
+  MergePending();
+
+  auto first = std::lower_bound(
+      m_keys.begin(), m_keys.end(), folded,
+      [](const Key &key, const std::wstring &text) { return key.text < text; });
+
+  auto moreRecent = [this](uint32_t a, uint32_t b) {
+    const Entry &left = m_entries[a];
+    const Entry &right = m_entries[b];
+    if (left.lastActive != right.lastActive) {
+      return left.lastActive > right.lastActive;
+    }
+    return left.sequence < right.sequence;
+  };
+
+  // A one-letter prefix in a large group spans thousands of keys; only the
+  // best `limit` entries are kept, as a heap with the least recent on top
+  std::vector<uint32_t> matches;
+  matches.reserve(limit);
+  for (auto it = first; it != m_keys.end() &&
+                        it->text.compare(0, folded.size(), folded) == 0;
+       ++it) {
+    if (it->generation != m_entries[it->entry].generation) {
+      continue;
+    }
+    if (usernameOnly && !it->isUsername) {
+      continue;
+    }
+    uint32_t entry = it->entry;
+    if (matches.size() == limit && !moreRecent(entry, matches.front())) {
+      continue;
+    }
+    // Name and username may both match the prefix
+    if (std::find(matches.begin(), matches.end(), entry) != matches.end()) {
+      continue;
+    }
+    if (matches.size() == limit) {
+      std::pop_heap(matches.begin(), matches.end(), moreRecent);
+      matches.back() = entry;
+    } else {
+      matches.push_back(entry);
+    }
+    std::push_heap(matches.begin(), matches.end(), moreRecent);
+  }
+  std::sort_heap(matches.begin(), matches.end(), moreRecent);
+
+  names.reserve(matches.size());
+  for (uint32_t index : matches) {
+    const Entry &entry = m_entries[index];
+    names.push_back(usernameOnly ? "@" + entry.username : entry.displayName);
+  }
+  return names;
+}
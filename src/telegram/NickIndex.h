@@ -0,0 +1,69 @@
+#ifndef NICKINDEX_H
+#define NICKINDEX_H
+
+#include <wx/wx.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct MessageInfo;
+struct UserInfo;
+
+// Names that Tab can complete in one chat: display names and usernames of
+// loaded members and of everyone seen posting. Keys are folded like the quick
+// switcher's and kept in a sorted array, so a prefix resolves to one
+// contiguous range with two binary searches and no UI control is consulted.
+// New names go to an unsorted tail that is merged in on the next lookup.
+//
+// Matches are ordered HexChat style: whoever spoke most recently first,
+// members that never spoke after them in load order.
+//
+// Not thread-safe; owned and used by the UI thread.
+class NickIndex {
+public:
+  void AddMember(const UserInfo &user);
+  void AddMembers(const std::vector<UserInfo> &users);
+  // Records the sender and bumps their activity to the message date
+  void AddSender(const MessageInfo &message);
+
+  // Names starting with prefix, most recently active first. A leading '@'
+  // completes usernames ("@name"); otherwise display names are returned,
+  // matched on either the name or the username.
+  std::vector<wxString> Complete(const wxString &prefix, size_t limit);
+
+  size_t GetSize() const { return m_entries.size(); }
+  void Clear();
+
+private:
+  struct Entry {
+    int64_t id = 0;
+    wxString displayName;
+    wxString username;
+    int64_t lastActive = 0;  // Date of their latest message seen, 0 if none
+    uint64_t sequence = 0;   // Insertion order, breaks activity ties
+    uint32_t generation = 0; // Bumped on rename; older keys are stale
+  };
+
+  struct Key {
+    std::wstring text;
+    uint32_t entry = 0;
+    uint32_t generation = 0;
+    bool isUsername = false;
+  };
+
+  void Upsert(int64_t id, const wxString &displayName,
+              const wxString &username, int64_t activity);
+  void AddKey(const wxString &text, uint32_t entry, bool isUsername);
+  void MergePending();
+
+  std::vector<Entry> m_entries;
+  std::unordered_map<int64_t, uint32_t> m_entryById;
+  std::vector<Key> m_keys; // Sorted by text up to m_sortedKeys
+  size_t m_sortedKeys = 0;
+  size_t m_staleKeys = 0;
+  uint64_t m_nextSequence = 0;
+};
+
+#endif // NICKINDEX_H
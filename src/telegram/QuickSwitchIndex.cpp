@@ -0,0 +1,260 @@
+#include "QuickSwitchIndex.h"
+#include "Types.h"
+
+#include <algorithm>
+#include <cwctype>
+#include <set>
+
+namespace {
+
+// U+00C0..U+00FF; '*' keeps the character as is
+const char LATIN1_FOLD[] =
+    "aaaaaaaceeeeiiiidnooooo*ouuuuy*s"  // U+00C0..U+00DF
+    "aaaaaaaceeeeiiiidnooooo*ouuuuy*y"; // U+00E0..U+00FF
+
+// U+0100..U+017F (Latin Extended-A)
+const std::string &LatinExtendedAFold() {
+  static const std::string table =
+      std::string(6, 'a') + std::string(8, 'c') + std::string(4, 'd') +
+      std::string(10, 'e') + std::string(8, 'g') + std::string(4, 'h') +
+      std::string(12, 'i') + std::string(2, 'j') + std::string(3, 'k') +
+      std::string(10, 'l') + std::string(9, 'n') + std::string(8, 'o') +
+      std::string(6, 'r') + std::string(8, 's') + std::string(6, 't') +
+      std::string(12, 'u') + std::string(2, 'w') + std::string(3, 'y') +
+      std::string(6, 'z') + std::string(1, 's');
+  return table;
+}
+
+bool IsBoundary(wchar_t ch) {
+  return ch == L' ' || ch == L'_' || ch == L'-' || ch == L'.' || ch == L'@' ||
+         ch == L'(' || ch == L'[' || ch == L'|' || ch == L'/';
+}
+
+} // namespace
+
+std::wstring QuickSwitchIndex::Fold(const wxString &text) {
+  std::wstring folded;
+  folded.reserve(text.length());
+  const std::string &extendedA = LatinExtendedAFold();
+
+  for (wxString::const_iterator it = text.begin(); it != text.end(); ++it) {
+    wchar_t ch = static_cast<wchar_t>(std::towlower(
+        static_cast<wint_t>(static_cast<wchar_t>((*it).GetValue()))));
+    if (ch >= 0xC0 && ch <= 0xFF) {
+      char ascii = LATIN1_FOLD[ch - 0xC0];
+      if (ascii != '*') {
+        ch = static_cast<wchar_t>(ascii);
+      }
+    } else if (ch >= 0x100 && ch <= 0x17F) {
+      ch = static_cast<wchar_t>(extendedA[ch - 0x100]);
+    }
+    folded += ch;
+  }
+  return folded;
+}
+
+uint64_t QuickSwitchIndex::CharMask(const std::wstring &text) {
+  // a-z and 0-9 get a bit each, everything else shares 28 hashed bits
+  uint64_t mask = 0;
+  for (wchar_t ch : text) {
+    if (ch >= L'a' && ch <= L'z') {
+      mask |= uint64_t(1) << (ch - L'a');
+    } else if (ch >= L'0' && ch <= L'9') {
+      mask |= uint64_t(1) << (26 + (ch - L'0'));
+    } else if (ch != L' ') {
+      mask |= uint64_t(1) << (36 + static_cast<uint32_t>(ch) % 28);
+    }
+  }
+  return mask;
+}
+
+void QuickSwitchIndex::Build(const std::map<int64_t, ChatInfo> &chats,
+                             const std::map<int64_t, UserInfo> &users) {
+  m_entries.clear();
+  m_keys.clear();
+  m_entries.reserve(chats.size() + users.size());
+
+  std::set<int64_t> usersWithChat;
+
+  for (const auto &[chatId, chat] : chats) {
+    QuickSwitchEntry entry;
+    entry.chatId = chatId;
+    entry.title = chat.title;
+    entry.lastActivity = chat.lastMessageDate;
+    entry.unreadCount = chat.unreadCount;
+    entry.isPinned = chat.isPinned;
+    if (chat.isChannel) {
+      entry.kind = "channel";
+    } else if (chat.isGroup || chat.isSupergroup) {
+      entry.kind = "group";
+    } else if (chat.isBot) {
+      entry.kind = "bot";
+    } else if (chat.isPrivate) {
+      entry.kind = "private";
+    } else {
+      entry.kind = "chat";
+    }
+
+    if (chat.isPrivate && chat.userId != 0) {
+      entry.userId = chat.userId;
+      usersWithChat.insert(chat.userId);
+      auto user = users.find(chat.userId);
+      if (user != users.end()) {
+        entry.username = user->second.username;
+      }
+    }
+    m_entries.push_back(std::move(entry));
+  }
+
+  // People seen in groups but never talked to - selecting one creates the
+  // private chat
+  for (const auto &[userId, user] : users) {
+    if (user.isSelf || usersWithChat.count(userId) > 0) {
+      continue;
+    }
+    QuickSwitchEntry entry;
+    entry.userId = userId;
+    entry.title = user.GetDisplayName();
+    entry.username = user.username;
+    entry.kind = user.isBot ? "bot" : "user";
+    entry.lastActivity = user.lastSeenTime;
+    m_entries.push_back(std::move(entry));
+  }
+
+  m_keys.reserve(m_entries.size());
+  for (const auto &entry : m_entries) {
+    Key key;
+    key.title = Fold(entry.title);
+    key.username = Fold(entry.username);
+    key.titleMask = CharMask(key.title);
+    key.usernameMask = CharMask(key.username);
+    m_keys.push_back(std::move(key));
+  }
+}
+
+int QuickSwitchIndex::ScoreKey(const std::wstring &key,
+                               const std::wstring &query) {
+  if (query.size() > key.size()) {
+    return -1;
+  }
+
+  int queryLength = static_cast<int>(query.size());
+
+  // Contiguous hit - the best kind, better still at a word start
+  size_t pos = key.find(query);
+  if (pos != std::wstring::npos) {
+    int score = SCORE_MATCH * queryLength +
+                BONUS_CONSECUTIVE * (queryLength - 1) + BONUS_SUBSTRING;
+    if (pos == 0) {
+      score += BONUS_PREFIX;
+      if (query.size() == key.size()) {
+        score += BONUS_EXACT;
+      }
+    } else if (IsBoundary(key[pos - 1])) {
+      score += BONUS_BOUNDARY;
+    }
+    return score;
+  }
+
+  // Scattered hit ("jdo" in "john doe"): greedy left-to-right subsequence,
+  // rewarding word starts and runs, penalising gaps
+  int score = 0;
+  size_t queryPos = 0;
+  size_t lastMatch = std::wstring::npos;
+  for (size_t i = 0; i < key.size() && queryPos < query.size(); ++i) {
+    if (key[i] != query[queryPos]) {
+      continue;
+    }
+    score += SCORE_MATCH;
+    if (i == 0 || IsBoundary(key[i - 1])) {
+      score += BONUS_BOUNDARY;
+    }
+    if (lastMatch != std::wstring::npos) {
+      if (i == lastMatch + 1) {
+        score += BONUS_CONSECUTIVE;
+      } else {
+        score -= std::min<int>(static_cast<int>(i - lastMatch - 1),
+                               MAX_GAP_PENALTY);
+      }
+    }
+    lastMatch = i;
+    queryPos++;
+  }
+  return queryPos == query.size() ? score : -1;
+}
+
+int QuickSwitchIndex::RankBonus(const QuickSwitchEntry &entry, int64_t now) {
+  int bonus = 0;
+  if (entry.chatId != 0) {
+    bonus += 6; // An existing conversation beats a stranger
+  }
+  if (entry.unreadCount > 0) {
+    bonus += 12;
+  }
+  if (entry.isPinned) {
+    bonus += 6;
+  }
+  if (entry.lastActivity > 0 && now >= entry.lastActivity) {
+    int64_t age = now - entry.lastActivity;
+    if (age < 3600) {
+      bonus += 24;
+    } else if (age < 86400) {
+      bonus += 16;
+    } else if (age < 7 * 86400) {
+      bonus += 8;
+    } else if (age < 30 * 86400) {
+      bonus += 4;
+    }
+  }
+  return bonus;
+}
+
+std::vector<QuickSwitchHit> QuickSwitchIndex::Search(const wxString &query,
+                                                     size_t limit,
+                                                     int64_t now) const {
+  wxString trimmed = query;
+  trimmed.Trim().Trim(false);
+  bool usernameOnly = trimmed.StartsWith("@");
+  if (usernameOnly) {
+    trimmed = trimmed.Mid(1);
+  }
+
+  // Spaces only separate words - the subsequence match bridges them
+  std::wstring folded = Fold(trimmed);
+  folded.erase(std::remove(folded.begin(), folded.end(), L' '), folded.end());
+  uint64_t queryMask = CharMask(folded);
+
+  std::vector<QuickSwitchHit> hits;
+  for (size_t i = 0; i < m_entries.size(); ++i) {
+    const Key &key = m_keys[i];
+    int best = -1;
+    if (folded.empty()) {
+      best = 0;
+    } else {
+      if (!usernameOnly && (queryMask & ~key.titleMask) == 0) {
+        best = ScoreKey(key.title, folded);
+      }
+      if (!key.username.empty() && (queryMask & ~key.usernameMask) == 0) {
+        best = std::max(best, ScoreKey(key.username, folded));
+      }
+    }
+    if (best < 0) {
+      continue;
+    }
+    hits.push_back({i, best + RankBonus(m_entries[i], now)});
+  }
+
+  auto better = [this](const QuickSwitchHit &a, const QuickSwitchHit &b) {
+    if (a.score != b.score) {
+      return a.score > b.score;
+    }
+    return m_entries[a.index].lastActivity > m_entries[b.index].lastActivity;
+  };
+  if (hits.size() > limit) {
+    std::partial_sort(hits.begin(), hits.begin() + limit, hits.end(), better);
+    hits.resize(limit);
+  } else {
+    std::sort(hits.begin(), hits.end(), better);
+  }
+  return hits;
+}
@@ -0,0 +1,81 @@
+#ifndef QUICKSWITCHINDEX_H
+#define QUICKSWITCHINDEX_H
+
+#include <wx/wx.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+struct ChatInfo;
+struct UserInfo;
+
+struct QuickSwitchEntry {
+  int64_t chatId = 0; // 0 for a user without a private chat yet
+  int64_t userId = 0; // Private chats and users
+  wxString title;
+  wxString username; // Without the '@'
+  wxString kind;     // "channel", "group", "bot", "user"...
+  int64_t lastActivity = 0;
+  int32_t unreadCount = 0;
+  bool isPinned = false;
+};
+
+struct QuickSwitchHit {
+  size_t index = 0; // Into the index entries
+  int score = 0;
+};
+
+// Fuzzy lookup over every chat and known user for the quick switcher
+// (Ctrl+K). Titles and usernames are lowercased and folded to ASCII once at
+// build time (é -> e, Ł -> l) together with a bitmask of the characters they
+// contain, so a query rejects most entries with one AND and scores the rest
+// with a single pass over the key. Ranking adds recency, unread and pinned
+// bonuses to the match score.
+//
+// Not thread-safe; owned and used by the UI thread.
+class QuickSwitchIndex {
+public:
+  void Build(const std::map<int64_t, ChatInfo> &chats,
+             const std::map<int64_t, UserInfo> &users);
+
+  // Best hits first. An empty query lists the most relevant entries;
+  // "@name" only matches usernames.
+  std::vector<QuickSwitchHit> Search(const wxString &query, size_t limit,
+                                     int64_t now) const;
+
+  const QuickSwitchEntry &GetEntry(size_t index) const {
+    return m_entries[index];
+  }
+  size_t GetSize() const { return m_entries.size(); }
+
+  // Lowercase and fold Latin letters with diacritics to ASCII
+  static std::wstring Fold(const wxString &text);
+
+private:
+  struct Key {
+    std::wstring title;
+    std::wstring username;
+    uint64_t titleMask = 0;
+    uint64_t usernameMask = 0;
+  };
+
+  static uint64_t CharMask(const std::wstring &text);
+  // -1 when the query is not a subsequence of the key
+  static int ScoreKey(const std::wstring &key, const std::wstring &query);
+  static int RankBonus(const QuickSwitchEntry &entry, int64_t now);
+
+  std::vector<QuickSwitchEntry> m_entries;
+  std::vector<Key> m_keys; // Parallel to m_entries
+
+  static constexpr int SCORE_MATCH = 16;
+  static constexpr int BONUS_BOUNDARY = 12;
+  static constexpr int BONUS_CONSECUTIVE = 8;
+  static constexpr int BONUS_SUBSTRING = 32;
+  static constexpr int BONUS_PREFIX = 32;
+  static constexpr int BONUS_EXACT = 48;
+  static constexpr int MAX_GAP_PENALTY = 8;
+};
+
+#endif // QUICKSWITCHINDEX_H
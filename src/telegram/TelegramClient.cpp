@@ -2,14 +2,23 @@
 #include "../ui/MainFrame.h"
 #include "../ui/MediaTypes.h"
 #include "../ui/WelcomeChat.h"
+#include "WarmSnapshot.h"
 
 #include <algorithm>
+#include <chrono>
 #include <ctime>
 #include <iostream>
 #include <set>
 #include <sstream>
 #include <wx/filename.h>
 
+// Milliseconds on a monotonic clock, for intervals and timer deadlines
+static int64_t SteadyMillis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
 // Helper to check if a file is actually available locally
 // TDLib may report is_downloading_completed_ = true but the file might have
 // been deleted
@@ -37,6 +46,45 @@ static bool IsFileAvailableLocally(const td_api::file *file) {
   return wxFileName::FileExists(wxString::FromUTF8(path));
 }
 
+// How a local file is sent - decides both the message content type and the
+// file type announced to preliminaryUploadFile
+enum class UploadKind { Photo, Video, Audio, Document };
+
+static UploadKind GetUploadKind(const wxString &filePath) {
+  wxString ext = filePath.AfterLast('.').Lower();
+  if (ext == "jpg" || ext == "jpeg" || ext == "png" || ext == "gif" ||
+      ext == "webp") {
+    return UploadKind::Photo;
+  }
+  if (ext == "mp4" || ext == "mkv" || ext == "avi" || ext == "mov" ||
+      ext == "webm") {
+    return UploadKind::Video;
+  }
+  if (ext == "mp3" || ext == "ogg" || ext == "wav" || ext == "flac" ||
+      ext == "m4a") {
+    return UploadKind::Audio;
+  }
+  return UploadKind::Document;
+}
+
+// History order: by date, then id
+static bool MessageBefore(const MessageInfo &a, const MessageInfo &b) {
+  if (a.date != b.date)
+    return a.date < b.date;
+  return a.id < b.id;
+}
+
+// Lowest and highest id of a non-empty page
+static void PageIdRange(const std::vector<MessageInfo> &page, int64_t &first,
+                        int64_t &last) {
+  first = page.front().id;
+  last = page.front().id;
+  for (const auto &msg : page) {
+    first = std::min(first, msg.id);
+    last = std::max(last, msg.id);
+  }
+}
+
 // Debug logging - disabled by default for release
 #define TDLOG(...)                                                             \
   do {                                                                         \
@@ -54,7 +102,9 @@ TelegramClient::TelegramClient()
     : m_clientManager(nullptr), m_clientId(0), m_running(false),
       m_authState(AuthState::WaitTdlibParameters), m_currentQueryId(0),
       m_mainFrame(nullptr), m_welcomeChat(nullptr),
-      m_downloadTimeoutTimer(this), m_startupTime(wxGetUTCTime()) {
+      m_downloadTimeoutTimer(this),
+      m_downloadWatchdog(WATCHDOG_TICK_MS, WATCHDOG_SLOT_COUNT),
+      m_startupTime(wxGetUTCTime()), m_snapshotTimer(this) {
   s_instance = this;
   // Bind to wxTheApp for proper main thread event handling
   if (wxTheApp) {
@@ -65,8 +115,12 @@ TelegramClient::TelegramClient()
   Bind(wxEVT_TIMER, &TelegramClient::OnDownloadTimeoutTimer, this,
        m_downloadTimeoutTimer.GetId());
 
-  // Start download timeout checker (every 10 seconds)
-  m_downloadTimeoutTimer.Start(10000);
+  // Drive the download watchdog wheel
+  m_downloadTimeoutTimer.Start(WATCHDOG_TICK_MS);
+
+  Bind(wxEVT_TIMER, &TelegramClient::OnSnapshotTimer, this,
+       m_snapshotTimer.GetId());
+  m_snapshotTimer.Start(SNAPSHOT_INTERVAL_MS);
 }
 
 TelegramClient::~TelegramClient() {
@@ -74,6 +128,9 @@ TelegramClient::~TelegramClient() {
   m_downloadTimeoutTimer.Stop();
   Unbind(wxEVT_TIMER, &TelegramClient::OnDownloadTimeoutTimer, this,
          m_downloadTimeoutTimer.GetId());
+  m_snapshotTimer.Stop();
+  Unbind(wxEVT_TIMER, &TelegramClient::OnSnapshotTimer, this,
+         m_snapshotTimer.GetId());
 
   Stop();
   if (wxTheApp) {
@@ -278,7 +335,7 @@ void TelegramClient::OnConnectionStateUpdate(
       TDLOG("Connection state: Updating");
       // Enter sync mode - many updates will arrive rapidly
       if (!m_isSyncing.exchange(true)) {
-        m_syncStartTime = wxGetUTCTimeMillis().GetValue();
+        m_syncStartTime = SteadyMillis();
         m_syncUpdateCount = 0;
         TDLOG("Entering sync mode");
       }
@@ -290,16 +347,18 @@ void TelegramClient::OnConnectionStateUpdate(
       // We don't immediately clear it since updates may still be arriving
       if (m_isSyncing.load()) {
         // Schedule sync end check - will be handled by update counting
-        m_syncStartTime = wxGetUTCTimeMillis().GetValue();
+        m_syncStartTime = SteadyMillis();
         TDLOG("Connection ready, will exit sync mode after updates settle");
       }
 
-      // If we have a pending chat load, fetch messages now
-      if (m_pendingChatLoad != 0) {
-        int64_t chatId = m_pendingChatLoad;
-        m_pendingChatLoad = 0;
+      // If we have a pending chat load, fetch messages now (a chat opened
+      // from the warm snapshot waits for authorization too)
+      int64_t chatId = m_authState == AuthState::Ready
+                           ? m_pendingChatLoad.exchange(0)
+                           : 0;
+      if (chatId != 0) {
         TDLOG("Connection ready, loading pending chat %lld", (long long)chatId);
-        FetchChatMessages(chatId);
+        FetchNetworkHistory(chatId);
       }
     }
   });
@@ -394,6 +453,9 @@ void TelegramClient::OnDeleteMessages(int64_t chatId,
                  msgs.end());
     }
   }
+  for (int64_t id : messageIds) {
+    m_searchIndex.Remove(chatId, id);
+  }
 
   // Queue deleted message IDs for UI
   {
@@ -431,6 +493,8 @@ void TelegramClient::OnMessageSendSucceeded(
       }
     }
   }
+  m_searchIndex.Rename(newMsg.chatId, oldMessageId, newId);
+  m_searchIndex.Add(newMsg);
 
   // Queue update for UI with OLD ID so it can find the message
   // The serverMessageId field tells the UI what the new ID should be
@@ -643,6 +707,8 @@ void TelegramClient::HandleAuthWaitTdlibParameters() {
 
 void TelegramClient::HandleAuthWaitPhoneNumber() {
   TDLOG("Ready for phone number, notifying UI...");
+  // The session behind the snapshot is gone
+  DiscardWarmSnapshot();
   PostToMainThread([this]() {
     // Update status bar to show connected
     if (m_mainFrame) {
@@ -713,6 +779,13 @@ void TelegramClient::HandleAuthReady() {
 
            // Load chats
            LoadChats();
+
+           // A chat opened from the warm snapshot before we were authorized
+           int64_t chatId = m_pendingChatLoad.exchange(0);
+           if (chatId != 0) {
+             OpenChat(chatId);
+             FetchChatMessages(chatId);
+           }
          }
        });
 }
@@ -778,6 +851,14 @@ void TelegramClient::ConfigureAutoDownload() {
 
 void TelegramClient::HandleAuthClosed() {
   m_running = false;
+  m_searchIndex.Clear(); // Another account must not find these messages
+  CancelPrefetch();
+  {
+    std::lock_guard<std::mutex> lock(m_prefetchMutex);
+    m_prefetchedPages.clear();
+    m_prefetchedBytes = 0;
+  }
+  WarmSnapshot::Remove(WarmSnapshot::GetPath()); // Nor see this chat list
   PostToMainThread([this]() {
     if (m_mainFrame) {
       m_mainFrame->OnLoggedOut();
@@ -871,6 +952,7 @@ void TelegramClient::LoadChats(int limit) {
       // Error 404 means no more chats to load
       if (error->code_ == 404) {
         m_allChatsLoaded = true;
+        PruneUnconfirmedChats();
         TDLOG("LoadChats: All chats loaded (404 response)");
       }
       m_isLoadingChats = false;
@@ -889,6 +971,7 @@ void TelegramClient::LoadChats(int limit) {
     // If we got fewer chats than requested, we've loaded all
     if (addedChats < (size_t)limit) {
       m_allChatsLoaded = true;
+      PruneUnconfirmedChats();
       TDLOG("LoadChats: All chats loaded (got %zu, requested %d)", addedChats, limit);
     }
 
@@ -911,7 +994,178 @@ void TelegramClient::LoadMoreChats() {
 
 size_t TelegramClient::GetLoadedChatCount() const {
   std::shared_lock<std::shared_mutex> lock(m_dataMutex);
-  return m_chats.size();
+  // Snapshot chats only count once TDLib has reported them
+  return m_chats.size() - m_unconfirmedChatIds.size();
+}
+
+std::vector<MessageInfo>
+TelegramClient::GetCachedMessages(int64_t chatId) const {
+  std::shared_lock<std::shared_mutex> lock(m_dataMutex);
+  auto it = m_messages.find(chatId);
+  if (it == m_messages.end()) {
+    return {};
+  }
+  return it->second;
+}
+
+bool TelegramClient::LoadWarmSnapshot(int64_t *lastChatId) {
+  WarmSnapshotData data;
+  if (!WarmSnapshot::Load(WarmSnapshot::GetPath(), data)) {
+    return false;
+  }
+
+  {
+    std::unique_lock<std::shared_mutex> lock(m_dataMutex);
+    if (!m_chats.empty()) {
+      return false; // TDLib got there first
+    }
+    for (const auto &chat : data.chats) {
+      m_chats[chat.id] = chat;
+      m_unconfirmedChatIds.insert(chat.id);
+    }
+    for (const auto &user : data.users) {
+      m_users[user.id] = user;
+    }
+    for (const auto &[chatId, messages] : data.messages) {
+      m_messages[chatId] = messages;
+    }
+  }
+
+  for (const auto &[chatId, messages] : data.messages) {
+    m_recentChatIds.push_back(chatId);
+    m_searchIndex.AddAll(messages);
+  }
+
+  m_warmStarted = true;
+  if (lastChatId) {
+    *lastChatId = data.lastChatId;
+  }
+  TDLOG("Warm start: %zu chats, %zu users, %zu histories", data.chats.size(),
+        data.users.size(), data.messages.size());
+  return true;
+}
+
+void TelegramClient::SaveWarmSnapshot() {
+  // Never overwrite a good snapshot with a half-started session
+  if (m_authState != AuthState::Ready || m_currentUser.id == 0) {
+    return;
+  }
+
+  WarmSnapshotData data;
+  data.savedAt = wxGetUTCTime();
+  data.selfUserId = m_currentUser.id;
+  data.lastChatId = m_currentChatId;
+
+  {
+    std::shared_lock<std::shared_mutex> lock(m_dataMutex);
+
+    data.chats.reserve(m_chats.size());
+    for (const auto &[chatId, chat] : m_chats) {
+      data.chats.push_back(chat);
+    }
+    // Keep what the top of the chat list shows
+    if (data.chats.size() > SNAPSHOT_MAX_CHATS) {
+      std::partial_sort(data.chats.begin(),
+                        data.chats.begin() + SNAPSHOT_MAX_CHATS,
+                        data.chats.end(),
+                        [](const ChatInfo &a, const ChatInfo &b) {
+                          if (a.isPinned != b.isPinned) {
+                            return a.isPinned;
+                          }
+                          return a.lastMessageDate > b.lastMessageDate;
+                        });
+      data.chats.resize(SNAPSHOT_MAX_CHATS);
+    }
+
+    std::set<int64_t> userIds = {m_currentUser.id};
+    for (const auto &chat : data.chats) {
+      if (chat.userId != 0) {
+        userIds.insert(chat.userId);
+      }
+    }
+
+    for (int64_t chatId : m_recentChatIds) {
+      auto it = m_messages.find(chatId);
+      if (it == m_messages.end() || it->second.empty()) {
+        continue;
+      }
+      size_t count = std::min(SNAPSHOT_MESSAGES_PER_CHAT, it->second.size());
+      std::vector<MessageInfo> tail(it->second.end() - count,
+                                    it->second.end());
+      for (const auto &msg : tail) {
+        userIds.insert(msg.senderId);
+      }
+      data.messages.emplace_back(chatId, std::move(tail));
+    }
+
+    for (int64_t userId : userIds) {
+      auto it = m_users.find(userId);
+      if (it != m_users.end()) {
+        data.users.push_back(it->second);
+      }
+    }
+  }
+
+  if (!WarmSnapshot::Save(WarmSnapshot::GetPath(), data)) {
+    TDLOG("SaveWarmSnapshot: could not write the snapshot");
+  }
+}
+
+void TelegramClient::OnSnapshotTimer(wxTimerEvent &event) {
+  SaveWarmSnapshot();
+}
+
+void TelegramClient::NoteRecentChat(int64_t chatId) {
+  auto it = std::find(m_recentChatIds.begin(), m_recentChatIds.end(), chatId);
+  if (it != m_recentChatIds.end()) {
+    m_recentChatIds.erase(it);
+  }
+  m_recentChatIds.push_front(chatId);
+  if (m_recentChatIds.size() > SNAPSHOT_RECENT_CHATS) {
+    m_recentChatIds.pop_back();
+  }
+}
+
+void TelegramClient::PruneUnconfirmedChats() {
+  {
+    std::unique_lock<std::shared_mutex> lock(m_dataMutex);
+    if (m_unconfirmedChatIds.empty()) {
+      return;
+    }
+    // Left or deleted since the snapshot was taken
+    for (int64_t chatId : m_unconfirmedChatIds) {
+      m_chats.erase(chatId);
+      m_messages.erase(chatId);
+      m_loadedIntervals.erase(chatId);
+    }
+    m_unconfirmedChatIds.clear();
+  }
+  SetDirty(DirtyFlag::ChatList);
+}
+
+void TelegramClient::DiscardWarmSnapshot() {
+  WarmSnapshot::Remove(WarmSnapshot::GetPath());
+  if (!m_warmStarted.exchange(false)) {
+    return;
+  }
+
+  {
+    std::unique_lock<std::shared_mutex> lock(m_dataMutex);
+    m_chats.clear();
+    m_users.clear();
+    m_messages.clear();
+    m_loadedIntervals.clear();
+    m_unconfirmedChatIds.clear();
+  }
+  m_searchIndex.Clear();
+
+  PostToMainThread([this]() {
+    m_recentChatIds.clear();
+    if (m_mainFrame) {
+      m_mainFrame->OnWarmSnapshotDiscarded();
+    }
+  });
+  SetDirty(DirtyFlag::ChatList);
 }
 
 std::map<int64_t, ChatInfo> TelegramClient::GetChats() const {
@@ -940,11 +1194,30 @@ void TelegramClient::OpenChat(int64_t chatId) {
 }
 
 void TelegramClient::OpenChatAndLoadMessages(int64_t chatId) {
-  TDLOG("OpenChatAndLoadMessages called for chatId=%lld (loading 100 messages)",
-        (long long)chatId);
+  TDLOG("OpenChatAndLoadMessages called for chatId=%lld", (long long)chatId);
 
   // Track current chat for download prioritization
   m_currentChatId = chatId;
+  NoteRecentChat(chatId);
+  m_localHistoryChatId = 0;
+  m_chatOpenStartedMs = SteadyMillis();
+
+  // The user has moved on; the guesses are re-made once idle again
+  CancelPrefetch();
+
+  // A prefetched page goes on screen before openChat is even answered
+  if (m_authState == AuthState::Ready && TakePrefetched(chatId)) {
+    std::vector<MessageInfo> cached = GetCachedMessages(chatId);
+    if (!cached.empty()) {
+      m_localHistoryChatId = chatId;
+      NoteFirstMessages(chatId, cached.size(), "prefetched");
+      PostToMainThread([this, chatId, cached]() {
+        if (m_mainFrame) {
+          m_mainFrame->OnMessagesLoaded(chatId, cached);
+        }
+      });
+    }
+  }
 
   // Clear typing users from previous chat
   {
@@ -952,6 +1225,15 @@ void TelegramClient::OpenChatAndLoadMessages(int64_t chatId) {
     m_typingUsers.clear();
   }
 
+  // openChat sent before authorization is dropped; HandleAuthReady opens
+  // the chat once the session is up
+  if (m_authState != AuthState::Ready) {
+    TDLOG("Not authorized yet, delaying openChat for chatId=%lld",
+          (long long)chatId);
+    m_pendingChatLoad = chatId;
+    return;
+  }
+
   // Step 1: Open the chat - this tells TDLib we're viewing this chat
   // and triggers background sync of messages from server
   auto openRequest = td_api::make_object<td_api::openChat>();
@@ -961,14 +1243,10 @@ void TelegramClient::OpenChatAndLoadMessages(int64_t chatId) {
        [this, chatId](td_api::object_ptr<td_api::Object> openResult) {
          TDLOG("openChat completed for chatId=%lld", (long long)chatId);
 
-         // Check if connection is ready - if not, delay message fetch
-         if (m_connectionState != ConnectionState::Ready) {
-           TDLOG("Connection not ready (state=%d), delaying message fetch for "
-                 "chatId=%lld",
-                 (int)m_connectionState, (long long)chatId);
-
-           // Store pending chat ID - will be loaded when connection becomes
-           // Ready
+         // The message database is only open once authorized
+         if (m_authState != AuthState::Ready) {
+           TDLOG("Not authorized yet, delaying message fetch for chatId=%lld",
+                 (long long)chatId);
            m_pendingChatLoad = chatId;
            return;
          }
@@ -977,71 +1255,429 @@ void TelegramClient::OpenChatAndLoadMessages(int64_t chatId) {
        });
 }
 
-void TelegramClient::FetchChatMessages(int64_t chatId) {
-  // Fetch 100 newest messages
+void TelegramClient::RequestNewestHistory(
+    int64_t chatId, bool onlyLocal,
+    std::function<void(bool ok, std::vector<MessageInfo> messages)> done) {
   // from_message_id=0 means "start from the newest message"
   auto historyRequest = td_api::make_object<td_api::getChatHistory>();
   historyRequest->chat_id_ = chatId;
   historyRequest->from_message_id_ = 0;
   historyRequest->offset_ = 0;
-  historyRequest->limit_ = 100;
-  historyRequest->only_local_ = false;
+  historyRequest->limit_ = HISTORY_PAGE_SIZE;
+  historyRequest->only_local_ = onlyLocal;
 
-  TDLOG("Requesting getChatHistory: chatId=%lld from_message_id=0 limit=100",
-        (long long)chatId);
+  TDLOG("Requesting getChatHistory: chatId=%lld limit=%d only_local=%d",
+        (long long)chatId, HISTORY_PAGE_SIZE, (int)onlyLocal);
 
   Send(std::move(historyRequest),
-       [this, chatId](td_api::object_ptr<td_api::Object> result) {
-         TDLOG("getChatHistory response for chatId=%lld result_id=%d",
-               (long long)chatId, result->get_id());
+       [this, chatId, done](td_api::object_ptr<td_api::Object> result) {
+         if (result->get_id() == td_api::error::ID) {
+           auto error = td_api::move_object_as<td_api::error>(result);
+           TDLOG("getChatHistory ERROR for chatId=%lld: %d - %s",
+                 (long long)chatId, error->code_, error->message_.c_str());
+           done(false, {});
+           return;
+         }
+         if (result->get_id() != td_api::messages::ID) {
+           done(false, {});
+           return;
+         }
 
-         if (result->get_id() == td_api::messages::ID) {
-           auto messages = td_api::move_object_as<td_api::messages>(result);
-           TDLOG("Got total_count=%d messages_.size()=%zu",
-                 messages->total_count_, messages->messages_.size());
+         auto messages = td_api::move_object_as<td_api::messages>(result);
+         TDLOG("getChatHistory chatId=%lld total_count=%d size=%zu",
+               (long long)chatId, messages->total_count_,
+               messages->messages_.size());
 
-           std::vector<MessageInfo> msgList;
-           for (auto &msg : messages->messages_) {
-             if (msg) {
-               msgList.push_back(ConvertMessage(msg.get()));
-             }
+         std::vector<MessageInfo> msgList;
+         msgList.reserve(messages->messages_.size());
+         for (auto &msg : messages->messages_) {
+           if (msg) {
+             msgList.push_back(ConvertMessage(msg.get()));
            }
+         }
 
-           // Sort by date/id
-           std::sort(msgList.begin(), msgList.end(),
-                     [](const MessageInfo &a, const MessageInfo &b) {
-                       if (a.date != b.date)
-                         return a.date < b.date;
-                       return a.id < b.id;
-                     });
+         // Sort by date/id
+         std::sort(msgList.begin(), msgList.end(),
+                   [](const MessageInfo &a, const MessageInfo &b) {
+                     if (a.date != b.date)
+                       return a.date < b.date;
+                     return a.id < b.id;
+                   });
+         done(true, std::move(msgList));
+       });
+}
 
-           // Store and display
-           {
-             std::unique_lock<std::shared_mutex> lock(m_dataMutex);
-             m_messages[chatId] = msgList;
-           }
+void TelegramClient::NoteFirstMessages(int64_t chatId, size_t count,
+                                       const char *source) {
+  int64_t started = m_chatOpenStartedMs.exchange(0);
+  if (started == 0) {
+    return; // Already measured for this open
+  }
+  int64_t elapsed = SteadyMillis() - started;
+  TDLOG("Time to first message for chatId=%lld: %lld ms (%zu %s messages)",
+        (long long)chatId, (long long)elapsed, count, source);
+}
 
-           // Mark that this chat might have more messages
-           // We assume there ARE more messages unless we got 0 messages back
-           // (getting fewer than requested just means we hit a sync boundary)
-           {
-             std::lock_guard<std::mutex> lock(m_messageLoadingMutex);
-             // Only mark as "no more" if we got absolutely nothing
-             // Otherwise assume there might be older messages to fetch
-             m_chatHasMoreMessages[chatId] = (msgList.size() > 0);
-           }
+void TelegramClient::FetchChatMessages(int64_t chatId) {
+  if (m_localHistoryChatId == chatId) {
+    ContinueWithNetworkHistory(chatId); // Prefetched page already shown
+    return;
+  }
 
-           PostToMainThread([this, chatId, msgList]() {
-             if (m_mainFrame) {
-               m_mainFrame->OnMessagesLoaded(chatId, msgList);
-             }
-           });
-         } else if (result->get_id() == td_api::error::ID) {
-           auto error = td_api::move_object_as<td_api::error>(result);
-           TDLOG("getChatHistory ERROR: %d - %s", error->code_,
-                 error->message_.c_str());
-         }
-       });
+  // Phase one never waits for the network: if TDLib's message database
+  // already has this chat, it is on screen before the round trip starts
+  RequestNewestHistory(
+      chatId, true, [this, chatId](bool ok, std::vector<MessageInfo> msgList) {
+        if (ok && !msgList.empty() && m_currentChatId == chatId) {
+          {
+            std::unique_lock<std::shared_mutex> lock(m_dataMutex);
+            m_messages[chatId] = msgList;
+            // The local database may lag behind; the network page decides
+            // what is newest
+            int64_t first = 0, last = 0;
+            PageIdRange(msgList, first, last);
+            m_loadedIntervals[chatId].Clear();
+            m_loadedIntervals[chatId].Add(first, last);
+          }
+          m_searchIndex.AddAll(msgList);
+          {
+            std::lock_guard<std::mutex> lock(m_messageLoadingMutex);
+            m_chatHasMoreMessages[chatId] = true;
+          }
+          m_localHistoryChatId = chatId;
+          NoteFirstMessages(chatId, msgList.size(), "local");
+
+          PostToMainThread([this, chatId, msgList]() {
+            if (m_mainFrame) {
+              m_mainFrame->OnMessagesLoaded(chatId, msgList);
+            }
+          });
+        }
+
+        ContinueWithNetworkHistory(chatId);
+      });
+}
+
+void TelegramClient::ContinueWithNetworkHistory(int64_t chatId) {
+  // Phase two waits for the connection
+  if (m_connectionState != ConnectionState::Ready) {
+    TDLOG("Connection not ready (state=%d), delaying network history for "
+          "chatId=%lld",
+          (int)m_connectionState, (long long)chatId);
+    m_pendingChatLoad = chatId;
+    return;
+  }
+  FetchNetworkHistory(chatId);
+}
+
+void TelegramClient::PrefetchHistory(const std::vector<int64_t> &chatIds) {
+  if (m_authState != AuthState::Ready) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_prefetchMutex);
+    m_prefetchGeneration++;
+    m_prefetchQueue.assign(chatIds.begin(), chatIds.end());
+  }
+  PumpPrefetch();
+}
+
+void TelegramClient::CancelPrefetch() {
+  // The request in flight cannot be recalled; its page is dropped instead
+  std::lock_guard<std::mutex> lock(m_prefetchMutex);
+  m_prefetchGeneration++;
+  m_prefetchQueue.clear();
+}
+
+void TelegramClient::PumpPrefetch() {
+  int64_t chatId = 0;
+  uint64_t generation = 0;
+  {
+    std::lock_guard<std::mutex> lock(m_prefetchMutex);
+    // One request at a time keeps prefetch behind anything the user asks for
+    if (m_prefetchInFlight) {
+      return;
+    }
+    while (!m_prefetchQueue.empty() && chatId == 0) {
+      int64_t candidate = m_prefetchQueue.front();
+      m_prefetchQueue.pop_front();
+      bool done = std::any_of(
+          m_prefetchedPages.begin(), m_prefetchedPages.end(),
+          [candidate](const auto &page) { return page.chatId == candidate; });
+      if (!done && candidate != m_currentChatId &&
+          !HasLoadedHistory(candidate)) {
+        chatId = candidate;
+      }
+    }
+    if (chatId == 0) {
+      return;
+    }
+    m_prefetchInFlight = true;
+    generation = m_prefetchGeneration;
+  }
+
+  RequestNewestHistory(
+      chatId, true,
+      [this, chatId, generation](bool ok, std::vector<MessageInfo> messages) {
+        // Not in the local database: one network page, if we are online
+        if (ok && messages.empty() &&
+            m_connectionState == ConnectionState::Ready) {
+          RequestNewestHistory(
+              chatId, false,
+              [this, chatId, generation](bool ok,
+                                         std::vector<MessageInfo> messages) {
+                FinishPrefetch(chatId, generation, ok, std::move(messages));
+              });
+          return;
+        }
+        FinishPrefetch(chatId, generation, ok, std::move(messages));
+      });
+}
+
+void TelegramClient::FinishPrefetch(int64_t chatId, uint64_t generation,
+                                    bool ok,
+                                    std::vector<MessageInfo> messages) {
+  bool keep = ok && !messages.empty() && chatId != m_currentChatId;
+  {
+    std::lock_guard<std::mutex> lock(m_prefetchMutex);
+    m_prefetchInFlight = false;
+    if (generation != m_prefetchGeneration) {
+      keep = false; // Cancelled while in flight
+    }
+  }
+
+  if (keep) {
+    // Merge with whatever live updates already put in the cache. A chat
+    // whose history was loaded meanwhile is left alone: its cache is not
+    // the prefetch budget's to evict
+    std::vector<int64_t> addedIds;
+    size_t bytes = 0;
+    {
+      std::unique_lock<std::shared_mutex> lock(m_dataMutex);
+      auto intervals = m_loadedIntervals.find(chatId);
+      if (intervals != m_loadedIntervals.end() &&
+          !intervals->second.IsEmpty()) {
+        keep = false;
+      } else {
+        auto &stored = m_messages[chatId];
+        int64_t first = 0, last = 0;
+        PageIdRange(messages, first, last);
+        int64_t storedLast = 0;
+        for (const auto &msg : stored) {
+          storedLast = std::max(storedLast, msg.id);
+        }
+        if (!stored.empty() && first > storedLast) {
+          // A stale tail (from the warm snapshot) the page does not reach:
+          // merged, the gap between them would pass for history
+          stored.clear();
+        }
+        std::set<int64_t> known;
+        for (const auto &msg : stored) {
+          known.insert(msg.id);
+        }
+        for (const auto &msg : messages) {
+          if (known.count(msg.id) == 0) {
+            stored.push_back(msg);
+            addedIds.push_back(msg.id);
+            bytes += sizeof(MessageInfo) + msg.text.length() * sizeof(wxChar);
+          }
+        }
+        std::sort(stored.begin(), stored.end(), MessageBefore);
+        m_loadedIntervals[chatId].Add(first, last);
+      }
+    }
+  }
+
+  if (keep) {
+    m_searchIndex.AddAll(messages);
+
+    std::vector<PrefetchedPage> evicted;
+    size_t cachedBytes = 0;
+    {
+      std::lock_guard<std::mutex> lock(m_prefetchMutex);
+      m_prefetchedBytes += bytes;
+      m_prefetchedPages.push_back(PrefetchedPage{chatId, bytes, addedIds});
+      while (m_prefetchedBytes > PREFETCH_BUDGET_BYTES &&
+             m_prefetchedPages.size() > 1) {
+        m_prefetchedBytes -= m_prefetchedPages.front().bytes;
+        evicted.push_back(std::move(m_prefetchedPages.front()));
+        m_prefetchedPages.pop_front();
+      }
+      cachedBytes = m_prefetchedBytes;
+    }
+    if (!evicted.empty()) {
+      std::unique_lock<std::shared_mutex> lock(m_dataMutex);
+      for (const auto &page : evicted) {
+        if (page.chatId == m_currentChatId) {
+          continue;
+        }
+        auto stored = m_messages.find(page.chatId);
+        if (stored != m_messages.end()) {
+          std::set<int64_t> added(page.addedIds.begin(), page.addedIds.end());
+          auto &list = stored->second;
+          list.erase(std::remove_if(list.begin(), list.end(),
+                                    [&added](const MessageInfo &msg) {
+                                      return added.count(msg.id) > 0;
+                                    }),
+                     list.end());
+          if (list.empty()) {
+            m_messages.erase(stored);
+          }
+        }
+        // The chat had no loaded range before the prefetch added one
+        m_loadedIntervals.erase(page.chatId);
+      }
+    }
+    TDLOG("Prefetched %zu messages for chatId=%lld (%zu bytes cached)",
+          messages.size(), (long long)chatId, cachedBytes);
+  }
+
+  PumpPrefetch();
+}
+
+bool TelegramClient::TakePrefetched(int64_t chatId) {
+  std::lock_guard<std::mutex> lock(m_prefetchMutex);
+  auto it = std::find_if(
+      m_prefetchedPages.begin(), m_prefetchedPages.end(),
+      [chatId](const auto &page) { return page.chatId == chatId; });
+  if (it == m_prefetchedPages.end()) {
+    return false;
+  }
+  // Opened chats are no longer the budget's to evict
+  m_prefetchedBytes -= it->bytes;
+  m_prefetchedPages.erase(it);
+  return true;
+}
+
+bool TelegramClient::HasLoadedHistory(int64_t chatId) const {
+  std::shared_lock<std::shared_mutex> lock(m_dataMutex);
+  auto it = m_loadedIntervals.find(chatId);
+  return it != m_loadedIntervals.end() && !it->second.IsEmpty();
+}
+
+void TelegramClient::FetchNetworkHistory(int64_t chatId) {
+  RequestNewestHistory(
+      chatId, false,
+      [this, chatId](bool ok, std::vector<MessageInfo> msgList) {
+        if (!ok) {
+          return;
+        }
+
+        if (m_localHistoryChatId == chatId) {
+          // The local page is on screen: hand over only what it lacks so the
+          // view can append instead of rebuilding. Messages it already shows
+          // take the network version, which carries edits and reactions
+          std::vector<MessageInfo> fresh;
+          std::vector<MessageInfo> changed;
+          bool replace = false;
+          {
+            std::unique_lock<std::shared_mutex> lock(m_dataMutex);
+            auto &stored = m_messages[chatId];
+            int64_t storedLast = 0;
+            for (const auto &msg : stored) {
+              storedLast = std::max(storedLast, msg.id);
+            }
+            int64_t first = 0, last = 0;
+            if (!msgList.empty()) {
+              PageIdRange(msgList, first, last);
+            }
+
+            if (!msgList.empty() && !stored.empty() && first > storedLast) {
+              // More arrived than one page holds: appending would hide the
+              // gap between the two, so the network page replaces the local
+              replace = true;
+              stored = msgList;
+              m_loadedIntervals[chatId].Clear();
+              m_loadedIntervals[chatId].AddNewest(first, last);
+            } else {
+              std::map<int64_t, size_t> known;
+              for (size_t i = 0; i < stored.size(); ++i) {
+                known[stored[i].id] = i;
+              }
+              for (const auto &msg : msgList) {
+                auto it = known.find(msg.id);
+                if (it == known.end()) {
+                  fresh.push_back(msg);
+                  continue;
+                }
+                MessageInfo &old = stored[it->second];
+                if (old.text != msg.text || old.editDate != msg.editDate ||
+                    old.reactions != msg.reactions) {
+                  changed.push_back(msg);
+                }
+                old = msg;
+              }
+              stored.insert(stored.end(), fresh.begin(), fresh.end());
+              std::sort(stored.begin(), stored.end(), MessageBefore);
+              if (!msgList.empty()) {
+                m_loadedIntervals[chatId].AddNewest(first, last);
+              }
+            }
+          }
+          TDLOG("Network history for chatId=%lld: %zu of %zu messages new, "
+                "%zu changed%s",
+                (long long)chatId, fresh.size(), msgList.size(),
+                changed.size(), replace ? ", replacing the local page" : "");
+
+          if (replace) {
+            m_localHistoryChatId = 0;
+            m_searchIndex.AddAll(msgList);
+            PostToMainThread([this, chatId, msgList]() {
+              if (m_mainFrame) {
+                m_mainFrame->OnMessagesMerged(chatId, msgList, true);
+              }
+            });
+            return;
+          }
+          if (fresh.empty() && changed.empty()) {
+            return;
+          }
+          m_searchIndex.AddAll(fresh);
+          m_searchIndex.AddAll(changed);
+          PostToMainThread([this, chatId, fresh, changed]() {
+            if (!m_mainFrame) {
+              return;
+            }
+            if (!fresh.empty()) {
+              m_mainFrame->OnMessagesMerged(chatId, fresh, false);
+            }
+            for (const auto &msg : changed) {
+              m_mainFrame->OnMessageUpdated(chatId, msg);
+            }
+          });
+          return;
+        }
+
+        // Nothing local was shown: the network page is the first paint
+        {
+          std::unique_lock<std::shared_mutex> lock(m_dataMutex);
+          m_messages[chatId] = msgList;
+          m_loadedIntervals[chatId].Clear();
+          if (!msgList.empty()) {
+            int64_t first = 0, last = 0;
+            PageIdRange(msgList, first, last);
+            m_loadedIntervals[chatId].AddNewest(first, last);
+          }
+        }
+        m_searchIndex.AddAll(msgList);
+
+        // Mark that this chat might have more messages
+        // We assume there ARE more messages unless we got 0 messages back
+        // (getting fewer than requested just means we hit a sync boundary)
+        {
+          std::lock_guard<std::mutex> lock(m_messageLoadingMutex);
+          m_chatHasMoreMessages[chatId] = (msgList.size() > 0);
+        }
+        if (m_currentChatId == chatId) {
+          NoteFirstMessages(chatId, msgList.size(), "network");
+        }
+
+        PostToMainThread([this, chatId, msgList]() {
+          if (m_mainFrame) {
+            m_mainFrame->OnMessagesLoaded(chatId, msgList);
+          }
+        });
+      });
 }
 
 void TelegramClient::LoadOlderMessages(int64_t chatId, int64_t fromMessageId,
@@ -1078,7 +1714,8 @@ void TelegramClient::LoadOlderMessages(int64_t chatId, int64_t fromMessageId,
   historyRequest->only_local_ = false;
 
   Send(std::move(historyRequest),
-       [this, chatId](td_api::object_ptr<td_api::Object> result) {
+       [this, chatId,
+        fromMessageId](td_api::object_ptr<td_api::Object> result) {
          if (result->get_id() == td_api::messages::ID) {
            auto messages = td_api::move_object_as<td_api::messages>(result);
            TDLOG("LoadOlderMessages: Got %zu messages",
@@ -1109,6 +1746,8 @@ void TelegramClient::LoadOlderMessages(int64_t chatId, int64_t fromMessageId,
                        return a.id < b.id;
                      });
 
+           m_searchIndex.AddAll(msgList);
+
            // Merge with existing messages
            {
              std::unique_lock<std::shared_mutex> lock(m_dataMutex);
@@ -1129,11 +1768,15 @@ void TelegramClient::LoadOlderMessages(int64_t chatId, int64_t fromMessageId,
 
              // Re-sort the combined list
              std::sort(existingMessages.begin(), existingMessages.end(),
-                       [](const MessageInfo &a, const MessageInfo &b) {
-                         if (a.date != b.date)
-                           return a.date < b.date;
-                         return a.id < b.id;
-                       });
+                       MessageBefore);
+
+             // The page runs without gaps from the anchor down
+             if (!msgList.empty()) {
+               int64_t first = 0, last = 0;
+               PageIdRange(msgList, first, last);
+               m_loadedIntervals[chatId].Add(first,
+                                             std::max(last, fromMessageId));
+             }
            }
 
            // Notify UI about older messages loaded
@@ -1167,7 +1810,446 @@ bool TelegramClient::HasMoreMessages(int64_t chatId) const {
   return true; // Assume there are more until we know otherwise
 }
 
-void TelegramClient::CloseChat(int64_t chatId) {
+void TelegramClient::StorePageLocked(int64_t chatId,
+                                     const std::vector<MessageInfo> &page,
+                                     int64_t first, int64_t last,
+                                     bool newest) {
+  auto &stored = m_messages[chatId];
+  std::set<int64_t> known;
+  for (const auto &msg : stored) {
+    known.insert(msg.id);
+  }
+  for (const auto &msg : page) {
+    if (known.count(msg.id) == 0) {
+      stored.push_back(msg);
+    }
+  }
+  std::sort(stored.begin(), stored.end(), MessageBefore);
+
+  if (newest) {
+    m_loadedIntervals[chatId].AddNewest(first, last);
+  } else {
+    m_loadedIntervals[chatId].Add(first, last);
+  }
+}
+
+std::vector<MessageInfo>
+TelegramClient::CollectCachedLocked(int64_t chatId, int64_t fromMessageId,
+                                    bool newer, size_t limit,
+                                    bool *atEnd) const {
+  std::vector<MessageInfo> result;
+  if (atEnd) {
+    *atEnd = false;
+  }
+
+  auto intervals = m_loadedIntervals.find(chatId);
+  auto messages = m_messages.find(chatId);
+  if (intervals == m_loadedIntervals.end() || messages == m_messages.end()) {
+    return result;
+  }
+  const HistoryIntervals::Interval *interval =
+      intervals->second.Find(fromMessageId);
+  if (!interval) {
+    return result;
+  }
+
+  // Ids inside the range, on the requested side of the anchor
+  std::vector<const MessageInfo *> candidates;
+  for (const auto &msg : messages->second) {
+    if (msg.id < interval->first || msg.id > interval->last) {
+      continue;
+    }
+    if (newer ? msg.id > fromMessageId : msg.id < fromMessageId) {
+      candidates.push_back(&msg);
+    }
+  }
+
+  // Nearest to the anchor first, then back into history order
+  std::sort(candidates.begin(), candidates.end(),
+            [newer](const MessageInfo *a, const MessageInfo *b) {
+              return newer ? a->id < b->id : a->id > b->id;
+            });
+  bool tookAll = candidates.size() <= limit;
+  if (!tookAll) {
+    candidates.resize(limit);
+  }
+  for (const MessageInfo *msg : candidates) {
+    result.push_back(*msg);
+  }
+  std::sort(result.begin(), result.end(), MessageBefore);
+
+  if (atEnd && newer) {
+    *atEnd = tookAll && intervals->second.IsNewest(interval);
+  }
+  return result;
+}
+
+bool TelegramClient::IsWindowAtNewestLocked(int64_t chatId,
+                                            int64_t newestId) const {
+  auto intervals = m_loadedIntervals.find(chatId);
+  if (intervals == m_loadedIntervals.end()) {
+    return false;
+  }
+  const HistoryIntervals::Interval *interval =
+      intervals->second.Find(newestId);
+  return intervals->second.IsNewest(interval) && interval->last == newestId;
+}
+
+void TelegramClient::PostHistoryWindow(int64_t chatId, int64_t anchorId,
+                                       std::vector<MessageInfo> messages) {
+  bool atNewest = false;
+  if (!messages.empty()) {
+    int64_t first = 0, last = 0;
+    PageIdRange(messages, first, last);
+    std::shared_lock<std::shared_mutex> lock(m_dataMutex);
+    atNewest = IsWindowAtNewestLocked(chatId, last);
+  }
+
+  PostToMainThread([this, chatId, anchorId, atNewest,
+                    messages = std::move(messages)]() {
+    if (m_mainFrame) {
+      m_mainFrame->OnHistoryWindowLoaded(chatId, anchorId, messages, atNewest);
+    }
+  });
+}
+
+void TelegramClient::LoadMessagesAround(int64_t chatId, int64_t messageId) {
+  if (chatId == 0 || messageId == 0) {
+    return;
+  }
+
+  static constexpr int HALF_WINDOW = HISTORY_PAGE_SIZE / 2;
+
+  // A jump into a range we already hold needs no request
+  {
+    std::shared_lock<std::shared_mutex> lock(m_dataMutex);
+    auto intervals = m_loadedIntervals.find(chatId);
+    auto messages = m_messages.find(chatId);
+    if (intervals != m_loadedIntervals.end() &&
+        intervals->second.Find(messageId) && messages != m_messages.end()) {
+      auto anchor = std::find_if(
+          messages->second.begin(), messages->second.end(),
+          [messageId](const MessageInfo &msg) { return msg.id == messageId; });
+      if (anchor != messages->second.end()) {
+        std::vector<MessageInfo> window = CollectCachedLocked(
+            chatId, messageId, false, HALF_WINDOW, nullptr);
+        window.push_back(*anchor);
+        std::vector<MessageInfo> newer = CollectCachedLocked(
+            chatId, messageId, true, HALF_WINDOW, nullptr);
+        window.insert(window.end(), newer.begin(), newer.end());
+        std::sort(window.begin(), window.end(), MessageBefore);
+        lock.unlock();
+        TDLOG("LoadMessagesAround: chatId=%lld msg=%lld served from cache "
+              "(%zu)",
+              (long long)chatId, (long long)messageId, window.size());
+        PostHistoryWindow(chatId, messageId, std::move(window));
+        return;
+      }
+    }
+  }
+
+  TDLOG("LoadMessagesAround: chatId=%lld msg=%lld", (long long)chatId,
+        (long long)messageId);
+
+  auto request = td_api::make_object<td_api::getChatHistory>();
+  request->chat_id_ = chatId;
+  request->from_message_id_ = messageId;
+  request->offset_ = -HALF_WINDOW;
+  request->limit_ = HISTORY_PAGE_SIZE;
+  request->only_local_ = false;
+
+  Send(std::move(request), [this, chatId,
+                            messageId](td_api::object_ptr<td_api::Object>
+                                           result) {
+    std::vector<MessageInfo> msgList;
+    if (result->get_id() == td_api::messages::ID) {
+      auto messages = td_api::move_object_as<td_api::messages>(result);
+      for (auto &msg : messages->messages_) {
+        if (msg) {
+          msgList.push_back(ConvertMessage(msg.get()));
+        }
+      }
+    } else if (result->get_id() == td_api::error::ID) {
+      auto error = td_api::move_object_as<td_api::error>(result);
+      TDLOG("LoadMessagesAround ERROR: %d - %s", error->code_,
+            error->message_.c_str());
+    }
+
+    std::sort(msgList.begin(), msgList.end(), MessageBefore);
+    m_searchIndex.AddAll(msgList);
+    if (!msgList.empty()) {
+      int64_t first = 0, last = 0;
+      PageIdRange(msgList, first, last);
+      std::unique_lock<std::shared_mutex> lock(m_dataMutex);
+      StorePageLocked(chatId, msgList, first, last, false);
+    }
+    PostHistoryWindow(chatId, messageId, std::move(msgList));
+  });
+}
+
+void TelegramClient::LoadMessagesAroundDate(int64_t chatId, int64_t date) {
+  if (chatId == 0) {
+    return;
+  }
+
+  auto request = td_api::make_object<td_api::getChatMessageByDate>();
+  request->chat_id_ = chatId;
+  request->date_ = static_cast<std::int32_t>(date);
+
+  Send(std::move(request), [this, chatId](
+                               td_api::object_ptr<td_api::Object> result) {
+    if (result->get_id() == td_api::message::ID) {
+      auto message = td_api::move_object_as<td_api::message>(result);
+      LoadMessagesAround(chatId, message->id_);
+      return;
+    }
+
+    wxString error = "No messages found around that date";
+    if (result->get_id() == td_api::error::ID) {
+      auto tdError = td_api::move_object_as<td_api::error>(result);
+      TDLOG("LoadMessagesAroundDate ERROR: %d - %s", tdError->code_,
+            tdError->message_.c_str());
+      error = "Failed to jump to date: " +
+              wxString::FromUTF8(tdError->message_);
+    }
+    PostToMainThread([this, error]() {
+      if (m_mainFrame) {
+        m_mainFrame->ShowStatusError(error);
+      }
+    });
+  });
+}
+
+void TelegramClient::LoadNewerMessages(int64_t chatId, int64_t fromMessageId,
+                                       int limit) {
+  if (chatId == 0 || fromMessageId == 0 || limit <= 0) {
+    return;
+  }
+  // TDLib wants -offset < limit, and one slot goes to the anchor itself
+  limit = std::min(limit, HISTORY_PAGE_SIZE - 1);
+
+  {
+    std::shared_lock<std::shared_mutex> lock(m_dataMutex);
+    bool atEnd = false;
+    std::vector<MessageInfo> cached = CollectCachedLocked(
+        chatId, fromMessageId, true, static_cast<size_t>(limit), &atEnd);
+    if (!cached.empty() || atEnd) {
+      lock.unlock();
+      PostToMainThread([this, chatId, atEnd, cached = std::move(cached)]() {
+        if (m_mainFrame) {
+          m_mainFrame->OnNewerMessagesLoaded(chatId, cached, atEnd);
+        }
+      });
+      return;
+    }
+  }
+
+  TDLOG("LoadNewerMessages: chatId=%lld fromMessageId=%lld limit=%d",
+        (long long)chatId, (long long)fromMessageId, limit);
+
+  auto request = td_api::make_object<td_api::getChatHistory>();
+  request->chat_id_ = chatId;
+  request->from_message_id_ = fromMessageId;
+  request->offset_ = -limit;
+  request->limit_ = limit + 1;
+  request->only_local_ = false;
+
+  Send(std::move(request), [this, chatId, fromMessageId](
+                               td_api::object_ptr<td_api::Object> result) {
+    std::vector<MessageInfo> msgList;
+    bool ok = false;
+    if (result->get_id() == td_api::messages::ID) {
+      ok = true;
+      auto messages = td_api::move_object_as<td_api::messages>(result);
+      for (auto &msg : messages->messages_) {
+        if (msg && msg->id_ > fromMessageId) {
+          msgList.push_back(ConvertMessage(msg.get()));
+        }
+      }
+    } else if (result->get_id() == td_api::error::ID) {
+      auto error = td_api::move_object_as<td_api::error>(result);
+      TDLOG("LoadNewerMessages ERROR: %d - %s", error->code_,
+            error->message_.c_str());
+    }
+
+    std::sort(msgList.begin(), msgList.end(), MessageBefore);
+    m_searchIndex.AddAll(msgList);
+
+    // Nothing after the anchor means the window has caught up
+    bool atNewest = ok && msgList.empty();
+    {
+      std::unique_lock<std::shared_mutex> lock(m_dataMutex);
+      if (!msgList.empty()) {
+        int64_t first = 0, last = 0;
+        PageIdRange(msgList, first, last);
+        StorePageLocked(chatId, msgList, fromMessageId, last, false);
+        atNewest = IsWindowAtNewestLocked(chatId, last);
+      } else if (atNewest) {
+        m_loadedIntervals[chatId].AddNewest(fromMessageId, fromMessageId);
+      }
+    }
+
+    PostToMainThread([this, chatId, atNewest, msgList = std::move(msgList)]() {
+      if (m_mainFrame) {
+        m_mainFrame->OnNewerMessagesLoaded(chatId, msgList, atNewest);
+      }
+    });
+  });
+}
+
+void TelegramClient::SearchChatMessages(int64_t chatId, const wxString &query,
+                                        SearchMediaFilter filter,
+                                        int64_t fromMessageId, int limit,
+                                        SearchMessagesCallback callback) {
+  if (chatId == 0) {
+    return;
+  }
+
+  td_api::object_ptr<td_api::SearchMessagesFilter> tdFilter;
+  switch (filter) {
+  case SearchMediaFilter::Photo:
+    tdFilter = td_api::make_object<td_api::searchMessagesFilterPhoto>();
+    break;
+  case SearchMediaFilter::Video:
+    tdFilter = td_api::make_object<td_api::searchMessagesFilterVideo>();
+    break;
+  case SearchMediaFilter::Document:
+    tdFilter = td_api::make_object<td_api::searchMessagesFilterDocument>();
+    break;
+  case SearchMediaFilter::Audio:
+    tdFilter = td_api::make_object<td_api::searchMessagesFilterAudio>();
+    break;
+  case SearchMediaFilter::Voice:
+    tdFilter = td_api::make_object<td_api::searchMessagesFilterVoiceNote>();
+    break;
+  case SearchMediaFilter::Animation:
+    tdFilter = td_api::make_object<td_api::searchMessagesFilterAnimation>();
+    break;
+  case SearchMediaFilter::None:
+    break;
+  }
+
+  auto request = td_api::make_object<td_api::searchChatMessages>();
+  request->chat_id_ = chatId;
+  request->query_ = std::string(query.ToUTF8());
+  request->from_message_id_ = fromMessageId;
+  request->offset_ = 0;
+  request->limit_ = limit;
+  request->filter_ = std::move(tdFilter);
+
+  TDLOG("SearchChatMessages: chatId=%lld from=%lld limit=%d filter=%d",
+        (long long)chatId, (long long)fromMessageId, limit,
+        static_cast<int>(filter));
+
+  Send(std::move(request), [this, callback](
+                               td_api::object_ptr<td_api::Object> result) {
+    if (!callback) {
+      return;
+    }
+
+    if (result->get_id() == td_api::foundChatMessages::ID) {
+      auto found = td_api::move_object_as<td_api::foundChatMessages>(result);
+      std::vector<MessageInfo> messages;
+      messages.reserve(found->messages_.size());
+      for (auto &msg : found->messages_) {
+        if (msg) {
+          messages.push_back(ConvertMessage(msg.get()));
+        }
+      }
+      m_searchIndex.AddAll(messages);
+      int64_t nextFrom = found->next_from_message_id_;
+      PostToMainThread([callback, messages, nextFrom]() {
+        callback(true, messages, nextFrom, wxString());
+      });
+    } else if (result->get_id() == td_api::error::ID) {
+      auto error = td_api::move_object_as<td_api::error>(result);
+      TDLOG("SearchChatMessages ERROR: %d - %s", error->code_,
+            error->message_.c_str());
+      wxString errorMsg = wxString::FromUTF8(error->message_);
+      PostToMainThread([callback, errorMsg]() {
+        callback(false, std::vector<MessageInfo>(), 0, errorMsg);
+      });
+    }
+  });
+}
+
+void TelegramClient::SearchMessages(const wxString &query,
+                                    const wxString &offset, int limit,
+                                    GlobalSearchCallback callback) {
+  auto request = td_api::make_object<td_api::searchMessages>();
+  request->chat_list_ = nullptr; // Main and archive
+  request->query_ = std::string(query.ToUTF8());
+  request->offset_ = std::string(offset.ToUTF8());
+  request->limit_ = limit;
+  request->filter_ = nullptr;
+  request->min_date_ = 0;
+  request->max_date_ = 0;
+
+  TDLOG("SearchMessages: offset=%s limit=%d", request->offset_.c_str(), limit);
+
+  Send(std::move(request), [this, callback](
+                               td_api::object_ptr<td_api::Object> result) {
+    if (result->get_id() == td_api::foundMessages::ID) {
+      auto found = td_api::move_object_as<td_api::foundMessages>(result);
+      std::vector<MessageInfo> messages;
+      messages.reserve(found->messages_.size());
+      for (auto &msg : found->messages_) {
+        if (msg) {
+          messages.push_back(ConvertMessage(msg.get()));
+        }
+      }
+      m_searchIndex.AddAll(messages);
+      if (!callback) {
+        return;
+      }
+      wxString nextOffset = wxString::FromUTF8(found->next_offset_);
+      int totalCount = found->total_count_;
+      PostToMainThread([callback, messages, nextOffset, totalCount]() {
+        callback(true, messages, nextOffset, totalCount, wxString());
+      });
+    } else if (result->get_id() == td_api::error::ID) {
+      auto error = td_api::move_object_as<td_api::error>(result);
+      TDLOG("SearchMessages ERROR: %d - %s", error->code_,
+            error->message_.c_str());
+      if (!callback) {
+        return;
+      }
+      wxString errorMsg = wxString::FromUTF8(error->message_);
+      PostToMainThread([callback, errorMsg]() {
+        callback(false, std::vector<MessageInfo>(), wxString(), 0, errorMsg);
+      });
+    }
+  });
+}
+
+void TelegramClient::CreatePrivateChat(int64_t userId,
+                                       CreateChatCallback callback) {
+  TDLOG("CreatePrivateChat: userId=%lld", (long long)userId);
+
+  // TDLib sends updateNewChat before answering, so the chat is already in
+  // m_chats when the callback runs
+  Send(td_api::make_object<td_api::createPrivateChat>(userId, false),
+       [this, callback](td_api::object_ptr<td_api::Object> result) {
+         if (!callback) {
+           return;
+         }
+         if (result->get_id() == td_api::chat::ID) {
+           auto chat = td_api::move_object_as<td_api::chat>(result);
+           int64_t chatId = chat->id_;
+           PostToMainThread(
+               [callback, chatId]() { callback(true, chatId, wxString()); });
+         } else if (result->get_id() == td_api::error::ID) {
+           auto error = td_api::move_object_as<td_api::error>(result);
+           TDLOG("CreatePrivateChat ERROR: %d - %s", error->code_,
+                 error->message_.c_str());
+           wxString errorMsg = wxString::FromUTF8(error->message_);
+           PostToMainThread(
+               [callback, errorMsg]() { callback(false, 0, errorMsg); });
+         }
+       });
+}
+
+void TelegramClient::CloseChat(int64_t chatId) {
   TDLOG("CloseChat called for chatId=%lld", (long long)chatId);
 
   // Clear current chat tracking if closing the active chat
@@ -1215,56 +2297,396 @@ void TelegramClient::SendMessage(int64_t chatId, const wxString &text,
 
 void TelegramClient::SendFile(int64_t chatId, const wxString &filePath,
                               const wxString &caption) {
-  // Determine file type based on extension
-  wxString ext = filePath.AfterLast('.').Lower();
+  auto inputFile = td_api::make_object<td_api::inputFileLocal>();
+  inputFile->path_ = filePath.ToStdString();
+  SendFileMessage(chatId, filePath, std::move(inputFile), caption);
+}
 
+void TelegramClient::SendFileMessage(
+    int64_t chatId, const wxString &filePath,
+    td_api::object_ptr<td_api::InputFile> inputFile, const wxString &caption) {
+  // Determine file type based on extension
   td_api::object_ptr<td_api::InputMessageContent> content;
 
+  auto formattedCaption = td_api::make_object<td_api::formattedText>();
+  formattedCaption->text_ = caption.ToStdString();
+
+  switch (GetUploadKind(filePath)) {
+  case UploadKind::Photo: {
+    auto photo = td_api::make_object<td_api::inputMessagePhoto>();
+    photo->photo_ = std::move(inputFile);
+    photo->caption_ = std::move(formattedCaption);
+    content = std::move(photo);
+    break;
+  }
+  case UploadKind::Video: {
+    auto video = td_api::make_object<td_api::inputMessageVideo>();
+    video->video_ = std::move(inputFile);
+    video->caption_ = std::move(formattedCaption);
+    content = std::move(video);
+    break;
+  }
+  case UploadKind::Audio: {
+    auto audio = td_api::make_object<td_api::inputMessageAudio>();
+    audio->audio_ = std::move(inputFile);
+    audio->caption_ = std::move(formattedCaption);
+    content = std::move(audio);
+    break;
+  }
+  case UploadKind::Document: {
+    auto doc = td_api::make_object<td_api::inputMessageDocument>();
+    doc->document_ = std::move(inputFile);
+    doc->caption_ = std::move(formattedCaption);
+    content = std::move(doc);
+    break;
+  }
+  }
+
+  auto request = td_api::make_object<td_api::sendMessage>();
+  request->chat_id_ = chatId;
+  request->input_message_content_ = std::move(content);
+
+  Send(std::move(request), [this](td_api::object_ptr<td_api::Object> result) {
+    if (result->get_id() == td_api::error::ID) {
+      auto error = td_api::move_object_as<td_api::error>(result);
+      PostToMainThread([this, msg = error->message_]() {
+        if (m_mainFrame) {
+          m_mainFrame->ShowStatusError(wxString::FromUTF8(msg));
+        }
+      });
+    }
+  });
+}
+
+int TelegramClient::QueueUpload(const wxString &filePath) {
+  int uploadId = 0;
+  {
+    std::lock_guard<std::mutex> lock(m_uploadsMutex);
+    uploadId = m_nextUploadId++;
+    PendingUpload upload;
+    upload.path = filePath;
+    m_uploads[uploadId] = upload;
+    m_uploadQueue.push_back(uploadId);
+  }
+
+  TDLOG("QueueUpload: uploadId=%d path=%s", uploadId,
+        filePath.ToStdString().c_str());
+
+  PumpUploadQueue();
+  return uploadId;
+}
+
+void TelegramClient::PumpUploadQueue() {
+  std::vector<std::pair<int, wxString>> toStart;
+  {
+    std::lock_guard<std::mutex> lock(m_uploadsMutex);
+    size_t activeCount = 0;
+    for (const auto &[id, upload] : m_uploads) {
+      if (upload.active) {
+        activeCount++;
+      }
+    }
+
+    while (activeCount < MAX_CONCURRENT_UPLOADS && !m_uploadQueue.empty()) {
+      int uploadId = m_uploadQueue.front();
+      m_uploadQueue.pop_front();
+      auto it = m_uploads.find(uploadId);
+      if (it == m_uploads.end()) {
+        continue;
+      }
+      it->second.active = true;
+      it->second.state = UploadState::Uploading;
+      toStart.emplace_back(uploadId, it->second.path);
+      activeCount++;
+    }
+  }
+
+  for (const auto &[uploadId, path] : toStart) {
+    StartPreliminaryUpload(uploadId, path);
+  }
+}
+
+void TelegramClient::StartPreliminaryUpload(int uploadId,
+                                            const wxString &path) {
   auto inputFile = td_api::make_object<td_api::inputFileLocal>();
-  inputFile->path_ = filePath.ToStdString();
+  inputFile->path_ = path.ToStdString();
+
+  td_api::object_ptr<td_api::FileType> fileType;
+  switch (GetUploadKind(path)) {
+  case UploadKind::Photo:
+    fileType = td_api::make_object<td_api::fileTypePhoto>();
+    break;
+  case UploadKind::Video:
+    fileType = td_api::make_object<td_api::fileTypeVideo>();
+    break;
+  case UploadKind::Audio:
+    fileType = td_api::make_object<td_api::fileTypeAudio>();
+    break;
+  case UploadKind::Document:
+    fileType = td_api::make_object<td_api::fileTypeDocument>();
+    break;
+  }
+
+  auto request = td_api::make_object<td_api::preliminaryUploadFile>();
+  request->file_ = std::move(inputFile);
+  request->file_type_ = std::move(fileType);
+  request->priority_ = 16;
+
+  Send(std::move(request), [this, uploadId](
+                               td_api::object_ptr<td_api::Object> result) {
+    if (result->get_id() == td_api::error::ID) {
+      auto error = td_api::move_object_as<td_api::error>(result);
+      wxString errorMsg = wxString::FromUTF8(error->message_);
+      TDLOG("preliminaryUploadFile ERROR for uploadId=%d: %s", uploadId,
+            error->message_.c_str());
+      int64_t chatId = 0;
+      wxString path;
+      wxString caption;
+      bool sendNow = false;
+      {
+        std::lock_guard<std::mutex> lock(m_uploadsMutex);
+        auto it = m_uploads.find(uploadId);
+        if (it != m_uploads.end()) {
+          // Kept as Failed: SendUploadedFile falls back to a plain send
+          it->second.state = UploadState::Failed;
+          it->second.active = false;
+          if (it->second.sendRequested && !it->second.sent) {
+            sendNow = true;
+            chatId = it->second.sendChatId;
+            path = it->second.path;
+            caption = it->second.sendCaption;
+            m_uploads.erase(it);
+          }
+        }
+      }
+      PushUploadUpdate(uploadId, UploadState::Failed, 0, 0, errorMsg);
+      if (sendNow) {
+        SendFile(chatId, path, caption);
+      }
+      PumpUploadQueue();
+      return;
+    }
+
+    if (result->get_id() != td_api::file::ID) {
+      return;
+    }
+
+    auto file = td_api::move_object_as<td_api::file>(result);
+    int32_t fileId = file->id_;
+    int64_t totalSize = file->size_ > 0 ? file->size_ : file->expected_size_;
+
+    bool cancelled = false;
+    bool sendNow = false;
+    int64_t chatId = 0;
+    wxString path;
+    wxString caption;
+    {
+      std::lock_guard<std::mutex> lock(m_uploadsMutex);
+      auto it = m_uploads.find(uploadId);
+      if (it == m_uploads.end()) {
+        cancelled = true; // CancelUpload raced the request
+      } else {
+        it->second.fileId = fileId;
+        m_uploadsByFileId[fileId] = uploadId;
+        if (it->second.sendRequested && !it->second.sent) {
+          it->second.sent = true;
+          sendNow = true;
+          chatId = it->second.sendChatId;
+          path = it->second.path;
+          caption = it->second.sendCaption;
+        }
+      }
+    }
+
+    if (cancelled) {
+      auto cancel = td_api::make_object<td_api::cancelPreliminaryUploadFile>();
+      cancel->file_id_ = fileId;
+      Send(std::move(cancel), nullptr);
+      return;
+    }
+
+    PushUploadUpdate(uploadId, UploadState::Uploading,
+                     file->remote_ ? file->remote_->uploaded_size_ : 0,
+                     totalSize);
+
+    if (sendNow) {
+      SendFileMessage(chatId, path,
+                      td_api::make_object<td_api::inputFileId>(fileId),
+                      caption);
+    }
+
+    // Small files can be done before the reply arrives
+    if (file->remote_ && file->remote_->is_uploading_completed_) {
+      OnUploadFileUpdate(*file);
+    }
+  });
+}
+
+void TelegramClient::SendUploadedFile(int64_t chatId, int uploadId,
+                                      const wxString &caption) {
+  int32_t fileId = 0;
+  wxString path;
+  bool startNow = false;
+  bool fallback = false;
+  {
+    std::lock_guard<std::mutex> lock(m_uploadsMutex);
+    auto it = m_uploads.find(uploadId);
+    if (it == m_uploads.end() || it->second.sent) {
+      return;
+    }
+
+    PendingUpload &upload = it->second;
+    if (upload.state == UploadState::Failed) {
+      // The pre-upload gave up; the message still goes out, uploading anew
+      path = upload.path;
+      m_uploads.erase(it);
+      fallback = true;
+    } else if (upload.fileId != 0) {
+      // Reference the (partially) uploaded file - TDLib finishes the same
+      // upload instead of starting a new one
+      upload.sent = true;
+      fileId = upload.fileId;
+      path = upload.path;
+      if (upload.state == UploadState::Completed) {
+        m_uploadsByFileId.erase(upload.fileId);
+        m_uploads.erase(it);
+      }
+    } else {
+      // No file id yet: send from the preliminaryUploadFile reply. Still
+      // queued means the user is waiting on it now - skip the queue.
+      upload.sendRequested = true;
+      upload.sendChatId = chatId;
+      upload.sendCaption = caption;
+      if (!upload.active) {
+        auto queued =
+            std::find(m_uploadQueue.begin(), m_uploadQueue.end(), uploadId);
+        if (queued != m_uploadQueue.end()) {
+          m_uploadQueue.erase(queued);
+        }
+        upload.active = true;
+        upload.state = UploadState::Uploading;
+        path = upload.path;
+        startNow = true;
+      }
+    }
+  }
+
+  if (fallback) {
+    SendFile(chatId, path, caption);
+  } else if (fileId != 0) {
+    SendFileMessage(chatId, path,
+                    td_api::make_object<td_api::inputFileId>(fileId), caption);
+  } else if (startNow) {
+    StartPreliminaryUpload(uploadId, path);
+  }
+}
+
+void TelegramClient::CancelUpload(int uploadId) {
+  int32_t fileId = 0;
+  {
+    std::lock_guard<std::mutex> lock(m_uploadsMutex);
+    auto it = m_uploads.find(uploadId);
+    if (it == m_uploads.end() || it->second.sent) {
+      return; // Unknown, or already part of a message
+    }
+    fileId = it->second.fileId;
+    if (fileId != 0) {
+      m_uploadsByFileId.erase(fileId);
+    }
+    auto queued =
+        std::find(m_uploadQueue.begin(), m_uploadQueue.end(), uploadId);
+    if (queued != m_uploadQueue.end()) {
+      m_uploadQueue.erase(queued);
+    }
+    m_uploads.erase(it);
+  }
+
+  if (fileId != 0) {
+    auto request = td_api::make_object<td_api::cancelPreliminaryUploadFile>();
+    request->file_id_ = fileId;
+    Send(std::move(request), nullptr);
+  }
+
+  PushUploadUpdate(uploadId, UploadState::Cancelled, 0, 0);
+  PumpUploadQueue();
+}
+
+bool TelegramClient::OnUploadFileUpdate(td_api::file &file) {
+  if (!file.remote_) {
+    return false;
+  }
+
+  int uploadId = 0;
+  UploadState state = UploadState::Uploading;
+  int64_t uploadedSize = file.remote_->uploaded_size_;
+  int64_t totalSize = file.size_ > 0 ? file.size_ : file.expected_size_;
+  bool slotFreed = false;
+  {
+    std::lock_guard<std::mutex> lock(m_uploadsMutex);
+    auto byFile = m_uploadsByFileId.find(file.id_);
+    if (byFile == m_uploadsByFileId.end()) {
+      return false;
+    }
+    uploadId = byFile->second;
+    auto it = m_uploads.find(uploadId);
+    if (it == m_uploads.end()) {
+      m_uploadsByFileId.erase(byFile);
+      return false;
+    }
 
-  auto formattedCaption = td_api::make_object<td_api::formattedText>();
-  formattedCaption->text_ = caption.ToStdString();
+    PendingUpload &upload = it->second;
+    if (file.remote_->is_uploading_completed_) {
+      state = UploadState::Completed;
+    } else if (file.remote_->is_uploading_active_) {
+      state = UploadState::Uploading;
+    } else if (upload.state == UploadState::Uploading) {
+      // Stopped without finishing, possibly before sending a single byte
+      state = UploadState::Failed;
+    } else {
+      return true; // Not started yet, or already reported as failed
+    }
 
-  if (ext == "jpg" || ext == "jpeg" || ext == "png" || ext == "gif" ||
-      ext == "webp") {
-    auto photo = td_api::make_object<td_api::inputMessagePhoto>();
-    photo->photo_ = std::move(inputFile);
-    photo->caption_ = std::move(formattedCaption);
-    content = std::move(photo);
-  } else if (ext == "mp4" || ext == "mkv" || ext == "avi" || ext == "mov" ||
-             ext == "webm") {
-    auto video = td_api::make_object<td_api::inputMessageVideo>();
-    video->video_ = std::move(inputFile);
-    video->caption_ = std::move(formattedCaption);
-    content = std::move(video);
-  } else if (ext == "mp3" || ext == "ogg" || ext == "wav" || ext == "flac" ||
-             ext == "m4a") {
-    auto audio = td_api::make_object<td_api::inputMessageAudio>();
-    audio->audio_ = std::move(inputFile);
-    audio->caption_ = std::move(formattedCaption);
-    content = std::move(audio);
-  } else {
-    auto doc = td_api::make_object<td_api::inputMessageDocument>();
-    doc->document_ = std::move(inputFile);
-    doc->caption_ = std::move(formattedCaption);
-    content = std::move(doc);
+    if (upload.state == UploadState::Completed) {
+      return true; // Already reported
+    }
+    upload.state = state;
+
+    if (state != UploadState::Uploading) {
+      slotFreed = upload.active;
+      upload.active = false;
+      // A sent message owns its file now. A failed upload that was not sent
+      // stays as Failed so SendUploadedFile can fall back to a plain send
+      if (upload.sent || state == UploadState::Failed) {
+        m_uploadsByFileId.erase(byFile);
+      }
+      if (upload.sent) {
+        m_uploads.erase(it);
+      }
+    }
   }
 
-  auto request = td_api::make_object<td_api::sendMessage>();
-  request->chat_id_ = chatId;
-  request->input_message_content_ = std::move(content);
+  PushUploadUpdate(uploadId, state, uploadedSize, totalSize,
+                   state == UploadState::Failed ? "Upload interrupted" : "");
+  if (slotFreed) {
+    PumpUploadQueue();
+  }
+  return true;
+}
 
-  Send(std::move(request), [this](td_api::object_ptr<td_api::Object> result) {
-    if (result->get_id() == td_api::error::ID) {
-      auto error = td_api::move_object_as<td_api::error>(result);
-      PostToMainThread([this, msg = error->message_]() {
-        if (m_mainFrame) {
-          m_mainFrame->ShowStatusError(wxString::FromUTF8(msg));
-        }
-      });
-    }
-  });
+void TelegramClient::PushUploadUpdate(int uploadId, UploadState state,
+                                      int64_t uploadedSize, int64_t totalSize,
+                                      const wxString &error) {
+  {
+    std::lock_guard<std::mutex> lock(m_uploadUpdatesMutex);
+    FileUploadUpdate update;
+    update.uploadId = uploadId;
+    update.state = state;
+    update.uploadedSize = uploadedSize;
+    update.totalSize = totalSize;
+    update.error = error;
+    m_uploadUpdates.push_back(update);
+  }
+  SetDirty(DirtyFlag::Uploads);
 }
 
 void TelegramClient::RefetchMessage(int64_t chatId, int64_t messageId) {
@@ -1316,6 +2738,7 @@ void TelegramClient::RefetchMessage(int64_t chatId, int64_t messageId) {
               cachedMsg.mediaThumbnailFileId = updatedInfo.mediaThumbnailFileId;
               cachedMsg.mediaLocalPath = updatedInfo.mediaLocalPath;
               cachedMsg.mediaThumbnailPath = updatedInfo.mediaThumbnailPath;
+              cachedMsg.mediaMinithumbnail = updatedInfo.mediaMinithumbnail;
               TDLOG(
                   "RefetchMessage: updated cached message fileId=%d thumbId=%d",
                   cachedMsg.mediaFileId, cachedMsg.mediaThumbnailFileId);
@@ -1348,12 +2771,10 @@ void TelegramClient::DownloadFile(int32_t fileId, int priority,
   // During startup cooldown, only allow high-priority downloads (priority >=
   // 10) This prevents flooding when opening after a long time with many unread
   // messages
-  int64_t timeSinceStartup = wxGetUTCTime() - m_startupTime;
-  if (timeSinceStartup < STARTUP_COOLDOWN_SECONDS && priority < 10) {
-    TDLOG(
-        "DownloadFile: in startup cooldown (%lld < %d), skipping low priority "
-        "fileId=%d (priority=%d)",
-        timeSinceStartup, STARTUP_COOLDOWN_SECONDS, fileId, priority);
+  if (IsInStartupCooldown(priority)) {
+    TDLOG("DownloadFile: in startup cooldown, skipping low priority "
+          "fileId=%d (priority=%d)",
+          fileId, priority);
     return;
   }
 
@@ -1363,20 +2784,11 @@ void TelegramClient::DownloadFile(int32_t fileId, int priority,
   {
     std::lock_guard<std::mutex> lock(m_downloadsMutex);
 
-    // Count active downloads
-    size_t activeCount = 0;
-    for (const auto &pair : m_activeDownloads) {
-      if (pair.second.state == DownloadState::Downloading ||
-          pair.second.state == DownloadState::Pending) {
-        activeCount++;
-      }
-    }
-
     // If at capacity, only allow high priority downloads
-    if (activeCount >= MAX_CONCURRENT_DOWNLOADS && priority < 8) {
+    if (m_inFlightDownloads >= MAX_CONCURRENT_DOWNLOADS && priority < 8) {
       TDLOG("DownloadFile: at capacity (%zu downloads), skipping low priority "
             "fileId=%d",
-            activeCount, fileId);
+            m_inFlightDownloads, fileId);
       return;
     }
 
@@ -1401,28 +2813,19 @@ void TelegramClient::DownloadFile(int32_t fileId, int priority,
             static_cast<int>(it->second.state));
     }
 
-    // Clean up old completed/failed downloads to prevent memory growth
-    if (m_activeDownloads.size() > 100) {
-      std::vector<int32_t> toRemove;
-      for (const auto &pair : m_activeDownloads) {
-        if (pair.second.state == DownloadState::Completed ||
-            pair.second.state == DownloadState::Cancelled) {
-          toRemove.push_back(pair.first);
-        }
-      }
-      for (int32_t id : toRemove) {
-        m_activeDownloads.erase(id);
-      }
-      TDLOG("DownloadFile: cleaned up %zu old downloads", toRemove.size());
-    }
-
-    // Track this download
+    // Track this download. Any entry it replaces is Failed or Cancelled,
+    // so it was not counted in flight
     DownloadInfo info(fileId, priority);
     info.state = DownloadState::Pending;
     info.totalSize = fileSize;
     m_activeDownloads[fileId] = info;
+    m_inFlightDownloads++;
     TDLOG("DownloadFile: tracking fileId=%d, total active downloads=%zu",
           fileId, m_activeDownloads.size());
+
+    // Finished entries are dropped by the watchdog's Expire timer, so the
+    // map no longer needs a cleanup pass here. The stall timeout is armed
+    // by the first progress update: TDLib may queue the file for a while
   }
 
   // REACTIVE MVC: Add to started downloads queue for UI to poll
@@ -1467,16 +2870,23 @@ void TelegramClient::StartDownloadInternal(int32_t fileId, int priority) {
                  errorMsg.ToStdString().c_str());
            OnDownloadError(fileId, errorMsg);
          } else if (response->get_id() == td_api::file::ID) {
-           // Download started successfully - the file object will be returned
+           // Already in TDLib's cache: no updateFile will follow, so complete
+           // it from the response instead of waiting for the watchdog
            auto &file = static_cast<td_api::file &>(*response);
+           if (file.local_ && file.local_->is_downloading_completed_) {
+             auto completed = td_api::move_object_as<td_api::file>(response);
+             OnFileUpdate(completed);
+             return;
+           }
+           // Download started successfully - the file object will be returned
            TDLOG("StartDownloadInternal: TDLib accepted download for fileId=%d",
                  fileId);
            {
              std::lock_guard<std::mutex> lock(m_downloadsMutex);
              auto it = m_activeDownloads.find(fileId);
              if (it != m_activeDownloads.end()) {
-               it->second.state = DownloadState::Downloading;
-               it->second.lastProgressTime = wxGetUTCTime();
+               SetDownloadStateLocked(it->second, DownloadState::Downloading);
+               it->second.lastProgressTime = DownloadInfo::Now();
                if (file.size_ > 0) {
                  it->second.totalSize = file.size_;
                } else if (file.expected_size_ > 0) {
@@ -1502,12 +2912,14 @@ void TelegramClient::RetryDownload(int32_t fileId) {
 
     if (!it->second.CanRetry()) {
       // Max retries exceeded - UI will see Failed state when it polls
+      ScheduleDownloadTimer(fileId, DownloadTimer::Expire,
+                            DOWNLOAD_EXPIRY_SECONDS * 1000LL);
       return;
     }
 
     it->second.retryCount++;
-    it->second.state = DownloadState::Pending;
-    it->second.lastProgressTime = wxGetUTCTime();
+    SetDownloadStateLocked(it->second, DownloadState::Pending);
+    it->second.lastProgressTime = DownloadInfo::Now();
     priority = it->second.priority;
 
     TDLOG("Retrying download for file %d (attempt %d/%d)", fileId,
@@ -1537,6 +2949,21 @@ DownloadState TelegramClient::GetDownloadState(int32_t fileId) const {
   return it->second.state;
 }
 
+bool TelegramClient::GetDownloadInfo(int32_t fileId,
+                                     DownloadInfo &info) const {
+  std::lock_guard<std::mutex> lock(m_downloadsMutex);
+  auto it = m_activeDownloads.find(fileId);
+  if (it == m_activeDownloads.end())
+    return false;
+  info = it->second;
+  return true;
+}
+
+bool TelegramClient::IsInStartupCooldown(int priority) const {
+  return priority < 10 &&
+         wxGetUTCTime() - m_startupTime < STARTUP_COOLDOWN_SECONDS;
+}
+
 int TelegramClient::GetDownloadProgress(int32_t fileId) const {
   std::lock_guard<std::mutex> lock(m_downloadsMutex);
   auto it = m_activeDownloads.find(fileId);
@@ -1563,8 +2990,11 @@ void TelegramClient::BoostDownloadPriority(int32_t fileId) {
   // Check download state
   {
     std::lock_guard<std::mutex> lock(m_downloadsMutex);
+    // Explicit user request - the viewport must not demote or cancel it
+    m_viewportFileIds.erase(fileId);
     auto it = m_activeDownloads.find(fileId);
     if (it != m_activeDownloads.end()) {
+      it->second.priority = 32;
       if (it->second.state == DownloadState::Completed) {
         TDLOG("BoostDownloadPriority: fileId=%d already completed", fileId);
         return; // Already done
@@ -1572,7 +3002,7 @@ void TelegramClient::BoostDownloadPriority(int32_t fileId) {
 
       // Check if download is stuck (Pending for more than 10 seconds or no
       // progress for 30s)
-      int64_t now = wxGetUTCTime();
+      int64_t now = DownloadInfo::Now();
       int64_t elapsed = now - it->second.startTime;
       int64_t lastProgress = now - it->second.lastProgressTime;
 
@@ -1630,8 +3060,10 @@ void TelegramClient::BoostDownloadPriority(int32_t fileId) {
           std::lock_guard<std::mutex> lock(m_downloadsMutex);
           auto it = m_activeDownloads.find(fileId);
           if (it != m_activeDownloads.end()) {
-            it->second.state = DownloadState::Completed;
+            SetDownloadStateLocked(it->second, DownloadState::Completed);
             it->second.localPath = localPath;
+            ScheduleDownloadTimer(fileId, DownloadTimer::Expire,
+                                  DOWNLOAD_EXPIRY_SECONDS * 1000LL);
           }
         }
         // Add to completed queue
@@ -1649,14 +3081,124 @@ void TelegramClient::BoostDownloadPriority(int32_t fileId) {
         std::lock_guard<std::mutex> lock(m_downloadsMutex);
         auto it = m_activeDownloads.find(fileId);
         if (it != m_activeDownloads.end()) {
-          it->second.state = DownloadState::Downloading;
-          it->second.lastProgressTime = wxGetUTCTime();
+          SetDownloadStateLocked(it->second, DownloadState::Downloading);
+          it->second.lastProgressTime = DownloadInfo::Now();
         }
       }
     }
   });
 }
 
+void TelegramClient::UpdateViewportDownloads(
+    const std::vector<ViewportMediaFile> &visible,
+    const std::vector<ViewportMediaFile> &nearby,
+    const std::vector<int32_t> &distant) {
+  std::vector<std::pair<ViewportMediaFile, int>> toStart;
+  std::vector<std::pair<int32_t, int>> toReprioritize;
+  std::vector<int32_t> toCancel;
+
+  {
+    std::lock_guard<std::mutex> lock(m_downloadsMutex);
+
+    auto request = [&](const ViewportMediaFile &file, int priority) {
+      if (file.fileId == 0)
+        return;
+      auto it = m_activeDownloads.find(file.fileId);
+      if (it == m_activeDownloads.end() ||
+          it->second.state == DownloadState::Cancelled) {
+        m_viewportFileIds.insert(file.fileId);
+        toStart.emplace_back(file, priority);
+        return;
+      }
+      // Completed needs nothing; Failed is handled by the retry backoff
+      if (it->second.state != DownloadState::Pending &&
+          it->second.state != DownloadState::Downloading) {
+        return;
+      }
+      // Downloads we own follow the viewport up and down; anything else
+      // (popup boosts, auto-download) is only ever raised, then adopted
+      bool owned = m_viewportFileIds.count(file.fileId) > 0;
+      if (it->second.priority == priority ||
+          (!owned && it->second.priority > priority)) {
+        return;
+      }
+      it->second.priority = priority;
+      m_viewportFileIds.insert(file.fileId);
+      toReprioritize.emplace_back(file.fileId, priority);
+    };
+
+    for (const auto &file : visible) {
+      request(file, VIEWPORT_VISIBLE_PRIORITY);
+    }
+    for (const auto &file : nearby) {
+      request(file, VIEWPORT_NEARBY_PRIORITY);
+    }
+
+    for (int32_t fileId : distant) {
+      if (m_viewportFileIds.count(fileId) == 0)
+        continue;
+      auto it = m_activeDownloads.find(fileId);
+      if (it == m_activeDownloads.end() ||
+          (it->second.state != DownloadState::Pending &&
+           it->second.state != DownloadState::Downloading)) {
+        m_viewportFileIds.erase(fileId);
+        continue;
+      }
+      if (it->second.downloadedSize == 0) {
+        // Nothing fetched yet - drop it, it is re-requested if scrolled back
+        SetDownloadStateLocked(it->second, DownloadState::Cancelled);
+        m_viewportFileIds.erase(fileId);
+        ScheduleDownloadTimer(fileId, DownloadTimer::Expire,
+                              DOWNLOAD_EXPIRY_SECONDS * 1000LL);
+        toCancel.push_back(fileId);
+      } else if (it->second.priority != VIEWPORT_DISTANT_PRIORITY) {
+        // Keep partial progress but stop competing for bandwidth
+        it->second.priority = VIEWPORT_DISTANT_PRIORITY;
+        toReprioritize.emplace_back(fileId, VIEWPORT_DISTANT_PRIORITY);
+      }
+    }
+  }
+
+  TDLOG("UpdateViewportDownloads: start=%zu reprioritize=%zu cancel=%zu",
+        toStart.size(), toReprioritize.size(), toCancel.size());
+
+  for (const auto &[file, priority] : toStart) {
+    DownloadFile(file.fileId, priority, file.fileName, file.fileSize);
+  }
+
+  // downloadFile on an active file just changes its priority in TDLib
+  for (const auto &[fileId, priority] : toReprioritize) {
+    auto request = td_api::make_object<td_api::downloadFile>();
+    request->file_id_ = fileId;
+    request->priority_ = priority;
+    request->synchronous_ = false;
+    Send(std::move(request), nullptr);
+  }
+
+  if (toCancel.empty())
+    return;
+
+  for (int32_t fileId : toCancel) {
+    auto request = td_api::make_object<td_api::cancelDownloadFile>();
+    request->file_id_ = fileId;
+    request->only_if_pending_ = false;
+    Send(std::move(request), nullptr);
+  }
+
+  // REACTIVE MVC: Let the UI release transfer rows and pending markers
+  {
+    std::lock_guard<std::mutex> lock(m_completedDownloadsMutex);
+    for (int32_t fileId : toCancel) {
+      FileDownloadResult result;
+      result.fileId = fileId;
+      result.success = false;
+      result.cancelled = true;
+      m_completedDownloads.push_back(result);
+    }
+  }
+  SetDirty(DirtyFlag::Downloads);
+}
+
 bool TelegramClient::ShouldAutoDownloadMedia(MediaType type,
                                              int64_t fileSize) const {
   // Size limits for auto-download (in bytes)
@@ -1789,10 +3331,20 @@ void TelegramClient::OnDownloadError(int32_t fileId, const wxString &error) {
     std::lock_guard<std::mutex> lock(m_downloadsMutex);
     auto it = m_activeDownloads.find(fileId);
     if (it != m_activeDownloads.end()) {
-      it->second.state = DownloadState::Failed;
+      SetDownloadStateLocked(it->second, DownloadState::Failed);
       it->second.errorMessage = error;
       shouldRetry = it->second.CanRetry();
       retryCount = it->second.retryCount;
+
+      if (shouldRetry) {
+        // Exponential backoff: 500ms, 1000ms, 2000ms based on retry count
+        int delayMs = 500 * (1 << retryCount);
+        delayMs = std::min(delayMs, 5000); // Cap at 5 seconds
+        ScheduleDownloadTimer(fileId, DownloadTimer::Retry, delayMs);
+      } else {
+        ScheduleDownloadTimer(fileId, DownloadTimer::Expire,
+                              DOWNLOAD_EXPIRY_SECONDS * 1000LL);
+      }
     }
   }
 
@@ -1806,51 +3358,95 @@ void TelegramClient::OnDownloadError(int32_t fileId, const wxString &error) {
     m_completedDownloads.push_back(result);
   }
   SetDirty(DirtyFlag::Downloads);
+}
 
-  if (shouldRetry) {
-    // Schedule retry after a delay using CallAfter with a one-shot timer
-    // Exponential backoff: 500ms, 1000ms, 2000ms based on retry count
-    int delayMs = 500 * (1 << retryCount); // 500, 1000, 2000, etc.
-    delayMs = std::min(delayMs, 5000);     // Cap at 5 seconds
-
-    // Use CallAfter to schedule the timer on main thread without blocking
-    wxTheApp->CallAfter([this, fileId, delayMs]() {
-      // Create a one-shot timer for the retry
-      wxTimer *retryTimer = new wxTimer();
-      retryTimer->Bind(wxEVT_TIMER, [this, fileId, retryTimer](wxTimerEvent &) {
-        RetryDownload(fileId);
-        retryTimer->Stop();
-        delete retryTimer;
-      });
-      retryTimer->StartOnce(delayMs);
-    });
+void TelegramClient::SetDownloadStateLocked(DownloadInfo &info,
+                                            DownloadState state) {
+  auto inFlight = [](DownloadState s) {
+    return s == DownloadState::Pending || s == DownloadState::Downloading;
+  };
+  if (inFlight(info.state) && !inFlight(state)) {
+    m_inFlightDownloads--;
+  } else if (!inFlight(info.state) && inFlight(state)) {
+    m_inFlightDownloads++;
   }
+  info.state = state;
+}
+
+void TelegramClient::ScheduleDownloadTimer(int32_t fileId,
+                                           DownloadTimer timer,
+                                           int64_t delayMs) {
+  m_downloadWatchdog.Schedule(fileId, static_cast<int>(timer), delayMs,
+                              SteadyMillis());
 }
 
 void TelegramClient::CheckDownloadTimeouts() {
+  // Only the timers that are due come back from the wheel
+  auto due = m_downloadWatchdog.Advance(SteadyMillis());
+  if (due.empty()) {
+    return;
+  }
+
   std::vector<int32_t> timedOutFiles;
+  std::vector<int32_t> retryFiles;
 
   {
     std::lock_guard<std::mutex> lock(m_downloadsMutex);
-    int activeCount = 0;
-    for (auto &pair : m_activeDownloads) {
-      if (pair.second.state == DownloadState::Downloading) {
-        activeCount++;
-        if (pair.second.IsTimedOut()) {
-          timedOutFiles.push_back(pair.first);
+    int64_t now = DownloadInfo::Now();
+    for (const auto &timer : due) {
+      int32_t fileId = static_cast<int32_t>(timer.key);
+      auto it = m_activeDownloads.find(fileId);
+      if (it == m_activeDownloads.end()) {
+        continue;
+      }
+      DownloadInfo &info = it->second;
+
+      switch (static_cast<DownloadTimer>(timer.tag)) {
+      case DownloadTimer::Timeout:
+        // Only armed once bytes flow; a retry or cancel since then ends it
+        if (info.state != DownloadState::Downloading) {
+          break;
+        }
+        if (info.IsTimedOut(now)) {
+          timedOutFiles.push_back(fileId);
+        } else {
+          // Progress arrived since the timer was armed - push the deadline
+          // out instead of re-arming on every progress update
+          int64_t idle = now - info.lastProgressTime;
+          ScheduleDownloadTimer(
+              fileId, DownloadTimer::Timeout,
+              (DownloadInfo::TIMEOUT_SECONDS - idle) * 1000LL);
+        }
+        break;
+      case DownloadTimer::Retry:
+        if (info.state == DownloadState::Failed) {
+          retryFiles.push_back(fileId);
+        }
+        break;
+      case DownloadTimer::Expire:
+        if (info.state == DownloadState::Completed ||
+            info.state == DownloadState::Cancelled ||
+            info.state == DownloadState::Failed) {
+          m_viewportFileIds.erase(fileId);
+          m_activeDownloads.erase(it);
         }
+        break;
       }
     }
-    if (activeCount > 0) {
-      TDLOG("CheckDownloadTimeouts: %d active downloads, %zu timed out",
-            activeCount, timedOutFiles.size());
-    }
+    TDLOG("CheckDownloadTimeouts: %zu due, %zu timed out, %zu retries, "
+          "%zu tracked",
+          due.size(), timedOutFiles.size(), retryFiles.size(),
+          m_activeDownloads.size());
   }
 
   for (int32_t fileId : timedOutFiles) {
     TDLOG("Download timeout for file %d, retrying...", fileId);
     OnDownloadError(fileId, "Download timed out - no progress");
   }
+
+  for (int32_t fileId : retryFiles) {
+    RetryDownload(fileId);
+  }
 }
 
 void TelegramClient::OnDownloadTimeoutTimer(wxTimerEvent &event) {
@@ -1858,12 +3454,18 @@ void TelegramClient::OnDownloadTimeoutTimer(wxTimerEvent &event) {
 }
 
 void TelegramClient::CancelDownload(int32_t fileId) {
+  bool wasActive = false;
   {
     std::lock_guard<std::mutex> lock(m_downloadsMutex);
     auto it = m_activeDownloads.find(fileId);
     if (it != m_activeDownloads.end()) {
-      it->second.state = DownloadState::Cancelled;
+      wasActive = it->second.state == DownloadState::Pending ||
+                  it->second.state == DownloadState::Downloading;
+      SetDownloadStateLocked(it->second, DownloadState::Cancelled);
+      ScheduleDownloadTimer(fileId, DownloadTimer::Expire,
+                            DOWNLOAD_EXPIRY_SECONDS * 1000LL);
     }
+    m_viewportFileIds.erase(fileId);
   }
 
   auto request = td_api::make_object<td_api::cancelDownloadFile>();
@@ -1871,6 +3473,19 @@ void TelegramClient::CancelDownload(int32_t fileId) {
   request->only_if_pending_ = false;
 
   Send(std::move(request), nullptr);
+
+  // REACTIVE MVC: Let the UI release the transfer row
+  if (wasActive) {
+    {
+      std::lock_guard<std::mutex> lock(m_completedDownloadsMutex);
+      FileDownloadResult result;
+      result.fileId = fileId;
+      result.success = false;
+      result.cancelled = true;
+      m_completedDownloads.push_back(result);
+    }
+    SetDirty(DirtyFlag::Downloads);
+  }
 }
 
 UserInfo TelegramClient::GetUser(int64_t userId, bool *found) const {
@@ -1886,6 +3501,11 @@ UserInfo TelegramClient::GetUser(int64_t userId, bool *found) const {
   return UserInfo();
 }
 
+std::map<int64_t, UserInfo> TelegramClient::GetUsers() const {
+  std::shared_lock<std::shared_mutex> lock(m_dataMutex);
+  return m_users;
+}
+
 wxString TelegramClient::GetUserDisplayName(int64_t userId) const {
   bool found = false;
   UserInfo user = GetUser(userId, &found);
@@ -1895,7 +3515,7 @@ wxString TelegramClient::GetUserDisplayName(int64_t userId) const {
   return wxString::Format("User %lld", userId);
 }
 
-void TelegramClient::LoadChatMembers(int64_t chatId, int limit) {
+void TelegramClient::LoadChatMembers(int64_t chatId) {
   if (chatId == 0)
     return;
 
@@ -1922,131 +3542,228 @@ void TelegramClient::LoadChatMembers(int64_t chatId, int limit) {
       }
     }
 
-    PostToMainThread([this, chatId, members]() {
-      if (m_mainFrame) {
-        m_mainFrame->OnMembersLoaded(chatId, members);
-      }
-    });
+    int32_t count = static_cast<int32_t>(members.size());
+    PostMembers(chatId, std::move(members), true, true, count);
     return;
   }
 
-  // For supergroups and channels
-  if (chat.isSupergroup || chat.isChannel) {
-    auto request = td_api::make_object<td_api::getSupergroupMembers>();
-    request->supergroup_id_ = chat.supergroupId;
-    request->filter_ =
-        td_api::make_object<td_api::supergroupMembersFilterRecent>();
-    request->offset_ = 0;
-    request->limit_ = limit;
+  bool paged = chat.isSupergroup || chat.isChannel;
+  if (!paged && !(chat.isGroup && chat.basicGroupId != 0)) {
+    TDLOG("LoadChatMembers: unknown chat type");
+    return;
+  }
 
-    Send(std::move(request), [this, chatId](
-                                 td_api::object_ptr<td_api::Object> result) {
-      if (!result) {
-        TDLOG("LoadChatMembers: null result for supergroup");
-        return;
-      }
+  // Serve what the cache has right away; refetch in the background when it
+  // is stale or was interrupted
+  std::vector<int64_t> cachedIds;
+  int32_t cachedTotal = 0;
+  bool fresh = false;
+  bool alreadyLoading = false;
+  {
+    std::lock_guard<std::mutex> lock(m_memberCacheMutex);
+    m_memberPagingChatId = chatId;
+    MemberCache &cache = m_memberCache[chatId];
+    cachedIds = cache.complete ? cache.userIds : cache.pendingIds;
+    cachedTotal = cache.totalCount;
+    fresh = cache.complete &&
+            wxGetUTCTime() - cache.fetchedAt < MEMBER_CACHE_TTL_SECONDS;
+    alreadyLoading = cache.loading;
+    if (!fresh && !alreadyLoading) {
+      cache.loading = true;
+      cache.pendingIds.clear();
+    }
+  }
 
-      if (result->get_id() == td_api::error::ID) {
-        auto error = td_api::move_object_as<td_api::error>(result);
-        TDLOG("LoadChatMembers error: %s", error->message_.c_str());
-        return;
-      }
+  if (!cachedIds.empty() || fresh) {
+    PostMembers(chatId, UsersFromIds(cachedIds), true, fresh, cachedTotal);
+  }
+  if (fresh || alreadyLoading) {
+    return;
+  }
 
-      if (result->get_id() != td_api::chatMembers::ID) {
-        TDLOG("LoadChatMembers: unexpected result type");
-        return;
-      }
+  if (paged) {
+    FetchMemberPage(chatId, chat.supergroupId, 0);
+    return;
+  }
 
-      auto chatMembers = td_api::move_object_as<td_api::chatMembers>(result);
-      std::vector<UserInfo> members;
+  // Basic groups hold at most a few hundred members, all in the full info
+  auto request = td_api::make_object<td_api::getBasicGroupFullInfo>();
+  request->basic_group_id_ = chat.basicGroupId;
 
-      for (auto &member : chatMembers->members_) {
-        if (!member)
-          continue;
+  Send(std::move(request), [this, chatId](
+                               td_api::object_ptr<td_api::Object> result) {
+    if (!result) {
+      TDLOG("LoadChatMembers: null result for basic group");
+      FinishMemberLoad(chatId, false);
+      return;
+    }
 
-        // Get user ID from member
-        int64_t memberId = 0;
-        if (member->member_id_->get_id() == td_api::messageSenderUser::ID) {
-          auto sender = static_cast<td_api::messageSenderUser *>(
-              member->member_id_.get());
-          memberId = sender->user_id_;
-        }
+    if (result->get_id() == td_api::error::ID) {
+      auto error = td_api::move_object_as<td_api::error>(result);
+      TDLOG("LoadChatMembers error: %s", error->message_.c_str());
+      FinishMemberLoad(chatId, false);
+      return;
+    }
 
-        if (memberId != 0) {
-          bool userFound = false;
-          UserInfo user = GetUser(memberId, &userFound);
-          if (userFound) {
-            members.push_back(user);
-          }
-        }
+    if (result->get_id() != td_api::basicGroupFullInfo::ID) {
+      TDLOG("LoadChatMembers: unexpected result type for basic group");
+      FinishMemberLoad(chatId, false);
+      return;
+    }
+
+    auto groupInfo = td_api::move_object_as<td_api::basicGroupFullInfo>(result);
+    std::vector<int64_t> ids;
+    ids.reserve(groupInfo->members_.size());
+    for (auto &member : groupInfo->members_) {
+      if (member && member->member_id_ &&
+          member->member_id_->get_id() == td_api::messageSenderUser::ID) {
+        ids.push_back(static_cast<td_api::messageSenderUser *>(
+                          member->member_id_.get())
+                          ->user_id_);
       }
+    }
 
-      PostToMainThread([this, chatId, members]() {
-        if (m_mainFrame) {
-          m_mainFrame->OnMembersLoaded(chatId, members);
-        }
-      });
-    });
-    return;
-  }
+    {
+      std::lock_guard<std::mutex> lock(m_memberCacheMutex);
+      MemberCache &cache = m_memberCache[chatId];
+      cache.pendingIds = ids;
+      cache.totalCount = static_cast<int32_t>(ids.size());
+    }
+    FinishMemberLoad(chatId, true);
+  });
+}
 
-  // For basic groups
-  if (chat.isGroup && chat.basicGroupId != 0) {
-    auto request = td_api::make_object<td_api::getBasicGroupFullInfo>();
-    request->basic_group_id_ = chat.basicGroupId;
+void TelegramClient::FetchMemberPage(int64_t chatId, int64_t supergroupId,
+                                     int32_t offset) {
+  auto request = td_api::make_object<td_api::getSupergroupMembers>();
+  request->supergroup_id_ = supergroupId;
+  request->filter_ =
+      td_api::make_object<td_api::supergroupMembersFilterRecent>();
+  request->offset_ = offset;
+  request->limit_ = MEMBER_PAGE_SIZE;
 
-    Send(std::move(request), [this, chatId](
-                                 td_api::object_ptr<td_api::Object> result) {
-      if (!result) {
-        TDLOG("LoadChatMembers: null result for basic group");
-        return;
-      }
+  Send(std::move(request), [this, chatId, supergroupId, offset](
+                               td_api::object_ptr<td_api::Object> result) {
+    if (!result) {
+      TDLOG("LoadChatMembers: null result for supergroup");
+      FinishMemberLoad(chatId, false);
+      return;
+    }
 
-      if (result->get_id() == td_api::error::ID) {
-        auto error = td_api::move_object_as<td_api::error>(result);
-        TDLOG("LoadChatMembers error: %s", error->message_.c_str());
-        return;
+    if (result->get_id() == td_api::error::ID) {
+      auto error = td_api::move_object_as<td_api::error>(result);
+      TDLOG("LoadChatMembers error: %s", error->message_.c_str());
+      FinishMemberLoad(chatId, false);
+      return;
+    }
+
+    if (result->get_id() != td_api::chatMembers::ID) {
+      TDLOG("LoadChatMembers: unexpected result type");
+      FinishMemberLoad(chatId, false);
+      return;
+    }
+
+    auto chatMembers = td_api::move_object_as<td_api::chatMembers>(result);
+    std::vector<int64_t> pageIds;
+    pageIds.reserve(chatMembers->members_.size());
+    for (auto &member : chatMembers->members_) {
+      if (member && member->member_id_ &&
+          member->member_id_->get_id() == td_api::messageSenderUser::ID) {
+        pageIds.push_back(static_cast<td_api::messageSenderUser *>(
+                              member->member_id_.get())
+                              ->user_id_);
       }
+    }
 
-      if (result->get_id() != td_api::basicGroupFullInfo::ID) {
-        TDLOG("LoadChatMembers: unexpected result type for basic group");
-        return;
+    int32_t received = static_cast<int32_t>(chatMembers->members_.size());
+    int32_t nextOffset = offset + received;
+    // The server stops listing "recent" members of big groups at around 10k
+    bool done = received == 0 || nextOffset >= chatMembers->total_count_;
+
+    bool keepPaging = false;
+    {
+      std::lock_guard<std::mutex> lock(m_memberCacheMutex);
+      MemberCache &cache = m_memberCache[chatId];
+      cache.pendingIds.insert(cache.pendingIds.end(), pageIds.begin(),
+                              pageIds.end());
+      cache.totalCount = chatMembers->total_count_;
+      keepPaging = !done && m_memberPagingChatId == chatId;
+      if (!done && !keepPaging) {
+        // Another chat took over; reopening this one starts a new pass.
+        // Cleared under the lock so LoadChatMembers never sees a pass that
+        // is about to stop.
+        cache.loading = false;
       }
+    }
 
-      auto groupInfo =
-          td_api::move_object_as<td_api::basicGroupFullInfo>(result);
-      std::vector<UserInfo> members;
+    if (done) {
+      FinishMemberLoad(chatId, true);
+      return;
+    }
 
-      for (auto &member : groupInfo->members_) {
-        if (!member)
-          continue;
+    // Stream the page; the final replace drops anyone who left meanwhile
+    PostMembers(chatId, UsersFromIds(pageIds), false, false,
+                chatMembers->total_count_);
 
-        int64_t memberId = 0;
-        if (member->member_id_->get_id() == td_api::messageSenderUser::ID) {
-          auto sender = static_cast<td_api::messageSenderUser *>(
-              member->member_id_.get());
-          memberId = sender->user_id_;
-        }
+    if (keepPaging) {
+      FetchMemberPage(chatId, supergroupId, nextOffset);
+    }
+  });
+}
 
-        if (memberId != 0) {
-          bool userFound = false;
-          UserInfo user = GetUser(memberId, &userFound);
-          if (userFound) {
-            members.push_back(user);
-          }
-        }
+void TelegramClient::FinishMemberLoad(int64_t chatId, bool complete) {
+  std::vector<int64_t> ids;
+  int32_t total = 0;
+  {
+    std::lock_guard<std::mutex> lock(m_memberCacheMutex);
+    MemberCache &cache = m_memberCache[chatId];
+    cache.loading = false;
+    if (!complete) {
+      return;
+    }
+    // Drop duplicates from members shifting between pages
+    std::set<int64_t> seen;
+    ids.reserve(cache.pendingIds.size());
+    for (int64_t id : cache.pendingIds) {
+      if (seen.insert(id).second) {
+        ids.push_back(id);
       }
+    }
+    cache.pendingIds.clear();
+    cache.userIds = ids;
+    cache.fetchedAt = wxGetUTCTime();
+    cache.complete = true;
+    total = cache.totalCount;
+  }
 
-      PostToMainThread([this, chatId, members]() {
-        if (m_mainFrame) {
-          m_mainFrame->OnMembersLoaded(chatId, members);
-        }
-      });
-    });
-    return;
+  // The final list replaces whatever was streamed or served stale
+  PostMembers(chatId, UsersFromIds(ids), true, true, total);
+}
+
+std::vector<UserInfo>
+TelegramClient::UsersFromIds(const std::vector<int64_t> &userIds) const {
+  std::vector<UserInfo> users;
+  users.reserve(userIds.size());
+  std::shared_lock<std::shared_mutex> lock(m_dataMutex);
+  for (int64_t id : userIds) {
+    auto it = m_users.find(id);
+    if (it != m_users.end()) {
+      users.push_back(it->second);
+    }
   }
+  return users;
+}
 
-  TDLOG("LoadChatMembers: unknown chat type");
+void TelegramClient::PostMembers(int64_t chatId, std::vector<UserInfo> members,
+                                 bool replace, bool complete,
+                                 int32_t totalCount) {
+  PostToMainThread([this, chatId, members = std::move(members), replace,
+                    complete, totalCount]() {
+    if (m_mainFrame) {
+      m_mainFrame->OnMembersLoaded(chatId, members, replace, complete,
+                                   totalCount);
+    }
+  });
 }
 
 void TelegramClient::MarkChatAsRead(int64_t chatId) {
@@ -2128,7 +3845,12 @@ void TelegramClient::OnNewMessage(
   {
     std::unique_lock<std::shared_mutex> lock(m_dataMutex);
     m_messages[msgInfo.chatId].push_back(msgInfo);
+    auto intervals = m_loadedIntervals.find(msgInfo.chatId);
+    if (intervals != m_loadedIntervals.end()) {
+      intervals->second.ExtendNewest(msgInfo.id);
+    }
   }
+  m_searchIndex.Add(msgInfo);
 
   // LAZY LOADING: Only download thumbnails for current chat
   // Full media is downloaded on-demand when user interacts
@@ -2171,6 +3893,7 @@ void TelegramClient::OnMessageEdited(
       }
     }
   }
+  m_searchIndex.UpdateText(chatId, messageId, newText);
 
   // REACTIVE MVC: Add to updated messages queue
   {
@@ -2193,7 +3916,7 @@ void TelegramClient::OnChatUpdate(td_api::object_ptr<td_api::chat> &chat) {
   // Track sync activity - if many updates arrive rapidly, we're syncing
   if (m_isSyncing.load()) {
     m_syncUpdateCount++;
-    int64_t now = wxGetUTCTimeMillis().GetValue();
+    int64_t now = SteadyMillis();
     int64_t elapsed = now - m_syncStartTime;
     
     // Check if sync should end (connection is ready and updates have slowed down)
@@ -2264,6 +3987,7 @@ void TelegramClient::OnChatUpdate(td_api::object_ptr<td_api::chat> &chat) {
   {
     std::unique_lock<std::shared_mutex> lock(m_dataMutex);
     m_chats[info.id] = info;
+    m_unconfirmedChatIds.erase(info.id);
   }
 
   // REACTIVE MVC: Set dirty flag instead of posting callback
@@ -2332,6 +4056,7 @@ void TelegramClient::OnUserUpdate(td_api::object_ptr<td_api::user> &user) {
   {
     std::unique_lock<std::shared_mutex> lock(m_dataMutex);
     m_users[info.id] = info;
+    m_directoryVersion++;
 
     // Update chat info if this user has a private chat
     for (auto &[chatId, chat] : m_chats) {
@@ -2436,6 +4161,10 @@ void TelegramClient::OnFileUpdate(td_api::object_ptr<td_api::file> &file) {
   if (fileId == 0)
     return; // Invalid file ID
 
+  // Pre-uploads report through their own queue
+  if (OnUploadFileUpdate(*file))
+    return;
+
   bool isDownloading = file->local_->is_downloading_active_;
   bool isComplete = file->local_->is_downloading_completed_;
   wxString localPath = wxString::FromUTF8(file->local_->path_);
@@ -2449,17 +4178,24 @@ void TelegramClient::OnFileUpdate(td_api::object_ptr<td_api::file> &file) {
     auto it = m_activeDownloads.find(fileId);
     if (it != m_activeDownloads.end()) {
       if (isComplete) {
-        it->second.state = DownloadState::Completed;
+        SetDownloadStateLocked(it->second, DownloadState::Completed);
         it->second.localPath = localPath;
         it->second.downloadedSize = downloadedSize;
+        ScheduleDownloadTimer(fileId, DownloadTimer::Expire,
+                              DOWNLOAD_EXPIRY_SECONDS * 1000LL);
         TDLOG("OnFileUpdate: Download COMPLETED for fileId=%d path=%s", fileId,
               localPath.ToStdString().c_str());
       } else if (isDownloading) {
-        it->second.state = DownloadState::Downloading;
+        SetDownloadStateLocked(it->second, DownloadState::Downloading);
         it->second.downloadedSize = downloadedSize;
         it->second.totalSize = totalSize;
         // Update progress time to prevent false timeout
-        it->second.lastProgressTime = wxGetUTCTime();
+        it->second.lastProgressTime = DownloadInfo::Now();
+        // Bytes are flowing: from here on no progress means a stall
+        if (downloadedSize > 0 && !m_downloadWatchdog.IsScheduled(fileId)) {
+          ScheduleDownloadTimer(fileId, DownloadTimer::Timeout,
+                                DownloadInfo::TIMEOUT_SECONDS * 1000LL);
+        }
       }
     } else {
       // File update for a file we're not tracking - could be auto-download
@@ -2728,6 +4464,9 @@ MessageInfo TelegramClient::ConvertMessage(td_api::message *msg) {
         if (c.caption_) {
           info.mediaCaption = wxString::FromUTF8(c.caption_->text_);
         }
+        if (c.photo_ && c.photo_->minithumbnail_) {
+          info.mediaMinithumbnail = c.photo_->minithumbnail_->data_;
+        }
         // Get smallest photo size for thumbnail (first), largest for full
         // (last)
         if (c.photo_ && !c.photo_->sizes_.empty()) {
@@ -2767,6 +4506,9 @@ MessageInfo TelegramClient::ConvertMessage(td_api::message *msg) {
         if (c.video_) {
           // Extract duration
           info.mediaDuration = c.video_->duration_;
+          if (c.video_->minithumbnail_) {
+            info.mediaMinithumbnail = c.video_->minithumbnail_->data_;
+          }
 
           if (c.video_->video_) {
             info.mediaFileId = c.video_->video_->id_;
@@ -2840,6 +4582,9 @@ MessageInfo TelegramClient::ConvertMessage(td_api::message *msg) {
         if (c.video_note_) {
           // Extract duration
           info.mediaDuration = c.video_note_->duration_;
+          if (c.video_note_->minithumbnail_) {
+            info.mediaMinithumbnail = c.video_note_->minithumbnail_->data_;
+          }
 
           if (c.video_note_->video_) {
             info.mediaFileId = c.video_note_->video_->id_;
@@ -2927,6 +4672,9 @@ MessageInfo TelegramClient::ConvertMessage(td_api::message *msg) {
           info.mediaCaption = wxString::FromUTF8(c.caption_->text_);
         }
         if (c.animation_) {
+          if (c.animation_->minithumbnail_) {
+            info.mediaMinithumbnail = c.animation_->minithumbnail_->data_;
+          }
           if (c.animation_->animation_) {
             info.mediaFileId = c.animation_->animation_->id_;
             info.mediaFileName = wxString::FromUTF8(c.animation_->file_name_);
@@ -3199,6 +4947,9 @@ void TelegramClient::OnTdlibUpdate(wxThreadEvent &event) {
 void TelegramClient::SetDirty(DirtyFlag flag) {
   // Atomically set the dirty flag
   m_dirtyFlags.fetch_or(static_cast<uint32_t>(flag));
+  if ((flag & DirtyFlag::ChatList) != DirtyFlag::None) {
+    m_directoryVersion++;
+  }
 
   // Notify UI to refresh (coalesced - only one event in flight)
   NotifyUIRefresh();
@@ -3305,6 +5056,13 @@ std::vector<FileDownloadProgress> TelegramClient::GetDownloadProgressUpdates() {
   return result;
 }
 
+std::vector<FileUploadUpdate> TelegramClient::GetUploadUpdates() {
+  std::lock_guard<std::mutex> lock(m_uploadUpdatesMutex);
+  std::vector<FileUploadUpdate> result;
+  result.swap(m_uploadUpdates);
+  return result;
+}
+
 std::vector<int64_t> TelegramClient::GetDeletedMessages(int64_t chatId) {
   std::lock_guard<std::mutex> lock(m_deletedMessagesMutex);
   std::vector<int64_t> result;
@@ -7,6 +7,7 @@
 #include <wx/wx.h>
 
 #include <atomic>
+#include <deque>
 #include <functional>
 #include <map>
 #include <memory>
@@ -17,6 +18,9 @@
 #include <thread>
 
 #include "../ui/MediaTypes.h"
+#include "HistoryIntervals.h"
+#include "MessageSearchIndex.h"
+#include "TimerWheel.h"
 #include "Types.h"
 
 // Dirty flags for reactive UI updates - View polls these instead of receiving
@@ -28,6 +32,7 @@ enum class DirtyFlag : uint32_t {
   Downloads = 1 << 2,  // Download state changed
   UserStatus = 1 << 3, // User online status changed
   Auth = 1 << 4,       // Auth state changed
+  Uploads = 1 << 5,    // Pre-upload state changed
   All = 0xFFFFFFFF
 };
 
@@ -64,6 +69,23 @@ struct FileDownloadResult {
   wxString localPath;
   bool success;
   wxString error;
+  bool cancelled = false; // Cancelled by us (e.g. scrolled out of view)
+};
+
+// Pre-upload state change - for reactive UI to poll
+struct FileUploadUpdate {
+  int uploadId;
+  UploadState state;
+  int64_t uploadedSize;
+  int64_t totalSize;
+  wxString error;
+};
+
+// Media file referenced from the chat viewport - see UpdateViewportDownloads
+struct ViewportMediaFile {
+  int32_t fileId;
+  wxString fileName;
+  int64_t fileSize;
 };
 
 // Forward declarations
@@ -115,6 +137,15 @@ public:
 
   std::map<int64_t, ChatInfo> GetChats() const;
   ChatInfo GetChat(int64_t chatId, bool *found = nullptr) const;
+  // Messages held in memory for a chat, oldest first
+  std::vector<MessageInfo> GetCachedMessages(int64_t chatId) const;
+
+  // Warm start (see WarmSnapshot). Load before Start() to fill the caches
+  // from the last session so the UI can draw at once; TDLib updates then
+  // overwrite the entries, and everything is dropped if the session turns
+  // out to be logged out. Saved every few minutes and on SaveWarmSnapshot.
+  bool LoadWarmSnapshot(int64_t *lastChatId);
+  void SaveWarmSnapshot();
 
   void OpenChat(int64_t chatId);
   void CloseChat(int64_t chatId);
@@ -123,11 +154,49 @@ public:
   // ones reactively
   void OpenChatAndLoadMessages(int64_t chatId);
 
+  // Idle prefetch: fetch the first history page (local first) of chats the
+  // user is likely to open next, one request at a time, into the message
+  // cache. A new list replaces the queue; opening a chat cancels it.
+  // Prefetched pages that were never opened are dropped oldest first once
+  // they exceed PREFETCH_BUDGET_BYTES.
+  void PrefetchHistory(const std::vector<int64_t> &chatIds);
+  void CancelPrefetch();
+  // Chats opened most recently first
+  const std::deque<int64_t> &GetRecentChatIds() const {
+    return m_recentChatIds;
+  }
+
+  // Windowed history for jumps: a page centred on a message (reply targets,
+  // search hits) or on a date, then pages newer than the window as the user
+  // scrolls down. Pages that fall inside cached ranges (see
+  // HistoryIntervals) are answered without a request, so gaps are only
+  // fetched when reached.
+  void LoadMessagesAround(int64_t chatId, int64_t messageId);
+  void LoadMessagesAroundDate(int64_t chatId, int64_t date);
+  void LoadNewerMessages(int64_t chatId, int64_t fromMessageId, int limit);
+
   // Lazy loading for older messages when scrolling up
   void LoadOlderMessages(int64_t chatId, int64_t fromMessageId, int limit = 50);
   bool IsLoadingMessages() const { return m_isLoadingMessages; }
   bool HasMoreMessages(int64_t chatId) const;
 
+  // Server-side search within one chat, newest first. Pass the returned
+  // nextFromMessageId back as fromMessageId to fetch the next page.
+  // The callback runs on the main thread.
+  void SearchChatMessages(int64_t chatId, const wxString &query,
+                          SearchMediaFilter filter, int64_t fromMessageId,
+                          int limit, SearchMessagesCallback callback);
+
+  // Server-side search across all chats, newest first. Pass the returned
+  // nextOffset back as offset ("" for the first page). The callback runs on
+  // the main thread.
+  void SearchMessages(const wxString &query, const wxString &offset, int limit,
+                      GlobalSearchCallback callback);
+
+  // Local full-text index over every message received, loaded or searched
+  // so far - answers without a server round trip
+  const MessageSearchIndex &GetSearchIndex() const { return m_searchIndex; }
+
   // Track current active chat for download prioritization
   void SetCurrentChatId(int64_t chatId) { m_currentChatId = chatId; }
   int64_t GetCurrentChatId() const { return m_currentChatId; }
@@ -137,12 +206,25 @@ public:
   void SendFile(int64_t chatId, const wxString &filePath,
                 const wxString &caption = "");
 
+  // Pre-upload pipeline: QueueUpload starts preliminaryUploadFile as soon as
+  // one of MAX_CONCURRENT_UPLOADS slots is free and returns an id for the UI.
+  // SendUploadedFile then sends the message by file id, so it goes out as
+  // soon as the upload finishes (or at once if it already has).
+  int QueueUpload(const wxString &filePath);
+  void SendUploadedFile(int64_t chatId, int uploadId,
+                        const wxString &caption = "");
+  void CancelUpload(int uploadId);
+
   void DownloadFile(int32_t fileId, int priority = 1,
                     const wxString &fileName = "", int64_t fileSize = 0);
   void CancelDownload(int32_t fileId);
   void RetryDownload(int32_t fileId);
   bool IsDownloading(int32_t fileId) const;
   DownloadState GetDownloadState(int32_t fileId) const;
+  // Copy of the tracking entry for a file - false if it is not tracked
+  bool GetDownloadInfo(int32_t fileId, DownloadInfo &info) const;
+  // True while DownloadFile turns away requests at this priority
+  bool IsInStartupCooldown(int priority) const;
 
   // Re-fetch a message from TDLib to get updated file info (for incomplete
   // stickers etc.)
@@ -155,16 +237,34 @@ public:
   // Boost download priority for a file (e.g., when user hovers)
   void BoostDownloadPriority(int32_t fileId);
 
+  // Viewport-driven prioritisation: the chat view reports media it is showing,
+  // media just outside the viewport (prefetched), and media scrolled far away
+  // (demoted, or cancelled if nothing has been downloaded yet)
+  void UpdateViewportDownloads(const std::vector<ViewportMediaFile> &visible,
+                               const std::vector<ViewportMediaFile> &nearby,
+                               const std::vector<int32_t> &distant);
+
   // Get download progress (0-100, or -1 if not downloading)
   int GetDownloadProgress(int32_t fileId) const;
 
   UserInfo GetUser(int64_t userId, bool *found = nullptr) const;
+  std::map<int64_t, UserInfo> GetUsers() const;
   wxString GetUserDisplayName(int64_t userId) const;
 
+  // Bumped whenever chats or users change - lets the UI skip rebuilding
+  // indexes over them when nothing moved
+  uint64_t GetDirectoryVersion() const { return m_directoryVersion.load(); }
+
+  // Open (creating if needed) the private chat with a user
+  void CreatePrivateChat(int64_t userId, CreateChatCallback callback);
+
   void MarkChatAsRead(int64_t chatId);
 
-  // Load members for a chat (groups/supergroups/channels)
-  void LoadChatMembers(int64_t chatId, int limit = 200);
+  // Load members for a chat. A fresh cached list is served at once; otherwise
+  // members are paged in the background and streamed to
+  // MainFrame::OnMembersLoaded page by page, ending with the complete list.
+  // Only the chat requested last keeps paging.
+  void LoadChatMembers(int64_t chatId);
 
   // ===== REACTIVE MVC API =====
   // UI should poll these instead of waiting for callbacks
@@ -218,6 +318,9 @@ public:
   // queue)
   std::vector<FileDownloadProgress> GetDownloadProgressUpdates();
 
+  // Get pre-upload state changes since last call (thread-safe, clears queue)
+  std::vector<FileUploadUpdate> GetUploadUpdates();
+
   // Signal UI to refresh (posts lightweight event, no data)
   void NotifyUIRefresh();
 
@@ -233,13 +336,40 @@ private:
   UserInfo m_currentUser;
   int64_t m_currentChatId =
       0; // Currently viewed chat for download prioritization
-  int64_t m_pendingChatLoad = 0; // Chat waiting for connection to be ready
+  // Chat waiting for authorization or the connection; set on the UI thread,
+  // taken on the TDLib thread
+  std::atomic<int64_t> m_pendingChatLoad{0};
+  // Chat whose local history page is on screen, awaiting the network fill
+  std::atomic<int64_t> m_localHistoryChatId{0};
+  // Time-to-first-message instrumentation (SteadyMillis at open)
+  std::atomic<int64_t> m_chatOpenStartedMs{0};
+  static constexpr int HISTORY_PAGE_SIZE = 100;
+  // Ranges of m_messages known to be gap-free (guarded by m_dataMutex)
+  std::map<int64_t, HistoryIntervals> m_loadedIntervals;
+
+  // Idle prefetch (guarded by m_prefetchMutex)
+  std::mutex m_prefetchMutex;
+  std::deque<int64_t> m_prefetchQueue;
+  bool m_prefetchInFlight = false;
+  uint64_t m_prefetchGeneration = 0;
+  // Pages prefetched but not opened yet, oldest first. Eviction removes only
+  // the messages the prefetch itself put in the cache
+  struct PrefetchedPage {
+    int64_t chatId = 0;
+    size_t bytes = 0; // Estimated
+    std::vector<int64_t> addedIds;
+  };
+  std::deque<PrefetchedPage> m_prefetchedPages;
+  size_t m_prefetchedBytes = 0;
+  static constexpr size_t PREFETCH_BUDGET_BYTES = 8 * 1024 * 1024;
 
   std::map<int64_t, ChatInfo> m_chats;
   std::map<int64_t, UserInfo> m_users;
   std::map<int64_t, std::vector<MessageInfo>> m_messages;
   mutable std::shared_mutex
       m_dataMutex; // Protects m_chats, m_users, m_messages
+  // Text of every message in m_messages and search results
+  MessageSearchIndex m_searchIndex; // Internally synchronised
 
   // Lazy loading state for chat list
   std::atomic<bool> m_allChatsLoaded{false};
@@ -298,8 +428,38 @@ private:
   void HandleAuthClosed();
   void ConfigureAutoDownload();
 
-  // Helper to fetch messages once connection is ready
+  // Chat open, phase one: render what TDLib's message database already
+  // holds, then fetch from the network once connected
   void FetchChatMessages(int64_t chatId);
+  // Phase two: merged into the local page if one was shown, else replaces
+  void FetchNetworkHistory(int64_t chatId);
+  void RequestNewestHistory(
+      int64_t chatId, bool onlyLocal,
+      std::function<void(bool ok, std::vector<MessageInfo> messages)> done);
+  void NoteFirstMessages(int64_t chatId, size_t count, const char *source);
+  void ContinueWithNetworkHistory(int64_t chatId);
+  // Merges a contiguous page into m_messages and m_loadedIntervals; caller
+  // holds m_dataMutex exclusively
+  void StorePageLocked(int64_t chatId, const std::vector<MessageInfo> &page,
+                       int64_t first, int64_t last, bool newest);
+  // Up to limit cached messages beyond fromMessageId inside its loaded
+  // range, oldest first. *atEnd is set when they run up to the newest
+  // message. Caller holds m_dataMutex.
+  std::vector<MessageInfo> CollectCachedLocked(int64_t chatId,
+                                               int64_t fromMessageId,
+                                               bool newer, size_t limit,
+                                               bool *atEnd) const;
+  bool IsWindowAtNewestLocked(int64_t chatId, int64_t newestId) const;
+  void PostHistoryWindow(int64_t chatId, int64_t anchorId,
+                         std::vector<MessageInfo> messages);
+
+  void PumpPrefetch();
+  void FinishPrefetch(int64_t chatId, uint64_t generation, bool ok,
+                      std::vector<MessageInfo> messages);
+  // Moves a prefetched page out of the budget; false if there is none
+  bool TakePrefetched(int64_t chatId);
+  // The chat already has a cached range; prefetch has nothing to add
+  bool HasLoadedHistory(int64_t chatId) const;
 
   void OnNewMessage(td_api::object_ptr<td_api::message> &message);
   void OnMessageEdited(int64_t chatId, int64_t messageId,
@@ -312,6 +472,18 @@ private:
   void OnDownloadError(int32_t fileId, const wxString &error);
   void CheckDownloadTimeouts();
 
+  // Download lifecycle watchdog - each tracked file has at most one timer
+  enum class DownloadTimer : int {
+    Timeout, // Pending/Downloading: fail if no progress for TIMEOUT_SECONDS
+    Retry,   // Failed: retry after exponential backoff
+    Expire   // Completed/Cancelled/given up: drop from m_activeDownloads
+  };
+  void ScheduleDownloadTimer(int32_t fileId, DownloadTimer timer,
+                             int64_t delayMs);
+  // Every DownloadInfo state change goes through here (m_downloadsMutex
+  // held) to keep m_inFlightDownloads exact
+  void SetDownloadStateLocked(DownloadInfo &info, DownloadState state);
+
   // Smart download helpers
   void DownloadMediaFromMessage(const MessageInfo &msg, int basePriority);
   bool ShouldAutoDownloadMedia(MediaType type, int64_t fileSize) const;
@@ -329,6 +501,13 @@ private:
   void PostToMainThread(std::function<void()> func);
   void OnTdlibUpdate(wxThreadEvent &event);
 
+  // Member loading (see LoadChatMembers)
+  void FetchMemberPage(int64_t chatId, int64_t supergroupId, int32_t offset);
+  void FinishMemberLoad(int64_t chatId, bool complete);
+  std::vector<UserInfo> UsersFromIds(const std::vector<int64_t> &userIds) const;
+  void PostMembers(int64_t chatId, std::vector<UserInfo> members, bool replace,
+                   bool complete, int32_t totalCount);
+
   void ReceiveLoop();
 
   std::queue<std::function<void()>> m_mainThreadQueue;
@@ -337,6 +516,45 @@ private:
   // Download tracking
   std::map<int32_t, DownloadInfo> m_activeDownloads;
   mutable std::mutex m_downloadsMutex;
+  size_t m_inFlightDownloads = 0; // Pending or Downloading entries
+
+  // Downloads whose priority is owned by the chat viewport (protected by
+  // m_downloadsMutex). Only these are demoted/cancelled when scrolled away.
+  std::set<int32_t> m_viewportFileIds;
+  static constexpr int VIEWPORT_VISIBLE_PRIORITY = 24;
+  static constexpr int VIEWPORT_NEARBY_PRIORITY = 12;
+  static constexpr int VIEWPORT_DISTANT_PRIORITY = 1;
+
+  // Pre-uploads, keyed by the id handed out by QueueUpload. An entry lives
+  // until its upload has both finished and been sent (or is cancelled).
+  struct PendingUpload {
+    wxString path;
+    int32_t fileId = 0; // Known once preliminaryUploadFile answers
+    UploadState state = UploadState::Queued;
+    bool active = false;        // Holds an upload slot
+    bool sendRequested = false; // SendUploadedFile was called
+    bool sent = false;          // sendMessage issued
+    int64_t sendChatId = 0;
+    wxString sendCaption;
+  };
+  std::map<int, PendingUpload> m_uploads;
+  std::deque<int> m_uploadQueue;          // Waiting for a slot, FIFO
+  std::map<int32_t, int> m_uploadsByFileId; // TDLib file id -> upload id
+  int m_nextUploadId = 1;
+  std::mutex m_uploadsMutex;
+  static constexpr size_t MAX_CONCURRENT_UPLOADS = 3;
+
+  std::vector<FileUploadUpdate> m_uploadUpdates;
+  std::mutex m_uploadUpdatesMutex;
+
+  void PumpUploadQueue();
+  void StartPreliminaryUpload(int uploadId, const wxString &path);
+  void SendFileMessage(int64_t chatId, const wxString &filePath,
+                       td_api::object_ptr<td_api::InputFile> inputFile,
+                       const wxString &caption);
+  bool OnUploadFileUpdate(td_api::file &file);
+  void PushUploadUpdate(int uploadId, UploadState state, int64_t uploadedSize,
+                        int64_t totalSize, const wxString &error = "");
 
   // Typing indicators: sender name -> (action text, timestamp)
   // Timestamp allows auto-timeout of stale typing indicators
@@ -355,16 +573,52 @@ private:
   std::map<int64_t, std::vector<std::pair<int64_t, wxString>>>
       m_sendFailedMessages;
   std::mutex m_sendFailedMutex;
+
+  // Member lists per chat, reused for MEMBER_CACHE_TTL_SECONDS
+  struct MemberCache {
+    std::vector<int64_t> userIds;    // Last complete list
+    std::vector<int64_t> pendingIds; // Pages fetched by the running pass
+    int32_t totalCount = 0;
+    int64_t fetchedAt = 0;
+    bool complete = false;
+    bool loading = false;
+  };
+  std::map<int64_t, MemberCache> m_memberCache;
+  std::mutex m_memberCacheMutex;
+  std::atomic<int64_t> m_memberPagingChatId{0};
+  static constexpr int MEMBER_PAGE_SIZE = 200; // TDLib maximum
+  static constexpr int64_t MEMBER_CACHE_TTL_SECONDS = 600;
+
   wxTimer m_downloadTimeoutTimer;
 
+  // Hashed timer wheel driven by m_downloadTimeoutTimer - a tick only touches
+  // downloads whose deadline is due instead of scanning m_activeDownloads
+  TimerWheel m_downloadWatchdog;
+  static constexpr int WATCHDOG_TICK_MS = 500;
+  static constexpr size_t WATCHDOG_SLOT_COUNT = 256; // ~2 min per revolution
+  static constexpr int DOWNLOAD_EXPIRY_SECONDS = 300;
+
   // Startup cooldown - prevent download flooding on first launch
   int64_t m_startupTime;
   static constexpr int STARTUP_COOLDOWN_SECONDS =
       5; // Defer low-priority downloads for 5s
 
+  // Warm start: chats restored from the snapshot that TDLib has not
+  // reported yet (guarded by m_dataMutex). Whatever is left once the whole
+  // chat list has loaded no longer exists and is dropped.
+  std::set<int64_t> m_unconfirmedChatIds;
+  std::atomic<bool> m_warmStarted{false};
+  std::deque<int64_t> m_recentChatIds; // Most recent first, UI thread only
+  wxTimer m_snapshotTimer;
+  static constexpr int SNAPSHOT_INTERVAL_MS = 5 * 60 * 1000;
+  static constexpr size_t SNAPSHOT_MAX_CHATS = 500;
+  static constexpr size_t SNAPSHOT_RECENT_CHATS = 8;
+  static constexpr size_t SNAPSHOT_MESSAGES_PER_CHAT = 50;
+
   // ===== REACTIVE MVC STATE =====
   // Dirty flags - set by background threads, polled by UI
   std::atomic<uint32_t> m_dirtyFlags{0};
+  std::atomic<uint64_t> m_directoryVersion{0};
 
   // Started downloads queue - background adds, UI polls
   std::vector<FileDownloadStarted> m_startedDownloads;
@@ -397,6 +651,11 @@ private:
 
   void OnDownloadTimeoutTimer(wxTimerEvent &event);
   void StartDownloadInternal(int32_t fileId, int priority);
+
+  void OnSnapshotTimer(wxTimerEvent &event);
+  void NoteRecentChat(int64_t chatId);
+  void PruneUnconfirmedChats();
+  void DiscardWarmSnapshot();
 };
 
 #endif // TELEGRAMCLIENT_H
\ No newline at end of file
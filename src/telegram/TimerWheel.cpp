@@ -0,0 +1,94 @@
+#include "TimerWheel.h"
+
+#include <algorithm>
+
+TimerWheel::TimerWheel(int64_t tickMs, size_t slotCount)
+    : m_tickMs(std::max<int64_t>(tickMs, 1)),
+      m_slots(std::max<size_t>(slotCount, 1)) {}
+
+void TimerWheel::Schedule(int64_t key, int tag, int64_t delayMs,
+                          int64_t nowMs) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (m_lastTick < 0) {
+    m_lastTick = nowMs / m_tickMs;
+  }
+
+  // Round up so a timer never fires early, and never into a processed tick
+  int64_t dueTick = (nowMs + std::max<int64_t>(delayMs, 0) + m_tickMs - 1) /
+                    m_tickMs;
+  dueTick = std::max(dueTick, m_lastTick + 1);
+
+  size_t slotCount = m_slots.size();
+  uint64_t generation = m_nextGeneration++;
+  m_armed[key] = generation;
+
+  Entry entry;
+  entry.key = key;
+  entry.tag = tag;
+  entry.generation = generation;
+  entry.rounds = static_cast<size_t>(dueTick - m_lastTick - 1) / slotCount;
+  m_slots[static_cast<size_t>(dueTick) % slotCount].push_back(entry);
+}
+
+void TimerWheel::Cancel(int64_t key) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_armed.erase(key);
+}
+
+bool TimerWheel::IsScheduled(int64_t key) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_armed.count(key) > 0;
+}
+
+size_t TimerWheel::Size() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_armed.size();
+}
+
+void TimerWheel::Clear() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (auto &slot : m_slots) {
+    slot.clear();
+  }
+  m_armed.clear();
+}
+
+std::vector<TimerWheel::Expired> TimerWheel::Advance(int64_t nowMs) {
+  std::vector<Expired> expired;
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  int64_t nowTick = nowMs / m_tickMs;
+  if (m_lastTick < 0) {
+    m_lastTick = nowTick;
+    return expired;
+  }
+
+  size_t slotCount = m_slots.size();
+  for (int64_t tick = m_lastTick + 1; tick <= nowTick; ++tick) {
+    auto &slot = m_slots[static_cast<size_t>(tick) % slotCount];
+    if (slot.empty()) {
+      continue;
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < slot.size(); ++i) {
+      Entry &entry = slot[i];
+      auto armed = m_armed.find(entry.key);
+      if (armed == m_armed.end() || armed->second != entry.generation) {
+        continue; // Cancelled or rescheduled since
+      }
+      if (entry.rounds > 0) {
+        entry.rounds--;
+        slot[kept++] = entry;
+        continue;
+      }
+      m_armed.erase(armed);
+      expired.push_back({entry.key, entry.tag});
+    }
+    slot.resize(kept);
+  }
+
+  m_lastTick = std::max(m_lastTick, nowTick);
+  return expired;
+}
@@ -0,0 +1,49 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Hashed timer wheel for per-key deadlines (e.g. download lifecycle).
+// Schedule/Cancel are O(1) and Advance() only visits the slots whose tick has
+// come due, so the cost of a tick is independent of how many keys are armed.
+// Each key holds at most one timer - scheduling it again replaces the old one
+// (stale slot entries are dropped lazily by generation). Thread-safe.
+class TimerWheel {
+public:
+  struct Expired {
+    int64_t key;
+    int tag;
+  };
+
+  TimerWheel(int64_t tickMs, size_t slotCount);
+
+  void Schedule(int64_t key, int tag, int64_t delayMs, int64_t nowMs);
+  void Cancel(int64_t key);
+  bool IsScheduled(int64_t key) const;
+  size_t Size() const;
+  void Clear();
+
+  // Process every tick up to nowMs and return the timers that fired
+  std::vector<Expired> Advance(int64_t nowMs);
+
+private:
+  struct Entry {
+    int64_t key;
+    int tag;
+    uint64_t generation;
+    size_t rounds; // Full revolutions left before this entry is due
+  };
+
+  int64_t m_tickMs;
+  std::vector<std::vector<Entry>> m_slots;
+  std::unordered_map<int64_t, uint64_t> m_armed; // key -> live generation
+  uint64_t m_nextGeneration = 1;
+  int64_t m_lastTick = -1; // Last processed absolute tick
+  mutable std::mutex m_mutex;
+};
+
+#endif // TIMERWHEEL_H
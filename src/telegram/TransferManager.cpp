@@ -9,12 +9,12 @@ TransferManager::~TransferManager()
 {
 }
 
-int TransferManager::StartUpload(const wxString& filePath, int64_t totalBytes)
+int TransferManager::StartUpload(const wxString& filePath, int64_t totalBytes, bool queued)
 {
     TransferInfo info;
     info.id = m_nextId++;
     info.direction = TransferDirection::Upload;
-    info.status = TransferStatus::InProgress;
+    info.status = queued ? TransferStatus::Pending : TransferStatus::InProgress;
     info.filePath = filePath;
     info.fileName = filePath.AfterLast('/').AfterLast('\\');
     if (info.fileName.IsEmpty()) {
@@ -45,6 +45,27 @@ int TransferManager::StartDownload(const wxString& fileName, int64_t totalBytes)
     return info.id;
 }
 
+void TransferManager::SetPhase(int transferId, TransferPhase phase, int64_t totalBytes, int64_t savedBytes)
+{
+    auto it = m_transfers.find(transferId);
+    if (it == m_transfers.end()) {
+        return;
+    }
+    
+    TransferInfo& info = it->second;
+    info.phase = phase;
+    info.status = phase == TransferPhase::Transform ? TransferStatus::InProgress : TransferStatus::Pending;
+    info.transferredBytes = 0;
+    if (totalBytes > 0) {
+        info.totalBytes = totalBytes;
+    }
+    if (savedBytes > 0) {
+        info.savedBytes = savedBytes;
+    }
+    
+    NotifyProgress(info);
+}
+
 void TransferManager::UpdateProgress(int transferId, int64_t transferredBytes, int64_t totalBytes)
 {
     auto it = m_transfers.find(transferId);
@@ -58,6 +79,7 @@ void TransferManager::UpdateProgress(int transferId, int64_t transferredBytes, i
         info.totalBytes = totalBytes;
     }
     info.status = TransferStatus::InProgress;
+    info.phase = TransferPhase::Transfer;
     
     NotifyProgress(info);
 }
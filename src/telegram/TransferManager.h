@@ -13,9 +13,15 @@ public:
     TransferManager();
     ~TransferManager();
     
-    int StartUpload(const wxString& filePath, int64_t totalBytes = 0);
+    // queued: waiting for an upload slot, shown as Pending until the first
+    // UpdateProgress
+    int StartUpload(const wxString& filePath, int64_t totalBytes = 0, bool queued = false);
     int StartDownload(const wxString& fileName, int64_t totalBytes = 0);
     
+    // Leaving the Transform phase puts the transfer back to Pending until
+    // the first UpdateProgress of the actual upload
+    void SetPhase(int transferId, TransferPhase phase, int64_t totalBytes = 0, int64_t savedBytes = 0);
+    
     void UpdateProgress(int transferId, int64_t transferredBytes, int64_t totalBytes);
     void CompleteTransfer(int transferId, const wxString& localPath = "");
     void FailTransfer(int transferId, const wxString& error);
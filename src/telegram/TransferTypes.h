@@ -19,23 +19,33 @@ enum class TransferStatus {
     Cancelled
 };
 
+// What a transfer is busy with - uploads may be prepared locally first
+enum class TransferPhase {
+    Transfer,
+    Transform   // Recompressing/resizing before the upload starts
+};
+
 // Single transfer info
 struct TransferInfo {
     int id;
     TransferDirection direction;
     TransferStatus status;
+    TransferPhase phase;
     wxString fileName;
     wxString filePath;
     int64_t totalBytes;
     int64_t transferredBytes;
+    int64_t savedBytes;     // Bytes the transform stage shaved off
     wxString error;
     
     TransferInfo()
         : id(0),
           direction(TransferDirection::Download),
           status(TransferStatus::Pending),
+          phase(TransferPhase::Transfer),
           totalBytes(0),
-          transferredBytes(0) {}
+          transferredBytes(0),
+          savedBytes(0) {}
     
     int GetProgressPercent() const {
         if (totalBytes <= 0) return 0;
@@ -43,7 +53,10 @@ struct TransferInfo {
     }
     
     wxString GetProgressText() const {
-        if (status == TransferStatus::Pending) {
+        if (phase == TransferPhase::Transform &&
+            status == TransferStatus::InProgress) {
+            return "Compressing...";
+        } else if (status == TransferStatus::Pending) {
             return "Pending...";
         } else if (status == TransferStatus::Failed) {
             return "Failed";
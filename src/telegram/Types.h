@@ -1,10 +1,12 @@
 #ifndef TELEGRAM_TYPES_H
 #define TELEGRAM_TYPES_H
 
+#include <chrono>
 #include <cstdint>
 #include <ctime>
 #include <functional>
 #include <map>
+#include <string>
 #include <vector>
 #include <wx/wx.h>
 
@@ -145,6 +147,10 @@ struct MessageInfo {
   int32_t mediaThumbnailFileId;
   wxString mediaThumbnailPath;
 
+  // Inline blurry JPEG (a few dozen pixels) TDLib sends with photos, videos
+  // and animations; shown until a real thumbnail or the file is local
+  std::string mediaMinithumbnail;
+
   // For voice/video notes - duration and waveform
   int32_t mediaDuration;              // Duration in seconds
   std::vector<uint8_t> mediaWaveform; // Waveform data (5-bit values packed)
@@ -267,14 +273,23 @@ enum class DownloadState {
   Cancelled    // Download cancelled by user
 };
 
+// Upload state for files pre-uploaded ahead of sending (preliminaryUploadFile)
+enum class UploadState {
+  Queued,    // Waiting for an upload slot
+  Uploading, // preliminaryUploadFile in progress
+  Completed, // File is on the server, ready to be referenced by id
+  Failed,
+  Cancelled
+};
+
 // Download info for tracking active downloads
 struct DownloadInfo {
   int32_t fileId;
   int priority;
   DownloadState state;
   int retryCount;
-  int64_t startTime;        // When download was initiated (for timeout)
-  int64_t lastProgressTime; // Last time we received progress update
+  int64_t startTime;        // When download was initiated, Now() seconds
+  int64_t lastProgressTime; // Last progress update, Now() seconds
   int64_t downloadedSize;
   int64_t totalSize;
   wxString localPath;
@@ -289,15 +304,34 @@ struct DownloadInfo {
 
   DownloadInfo(int32_t id, int prio)
       : fileId(id), priority(prio), state(DownloadState::Pending),
-        retryCount(0), startTime(wxGetUTCTime()),
-        lastProgressTime(wxGetUTCTime()), downloadedSize(0), totalSize(0) {}
+        retryCount(0), startTime(Now()), lastProgressTime(Now()),
+        downloadedSize(0), totalSize(0) {}
+
+  // Monotonic seconds: clock steps and suspend/resume must not fire or
+  // stall timeouts
+  static int64_t Now() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
 
   bool CanRetry() const { return retryCount < MAX_RETRIES; }
-  bool IsTimedOut() const {
-    return (wxGetUTCTime() - lastProgressTime) > TIMEOUT_SECONDS;
+  bool IsTimedOut(int64_t now) const {
+    return (now - lastProgressTime) >= TIMEOUT_SECONDS;
   }
 };
 
+// Media filter for chat searches (maps onto td_api::SearchMessagesFilter)
+enum class SearchMediaFilter {
+  None,      // Any message (text search)
+  Photo,
+  Video,
+  Document,
+  Audio,
+  Voice,
+  Animation
+};
+
 // Callback types for async operations
 using AuthCallback =
     std::function<void(AuthState state, const wxString &error)>;
@@ -308,5 +342,15 @@ using SendMessageCallback =
     std::function<void(bool success, int64_t messageId, const wxString &error)>;
 using FileCallback = std::function<void(bool success, const wxString &localPath,
                                         const wxString &error)>;
+// nextFromMessageId is 0 once the search has no more results
+using SearchMessagesCallback = std::function<void(
+    bool success, const std::vector<MessageInfo> &messages,
+    int64_t nextFromMessageId, const wxString &error)>;
+// nextOffset is empty once the search has no more results
+using GlobalSearchCallback = std::function<void(
+    bool success, const std::vector<MessageInfo> &messages,
+    const wxString &nextOffset, int totalCount, const wxString &error)>;
+using CreateChatCallback =
+    std::function<void(bool success, int64_t chatId, const wxString &error)>;
 
 #endif // TELEGRAM_TYPES_H
\ No newline at end of file
@@ -0,0 +1,458 @@
+#include "WarmSnapshot.h"
+
+#include <wx/file.h>
+#include <wx/filename.h>
+
+#include <string>
+
+namespace {
+
+class Writer {
+public:
+  void U8(uint8_t value) { m_buffer.push_back(static_cast<char>(value)); }
+  void Bool(bool value) { U8(value ? 1 : 0); }
+  void U32(uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+      U8(static_cast<uint8_t>(value >> (8 * i)));
+    }
+  }
+  void I32(int32_t value) { U32(static_cast<uint32_t>(value)); }
+  void I64(int64_t value) {
+    uint64_t bits = static_cast<uint64_t>(value);
+    for (int i = 0; i < 8; ++i) {
+      U8(static_cast<uint8_t>(bits >> (8 * i)));
+    }
+  }
+  void Str(const wxString &value) {
+    wxScopedCharBuffer utf8 = value.utf8_str();
+    U32(static_cast<uint32_t>(utf8.length()));
+    m_buffer.append(utf8.data(), utf8.length());
+  }
+  void Bytes(const std::vector<uint8_t> &value) {
+    U32(static_cast<uint32_t>(value.size()));
+    m_buffer.append(reinterpret_cast<const char *>(value.data()),
+                    value.size());
+  }
+  void Blob(const std::string &value) {
+    U32(static_cast<uint32_t>(value.size()));
+    m_buffer.append(value);
+  }
+
+  const std::string &GetBuffer() const { return m_buffer; }
+
+private:
+  std::string m_buffer;
+};
+
+// Every getter fails soft: past the end it returns zero and marks the
+// reader bad, and the caller checks IsOk() once at the end
+class Reader {
+public:
+  Reader(const char *data, size_t size) : m_data(data), m_size(size) {}
+
+  bool IsOk() const { return m_ok; }
+
+  uint8_t U8() {
+    if (!Need(1)) {
+      return 0;
+    }
+    return static_cast<uint8_t>(m_data[m_pos++]);
+  }
+  bool Bool() { return U8() != 0; }
+  uint32_t U32() {
+    if (!Need(4)) {
+      return 0;
+    }
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+      value |= static_cast<uint32_t>(static_cast<uint8_t>(m_data[m_pos++]))
+               << (8 * i);
+    }
+    return value;
+  }
+  int32_t I32() { return static_cast<int32_t>(U32()); }
+  int64_t I64() {
+    if (!Need(8)) {
+      return 0;
+    }
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+      value |= static_cast<uint64_t>(static_cast<uint8_t>(m_data[m_pos++]))
+               << (8 * i);
+    }
+    return static_cast<int64_t>(value);
+  }
+  wxString Str() {
+    uint32_t length = U32();
+    if (!Need(length)) {
+      return wxString();
+    }
+    wxString value = wxString::FromUTF8(m_data + m_pos, length);
+    m_pos += length;
+    return value;
+  }
+  std::vector<uint8_t> Bytes() {
+    uint32_t length = U32();
+    if (!Need(length)) {
+      return {};
+    }
+    std::vector<uint8_t> value(m_data + m_pos, m_data + m_pos + length);
+    m_pos += length;
+    return value;
+  }
+  std::string Blob() {
+    uint32_t length = U32();
+    if (!Need(length)) {
+      return std::string();
+    }
+    std::string value(m_data + m_pos, length);
+    m_pos += length;
+    return value;
+  }
+  // Element count that cannot possibly exceed the bytes left
+  uint32_t Count(size_t minElementSize) {
+    uint32_t count = U32();
+    if (m_ok && count > (m_size - m_pos) / minElementSize) {
+      m_ok = false;
+      return 0;
+    }
+    return count;
+  }
+
+private:
+  bool Need(size_t bytes) {
+    if (!m_ok || m_size - m_pos < bytes) {
+      m_ok = false;
+      return false;
+    }
+    return true;
+  }
+
+  const char *m_data;
+  size_t m_size;
+  size_t m_pos = 0;
+  bool m_ok = true;
+};
+
+void WriteChat(Writer &out, const ChatInfo &chat) {
+  out.I64(chat.id);
+  out.Str(chat.title);
+  out.Str(chat.lastMessage);
+  out.I64(chat.lastMessageDate);
+  out.I32(chat.unreadCount);
+  out.I64(chat.lastReadInboxMessageId);
+  out.I32(chat.memberCount);
+  out.Bool(chat.isPinned);
+  out.Bool(chat.isMuted);
+  out.I64(chat.order);
+  out.Bool(chat.isPrivate);
+  out.Bool(chat.isGroup);
+  out.Bool(chat.isSupergroup);
+  out.Bool(chat.isChannel);
+  out.Bool(chat.isBot);
+  out.I64(chat.userId);
+  out.I64(chat.supergroupId);
+  out.I64(chat.basicGroupId);
+  out.I64(chat.lastReadOutboxMessageId);
+  out.I64(chat.lastReadOutboxTime);
+}
+
+ChatInfo ReadChat(Reader &in) {
+  ChatInfo chat;
+  chat.id = in.I64();
+  chat.title = in.Str();
+  chat.lastMessage = in.Str();
+  chat.lastMessageDate = in.I64();
+  chat.unreadCount = in.I32();
+  chat.lastReadInboxMessageId = in.I64();
+  chat.memberCount = in.I32();
+  chat.isPinned = in.Bool();
+  chat.isMuted = in.Bool();
+  chat.order = in.I64();
+  chat.isPrivate = in.Bool();
+  chat.isGroup = in.Bool();
+  chat.isSupergroup = in.Bool();
+  chat.isChannel = in.Bool();
+  chat.isBot = in.Bool();
+  chat.userId = in.I64();
+  chat.supergroupId = in.I64();
+  chat.basicGroupId = in.I64();
+  chat.lastReadOutboxMessageId = in.I64();
+  chat.lastReadOutboxTime = in.I64();
+  return chat;
+}
+
+// Presence is left out on purpose - it is stale by the next launch
+void WriteUser(Writer &out, const UserInfo &user) {
+  out.I64(user.id);
+  out.Str(user.firstName);
+  out.Str(user.lastName);
+  out.Str(user.username);
+  out.Str(user.phoneNumber);
+  out.Bool(user.isBot);
+  out.Bool(user.isVerified);
+  out.Bool(user.isSelf);
+  out.I64(user.lastSeenTime);
+  out.I32(user.profilePhotoSmallFileId);
+  out.Str(user.profilePhotoSmallPath);
+}
+
+UserInfo ReadUser(Reader &in) {
+  UserInfo user;
+  user.id = in.I64();
+  user.firstName = in.Str();
+  user.lastName = in.Str();
+  user.username = in.Str();
+  user.phoneNumber = in.Str();
+  user.isBot = in.Bool();
+  user.isVerified = in.Bool();
+  user.isSelf = in.Bool();
+  user.lastSeenTime = in.I64();
+  user.profilePhotoSmallFileId = in.I32();
+  user.profilePhotoSmallPath = in.Str();
+  return user;
+}
+
+void WriteMessage(Writer &out, const MessageInfo &msg) {
+  out.I64(msg.id);
+  out.I64(msg.chatId);
+  out.I64(msg.senderId);
+  out.Str(msg.senderName);
+  out.Str(msg.text);
+  out.I64(msg.date);
+  out.I64(msg.editDate);
+  out.Bool(msg.isOutgoing);
+  out.Bool(msg.isEdited);
+  out.Str(msg.originalText);
+  out.Bool(msg.hasPhoto);
+  out.Bool(msg.hasVideo);
+  out.Bool(msg.hasDocument);
+  out.Bool(msg.hasVoice);
+  out.Bool(msg.hasVideoNote);
+  out.Bool(msg.hasSticker);
+  out.Bool(msg.hasAnimation);
+  out.Str(msg.mediaCaption);
+  out.Str(msg.mediaFileName);
+  out.I32(msg.mediaFileId);
+  out.Str(msg.mediaLocalPath);
+  out.I64(msg.mediaFileSize);
+  out.I32(msg.width);
+  out.I32(msg.height);
+  out.I32(msg.mediaThumbnailFileId);
+  out.Str(msg.mediaThumbnailPath);
+  out.Blob(msg.mediaMinithumbnail);
+  out.I32(msg.mediaDuration);
+  out.Bytes(msg.mediaWaveform);
+  out.I64(msg.replyToMessageId);
+  out.Str(msg.replyToText);
+  out.Bool(msg.isForwarded);
+  out.Str(msg.forwardedFrom);
+
+  out.U32(static_cast<uint32_t>(msg.reactions.size()));
+  for (const auto &[emoji, senders] : msg.reactions) {
+    out.Str(emoji);
+    out.U32(static_cast<uint32_t>(senders.size()));
+    for (const auto &sender : senders) {
+      out.Str(sender);
+    }
+  }
+
+  out.U32(static_cast<uint32_t>(msg.entities.size()));
+  for (const auto &entity : msg.entities) {
+    out.U32(static_cast<uint32_t>(entity.type));
+    out.I32(entity.offset);
+    out.I32(entity.length);
+    out.Str(entity.url);
+    out.I64(entity.userId);
+    out.Str(entity.language);
+    out.I64(entity.customEmojiId);
+  }
+}
+
+MessageInfo ReadMessage(Reader &in) {
+  MessageInfo msg;
+  msg.id = in.I64();
+  msg.chatId = in.I64();
+  msg.senderId = in.I64();
+  msg.senderName = in.Str();
+  msg.text = in.Str();
+  msg.date = in.I64();
+  msg.editDate = in.I64();
+  msg.isOutgoing = in.Bool();
+  msg.isEdited = in.Bool();
+  msg.originalText = in.Str();
+  msg.hasPhoto = in.Bool();
+  msg.hasVideo = in.Bool();
+  msg.hasDocument = in.Bool();
+  msg.hasVoice = in.Bool();
+  msg.hasVideoNote = in.Bool();
+  msg.hasSticker = in.Bool();
+  msg.hasAnimation = in.Bool();
+  msg.mediaCaption = in.Str();
+  msg.mediaFileName = in.Str();
+  msg.mediaFileId = in.I32();
+  msg.mediaLocalPath = in.Str();
+  msg.mediaFileSize = in.I64();
+  msg.width = in.I32();
+  msg.height = in.I32();
+  msg.mediaThumbnailFileId = in.I32();
+  msg.mediaThumbnailPath = in.Str();
+  msg.mediaMinithumbnail = in.Blob();
+  msg.mediaDuration = in.I32();
+  msg.mediaWaveform = in.Bytes();
+  msg.replyToMessageId = in.I64();
+  msg.replyToText = in.Str();
+  msg.isForwarded = in.Bool();
+  msg.forwardedFrom = in.Str();
+
+  uint32_t reactionCount = in.Count(8);
+  for (uint32_t i = 0; i < reactionCount && in.IsOk(); ++i) {
+    wxString emoji = in.Str();
+    uint32_t senderCount = in.Count(4);
+    std::vector<wxString> senders;
+    senders.reserve(senderCount);
+    for (uint32_t j = 0; j < senderCount && in.IsOk(); ++j) {
+      senders.push_back(in.Str());
+    }
+    msg.reactions[emoji] = std::move(senders);
+  }
+
+  uint32_t entityCount = in.Count(36);
+  msg.entities.reserve(entityCount);
+  for (uint32_t i = 0; i < entityCount && in.IsOk(); ++i) {
+    TextEntity entity;
+    uint32_t type = in.U32();
+    entity.type = type <= static_cast<uint32_t>(TextEntityType::Unknown)
+                      ? static_cast<TextEntityType>(type)
+                      : TextEntityType::Unknown;
+    entity.offset = in.I32();
+    entity.length = in.I32();
+    entity.url = in.Str();
+    entity.userId = in.I64();
+    entity.language = in.Str();
+    entity.customEmojiId = in.I64();
+    msg.entities.push_back(std::move(entity));
+  }
+  return msg;
+}
+
+} // namespace
+
+wxString WarmSnapshot::GetPath() {
+  return wxGetHomeDir() + "/.teleliter/warm.snapshot";
+}
+
+bool WarmSnapshot::Save(const wxString &path, const WarmSnapshotData &data) {
+  Writer out;
+  out.U32(MAGIC);
+  out.U32(VERSION);
+  out.I64(data.savedAt);
+  out.I64(data.selfUserId);
+  out.I64(data.lastChatId);
+
+  out.U32(static_cast<uint32_t>(data.chats.size()));
+  for (const auto &chat : data.chats) {
+    WriteChat(out, chat);
+  }
+
+  out.U32(static_cast<uint32_t>(data.users.size()));
+  for (const auto &user : data.users) {
+    WriteUser(out, user);
+  }
+
+  out.U32(static_cast<uint32_t>(data.messages.size()));
+  for (const auto &[chatId, messages] : data.messages) {
+    out.I64(chatId);
+    out.U32(static_cast<uint32_t>(messages.size()));
+    for (const auto &msg : messages) {
+      WriteMessage(out, msg);
+    }
+  }
+
+  wxFileName target(path);
+  if (!target.DirExists()) {
+    wxFileName::Mkdir(target.GetPath(), wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL);
+  }
+
+  wxString tempPath = path + ".tmp";
+  {
+    wxFile file;
+    if (!file.Create(tempPath, true, wxS_IRUSR | wxS_IWUSR)) {
+      return false;
+    }
+    const std::string &buffer = out.GetBuffer();
+    if (file.Write(buffer.data(), buffer.size()) != buffer.size()) {
+      file.Close();
+      wxRemoveFile(tempPath);
+      return false;
+    }
+  }
+  return wxRenameFile(tempPath, path, true);
+}
+
+bool WarmSnapshot::Load(const wxString &path, WarmSnapshotData &data) {
+  if (!wxFileExists(path)) {
+    return false;
+  }
+
+  wxFile file(path);
+  if (!file.IsOpened()) {
+    return false;
+  }
+  wxFileOffset length = file.Length();
+  if (length <= 0 || static_cast<uint64_t>(length) > MAX_FILE_SIZE) {
+    return false;
+  }
+
+  std::vector<char> buffer(static_cast<size_t>(length));
+  if (file.Read(buffer.data(), buffer.size()) !=
+      static_cast<ssize_t>(buffer.size())) {
+    return false;
+  }
+
+  Reader in(buffer.data(), buffer.size());
+  if (in.U32() != MAGIC || in.U32() != VERSION) {
+    return false;
+  }
+
+  WarmSnapshotData loaded;
+  loaded.savedAt = in.I64();
+  loaded.selfUserId = in.I64();
+  loaded.lastChatId = in.I64();
+
+  uint32_t chatCount = in.Count(64);
+  loaded.chats.reserve(chatCount);
+  for (uint32_t i = 0; i < chatCount && in.IsOk(); ++i) {
+    loaded.chats.push_back(ReadChat(in));
+  }
+
+  uint32_t userCount = in.Count(32);
+  loaded.users.reserve(userCount);
+  for (uint32_t i = 0; i < userCount && in.IsOk(); ++i) {
+    loaded.users.push_back(ReadUser(in));
+  }
+
+  uint32_t messageChatCount = in.Count(12);
+  for (uint32_t i = 0; i < messageChatCount && in.IsOk(); ++i) {
+    int64_t chatId = in.I64();
+    uint32_t messageCount = in.Count(100);
+    loaded.messages.emplace_back(chatId, std::vector<MessageInfo>());
+    std::vector<MessageInfo> &messages = loaded.messages.back().second;
+    messages.reserve(messageCount);
+    for (uint32_t j = 0; j < messageCount && in.IsOk(); ++j) {
+      messages.push_back(ReadMessage(in));
+    }
+  }
+
+  if (!in.IsOk()) {
+    return false;
+  }
+  data = std::move(loaded);
+  return true;
+}
+
+void WarmSnapshot::Remove(const wxString &path) {
+  if (wxFileExists(path)) {
+    wxRemoveFile(path);
+  }
+}
@@ -0,0 +1,46 @@
+#ifndef WARMSNAPSHOT_H
+#define WARMSNAPSHOT_H
+
+#include <wx/wx.h>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Types.h"
+
+// What the window needs to draw before TDLib has authorized: the chat list,
+// the users it refers to, and the tail of the chats opened last.
+struct WarmSnapshotData {
+  int64_t savedAt = 0;
+  int64_t selfUserId = 0;
+  int64_t lastChatId = 0;
+  std::vector<ChatInfo> chats;
+  std::vector<UserInfo> users;
+  // Most recently used chat first; each chat's messages oldest first
+  std::vector<std::pair<int64_t, std::vector<MessageInfo>>> messages;
+};
+
+// Compact binary snapshot in ~/.teleliter/warm.snapshot. Fixed-width
+// little-endian fields and length-prefixed UTF-8 strings, read with a single
+// read() and decoded in one pass. Writes go to a temp file that is renamed
+// over the old one, so a crash never leaves a torn snapshot behind.
+//
+// Any mismatch (magic, version, truncation) makes Load() fail and the
+// caller simply starts cold.
+class WarmSnapshot {
+public:
+  static wxString GetPath();
+
+  static bool Save(const wxString &path, const WarmSnapshotData &data);
+  static bool Load(const wxString &path, WarmSnapshotData &data);
+  static void Remove(const wxString &path);
+
+private:
+  static constexpr uint32_t MAGIC = 0x534C5754; // "TWLS"
+  static constexpr uint32_t VERSION = 1;
+  // Refuse absurd files instead of allocating for them
+  static constexpr uint64_t MAX_FILE_SIZE = 64 * 1024 * 1024;
+};
+
+#endif // WARMSNAPSHOT_H
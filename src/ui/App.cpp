@@ -1,5 +1,8 @@
 #include "App.h"
+#include "AudioOutput.h"
+#include "BitmapCache.h"
 #include "MainFrame.h"
+#include "MediaDecodePool.h"
 #include "Theme.h"
 #include <wx/image.h>
 #include <wx/config.h>
@@ -178,3 +181,14 @@ bool App::OnInit()
     frame->Show(true);
     return true;
 }
+
+int App::OnExit()
+{
+    // Join the decode workers while wxWidgets is still fully alive
+    MediaDecodePool::Get().Shutdown();
+    // Players are gone by now; release the shared audio device
+    AudioOutput::Get().Shutdown();
+    // Bitmaps must not outlive the GUI toolkit in a static destructor
+    BitmapCache::Get().Clear();
+    return wxApp::OnExit();
+}
@@ -0,0 +1,190 @@
+#include "AudioOutput.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#ifdef HAVE_SDL2
+#include <SDL.h>
+#endif
+
+#define AUDIOLOG(msg) std::cerr << "[AudioOutput] " << msg << std::endl
+
+AudioOutput &AudioOutput::Get() {
+  static AudioOutput instance;
+  return instance;
+}
+
+AudioOutput::~AudioOutput() { Shutdown(); }
+
+bool AudioOutput::OpenLocked() {
+#ifdef HAVE_SDL2
+  if (m_deviceId > 0) {
+    return true;
+  }
+  if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0) {
+    AUDIOLOG("Failed to initialize SDL audio: " << SDL_GetError());
+    return false;
+  }
+
+  SDL_AudioSpec wanted, obtained;
+  SDL_zero(wanted);
+  wanted.freq = SAMPLE_RATE;
+  wanted.format = AUDIO_S16SYS;
+  wanted.channels = CHANNELS;
+  wanted.samples = DEVICE_SAMPLES;
+  wanted.callback = Callback;
+  wanted.userdata = this;
+
+  // No allowed changes: SDL converts to whatever the device really uses
+  m_deviceId = SDL_OpenAudioDevice(nullptr, 0, &wanted, &obtained, 0);
+  if (m_deviceId == 0) {
+    AUDIOLOG("Failed to open SDL audio device: " << SDL_GetError());
+    SDL_QuitSubSystem(SDL_INIT_AUDIO);
+    return false;
+  }
+
+  // The callback must not allocate; obtained.size is its period in bytes
+  m_mixBuffer.resize(obtained.size / 2);
+  m_readBuffer.resize(obtained.size);
+
+  AUDIOLOG("SDL audio opened: " << obtained.freq << "Hz, "
+                                << (int)obtained.channels << " channels, "
+                                << obtained.samples << " samples");
+  return true;
+#else
+  AUDIOLOG("SDL2 not available - audio playback disabled");
+  return false;
+#endif
+}
+
+bool AudioOutput::Attach(Stream *stream) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_shutdown || !OpenLocked()) {
+    return false;
+  }
+  if (std::find(m_streams.begin(), m_streams.end(), stream) !=
+      m_streams.end()) {
+    return true;
+  }
+
+  stream->m_playing = false;
+#ifdef HAVE_SDL2
+  SDL_LockAudioDevice(m_deviceId);
+#endif
+  m_streams.push_back(stream);
+#ifdef HAVE_SDL2
+  SDL_UnlockAudioDevice(m_deviceId);
+#endif
+  return true;
+}
+
+void AudioOutput::Detach(Stream *stream) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = std::find(m_streams.begin(), m_streams.end(), stream);
+  if (it == m_streams.end()) {
+    return;
+  }
+
+#ifdef HAVE_SDL2
+  // Waits for a running callback to finish with the stream
+  SDL_LockAudioDevice(m_deviceId);
+#endif
+  m_streams.erase(it);
+#ifdef HAVE_SDL2
+  SDL_UnlockAudioDevice(m_deviceId);
+#endif
+  stream->m_playing = false;
+  UpdatePauseLocked();
+}
+
+void AudioOutput::SetPlaying(Stream *stream, bool playing) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (std::find(m_streams.begin(), m_streams.end(), stream) ==
+      m_streams.end()) {
+    return;
+  }
+  stream->m_playing = playing;
+  UpdatePauseLocked();
+}
+
+void AudioOutput::Clear(Stream *stream) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+#ifdef HAVE_SDL2
+  if (m_deviceId > 0) {
+    SDL_LockAudioDevice(m_deviceId);
+  }
+#endif
+  stream->m_ring.Clear();
+#ifdef HAVE_SDL2
+  if (m_deviceId > 0) {
+    SDL_UnlockAudioDevice(m_deviceId);
+  }
+#endif
+}
+
+void AudioOutput::UpdatePauseLocked() {
+#ifdef HAVE_SDL2
+  if (m_deviceId == 0) {
+    return;
+  }
+  bool anyPlaying = std::any_of(m_streams.begin(), m_streams.end(),
+                                [](Stream *s) { return s->m_playing.load(); });
+  // Pausing only stops the callback; the device stays open
+  SDL_PauseAudioDevice(m_deviceId, anyPlaying ? 0 : 1);
+#endif
+}
+
+void AudioOutput::Shutdown() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_shutdown = true;
+#ifdef HAVE_SDL2
+  if (m_deviceId > 0) {
+    SDL_CloseAudioDevice(m_deviceId);
+    SDL_QuitSubSystem(SDL_INIT_AUDIO);
+    m_deviceId = 0;
+  }
+#endif
+  m_streams.clear();
+}
+
+void AudioOutput::Callback(void *userdata, uint8_t *stream, int len) {
+  static_cast<AudioOutput *>(userdata)->Mix(stream, static_cast<size_t>(len));
+}
+
+void AudioOutput::Mix(uint8_t *out, size_t bytes) {
+  // Runs on the SDL audio thread with the device locked, so m_streams
+  // cannot change underneath it
+  if (m_readBuffer.size() < bytes) {
+    m_readBuffer.resize(bytes);
+    m_mixBuffer.resize(bytes / 2);
+  }
+  size_t sampleCount = bytes / 2;
+  std::fill(m_mixBuffer.begin(), m_mixBuffer.begin() + sampleCount, 0);
+
+  for (Stream *stream : m_streams) {
+    if (!stream->m_playing) {
+      continue;
+    }
+
+    size_t got = stream->m_ring.Read(m_readBuffer.data(), bytes);
+    stream->m_framesPlayed += got / FRAME_BYTES;
+    if (got < bytes && !stream->m_ended) {
+      stream->m_underruns++;
+      stream->m_underrunFrames += (bytes - got) / FRAME_BYTES;
+    }
+
+    const int16_t *samples =
+        reinterpret_cast<const int16_t *>(m_readBuffer.data());
+    float volume = stream->m_volume;
+    for (size_t i = 0; i < got / 2; i++) {
+      m_mixBuffer[i] += static_cast<int32_t>(samples[i] * volume);
+    }
+  }
+
+  int16_t *output = reinterpret_cast<int16_t *>(out);
+  for (size_t i = 0; i < sampleCount; i++) {
+    output[i] = static_cast<int16_t>(
+        std::max<int32_t>(-32768, std::min<int32_t>(32767, m_mixBuffer[i])));
+  }
+}
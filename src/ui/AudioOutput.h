@@ -0,0 +1,96 @@
+#ifndef AUDIOOUTPUT_H
+#define AUDIOOUTPUT_H
+
+#include "AudioRingBuffer.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// The one SDL audio device of the process, opened on first use and kept
+// open until Shutdown(). Players attach a Stream and write PCM into its
+// ring; the device callback mixes every playing stream. Opening a device
+// costs tens to hundreds of milliseconds on PulseAudio/PipeWire, so one
+// voice note after another, or a video after a voice note, starts without
+// that wait.
+//
+// The device is paused, not closed, while no stream is playing.
+class AudioOutput {
+public:
+  // Output format of every stream: interleaved S16 stereo at 48 kHz
+  static const int SAMPLE_RATE = 48000;
+  static const int CHANNELS = 2;
+  static const int FRAME_BYTES = CHANNELS * 2;
+
+  // One source in the mix. Its owner writes into GetRing() from a single
+  // thread; the device callback is the only reader.
+  class Stream {
+  public:
+    AudioRingBuffer &GetRing() { return m_ring; }
+    const AudioRingBuffer &GetRing() const { return m_ring; }
+
+    void SetVolume(double volume) { m_volume = static_cast<float>(volume); }
+
+    // Running dry once the source is exhausted is not an underrun
+    void SetEnded(bool ended) { m_ended = ended; }
+
+    // Sample frames the device has taken from the ring
+    uint64_t GetFramesPlayed() const { return m_framesPlayed; }
+    void ResetFramesPlayed() { m_framesPlayed = 0; }
+
+    // Device periods the ring fell short in, and the frames of silence
+    // that cost
+    uint64_t GetUnderruns() const { return m_underruns; }
+    uint64_t GetUnderrunFrames() const { return m_underrunFrames; }
+
+  private:
+    friend class AudioOutput;
+
+    AudioRingBuffer m_ring;
+    std::atomic<float> m_volume{1.0f};
+    std::atomic<bool> m_playing{false};
+    std::atomic<bool> m_ended{false};
+    std::atomic<uint64_t> m_framesPlayed{0};
+    std::atomic<uint64_t> m_underruns{0};
+    std::atomic<uint64_t> m_underrunFrames{0};
+  };
+
+  static AudioOutput &Get();
+
+  // Adds the stream to the mix, paused, opening the device if needed.
+  // False if there is no audio device
+  bool Attach(Stream *stream);
+  // Removes the stream; the callback no longer touches it on return
+  void Detach(Stream *stream);
+
+  void SetPlaying(Stream *stream, bool playing);
+
+  // Empties the stream's ring with the callback held off
+  void Clear(Stream *stream);
+
+  // Closes the device; later Attach() calls fail
+  void Shutdown();
+
+private:
+  AudioOutput() = default;
+  ~AudioOutput();
+
+  bool OpenLocked();
+  void UpdatePauseLocked();
+  void Mix(uint8_t *out, size_t bytes);
+  static void Callback(void *userdata, uint8_t *stream, int len);
+
+  std::mutex m_mutex;  // Attach/Detach/SetPlaying; never taken by Mix()
+  std::vector<Stream *> m_streams;  // Changed only with the device locked
+  uint32_t m_deviceId = 0;
+  bool m_shutdown = false;
+
+  // Callback scratch, sized to the device period when it opens
+  std::vector<int32_t> m_mixBuffer;
+  std::vector<uint8_t> m_readBuffer;
+
+  static const int DEVICE_SAMPLES = 1024;  // ~21 ms per callback
+};
+
+#endif // AUDIOOUTPUT_H
@@ -0,0 +1,74 @@
+#include "AudioRingBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+void AudioRingBuffer::Reset(size_t minBytes) {
+  size_t capacity = 1;
+  while (capacity < minBytes) {
+    capacity <<= 1;
+  }
+  m_buffer.assign(capacity, 0);
+  m_mask = capacity - 1;
+  Clear();
+}
+
+void AudioRingBuffer::Clear() {
+  m_writePos.store(0, std::memory_order_relaxed);
+  m_readPos.store(0, std::memory_order_relaxed);
+}
+
+size_t AudioRingBuffer::GetWritable() const {
+  uint64_t write = m_writePos.load(std::memory_order_relaxed);
+  uint64_t read = m_readPos.load(std::memory_order_acquire);
+  return m_buffer.size() - static_cast<size_t>(write - read);
+}
+
+size_t AudioRingBuffer::GetReadable() const {
+  uint64_t write = m_writePos.load(std::memory_order_acquire);
+  uint64_t read = m_readPos.load(std::memory_order_relaxed);
+  return static_cast<size_t>(write - read);
+}
+
+size_t AudioRingBuffer::Write(const uint8_t *data, size_t bytes) {
+  if (m_buffer.empty()) {
+    return 0;
+  }
+  uint64_t write = m_writePos.load(std::memory_order_relaxed);
+  // Acquire: the consumer is done with the bytes it has released
+  uint64_t read = m_readPos.load(std::memory_order_acquire);
+  size_t count =
+      std::min(bytes, m_buffer.size() - static_cast<size_t>(write - read));
+  if (count == 0) {
+    return 0;
+  }
+
+  size_t start = static_cast<size_t>(write) & m_mask;
+  size_t first = std::min(count, m_buffer.size() - start);
+  memcpy(m_buffer.data() + start, data, first);
+  memcpy(m_buffer.data(), data + first, count - first);
+
+  // Release: the bytes are in place before the consumer can see them
+  m_writePos.store(write + count, std::memory_order_release);
+  return count;
+}
+
+size_t AudioRingBuffer::Read(uint8_t *out, size_t bytes) {
+  if (m_buffer.empty()) {
+    return 0;
+  }
+  uint64_t read = m_readPos.load(std::memory_order_relaxed);
+  uint64_t write = m_writePos.load(std::memory_order_acquire);
+  size_t count = std::min(bytes, static_cast<size_t>(write - read));
+  if (count == 0) {
+    return 0;
+  }
+
+  size_t start = static_cast<size_t>(read) & m_mask;
+  size_t first = std::min(count, m_buffer.size() - start);
+  memcpy(out, m_buffer.data() + start, first);
+  memcpy(out + first, m_buffer.data(), count - first);
+
+  m_readPos.store(read + count, std::memory_order_release);
+  return count;
+}
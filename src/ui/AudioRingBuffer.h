@@ -0,0 +1,45 @@
+#ifndef AUDIORINGBUFFER_H
+#define AUDIORINGBUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Wait-free single-producer/single-consumer byte ring for PCM between a
+// decode thread and the SDL audio callback. Neither side ever blocks or
+// takes a lock: each owns one position counter and only reads the other's.
+//
+// Counters run on forever (64 bits do not wrap in practice) and are masked
+// into the buffer, whose capacity is a power of two.
+//
+// Reset() and Clear() are not concurrent with Read()/Write(); call them
+// with the consumer stopped (e.g. under SDL_LockAudioDevice).
+class AudioRingBuffer {
+public:
+  AudioRingBuffer() = default;
+
+  // Room for at least minBytes, rounded up to a power of two; empties it
+  void Reset(size_t minBytes);
+  void Clear();
+
+  // Producer side. Copies as much of data as fits and returns that count
+  size_t Write(const uint8_t *data, size_t bytes);
+  size_t GetWritable() const;
+
+  // Consumer side. Copies up to bytes and returns the count copied
+  size_t Read(uint8_t *out, size_t bytes);
+  size_t GetReadable() const;
+
+  size_t GetCapacity() const { return m_buffer.size(); }
+
+private:
+  std::vector<uint8_t> m_buffer;
+  size_t m_mask = 0;
+
+  // On separate cache lines so producer and consumer do not contend
+  alignas(64) std::atomic<uint64_t> m_writePos{0};
+  alignas(64) std::atomic<uint64_t> m_readPos{0};
+};
+
+#endif // AUDIORINGBUFFER_H
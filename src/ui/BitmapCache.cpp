@@ -0,0 +1,136 @@
+#include "BitmapCache.h"
+
+#include <wx/filefn.h>
+
+#include <iterator>
+
+BitmapCache &BitmapCache::Get() {
+  static BitmapCache instance;
+  return instance;
+}
+
+uint64_t BitmapCache::Hash(const wxString &path, int width, int height) {
+  // FNV-1a over the characters and the size
+  uint64_t hash = 1469598103934665603ULL;
+  auto mix = [&hash](uint64_t value) {
+    hash ^= value;
+    hash *= 1099511628211ULL;
+  };
+  for (wxString::const_iterator it = path.begin(); it != path.end(); ++it) {
+    mix(static_cast<uint64_t>((*it).GetValue()));
+  }
+  mix(static_cast<uint64_t>(static_cast<uint32_t>(width)));
+  mix(static_cast<uint64_t>(static_cast<uint32_t>(height)));
+  return hash;
+}
+
+bool BitmapCache::Lookup(const wxString &path, int width, int height,
+                         wxBitmap &bitmap) {
+  return Find(path, width, height, true, bitmap);
+}
+
+bool BitmapCache::LookupKey(const wxString &key, int width, int height,
+                            wxBitmap &bitmap) {
+  return Find(key, width, height, false, bitmap);
+}
+
+void BitmapCache::Store(const wxString &path, int width, int height,
+                        const wxBitmap &bitmap) {
+  if (path.IsEmpty()) {
+    return;
+  }
+  time_t mtime = wxFileModificationTime(path);
+  if (mtime == static_cast<time_t>(-1)) {
+    return;
+  }
+  Insert(path, width, height, mtime, bitmap);
+}
+
+void BitmapCache::StoreKey(const wxString &key, int width, int height,
+                           const wxBitmap &bitmap) {
+  if (key.IsEmpty()) {
+    return;
+  }
+  Insert(key, width, height, static_cast<time_t>(-1), bitmap);
+}
+
+bool BitmapCache::Find(const wxString &path, int width, int height,
+                       bool checkFile, wxBitmap &bitmap) {
+  if (path.IsEmpty()) {
+    return false;
+  }
+
+  auto found = m_index.find(Hash(path, width, height));
+  if (found == m_index.end()) {
+    return false;
+  }
+  EntryList::iterator entry = found->second;
+  if (entry->width != width || entry->height != height ||
+      entry->path != path) {
+    return false; // Hash collision; Store() will replace it
+  }
+
+  if (checkFile) {
+    time_t mtime = wxFileModificationTime(path);
+    if (mtime == static_cast<time_t>(-1) || mtime != entry->mtime) {
+      Erase(entry);
+      return false;
+    }
+  }
+
+  // Splicing relinks the node in place, so a hit never allocates
+  m_entries.splice(m_entries.begin(), m_entries, entry);
+  bitmap = entry->bitmap;
+  return true;
+}
+
+void BitmapCache::Insert(const wxString &path, int width, int height,
+                         time_t mtime, const wxBitmap &bitmap) {
+  if (!bitmap.IsOk()) {
+    return;
+  }
+
+  size_t bytes = static_cast<size_t>(bitmap.GetWidth()) *
+                 static_cast<size_t>(bitmap.GetHeight()) * 4;
+  if (bytes > BUDGET_BYTES / 4) {
+    return; // One picture must not flush everything else
+  }
+
+  uint64_t hash = Hash(path, width, height);
+  auto found = m_index.find(hash);
+  if (found != m_index.end()) {
+    Erase(found->second);
+  }
+
+  Entry entry;
+  entry.hash = hash;
+  entry.path = path;
+  entry.width = width;
+  entry.height = height;
+  entry.mtime = mtime;
+  entry.bitmap = bitmap;
+  entry.bytes = bytes;
+  m_entries.push_front(std::move(entry));
+  m_index[hash] = m_entries.begin();
+  m_bytes += bytes;
+
+  Trim();
+}
+
+void BitmapCache::Clear() {
+  m_entries.clear();
+  m_index.clear();
+  m_bytes = 0;
+}
+
+void BitmapCache::Erase(EntryList::iterator entry) {
+  m_bytes -= entry->bytes;
+  m_index.erase(entry->hash);
+  m_entries.erase(entry);
+}
+
+void BitmapCache::Trim() {
+  while (m_bytes > BUDGET_BYTES && !m_entries.empty()) {
+    Erase(std::prev(m_entries.end()));
+  }
+}
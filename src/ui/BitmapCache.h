@@ -0,0 +1,70 @@
+#ifndef BITMAPCACHE_H
+#define BITMAPCACHE_H
+
+#include <wx/wx.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <list>
+#include <unordered_map>
+
+// Process-wide cache of images that were decoded and scaled for display,
+// keyed by (file path, target size, modification time). Media previews and
+// avatars look here before going back to the disk, so showing the same
+// picture again is a lookup instead of a decode and a high-quality rescale.
+//
+// Entries are evicted least recently used first once the decoded pixels
+// exceed the byte budget. A file that changed on disk (a re-download, a
+// newer profile photo) misses because its mtime no longer matches.
+//
+// Main thread only: wxBitmap is a GUI object.
+class BitmapCache {
+public:
+  static BitmapCache &Get();
+
+  // The bitmap stored for path at width x height, if the file is unchanged
+  bool Lookup(const wxString &path, int width, int height, wxBitmap &bitmap);
+  void Store(const wxString &path, int width, int height,
+             const wxBitmap &bitmap);
+
+  // Same for pictures decoded from bytes in memory (TDLib minithumbnails):
+  // key names the source, and with no file behind it there is no mtime check
+  bool LookupKey(const wxString &key, int width, int height, wxBitmap &bitmap);
+  void StoreKey(const wxString &key, int width, int height,
+                const wxBitmap &bitmap);
+
+  void Clear();
+  size_t GetBytes() const { return m_bytes; }
+
+private:
+  BitmapCache() = default;
+
+  struct Entry {
+    uint64_t hash = 0;
+    wxString path;
+    int width = 0;
+    int height = 0;
+    time_t mtime = 0; // -1 for keyed entries
+    wxBitmap bitmap;
+    size_t bytes = 0;
+  };
+  using EntryList = std::list<Entry>;
+
+  // Hashes the key without building a string, so hits do not allocate
+  static uint64_t Hash(const wxString &path, int width, int height);
+  bool Find(const wxString &path, int width, int height, bool checkFile,
+            wxBitmap &bitmap);
+  void Insert(const wxString &path, int width, int height, time_t mtime,
+              const wxBitmap &bitmap);
+  void Erase(EntryList::iterator entry);
+  void Trim();
+
+  EntryList m_entries; // Most recently used first
+  std::unordered_map<uint64_t, EntryList::iterator> m_index;
+  size_t m_bytes = 0;
+
+  static constexpr size_t BUDGET_BYTES = 64 * 1024 * 1024;
+};
+
+#endif // BITMAPCACHE_H
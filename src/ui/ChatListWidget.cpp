@@ -6,6 +6,7 @@
 #include "UserInfoPopup.h"
 #include <wx/settings.h>
 #include <wx/sizer.h>
+#include <algorithm>
 #include <iostream>
 
 // #define CLWLOG(msg) std::cerr << "[ChatListWidget] " << msg << std::endl
@@ -151,6 +152,9 @@ void ChatListWidget::CreateCategories() {
 void ChatListWidget::RefreshChatList(const std::vector<ChatInfo> &chats) {
   // Store chats for filtering
   m_allChats = chats;
+  if (m_lowerTitles.size() > m_allChats.size() * 2) {
+    m_lowerTitles.clear(); // Mostly chats that are gone
+  }
 
   // Remember current selection
   int64_t selectedChatId = GetSelectedChatId();
@@ -289,11 +293,13 @@ void ChatListWidget::SelectTeleliter() {
   m_chatTree->SelectItem(m_teleliterItem);
 }
 
-void ChatListWidget::SelectChat(int64_t chatId) {
+bool ChatListWidget::SelectChat(int64_t chatId) {
   auto it = m_chatIdToTreeItem.find(chatId);
-  if (it != m_chatIdToTreeItem.end()) {
-    m_chatTree->SelectItem(it->second);
+  if (it == m_chatIdToTreeItem.end()) {
+    return false;
   }
+  m_chatTree->SelectItem(it->second);
+  return true;
 }
 
 int64_t ChatListWidget::GetSelectedChatId() const {
@@ -365,6 +371,43 @@ wxTreeItemId ChatListWidget::GetTreeItemFromChatId(int64_t chatId) const {
   return wxTreeItemId();
 }
 
+std::vector<int64_t> ChatListWidget::GetNeighbourChatIds(int64_t chatId,
+                                                         size_t radius) const {
+  std::vector<int64_t> neighbours;
+  if (m_chatIdToTreeItem.find(chatId) == m_chatIdToTreeItem.end()) {
+    return neighbours;
+  }
+
+  // Categories top to bottom; a filtered-out chat is not in the tree
+  std::vector<int64_t> rows;
+  for (const wxTreeItemId &category :
+       {m_pinnedChats, m_privateChats, m_groups, m_channels, m_bots}) {
+    wxTreeItemIdValue cookie;
+    for (wxTreeItemId child = m_chatTree->GetFirstChild(category, cookie);
+         child.IsOk(); child = m_chatTree->GetNextChild(category, cookie)) {
+      int64_t id = GetChatIdFromTreeItem(child);
+      if (id != 0) {
+        rows.push_back(id);
+      }
+    }
+  }
+
+  auto current = std::find(rows.begin(), rows.end(), chatId);
+  if (current == rows.end()) {
+    return neighbours;
+  }
+  size_t index = current - rows.begin();
+  for (size_t distance = 1; distance <= radius; ++distance) {
+    if (index + distance < rows.size()) {
+      neighbours.push_back(rows[index + distance]);
+    }
+    if (index >= distance) {
+      neighbours.push_back(rows[index - distance]);
+    }
+  }
+  return neighbours;
+}
+
 wxTreeItemId ChatListWidget::GetCategoryForChat(const ChatInfo &chat) const {
   // Determine which category this chat belongs to
   if (chat.isPinned) {
@@ -505,15 +548,17 @@ bool ChatListWidget::MatchesFilter(const ChatInfo &chat) const {
     return true;
   }
 
-  // Case-insensitive search on title
-  wxString lowerTitle = chat.title.Lower();
-  wxString lowerFilter = m_searchFilter.Lower();
-
-  return lowerTitle.Contains(lowerFilter);
+  // Case-insensitive search on title (the filter is stored lowercased)
+  auto &cached = m_lowerTitles[chat.id];
+  if (cached.first != chat.title) {
+    cached.first = chat.title;
+    cached.second = chat.title.Lower();
+  }
+  return cached.second.Contains(m_searchFilter);
 }
 
 void ChatListWidget::SetSearchFilter(const wxString &filter) {
-  m_searchFilter = filter;
+  m_searchFilter = filter.Lower();
   ApplyFilter();
 }
 
@@ -559,7 +604,7 @@ void ChatListWidget::RefreshOnlineIndicators() {
 }
 
 void ChatListWidget::OnSearchText(wxCommandEvent &event) {
-  m_searchFilter = m_searchBox->GetValue();
+  m_searchFilter = m_searchBox->GetValue().Lower();
   ApplyFilter();
 }
 
@@ -27,11 +27,16 @@ public:
   void RefreshOnlineIndicators();  // Update online status for private chats
   void ClearAllChats();
   void SelectTeleliter();
-  void SelectChat(int64_t chatId);
+  // False if the chat is not in the tree (not loaded or filtered out)
+  bool SelectChat(int64_t chatId);
 
   // Chat item access
   int64_t GetSelectedChatId() const;
   bool IsTeleliterSelected() const;
+  // Chats up to radius rows away in the order Prev/Next Chat walks,
+  // nearest first
+  std::vector<int64_t> GetNeighbourChatIds(int64_t chatId,
+                                           size_t radius) const;
 
   // Styling
   void SetTreeColors(const wxColour &bg, const wxColour &fg,
@@ -126,7 +131,10 @@ private:
 
   // Store all chats for filtering
   std::vector<ChatInfo> m_allChats;
-  wxString m_searchFilter;
+  wxString m_searchFilter; // Lowercased
+  // Chat id -> (title, lowercased title), so filtering on every keystroke
+  // does not lowercase every title again; redone when a title changes
+  mutable std::map<int64_t, std::pair<wxString, wxString>> m_lowerTitles;
 
   // Colors
   wxColour m_bgColor;
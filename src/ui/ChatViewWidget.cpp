@@ -1,5 +1,7 @@
 #include "ChatViewWidget.h"
 #include "../telegram/TelegramClient.h"
+#include "BitmapCache.h"
+#include "ImageScaler.h"
 #include "InputBoxWidget.h"
 #include "MainFrame.h"
 #include "MediaPopup.h"
@@ -7,6 +9,7 @@
 #include "Theme.h"
 #include <algorithm>
 #include <iostream>
+#include <string_view>
 #include <unordered_map>
 #include <wx/clipbrd.h>
 #include <wx/settings.h>
@@ -83,7 +86,8 @@ ChatViewWidget::ChatViewWidget(wxWindow *parent, MainFrame *mainFrame)
       m_wasAtBottom(true), m_forceScrollToBottom(false), m_newMessageCount(0),
       m_isLoading(false), m_highlightTimer(this, HIGHLIGHT_TIMER_ID),
       m_isReloading(false), m_batchUpdateDepth(0), m_lastDisplayedTimestamp(0),
-      m_lastDisplayedMessageId(0), m_contextMenuPos(-1), m_lazyLoadTimer(this) {
+      m_lastDisplayedMessageId(0), m_contextMenuPos(-1), m_lazyLoadTimer(this),
+      m_viewportTimer(this) {
   // Bind timer events
   Bind(
       wxEVT_TIMER, [this](wxTimerEvent &) { HideDownloadProgress(); },
@@ -94,6 +98,8 @@ ChatViewWidget::ChatViewWidget(wxWindow *parent, MainFrame *mainFrame)
        HIGHLIGHT_TIMER_ID);
   Bind(wxEVT_TIMER, &ChatViewWidget::OnLazyLoadTimer, this,
        m_lazyLoadTimer.GetId());
+  Bind(wxEVT_TIMER, &ChatViewWidget::OnViewportTimer, this,
+       m_viewportTimer.GetId());
 
   // Bind size event for repositioning the new message button
   Bind(wxEVT_SIZE, &ChatViewWidget::OnSize, this);
@@ -172,6 +178,10 @@ void ChatViewWidget::CreateLayout() {
   m_chatArea = new ChatArea(this);
   mainSizer->Add(m_chatArea, 1, wxEXPAND);
 
+  // Find bar below the scrollback (hidden until Ctrl+F)
+  CreateFindBar();
+  mainSizer->Add(m_findBar, 0, wxEXPAND);
+
   SetSizer(mainSizer);
 
   // Create the "New Messages" button (hidden initially)
@@ -397,10 +407,16 @@ void ChatViewWidget::UpdateUserPhoto(const wxString &photoPath) {
     return;
   }
 
+  // Cached already cropped and made circular
+  static constexpr int size = 40;
+  if (BitmapCache::Get().Lookup(photoPath, size, size, m_userPhotoBitmap)) {
+    m_userPhoto->SetBitmap(m_userPhotoBitmap);
+    return;
+  }
+
   wxImage image;
   if (image.LoadFile(photoPath)) {
     // Scale to 40x40
-    int size = 40;
     int origW = image.GetWidth();
     int origH = image.GetHeight();
     int newW, newH;
@@ -413,7 +429,7 @@ void ChatViewWidget::UpdateUserPhoto(const wxString &photoPath) {
       newH = (origH * size) / origW;
     }
 
-    image.Rescale(newW, newH, wxIMAGE_QUALITY_HIGH);
+    image = DownscaleImage(image, newW, newH);
 
     // Crop to center
     int cropX = (newW - size) / 2;
@@ -422,6 +438,7 @@ void ChatViewWidget::UpdateUserPhoto(const wxString &photoPath) {
 
     m_userPhotoBitmap = CreateCircularBitmap(wxBitmap(image), size);
     m_userPhoto->SetBitmap(m_userPhotoBitmap);
+    BitmapCache::Get().Store(photoPath, size, size, m_userPhotoBitmap);
   }
 }
 
@@ -568,6 +585,16 @@ void ChatViewWidget::RefreshTheme() {
     }
   }
   
+  // Theme the find bar
+  if (m_findBar) {
+    m_findBar->SetBackgroundColour(colors.panelBg);
+    m_findLabel->SetForegroundColour(colors.windowFg);
+    m_findStatus->SetForegroundColour(colors.mutedText);
+    if (!m_findHighlighted.empty()) {
+      ApplyFindHighlights();
+    }
+  }
+
   // Theme the new message button
   if (m_newMessageButton) {
     m_newMessageButton->SetBackgroundColour(colors.accentPrimary);
@@ -801,8 +828,10 @@ void ChatViewWidget::RefreshDisplay() {
   // Check if we should scroll to bottom after refresh
   // Use m_forceScrollToBottom for robust new-chat scrolling
   // Also use m_wasAtBottom flag or check current position
+  // Pages appended below a window must not fling the view to their end
   bool shouldScrollToBottom =
-      m_forceScrollToBottom || m_wasAtBottom || IsAtBottom();
+      (m_forceScrollToBottom || m_wasAtBottom || IsAtBottom()) &&
+      !m_isLoadingNewer;
 
   // Consume the force flag (it's a one-shot)
   bool wasForced = m_forceScrollToBottom;
@@ -852,8 +881,10 @@ void ChatViewWidget::RefreshDisplay() {
   ClearMediaSpans();
   ClearEditSpans();
   ClearLinkSpans();
+  ClearReplySpans();
   m_readMarkerSpans.clear();
   m_messageRangeMap.clear();
+  m_findHighlighted.clear(); // Went away with the old document
 
   // Reset formatting state
   m_messageFormatter->ResetGroupingState();
@@ -964,6 +995,10 @@ void ChatViewWidget::RefreshDisplay() {
                << addedScrollRange << " oldPos=" << oldScrollPos
                << " -> targetScrollPos=" << targetScrollPos);
     display->Scroll(0, targetScrollPos);
+  } else if (m_isLoadingNewer) {
+    // New content went in below; the same pixel offset shows the same text
+    SCROLL_LOG("  -> keeping position (loading newer)");
+    display->Scroll(0, std::min(oldScrollPos, std::max(0, newMaxScroll)));
   } else if (userScrolledUp && newMaxScroll > 0) {
     // User was scrolled up - restore same percentage position
     int targetScrollPos = static_cast<int>(scrollPercent * newMaxScroll);
@@ -977,6 +1012,14 @@ void ChatViewWidget::RefreshDisplay() {
 
   // Force immediate update to prevent flash of wrong position
   display->Update();
+
+  // Character ranges changed - re-evaluate which media is on screen
+  ScheduleViewportUpdate();
+
+  // Keep find results in step with the new document
+  if (IsFindBarShown() && !m_findQuery.empty()) {
+    RunFind(false);
+  }
 }
 
 void ChatViewWidget::ForceScrollToBottom() {
@@ -987,6 +1030,45 @@ void ChatViewWidget::ForceScrollToBottom() {
   ScrollToBottom();
 }
 
+bool ChatViewWidget::ScrollToMessage(int64_t messageId) {
+  if (!m_chatArea)
+    return false;
+
+  wxRichTextCtrl *display = m_chatArea->GetDisplay();
+  if (!display)
+    return false;
+
+  long startPos = 0, endPos = 0;
+  {
+    std::lock_guard<std::mutex> lock(m_messagesMutex);
+    auto it = m_messageRangeMap.find(messageId);
+    if (it == m_messageRangeMap.end()) {
+      return false;
+    }
+    startPos = it->second.first;
+    endPos = it->second.second;
+  }
+
+  ShowRange(startPos, endPos);
+  return true;
+}
+
+void ChatViewWidget::ShowRange(long startPos, long endPos) {
+  wxRichTextCtrl *display = m_chatArea ? m_chatArea->GetDisplay() : nullptr;
+  if (!display)
+    return;
+
+  // Stop pending auto-scrolls from yanking the view back to the bottom
+  m_wasAtBottom = false;
+  m_forceScrollToBottom = false;
+
+  display->LayoutContent();
+  display->ShowPosition(endPos);
+  display->ShowPosition(startPos);
+  display->SetSelection(startPos, endPos);
+  ScheduleViewportUpdate();
+}
+
 void ChatViewWidget::ScrollToBottomAggressive() {
   if (!m_chatArea)
     return;
@@ -1037,6 +1119,7 @@ void ChatViewWidget::RenderMessageToDisplay(const MessageInfo &msg) {
   if (msg.id != 0 && endPos > startPos) {
     m_messageRangeMap[msg.id] = {startPos, endPos};
   }
+  m_findHaystackDirty = true;
 }
 
 void ChatViewWidget::DoRenderMessage(const MessageInfo &msg) {
@@ -1108,8 +1191,10 @@ void ChatViewWidget::DoRenderMessage(const MessageInfo &msg) {
   // Handle reply messages
   if (msg.replyToMessageId != 0 && !msg.replyToText.IsEmpty()) {
     long startPos = m_chatArea->GetLastPosition();
-    m_messageFormatter->AppendReplyMessage(timestamp, sender, msg.replyToText,
-                                           msg.text, status, statusHighlight);
+    long replyStart = m_messageFormatter->AppendReplyMessage(
+        timestamp, sender, msg.replyToText, msg.text, status, statusHighlight);
+    AddReplySpan(replyStart, m_chatArea->GetLastPosition() - 1,
+                 msg.replyToMessageId);
     if (hasReadMarker)
       RecordReadMarker(startPos, m_chatArea->GetLastPosition(), msg.id);
     if (!msg.reactions.empty()) {
@@ -1452,6 +1537,10 @@ void ChatViewWidget::DisplayMessage(const MessageInfo &msg) {
     // needed
 
     ScrollToBottomIfAtBottom();
+
+    if (IsFindBarShown() && !m_findQuery.empty()) {
+      RunFind(false);
+    }
   } else {
     // Out of order message - must resort and refresh
     ScheduleRefresh();
@@ -1461,10 +1550,6 @@ void ChatViewWidget::DisplayMessage(const MessageInfo &msg) {
 void ChatViewWidget::DisplayMessages(const std::vector<MessageInfo> &messages) {
   CVWLOG("DisplayMessages: called with " << messages.size() << " messages");
 
-  // Collect media to download outside the lock to avoid holding mutex during
-  // external calls
-  std::vector<MediaInfo> mediaToDownload;
-
   // Add all messages to storage first
   {
     std::lock_guard<std::mutex> lock(m_messagesMutex);
@@ -1479,38 +1564,12 @@ void ChatViewWidget::DisplayMessages(const std::vector<MessageInfo> &messages) {
         m_displayedMessageIds.insert(msg.id);
         m_messageIdToIndex[msg.id] = index;
       }
-
-      // Collect media info for later download (outside lock)
-      if (msg.hasPhoto || msg.hasSticker || msg.hasAnimation || msg.hasVoice ||
-          msg.hasVideoNote || msg.hasVideo) {
-        MediaInfo info;
-        info.fileId = msg.mediaFileId;
-        info.localPath = msg.mediaLocalPath;
-        if (msg.hasPhoto)
-          info.type = MediaType::Photo;
-        else if (msg.hasSticker)
-          info.type = MediaType::Sticker;
-        else if (msg.hasAnimation)
-          info.type = MediaType::GIF;
-        else if (msg.hasVoice)
-          info.type = MediaType::Voice;
-        else if (msg.hasVideoNote)
-          info.type = MediaType::VideoNote;
-        else if (msg.hasVideo)
-          info.type = MediaType::Video;
-        mediaToDownload.push_back(info);
-      }
     }
   }
-  // Lock released - now safe to make external calls
-
-  // Trigger downloads for media (outside the lock to avoid potential deadlocks)
-  for (const auto &info : mediaToDownload) {
-    EnsureMediaDownloaded(info);
-  }
 
   // Render all messages in proper order immediately (not debounced for bulk
-  // loads)
+  // loads). Media downloads are driven by the viewport once the layout has
+  // settled (RefreshDisplay schedules it) instead of fetching every message.
   RefreshDisplay();
 
   // Safety scroll: For new chats, use aggressive multi-attempt scrolling
@@ -1559,6 +1618,113 @@ void ChatViewWidget::DisplayMessages(const std::vector<MessageInfo> &messages) {
   });
 }
 
+void ChatViewWidget::MergeMessages(const std::vector<MessageInfo> &messages) {
+  if (messages.empty()) {
+    return;
+  }
+
+  // Sorted input: if the oldest new message is past the last line, every
+  // one of them can be appended without rebuilding the document
+  if (m_lastDisplayedTimestamp == 0 ||
+      messages.front().date >= m_lastDisplayedTimestamp) {
+    for (const auto &msg : messages) {
+      DisplayMessage(msg);
+    }
+    return;
+  }
+
+  for (const auto &msg : messages) {
+    AddMessage(msg);
+  }
+  ScheduleRefresh();
+}
+
+void ChatViewWidget::AppendMessages(const std::vector<MessageInfo> &messages) {
+  if (messages.empty()) {
+    return;
+  }
+
+  std::vector<MessageInfo> page = messages;
+  std::sort(page.begin(), page.end(),
+            [](const MessageInfo &a, const MessageInfo &b) {
+              if (a.date != b.date)
+                return a.date < b.date;
+              return a.id < b.id;
+            });
+
+  wxRichTextCtrl *display = m_chatArea ? m_chatArea->GetDisplay() : nullptr;
+  if (!m_messageFormatter || !display ||
+      (m_lastDisplayedTimestamp != 0 &&
+       page.front().date < m_lastDisplayedTimestamp)) {
+    for (const auto &msg : page) {
+      AddMessage(msg);
+    }
+    RefreshDisplay();
+    return;
+  }
+
+  // Media is fetched by the viewport, not per appended message
+  BeginBatchUpdate();
+  display->BeginSuppressUndo();
+  for (const auto &msg : page) {
+    if (msg.id != 0 && HasMessage(msg.id)) {
+      continue;
+    }
+    AddMessage(msg);
+    display->SetInsertionPointEnd();
+    long lastPos = display->GetLastPosition();
+    if (lastPos > 0) {
+      wxString lastChar = display->GetRange(lastPos - 1, lastPos);
+      if (!lastChar.IsEmpty() && lastChar[0] != '\n' && lastChar[0] != '\r') {
+        display->WriteText("\n");
+      }
+    }
+    RenderMessageToDisplay(msg);
+  }
+  long lastPos = display->GetLastPosition();
+  if (lastPos > 0 && display->GetRange(lastPos - 1, lastPos) == "\n") {
+    display->Remove(lastPos - 1, lastPos);
+  }
+  display->EndSuppressUndo();
+  EndBatchUpdate();
+
+  ScheduleViewportUpdate();
+  if (IsFindBarShown() && !m_findQuery.empty()) {
+    RunFind(false);
+  }
+}
+
+void ChatViewWidget::DisplayHistoryWindow(
+    const std::vector<MessageInfo> &messages, int64_t anchorId,
+    bool hasNewer) {
+  ClearMessages();
+  m_hasNewerMessages = hasNewer;
+  m_hasMoreMessages = true;
+
+  {
+    std::lock_guard<std::mutex> lock(m_messagesMutex);
+    for (const auto &msg : messages) {
+      if (msg.id != 0 && m_displayedMessageIds.count(msg.id) > 0) {
+        continue;
+      }
+      size_t index = m_messages.size();
+      m_messages.push_back(msg);
+      if (msg.id != 0) {
+        m_displayedMessageIds.insert(msg.id);
+        m_messageIdToIndex[msg.id] = index;
+      }
+    }
+  }
+
+  // The anchor, not the bottom, is what the user asked to see
+  m_wasAtBottom = false;
+  m_forceScrollToBottom = false;
+  RefreshDisplay();
+  ScrollToMessage(anchorId);
+  // Once more after layout has settled
+  CallAfter([this, anchorId]() { ScrollToMessage(anchorId); });
+}
+
 void ChatViewWidget::RemoveMessage(int64_t messageId) {
   if (messageId == 0)
     return;
@@ -1724,6 +1890,11 @@ void ChatViewWidget::ClearMessages() {
     m_displayedMessageIds.clear();
     m_messageIdToIndex.clear();
   }
+  m_messageRangeMap.clear();
+
+  // Find results belong to the old chat
+  m_findHighlighted.clear();
+  HideFindBar();
 
   // Clear per-message read times and read status (switching chats)
   m_messageReadTimes.clear();
@@ -1744,6 +1915,11 @@ void ChatViewWidget::ClearMessages() {
   ClearMediaSpans();
   ClearEditSpans();
   ClearLinkSpans();
+  ClearReplySpans();
+
+  // Windowed state belongs to the old chat
+  m_hasNewerMessages = false;
+  m_isLoadingNewer = false;
 
   // Reset scroll state so new chat scrolls to bottom
   // Use both flags for robust scrolling on new chat
@@ -1957,6 +2133,7 @@ MediaInfo ChatViewWidget::GetMediaInfoForSpan(const MediaSpan &span) const {
     }
     info.localPath = msg->mediaLocalPath;
     info.thumbnailPath = msg->mediaThumbnailPath;
+    info.minithumbnail = msg->mediaMinithumbnail;
     info.fileName = msg->mediaFileName;
     info.caption = msg->mediaCaption;
     // isDownloading will be set by caller (ShowMediaPopup) when needed
@@ -2048,6 +2225,26 @@ LinkSpan *ChatViewWidget::GetLinkSpanAtPosition(long pos) {
 
 void ChatViewWidget::ClearLinkSpans() { m_linkSpans.clear(); }
 
+void ChatViewWidget::AddReplySpan(long startPos, long endPos,
+                                  int64_t replyToMessageId) {
+  ReplySpan span;
+  span.startPos = startPos;
+  span.endPos = endPos;
+  span.replyToMessageId = replyToMessageId;
+  m_replySpans.push_back(span);
+}
+
+ReplySpan *ChatViewWidget::GetReplySpanAtPosition(long pos) {
+  for (auto &span : m_replySpans) {
+    if (span.Contains(pos)) {
+      return &span;
+    }
+  }
+  return nullptr;
+}
+
+void ChatViewWidget::ClearReplySpans() { m_replySpans.clear(); }
+
 void ChatViewWidget::ShowEditHistoryPopup(const EditSpan &span,
                                           const wxPoint &position) {
   // Create popup on demand
@@ -2437,6 +2634,7 @@ void ChatViewWidget::HideMediaPopup() {
       // Always stop playback - even if popup isn't visible yet
       // (video might be loading in background)
       m_mediaPopup->StopAllPlayback();
+      m_mediaPopup->CancelPendingLoads();
 
       if (m_mediaPopup->IsShown()) {
         m_mediaPopup->Hide();
@@ -2654,6 +2852,7 @@ void ChatViewWidget::OnScroll(wxScrollWinEvent &event) {
 
   // Debounced lazy load check for smooth experience
   ScheduleLazyLoadCheck();
+  ScheduleViewportUpdate();
 }
 
 void ChatViewWidget::OnMouseWheel(wxMouseEvent &event) {
@@ -2676,6 +2875,7 @@ void ChatViewWidget::OnMouseWheel(wxMouseEvent &event) {
 
   // Debounced lazy load check
   ScheduleLazyLoadCheck();
+  ScheduleViewportUpdate();
 }
 
 void ChatViewWidget::OnSize(wxSizeEvent &event) {
@@ -2703,6 +2903,9 @@ void ChatViewWidget::OnSize(wxSizeEvent &event) {
     m_topicBar->Layout();
   }
 
+  // A taller window may expose media that was previously off screen
+  ScheduleViewportUpdate();
+
   // Use CallAfter to defer scroll adjustment until after layout completes
   // This ensures smooth reactive behavior during window resize
   if (wasAtBottom && m_chatArea) {
@@ -2732,6 +2935,15 @@ void ChatViewWidget::OnLazyLoadTimer(wxTimerEvent &event) {
 }
 
 void ChatViewWidget::CheckAndTriggerLazyLoad() {
+  if (m_loadNewerCallback && m_hasNewerMessages && !m_isLoadingNewer &&
+      IsNearBottom()) {
+    int64_t newestId = GetNewestMessageId();
+    if (newestId > 0) {
+      m_isLoadingNewer = true;
+      m_loadNewerCallback(newestId);
+    }
+  }
+
   if (!m_loadOlderCallback || !m_hasMoreMessages || m_isLoadingOlder) {
     return;
   }
@@ -2782,6 +2994,157 @@ bool ChatViewWidget::IsNearTop() const {
   return scrollPercent < 0.10f;
 }
 
+bool ChatViewWidget::IsNearBottom() const {
+  if (!m_chatArea) {
+    return false;
+  }
+
+  wxRichTextCtrl *display = m_chatArea->GetDisplay();
+  if (!display) {
+    return false;
+  }
+
+  int scrollPos = display->GetScrollPos(wxVERTICAL);
+  int scrollRange = display->GetScrollRange(wxVERTICAL);
+  int thumbSize = display->GetScrollThumb(wxVERTICAL);
+
+  // A short window has no scrollbar to reach the end of
+  int maxScroll = scrollRange - thumbSize;
+  if (maxScroll <= 0) {
+    return true;
+  }
+
+  // Mirror of IsNearTop: within the bottom 10%
+  float scrollPercent = (float)scrollPos / (float)maxScroll;
+  return scrollPercent > 0.90f;
+}
+
+bool ChatViewWidget::FindVisibleMessageRange(size_t &first,
+                                             size_t &last) const {
+  // Caller must hold m_messagesMutex
+  if (!m_chatArea || m_messages.empty() || m_messageRangeMap.empty()) {
+    return false;
+  }
+
+  wxRichTextCtrl *display = m_chatArea->GetDisplay();
+  if (!display || !display->IsShownOnScreen()) {
+    return false;
+  }
+
+  // Map the top and bottom edges of the client area to character positions
+  wxSize clientSize = display->GetClientSize();
+  long topPos = 0;
+  long bottomPos = display->GetLastPosition();
+  long pos = 0;
+  if (display->HitTest(wxPoint(1, 1), &pos) != wxTE_HT_UNKNOWN) {
+    topPos = pos;
+  }
+  if (display->HitTest(wxPoint(1, std::max(1, clientSize.GetHeight() - 1)),
+                       &pos) != wxTE_HT_UNKNOWN) {
+    bottomPos = pos;
+  }
+
+  // m_messages is rendered in order, so the ranges are monotonic
+  bool found = false;
+  for (size_t i = 0; i < m_messages.size(); ++i) {
+    auto it = m_messageRangeMap.find(m_messages[i].id);
+    if (it == m_messageRangeMap.end()) {
+      continue;
+    }
+    if (it->second.first > bottomPos) {
+      break;
+    }
+    if (it->second.second >= topPos) {
+      if (!found) {
+        first = i;
+        found = true;
+      }
+      last = i;
+    }
+  }
+  return found;
+}
+
+void ChatViewWidget::ScheduleViewportUpdate() {
+  // Throttle rather than debounce so priorities keep up during long scrolls
+  if (!m_viewportTimer.IsRunning()) {
+    m_viewportTimer.StartOnce(VIEWPORT_UPDATE_INTERVAL_MS);
+  }
+}
+
+void ChatViewWidget::OnViewportTimer(wxTimerEvent &event) {
+  UpdateViewportDownloads();
+}
+
+void ChatViewWidget::UpdateViewportDownloads() {
+  TelegramClient *client =
+      m_mainFrame ? m_mainFrame->GetTelegramClient() : nullptr;
+  if (!client) {
+    return;
+  }
+
+  std::vector<ViewportMediaFile> visible;
+  std::vector<ViewportMediaFile> nearby;
+  std::vector<int32_t> distant;
+
+  // Thumbnails and small media are fetched for anything near the viewport;
+  // videos only once they are actually on screen
+  auto collect = [](const MessageInfo &msg, bool onScreen,
+                    std::vector<ViewportMediaFile> &out) {
+    if (msg.mediaThumbnailFileId != 0 && msg.mediaThumbnailPath.IsEmpty()) {
+      out.push_back({msg.mediaThumbnailFileId, "Thumbnail", 0});
+    }
+    if (msg.mediaFileId == 0 || !msg.mediaLocalPath.IsEmpty()) {
+      return;
+    }
+    bool isSmallMedia = msg.hasPhoto || msg.hasSticker || msg.hasAnimation ||
+                        msg.hasVoice || msg.hasVideoNote;
+    if (isSmallMedia || (onScreen && msg.hasVideo)) {
+      out.push_back({msg.mediaFileId,
+                     msg.mediaFileName.IsEmpty() ? wxString("Auto-download")
+                                                 : msg.mediaFileName,
+                     msg.mediaFileSize});
+    }
+  };
+
+  {
+    std::lock_guard<std::mutex> lock(m_messagesMutex);
+    size_t first = 0, last = 0;
+    if (!FindVisibleMessageRange(first, last)) {
+      return;
+    }
+
+    for (size_t i = 0; i < m_messages.size(); ++i) {
+      const MessageInfo &msg = m_messages[i];
+      size_t distance = i < first ? first - i : (i > last ? i - last : 0);
+      if (distance == 0) {
+        collect(msg, true, visible);
+      } else if (distance <= VIEWPORT_PREFETCH_MESSAGES) {
+        collect(msg, false, nearby);
+      } else if (distance > VIEWPORT_CANCEL_DISTANCE) {
+        if (msg.mediaThumbnailFileId != 0 && msg.mediaThumbnailPath.IsEmpty()) {
+          distant.push_back(msg.mediaThumbnailFileId);
+        }
+        if (msg.mediaFileId != 0 && msg.mediaLocalPath.IsEmpty()) {
+          distant.push_back(msg.mediaFileId);
+        }
+      }
+    }
+  }
+
+  SCROLL_LOG("UpdateViewportDownloads: visible=" << visible.size()
+             << " nearby=" << nearby.size() << " distant=" << distant.size());
+
+  for (const auto &file : visible) {
+    AddPendingDownload(file.fileId);
+  }
+  for (const auto &file : nearby) {
+    AddPendingDownload(file.fileId);
+  }
+
+  client->UpdateViewportDownloads(visible, nearby, distant);
+}
+
 int64_t ChatViewWidget::GetOldestMessageId() const {
   std::lock_guard<std::mutex> lock(m_messagesMutex);
 
@@ -2793,6 +3156,17 @@ int64_t ChatViewWidget::GetOldestMessageId() const {
   return m_messages.front().id;
 }
 
+int64_t ChatViewWidget::GetNewestMessageId() const {
+  std::lock_guard<std::mutex> lock(m_messagesMutex);
+
+  if (m_messages.empty()) {
+    return 0;
+  }
+
+  // Messages are sorted by date/id, so last one is newest
+  return m_messages.back().id;
+}
+
 void ChatViewWidget::SetIsLoadingOlder(bool loading) {
   bool wasLoading = m_isLoadingOlder;
   m_isLoadingOlder = loading;
@@ -2802,6 +3176,10 @@ void ChatViewWidget::SetIsLoadingOlder(bool loading) {
     ShowLoadingOlderIndicator();
   } else if (!loading && wasLoading) {
     HideLoadingOlderIndicator();
+    if (m_findExtendAnchorId != 0) {
+      // The page has been rendered and searched - look for older hits
+      CallAfter([this]() { ContinueFindExtension(); });
+    }
   }
 }
 
@@ -2823,6 +3201,12 @@ void ChatViewWidget::OnNewMessageButtonClick(wxCommandEvent &event) {
   // Hide the button
   HideNewMessageIndicator();
 
+  // Showing an older window: the newest messages have to be loaded first
+  if (m_hasNewerMessages && m_mainFrame) {
+    m_mainFrame->JumpToLatest();
+    return;
+  }
+
   // Scroll to bottom
   m_wasAtBottom = true;
   ScrollToBottom();
@@ -2833,6 +3217,518 @@ void ChatViewWidget::OnKeyDown(wxKeyEvent &event) {
   event.Skip();
 }
 
+void ChatViewWidget::CreateFindBar() {
+  const ThemeColors &colors = ThemeManager::Get().GetColors();
+
+  m_findBar = new wxPanel(this, wxID_ANY);
+  m_findBar->SetBackgroundColour(colors.panelBg);
+
+  wxBoxSizer *sizer = new wxBoxSizer(wxHORIZONTAL);
+
+  m_findLabel = new wxStaticText(m_findBar, wxID_ANY, "Find:");
+  m_findLabel->SetForegroundColour(colors.windowFg);
+  sizer->Add(m_findLabel, 0, wxALIGN_CENTER_VERTICAL | wxLEFT, 8);
+
+  m_findInput = new wxTextCtrl(m_findBar, wxID_ANY, "", wxDefaultPosition,
+                               wxSize(240, -1), wxTE_PROCESS_ENTER);
+  m_findInput->Bind(wxEVT_TEXT, &ChatViewWidget::OnFindTextChanged, this);
+  m_findInput->Bind(wxEVT_KEY_DOWN, &ChatViewWidget::OnFindKeyDown, this);
+  sizer->Add(m_findInput, 0, wxALIGN_CENTER_VERTICAL | wxALL, 4);
+
+  wxButton *olderButton =
+      new wxButton(m_findBar, wxID_ANY,
+                   wxString::FromUTF8("\xE2\x86\x91"), // U+2191 UPWARDS ARROW
+                   wxDefaultPosition, wxDefaultSize, wxBU_EXACTFIT);
+  olderButton->SetToolTip("Previous (older) match - Enter");
+  olderButton->Bind(wxEVT_BUTTON,
+                    [this](wxCommandEvent &) { StepFind(true); });
+  sizer->Add(olderButton, 0, wxALIGN_CENTER_VERTICAL);
+
+  wxButton *newerButton = new wxButton(
+      m_findBar, wxID_ANY,
+      wxString::FromUTF8("\xE2\x86\x93"), // U+2193 DOWNWARDS ARROW
+      wxDefaultPosition, wxDefaultSize, wxBU_EXACTFIT);
+  newerButton->SetToolTip("Next (newer) match - Shift+Enter");
+  newerButton->Bind(wxEVT_BUTTON,
+                    [this](wxCommandEvent &) { StepFind(false); });
+  sizer->Add(newerButton, 0, wxALIGN_CENTER_VERTICAL | wxLEFT, 2);
+
+  m_findOlderButton =
+      new wxButton(m_findBar, wxID_ANY, "Search older", wxDefaultPosition,
+                   wxDefaultSize, wxBU_EXACTFIT);
+  m_findOlderButton->SetToolTip(
+      "Load older history until an earlier match turns up");
+  m_findOlderButton->Bind(wxEVT_BUTTON,
+                          [this](wxCommandEvent &) { ExtendFindBackwards(); });
+  sizer->Add(m_findOlderButton, 0, wxALIGN_CENTER_VERTICAL | wxLEFT, 6);
+
+  m_findStatus = new wxStaticText(m_findBar, wxID_ANY, "");
+  m_findStatus->SetForegroundColour(colors.mutedText);
+  sizer->Add(m_findStatus, 1, wxALIGN_CENTER_VERTICAL | wxLEFT, 8);
+
+  wxButton *closeButton = new wxButton(
+      m_findBar, wxID_ANY,
+      wxString::FromUTF8("\xC3\x97"), // U+00D7 MULTIPLICATION SIGN
+      wxDefaultPosition, wxDefaultSize, wxBU_EXACTFIT);
+  closeButton->SetToolTip("Close - Esc");
+  closeButton->Bind(wxEVT_BUTTON, [this](wxCommandEvent &) { HideFindBar(); });
+  sizer->Add(closeButton, 0, wxALIGN_CENTER_VERTICAL | wxALL, 4);
+
+  m_findBar->SetSizer(sizer);
+  m_findBar->Hide();
+}
+
+void ChatViewWidget::ShowFindBar() {
+  if (!m_findBar)
+    return;
+
+  if (!m_findBar->IsShown()) {
+    m_findBar->Show();
+    Layout();
+  }
+  m_findInput->SetFocus();
+  m_findInput->SelectAll();
+
+  // Reopened with the previous query - search the current scrollback again
+  if (!m_findInput->IsEmpty()) {
+    m_findQuery.clear();
+    RunFind(true);
+  }
+}
+
+void ChatViewWidget::HideFindBar() {
+  if (!m_findBar)
+    return;
+
+  ClearFindHighlights();
+  m_findMatches.clear();
+  m_findHitSegments.clear();
+  m_findQuery.clear();
+  m_findCurrent = -1;
+  m_findExtendAnchorId = 0;
+  m_findExtendPagesLeft = 0;
+  m_findNote.Clear();
+
+  // The caches can be large - don't keep them around while unused
+  std::wstring().swap(m_findHaystack);
+  std::wstring().swap(m_findDocText);
+  std::vector<FindSegment>().swap(m_findSegments);
+  m_findHaystackDirty = true;
+
+  if (m_findBar->IsShown()) {
+    m_findBar->Hide();
+    Layout();
+  }
+}
+
+bool ChatViewWidget::IsFindBarShown() const {
+  return m_findBar && m_findBar->IsShown();
+}
+
+void ChatViewWidget::OnFindTextChanged(wxCommandEvent &event) {
+  m_findNote.Clear();
+  RunFind(true);
+}
+
+void ChatViewWidget::OnFindKeyDown(wxKeyEvent &event) {
+  int keyCode = event.GetKeyCode();
+
+  if (keyCode == WXK_RETURN || keyCode == WXK_NUMPAD_ENTER) {
+    // Enter walks back in time, Shift+Enter forward
+    StepFind(!event.ShiftDown());
+    return;
+  }
+
+  if (keyCode == WXK_ESCAPE) {
+    HideFindBar();
+    if (m_chatArea && m_chatArea->GetDisplay()) {
+      m_chatArea->GetDisplay()->SetFocus();
+    }
+    return;
+  }
+
+  event.Skip();
+}
+
+void ChatViewWidget::RebuildFindHaystack() {
+  m_findHaystack.clear();
+  m_findSegments.clear();
+
+  {
+    std::lock_guard<std::mutex> lock(m_messagesMutex);
+    m_findSegments.reserve(m_messages.size());
+    for (const auto &msg : m_messages) {
+      if (msg.id == 0 || m_messageRangeMap.count(msg.id) == 0) {
+        continue; // Not rendered
+      }
+      wxString text = msg.text;
+      if (!msg.mediaCaption.IsEmpty() && msg.mediaCaption != text) {
+        text += "\n" + msg.mediaCaption;
+      }
+      if (text.IsEmpty()) {
+        continue;
+      }
+      m_findSegments.push_back({msg.id, m_findHaystack.size()});
+      m_findHaystack += text.Lower().ToStdWstring();
+      m_findHaystack += L'\0'; // Matches never straddle two messages
+    }
+  }
+
+  wxRichTextCtrl *display = m_chatArea ? m_chatArea->GetDisplay() : nullptr;
+  m_findDocText =
+      display ? display->GetValue().Lower().ToStdWstring() : std::wstring();
+
+  m_findHaystackDirty = false;
+  m_findHitSegments.clear();
+  m_findQuery.clear(); // Segment indices changed - next scan is a full one
+}
+
+void ChatViewWidget::RunFind(bool reveal) {
+  if (!m_findInput)
+    return;
+
+  std::wstring query = m_findInput->GetValue().Lower().ToStdWstring();
+
+  // Remember where we were so new results keep the position
+  int64_t anchorId = 0;
+  long anchorOffset = 0;
+  if (m_findCurrent >= 0 &&
+      m_findCurrent < static_cast<int>(m_findMatches.size())) {
+    anchorId = m_findMatches[m_findCurrent].messageId;
+    anchorOffset = m_findMatches[m_findCurrent].offsetInMessage;
+  }
+
+  if (m_findHaystackDirty) {
+    RebuildFindHaystack();
+  }
+
+  if (query.empty()) {
+    ClearFindHighlights();
+    m_findMatches.clear();
+    m_findHitSegments.clear();
+    m_findQuery.clear();
+    m_findCurrent = -1;
+    UpdateFindStatus();
+    return;
+  }
+
+  auto segmentEnd = [this](size_t segment) {
+    return segment + 1 < m_findSegments.size()
+               ? m_findSegments[segment + 1].offset
+               : m_findHaystack.size();
+  };
+
+  std::vector<size_t> hits;
+  if (!m_findQuery.empty() && query.size() >= m_findQuery.size() &&
+      query.compare(0, m_findQuery.size(), m_findQuery) == 0) {
+    // Typing more characters can only narrow the hit set - rescan just
+    // the messages that matched the shorter query
+    hits.reserve(m_findHitSegments.size());
+    for (size_t segment : m_findHitSegments) {
+      size_t begin = m_findSegments[segment].offset;
+      std::wstring_view text(m_findHaystack.data() + begin,
+                             segmentEnd(segment) - begin);
+      if (text.find(query) != std::wstring_view::npos) {
+        hits.push_back(segment);
+      }
+    }
+  } else {
+    size_t pos = m_findHaystack.find(query);
+    while (pos != std::wstring::npos) {
+      auto it = std::upper_bound(
+          m_findSegments.begin(), m_findSegments.end(), pos,
+          [](size_t value, const FindSegment &segment) {
+            return value < segment.offset;
+          });
+      size_t segment = static_cast<size_t>(it - m_findSegments.begin()) - 1;
+      hits.push_back(segment);
+      // One hit per message is enough here - skip to the next message
+      pos = m_findHaystack.find(query, segmentEnd(segment));
+    }
+  }
+  m_findHitSegments.swap(hits);
+  m_findQuery = query;
+
+  // Turn message hits into character ranges of the rendered document
+  m_findMatches.clear();
+  {
+    std::lock_guard<std::mutex> lock(m_messagesMutex);
+    for (size_t segment : m_findHitSegments) {
+      int64_t messageId = m_findSegments[segment].messageId;
+      auto range = m_messageRangeMap.find(messageId);
+      if (range == m_messageRangeMap.end()) {
+        continue;
+      }
+      long start = range->second.first;
+      long end = std::min<long>(range->second.second,
+                                static_cast<long>(m_findDocText.size()));
+      bool found = false;
+      if (start < end) {
+        std::wstring_view text(m_findDocText.data() + start, end - start);
+        for (size_t pos = text.find(query); pos != std::wstring_view::npos;
+             pos = text.find(query, pos + query.size())) {
+          long matchStart = start + static_cast<long>(pos);
+          m_findMatches.push_back(
+              {messageId, matchStart,
+               matchStart + static_cast<long>(query.size()),
+               static_cast<long>(pos), true});
+          found = true;
+        }
+      }
+      if (!found) {
+        m_findMatches.push_back({messageId, range->second.first,
+                                 range->second.second, 0, false});
+      }
+    }
+  }
+  std::sort(m_findMatches.begin(), m_findMatches.end(),
+            [](const FindMatch &a, const FindMatch &b) {
+              return a.startPos < b.startPos;
+            });
+
+  // Stay on (or just above) the previous match; a fresh search starts
+  // at the newest message
+  m_findCurrent = m_findMatches.empty() ? -1
+                                        : static_cast<int>(m_findMatches.size()) - 1;
+  if (anchorId != 0 && !m_findMatches.empty()) {
+    int best = -1;
+    for (size_t i = 0; i < m_findMatches.size(); ++i) {
+      const FindMatch &match = m_findMatches[i];
+      if (match.messageId < anchorId ||
+          (match.messageId == anchorId &&
+           match.offsetInMessage <= anchorOffset)) {
+        best = static_cast<int>(i);
+      }
+    }
+    m_findCurrent = best >= 0 ? best : 0;
+  }
+
+  ApplyFindHighlights();
+  if (reveal && m_findCurrent >= 0) {
+    ShowFindMatch();
+  } else {
+    UpdateFindStatus();
+  }
+}
+
+void ChatViewWidget::StepFind(bool older) {
+  if (m_findQuery.empty()) {
+    return;
+  }
+
+  if (m_findMatches.empty() || (older && m_findCurrent <= 0)) {
+    // Ran out of loaded history - keep looking further back
+    ExtendFindBackwards();
+    return;
+  }
+
+  if (older) {
+    m_findCurrent--;
+  } else if (m_findCurrent + 1 < static_cast<int>(m_findMatches.size())) {
+    m_findCurrent++;
+  } else {
+    wxBell();
+    return;
+  }
+  m_findNote.Clear();
+  ShowFindMatch();
+}
+
+void ChatViewWidget::ShowFindMatch() {
+  if (m_findCurrent < 0 ||
+      m_findCurrent >= static_cast<int>(m_findMatches.size())) {
+    return;
+  }
+
+  if (m_findCurrent < m_findHighlightFirst ||
+      m_findCurrent > m_findHighlightLast) {
+    ApplyFindHighlights();
+  }
+
+  const FindMatch &match = m_findMatches[m_findCurrent];
+  ShowRange(match.startPos, match.endPos);
+  UpdateFindStatus();
+}
+
+void ChatViewWidget::ExtendFindBackwards() {
+  if (m_findQuery.empty() || m_findExtendAnchorId != 0) {
+    return;
+  }
+
+  int64_t oldestId = GetOldestMessageId();
+  if (!m_loadOlderCallback || !m_hasMoreMessages || oldestId <= 0) {
+    m_findNote = "start of history";
+    UpdateFindStatus();
+    return;
+  }
+
+  m_findExtendAnchorId = oldestId;
+  m_findExtendPagesLeft = MAX_FIND_EXTEND_PAGES;
+  RequestOlderForFind();
+}
+
+void ChatViewWidget::RequestOlderForFind() {
+  m_findExtendPagesLeft--;
+  UpdateFindStatus();
+
+  // A lazy load already in flight ends in ContinueFindExtension too
+  if (m_isLoadingOlder) {
+    return;
+  }
+
+  int64_t oldestId = GetOldestMessageId();
+  if (oldestId <= 0) {
+    m_findExtendAnchorId = 0;
+    UpdateFindStatus();
+    return;
+  }
+  m_isLoadingOlder = true;
+  ShowLoadingOlderIndicator();
+  m_loadOlderCallback(oldestId);
+}
+
+void ChatViewWidget::ContinueFindExtension() {
+  if (m_findExtendAnchorId == 0) {
+    return;
+  }
+  if (!IsFindBarShown()) {
+    m_findExtendAnchorId = 0;
+    return;
+  }
+
+  // RefreshDisplay already re-ran the search over the grown scrollback -
+  // take the newest match older than where the search started
+  int older = -1;
+  for (size_t i = 0; i < m_findMatches.size() &&
+                     m_findMatches[i].messageId < m_findExtendAnchorId;
+       ++i) {
+    older = static_cast<int>(i);
+  }
+  if (older >= 0) {
+    m_findExtendAnchorId = 0;
+    m_findNote.Clear();
+    m_findCurrent = older;
+    ShowFindMatch();
+    return;
+  }
+
+  if (m_findExtendPagesLeft > 0 && m_hasMoreMessages) {
+    RequestOlderForFind();
+    return;
+  }
+
+  m_findExtendAnchorId = 0;
+  m_findNote = m_hasMoreMessages ? "no older matches yet - search again"
+                                 : "start of history";
+  UpdateFindStatus();
+}
+
+void ChatViewWidget::ApplyFindHighlights() {
+  ClearFindHighlights();
+
+  wxRichTextCtrl *display = m_chatArea ? m_chatArea->GetDisplay() : nullptr;
+  if (!display || m_findMatches.empty()) {
+    m_findHighlightFirst = 0;
+    m_findHighlightLast = -1;
+    return;
+  }
+
+  // Restyling is per range, so huge result sets only get the matches
+  // around the current one painted; stepping out of the window repaints
+  int count = static_cast<int>(m_findMatches.size());
+  int window = static_cast<int>(MAX_FIND_HIGHLIGHTS);
+  int first = std::max(0, m_findCurrent - window / 2);
+  int last = std::min(count - 1, first + window - 1);
+  first = std::max(0, last - window + 1);
+  m_findHighlightFirst = first;
+  m_findHighlightLast = last;
+
+  wxRichTextAttr attr;
+  attr.SetBackgroundColour(ThemeManager::Get().IsDarkTheme()
+                               ? wxColour(110, 90, 20)
+                               : wxColour(255, 230, 120));
+
+  display->Freeze();
+  display->BeginSuppressUndo();
+  for (int i = first; i <= last; ++i) {
+    const FindMatch &match = m_findMatches[i];
+    if (!match.exact) {
+      continue;
+    }
+    // Remember the backgrounds underneath, one run per change
+    for (long pos = match.startPos; pos < match.endPos; ++pos) {
+      wxRichTextAttr existing;
+      display->GetUncombinedStyle(pos, existing);
+      bool hadBackground = existing.HasBackgroundColour();
+      wxColour background =
+          hadBackground ? existing.GetBackgroundColour() : wxColour();
+      if (!m_findHighlighted.empty() &&
+          m_findHighlighted.back().endPos == pos &&
+          m_findHighlighted.back().hadBackground == hadBackground &&
+          m_findHighlighted.back().background == background) {
+        m_findHighlighted.back().endPos = pos + 1;
+      } else {
+        m_findHighlighted.push_back({pos, pos + 1, hadBackground, background});
+      }
+    }
+    display->SetStyleEx(wxRichTextRange(match.startPos, match.endPos - 1),
+                        attr, wxRICHTEXT_SETSTYLE_CHARACTERS_ONLY);
+  }
+  display->EndSuppressUndo();
+  display->Thaw();
+}
+
+void ChatViewWidget::ClearFindHighlights() {
+  wxRichTextCtrl *display = m_chatArea ? m_chatArea->GetDisplay() : nullptr;
+  if (!display || m_findHighlighted.empty()) {
+    m_findHighlighted.clear();
+    return;
+  }
+
+  display->Freeze();
+  display->BeginSuppressUndo();
+  for (const auto &run : m_findHighlighted) {
+    wxRichTextRange range(run.startPos, run.endPos - 1);
+    if (run.hadBackground) {
+      wxRichTextAttr attr;
+      attr.SetBackgroundColour(run.background);
+      display->SetStyleEx(range, attr, wxRICHTEXT_SETSTYLE_CHARACTERS_ONLY);
+    } else {
+      wxRichTextAttr attr;
+      attr.SetBackgroundColour(*wxWHITE); // Only the flag matters for removal
+      display->SetStyleEx(range, attr,
+                          wxRICHTEXT_SETSTYLE_CHARACTERS_ONLY |
+                              wxRICHTEXT_SETSTYLE_REMOVE);
+    }
+  }
+  display->EndSuppressUndo();
+  display->Thaw();
+  m_findHighlighted.clear();
+}
+
+void ChatViewWidget::UpdateFindStatus() {
+  if (!m_findStatus)
+    return;
+
+  wxString label;
+  if (!m_findQuery.empty()) {
+    if (m_findMatches.empty()) {
+      label = "No matches in loaded messages";
+    } else {
+      label = wxString::Format("%d of %zu", m_findCurrent + 1,
+                               m_findMatches.size());
+    }
+    if (m_findExtendAnchorId != 0) {
+      label += " - searching older messages...";
+    } else if (!m_findNote.IsEmpty()) {
+      label += " - " + m_findNote;
+    }
+  }
+  m_findStatus->SetLabel(label);
+  m_findOlderButton->Enable(m_hasMoreMessages && m_findExtendAnchorId == 0);
+  m_findBar->Layout();
+}
+
 void ChatViewWidget::RecordReadMarker(long startPos, long endPos,
                                       int64_t messageId) {
   // Use the formatter's tracked status marker positions for accurate tooltip
@@ -3018,6 +3914,17 @@ void ChatViewWidget::ShowContextMenu(const wxPoint &pos) {
     Bind(wxEVT_MENU, &ChatViewWidget::OnOpenMedia, this, ID_OPEN_MEDIA);
   }
 
+  // Chat-wide action, same as /archive
+  if (m_mainFrame && m_mainFrame->GetCurrentChatId() != 0) {
+    if (menu.GetMenuItemCount() > 0) {
+      menu.AppendSeparator();
+    }
+    menu.Append(ID_ARCHIVE_MEDIA, m_mainFrame->IsMediaExportRunning()
+                                      ? "Cancel Media Archive"
+                                      : "Archive All Media...");
+    Bind(wxEVT_MENU, &ChatViewWidget::OnArchiveMedia, this, ID_ARCHIVE_MEDIA);
+  }
+
   if (menu.GetMenuItemCount() > 0) {
     PopupMenu(&menu, pos);
   }
@@ -3065,6 +3972,17 @@ void ChatViewWidget::OnOpenMedia(wxCommandEvent &event) {
   }
 }
 
+void ChatViewWidget::OnArchiveMedia(wxCommandEvent &event) {
+  if (!m_mainFrame)
+    return;
+
+  if (m_mainFrame->IsMediaExportRunning()) {
+    m_mainFrame->CancelMediaExport();
+  } else {
+    m_mainFrame->StartMediaExport("all");
+  }
+}
+
 void ChatViewWidget::OnMouseMove(wxMouseEvent &event) {
   if (!m_chatArea || !m_chatArea->GetDisplay()) {
     event.Skip();
@@ -3159,6 +4077,9 @@ void ChatViewWidget::OnMouseMove(wxMouseEvent &event) {
       if (linkSpan) {
         setCursor(wxCURSOR_HAND);
         setTooltip(linkSpan->url);
+      } else if (GetReplySpanAtPosition(charPos)) {
+        setCursor(wxCURSOR_HAND);
+        setTooltip("Click to jump to the original message");
       } else {
         // Check for media
         MediaSpan *mediaSpan = GetMediaSpanAtPosition(charPos);
@@ -3221,6 +4142,14 @@ void ChatViewWidget::OnLeftDown(wxMouseEvent &event) {
       return;
     }
 
+    // Reply previews jump to the quoted message
+    ReplySpan *replySpan = GetReplySpanAtPosition(charPos);
+    if (replySpan && m_mainFrame) {
+      m_mainFrame->JumpToMessage(m_mainFrame->GetCurrentChatId(),
+                                 replySpan->replyToMessageId);
+      return;
+    }
+
     // Check for media
     MediaSpan *mediaSpan = GetMediaSpanAtPosition(charPos);
     if (mediaSpan) {
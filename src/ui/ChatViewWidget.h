@@ -6,6 +6,7 @@
 #include <map>
 #include <mutex>
 #include <set>
+#include <string>
 #include <vector>
 #include <wx/gauge.h>
 #include <wx/popupwin.h>
@@ -31,11 +32,25 @@ public:
   // Message display - messages are stored and rendered in sorted order
   void DisplayMessage(const MessageInfo &msg);
   void DisplayMessages(const std::vector<MessageInfo> &messages);
+  // Fold a later page (sorted, not yet shown) into what is displayed:
+  // appended in place when it is all newer, one re-render otherwise
+  void MergeMessages(const std::vector<MessageInfo> &messages);
+  // A page below a history window: rendered at the end without moving the
+  // view; falls back to a re-render if it overlaps what is shown
+  void AppendMessages(const std::vector<MessageInfo> &messages);
   void ClearMessages();
   
   void ScrollToBottom();
   void ForceScrollToBottom(); // Force scroll and set m_wasAtBottom = true
   void ScrollToBottomAggressive(); // Multi-method aggressive scroll for big chats
+  // Scroll a rendered message into view and select it (search hits).
+  // False if the message is not rendered.
+  bool ScrollToMessage(int64_t messageId);
+
+  // In-chat find bar (Ctrl+F) over the loaded scrollback
+  void ShowFindBar();
+  void HideFindBar();
+  bool IsFindBarShown() const;
 
   // Refresh the display from the stored message vector
   // This re-renders all messages in proper sorted order
@@ -81,7 +96,20 @@ public:
   void SetIsLoadingOlder(bool loading);
   bool IsLoadingOlder() const { return m_isLoadingOlder; }
   int64_t GetOldestMessageId() const;
-  
+
+  // Windowed history: the view can hold a page from the middle of the chat
+  // (a jump target); newer pages then load when scrolling down, and live
+  // messages wait until the window has caught up with the newest
+  void DisplayHistoryWindow(const std::vector<MessageInfo> &messages,
+                            int64_t anchorId, bool hasNewer);
+  void SetLoadNewerCallback(std::function<void(int64_t)> callback) { m_loadNewerCallback = callback; }
+  void SetHasNewerMessages(bool hasNewer) { m_hasNewerMessages = hasNewer; }
+  bool HasNewerMessages() const { return m_hasNewerMessages; }
+  void SetIsLoadingNewer(bool loading) { m_isLoadingNewer = loading; }
+  bool IsLoadingNewer() const { return m_isLoadingNewer; }
+  int64_t GetNewestMessageId() const;
+  bool IsNearBottom() const; // For lazy loading newer messages
+
   // Loading indicator for older messages
   void ShowLoadingOlderIndicator();
   void HideLoadingOlderIndicator();
@@ -125,6 +153,11 @@ public:
   LinkSpan *GetLinkSpanAtPosition(long pos);
   void ClearLinkSpans();
 
+  // Reply preview tracking (click jumps to the quoted message)
+  void AddReplySpan(long startPos, long endPos, int64_t replyToMessageId);
+  ReplySpan *GetReplySpanAtPosition(long pos);
+  void ClearReplySpans();
+
 
 
   // Access to ChatArea and underlying display control
@@ -192,6 +225,7 @@ private:
   void CreateLayout();
   void SetupDisplayControl();
   void CreateNewMessageButton();
+  void CreateFindBar();
   wxString FormatTimestamp(int64_t unixTime);
   wxString FormatSmartTimestamp(int64_t unixTime);
 
@@ -228,15 +262,39 @@ private:
   void CheckAndTriggerLazyLoad();
   void ScheduleLazyLoadCheck();
   void OnLazyLoadTimer(wxTimerEvent &event);
+
+  // Viewport-driven download priorities
+  bool FindVisibleMessageRange(size_t &first, size_t &last) const;
+  void ScheduleViewportUpdate();
+  void OnViewportTimer(wxTimerEvent &event);
+  void UpdateViewportDownloads();
   void OnNewMessageButtonClick(wxCommandEvent &event);
   void OnSize(wxSizeEvent &event);
 
+  // Select a character range and scroll it into view
+  void ShowRange(long startPos, long endPos);
+
+  // In-chat find
+  void OnFindTextChanged(wxCommandEvent &event);
+  void OnFindKeyDown(wxKeyEvent &event);
+  void RebuildFindHaystack();
+  void RunFind(bool reveal);
+  void StepFind(bool older);
+  void ShowFindMatch();
+  void ExtendFindBackwards();
+  void RequestOlderForFind();
+  void ContinueFindExtension();
+  void ApplyFindHighlights();
+  void ClearFindHighlights();
+  void UpdateFindStatus();
+
   // Context menu handlers
   void OnCopyText(wxCommandEvent &event);
   void OnCopyLink(wxCommandEvent &event);
   void OnOpenLink(wxCommandEvent &event);
   void OnSaveMedia(wxCommandEvent &event);
   void OnOpenMedia(wxCommandEvent &event);
+  void OnArchiveMedia(wxCommandEvent &event);
 
   // Context menu helpers
   void ShowContextMenu(const wxPoint &pos);
@@ -295,6 +353,9 @@ private:
   // Link spans for clickable URLs
   std::vector<LinkSpan> m_linkSpans;
 
+  // Reply previews that jump to the quoted message
+  std::vector<ReplySpan> m_replySpans;
+
 
 
   // Pending downloads - just tracks which fileIds are being downloaded
@@ -383,13 +444,72 @@ private:
   std::function<void(int64_t)> m_loadOlderCallback;
   bool m_hasMoreMessages = true;
   bool m_isLoadingOlder = false;
+
+  // Lazy loading for newer messages (only after a jump into the middle)
+  std::function<void(int64_t)> m_loadNewerCallback;
+  bool m_hasNewerMessages = false;
+  bool m_isLoadingNewer = false;
   wxTimer m_lazyLoadTimer;
   static constexpr int LAZY_LOAD_DEBOUNCE_MS = 500;  // Much longer debounce - wait for scrolling to settle
+
+  // Viewport download prioritisation - visible media first, neighbours
+  // prefetched, media scrolled far away demoted or cancelled
+  wxTimer m_viewportTimer;
+  static constexpr int VIEWPORT_UPDATE_INTERVAL_MS = 250;
+  static constexpr size_t VIEWPORT_PREFETCH_MESSAGES = 15;
+  static constexpr size_t VIEWPORT_CANCEL_DISTANCE = 60;
   
   // Loading indicator for older messages
   wxPanel *m_loadingOlderPanel = nullptr;
   wxStaticText *m_loadingOlderText = nullptr;
 
+  // Find bar. The text (and caption) of every rendered message is kept
+  // lowercased in one NUL-separated buffer so a query is a single
+  // wmemchr-driven scan; the rendered document text is cached alongside to
+  // turn message hits into character ranges. Both are rebuilt lazily after
+  // the display changes.
+  struct FindSegment {
+    int64_t messageId;
+    size_t offset; // Start of the message in m_findHaystack
+  };
+  struct FindMatch {
+    int64_t messageId;
+    long startPos;
+    long endPos;
+    long offsetInMessage;
+    bool exact; // False: the text was reformatted, the whole message is hit
+  };
+  wxPanel *m_findBar = nullptr;
+  wxStaticText *m_findLabel = nullptr;
+  wxTextCtrl *m_findInput = nullptr;
+  wxStaticText *m_findStatus = nullptr;
+  wxButton *m_findOlderButton = nullptr;
+  std::wstring m_findHaystack;
+  std::vector<FindSegment> m_findSegments;
+  std::wstring m_findDocText;
+  bool m_findHaystackDirty = true;
+  std::wstring m_findQuery;        // Query m_findHitSegments belongs to
+  std::vector<size_t> m_findHitSegments;
+  std::vector<FindMatch> m_findMatches; // Document order
+  int m_findCurrent = -1;
+  // Runs the find pass restyled, with the background each had before, so
+  // clearing puts the formatter's mention/highlight styling back
+  struct FindStyledRun {
+    long startPos;
+    long endPos;
+    bool hadBackground;
+    wxColour background;
+  };
+  std::vector<FindStyledRun> m_findHighlighted;
+  int m_findHighlightFirst = 0;
+  int m_findHighlightLast = -1;
+  // Searching further back: pages older history until a match shows up
+  int64_t m_findExtendAnchorId = 0; // Oldest message when the search started
+  int m_findExtendPagesLeft = 0;
+  wxString m_findNote;
+  static constexpr size_t MAX_FIND_HIGHLIGHTS = 500;
+  static constexpr int MAX_FIND_EXTEND_PAGES = 10;
+
   // Menu IDs
   enum {
     ID_COPY_TEXT = wxID_HIGHEST + 1000,
@@ -397,6 +517,7 @@ private:
     ID_OPEN_LINK,
     ID_SAVE_MEDIA,
     ID_OPEN_MEDIA,
+    ID_ARCHIVE_MEDIA,
     ID_NEW_MESSAGE_BUTTON
   };
 };
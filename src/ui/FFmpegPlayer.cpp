@@ -1,6 +1,9 @@
 #include "FFmpegPlayer.h"
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <wx/file.h>
+#include <wx/rawbmp.h>
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -11,25 +14,47 @@ extern "C" {
 #include <libswscale/swscale.h>
 }
 
-#ifdef HAVE_SDL2
-#include <SDL.h>
-#endif
-
 #define FFMPEGLOG(msg) std::cerr << "[FFmpegPlayer] " << msg << std::endl
 
+namespace {
+
+// The layout wxNativePixelData exposes, so that presenting a frame is a
+// row copy rather than per-pixel work
+AVPixelFormat NativePixelFormat() {
+  typedef wxNativePixelFormat Format;
+  if (Format::SizePixel == 3) {
+    return Format::RED == 0 ? AV_PIX_FMT_RGB24 : AV_PIX_FMT_BGR24;
+  }
+  switch (Format::RED) {
+  case 0:
+    return AV_PIX_FMT_RGB0;
+  case 1:
+    return AV_PIX_FMT_0RGB;
+  case 2:
+    return AV_PIX_FMT_BGR0;
+  default:
+    return AV_PIX_FMT_0BGR;
+  }
+}
+
+} // namespace
+
 FFmpegPlayer::FFmpegPlayer()
     : m_width(0), m_height(0), m_frameRate(30.0), m_duration(0.0),
       m_renderWidth(0), m_renderHeight(0), m_isLoaded(false),
       m_isPlaying(false), m_loop(true), m_hitEOF(false), m_currentFrame(0),
-      m_currentTime(0.0), m_volume(0.5), m_muted(false), m_isAudioOnly(false),
-      m_hasAudio(false), m_formatCtx(nullptr), m_codecCtx(nullptr),
-      m_frame(nullptr), m_frameRGB(nullptr), m_packet(nullptr),
+      m_currentTime(0.0), m_droppedFrames(0), m_volume(0.5), m_muted(false),
+      m_isAudioOnly(false), m_hasAudio(false), m_formatCtx(nullptr),
+      m_codecCtx(nullptr), m_frame(nullptr), m_packet(nullptr),
       m_swsCtx(nullptr), m_audioCodecCtx(nullptr), m_audioFrame(nullptr),
       m_swrCtx(nullptr), m_videoStreamIndex(-1), m_audioStreamIndex(-1),
-      m_audioBufferReadPos(0), m_audioBufferWritePos(0), m_audioBytesPlayed(0),
-      m_sdlAudioInitialized(false), m_sdlAudioDeviceId(0), m_rgbBuffer(nullptr),
-      m_rgbBufferSize(0) {
-  m_audioBuffer.resize(AUDIO_BUFFER_SIZE);
+      m_audioAttached(false), m_resampleOffset(0), m_resampleBytes(0),
+      m_audioTimeBase(0.0), m_stopDecode(false),
+      m_decodeFinished(false), m_audioEnded(false), m_startTime(0.0),
+      m_lastFrameTime(-1.0), m_loopOffset(0.0), m_videoDraining(false),
+      m_decodeForRenderSize(true), m_clockBase(0.0) {
+  m_audioStream.SetVolume(m_volume);
+  m_audioStream.GetRing().Reset(AUDIO_LATENCY_BYTES);
 }
 
 FFmpegPlayer::~FFmpegPlayer() {
@@ -39,16 +64,11 @@ FFmpegPlayer::~FFmpegPlayer() {
 }
 
 void FFmpegPlayer::CleanupAudio() {
-#ifdef HAVE_SDL2
-  if (m_sdlAudioDeviceId > 0) {
-    SDL_CloseAudioDevice(m_sdlAudioDeviceId);
-    m_sdlAudioDeviceId = 0;
-  }
-  if (m_sdlAudioInitialized) {
-    SDL_QuitSubSystem(SDL_INIT_AUDIO);
-    m_sdlAudioInitialized = false;
+  // The device stays open for the next player
+  if (m_audioAttached) {
+    AudioOutput::Get().Detach(&m_audioStream);
+    m_audioAttached = false;
   }
-#endif
 
   // Clear audio packet queue
   {
@@ -77,11 +97,13 @@ void FFmpegPlayer::CleanupAudio() {
 
   m_audioStreamIndex = -1;
   m_hasAudio = false;
-  m_audioBufferReadPos = 0;
-  m_audioBufferWritePos = 0;
+  m_audioStream.GetRing().Clear();
+  m_resampleBytes = 0;
 }
 
 void FFmpegPlayer::CleanupDecoder() {
+  StopDecodeThread();
+  ClearFrameQueue();
   CleanupAudio();
 
   // Clear video packet queue
@@ -99,17 +121,6 @@ void FFmpegPlayer::CleanupDecoder() {
     m_swsCtx = nullptr;
   }
 
-  if (m_rgbBuffer) {
-    av_free(m_rgbBuffer);
-    m_rgbBuffer = nullptr;
-    m_rgbBufferSize = 0;
-  }
-
-  if (m_frameRGB) {
-    av_frame_free(&m_frameRGB);
-    m_frameRGB = nullptr;
-  }
-
   if (m_frame) {
     av_frame_free(&m_frame);
     m_frame = nullptr;
@@ -163,10 +174,20 @@ bool FFmpegPlayer::LoadFile(const wxString &path) {
   m_filePath = path;
   m_currentFrame = 0;
   m_currentTime = 0.0;
+  m_droppedFrames = 0;
   m_isAudioOnly = false;
   m_hasAudio = false;
   m_hitEOF = false;
-  m_audioBytesPlayed = 0;
+  m_videoDraining = false;
+  m_audioStream.ResetFramesPlayed();
+  m_audioTimeBase = 0.0;
+  m_decodeFinished = false;
+  m_audioEnded = false;
+  m_audioStream.SetEnded(false);
+  m_startTime = 0.0;
+  m_lastFrameTime = -1.0;
+  m_loopOffset = 0.0;
+  m_clockBase = 0.0;
 
   // Open the input file
   std::string pathStr = path.ToStdString();
@@ -242,6 +263,8 @@ bool FFmpegPlayer::LoadFile(const wxString &path) {
       return false;
     }
 
+    ConfigureVideoDecoder(codec);
+
     ret = avcodec_open2(m_codecCtx, codec, nullptr);
     if (ret < 0) {
       FFMPEGLOG("Failed to open video codec");
@@ -270,9 +293,13 @@ bool FFmpegPlayer::LoadFile(const wxString &path) {
     FFMPEGLOG("Video: " << m_width << "x" << m_height << " @ " << m_frameRate
                         << " fps");
 
+    // Timestamps are presented relative to the first one
+    if (videoStream->start_time != AV_NOPTS_VALUE) {
+      m_startTime = videoStream->start_time * av_q2d(videoStream->time_base);
+    }
+
     m_frame = av_frame_alloc();
-    m_frameRGB = av_frame_alloc();
-    if (!m_frame || !m_frameRGB) {
+    if (!m_frame) {
       FFMPEGLOG("Failed to allocate video frames");
       CleanupDecoder();
       return false;
@@ -281,20 +308,8 @@ bool FFmpegPlayer::LoadFile(const wxString &path) {
     int outWidth = m_renderWidth > 0 ? m_renderWidth : m_width;
     int outHeight = m_renderHeight > 0 ? m_renderHeight : m_height;
 
-    m_rgbBufferSize =
-        av_image_get_buffer_size(AV_PIX_FMT_RGB24, outWidth, outHeight, 1);
-    m_rgbBuffer = (uint8_t *)av_malloc(m_rgbBufferSize);
-    if (!m_rgbBuffer) {
-      FFMPEGLOG("Failed to allocate RGB buffer");
-      CleanupDecoder();
-      return false;
-    }
-
-    av_image_fill_arrays(m_frameRGB->data, m_frameRGB->linesize, m_rgbBuffer,
-                         AV_PIX_FMT_RGB24, outWidth, outHeight, 1);
-
     m_swsCtx = sws_getContext(m_width, m_height, m_codecCtx->pix_fmt, outWidth,
-                              outHeight, AV_PIX_FMT_RGB24, SWS_BILINEAR,
+                              outHeight, NativePixelFormat(), SWS_BILINEAR,
                               nullptr, nullptr, nullptr);
 
     if (!m_swsCtx) {
@@ -319,16 +334,21 @@ bool FFmpegPlayer::LoadFile(const wxString &path) {
 
   m_isLoaded = true;
 
-  // For video files, decode the first frame for display
+  // For video files, decode the first frame for display; it is presented as
+  // soon as playback starts
   if (!m_isAudioOnly) {
     FFMPEGLOG("Attempting to decode first frame...");
-    if (!DecodeNextFrame()) {
+    double frameTime = 0.0;
+    if (!DecodeNextFrame(frameTime)) {
       FFMPEGLOG("Failed to decode first frame - this may be a partial/incomplete file");
       // Don't fail completely - the file might still be playable
       // Just log the issue and continue
       FFMPEGLOG("Continuing despite first frame decode failure");
     } else {
       FFMPEGLOG("First frame decoded successfully");
+      std::vector<uint8_t> pixels;
+      ConvertFrame(pixels);
+      QueueFrame(std::move(pixels), frameTime);
     }
   }
 
@@ -339,6 +359,48 @@ bool FFmpegPlayer::LoadFile(const wxString &path) {
   return true;
 }
 
+void FFmpegPlayer::ConfigureVideoDecoder(const AVCodec *codec) {
+  // Frame threads decode consecutive frames in parallel, slice threads
+  // split one frame; the decoder uses whichever the stream allows
+  unsigned int cores = std::thread::hardware_concurrency();
+  m_codecCtx->thread_count =
+      cores == 0 ? 0 : std::min<int>(cores, MAX_DECODE_THREADS);
+  m_codecCtx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
+  if (!m_decodeForRenderSize || m_renderWidth <= 0 || m_renderHeight <= 0 ||
+      m_codecCtx->width <= 0 || m_codecCtx->height <= 0) {
+    return;
+  }
+
+  // How much larger the source is than what gets shown
+  double reduction =
+      std::max((double)m_codecCtx->width / m_renderWidth,
+               (double)m_codecCtx->height / m_renderHeight);
+  if (reduction < 2.0) {
+    return;
+  }
+
+  // Deblocking artifacts vanish when shrunk this much. Skipping the filter
+  // on non-reference frames cannot leak into later ones; past 4:1 it is
+  // skipped everywhere
+  m_codecCtx->skip_loop_filter =
+      reduction >= 4.0 ? AVDISCARD_ALL : AVDISCARD_NONREF;
+  m_codecCtx->flags2 |= AV_CODEC_FLAG2_FAST;
+
+  // Decoders that can (JPEG-style ones) decode straight to 1/2, 1/4 or 1/8
+  // size; H.264 and VP9 cannot
+  int lowres = 0;
+  while (lowres < codec->max_lowres && reduction >= 2.0) {
+    lowres++;
+    reduction /= 2.0;
+  }
+  m_codecCtx->lowres = lowres;
+
+  FFMPEGLOG("Decoder tuned for " << m_renderWidth << "x" << m_renderHeight
+                                 << ": lowres=" << lowres << " skip_loop_filter="
+                                 << m_codecCtx->skip_loop_filter);
+}
+
 bool FFmpegPlayer::InitAudioDecoder() {
   if (m_audioStreamIndex < 0 || !m_formatCtx) {
     return false;
@@ -397,7 +459,7 @@ bool FFmpegPlayer::InitAudioDecoder() {
 
   AVChannelLayout outLayout = AV_CHANNEL_LAYOUT_STEREO;
   av_opt_set_chlayout(m_swrCtx, "out_chlayout", &outLayout, 0);
-  av_opt_set_int(m_swrCtx, "out_sample_rate", 48000, 0);
+  av_opt_set_int(m_swrCtx, "out_sample_rate", AudioOutput::SAMPLE_RATE, 0);
   av_opt_set_sample_fmt(m_swrCtx, "out_sample_fmt", AV_SAMPLE_FMT_S16, 0);
 
   ret = swr_init(m_swrCtx);
@@ -409,9 +471,9 @@ bool FFmpegPlayer::InitAudioDecoder() {
     return false;
   }
 
-  // Initialize SDL audio
-  if (!InitSDLAudio()) {
-    FFMPEGLOG("Failed to initialize SDL audio");
+  // Join the shared output device
+  if (!InitAudioOutput()) {
+    FFMPEGLOG("No audio output");
     swr_free(&m_swrCtx);
     av_frame_free(&m_audioFrame);
     avcodec_free_context(&m_audioCodecCtx);
@@ -426,83 +488,37 @@ bool FFmpegPlayer::InitAudioDecoder() {
   return true;
 }
 
-bool FFmpegPlayer::InitSDLAudio() {
-#ifdef HAVE_SDL2
-  if (SDL_Init(SDL_INIT_AUDIO) < 0) {
-    FFMPEGLOG("Failed to initialize SDL audio: " << SDL_GetError());
-    return false;
-  }
-  m_sdlAudioInitialized = true;
-
-  SDL_AudioSpec wanted, obtained;
-  SDL_zero(wanted);
-  wanted.freq = 48000;
-  wanted.format = AUDIO_S16SYS;
-  wanted.channels = 2;
-  wanted.samples = 4096;
-  wanted.callback = AudioCallback;
-  wanted.userdata = this;
-
-  m_sdlAudioDeviceId = SDL_OpenAudioDevice(nullptr, 0, &wanted, &obtained, 0);
-  if (m_sdlAudioDeviceId == 0) {
-    FFMPEGLOG("Failed to open SDL audio device: " << SDL_GetError());
-    SDL_QuitSubSystem(SDL_INIT_AUDIO);
-    m_sdlAudioInitialized = false;
-    return false;
-  }
-
-  FFMPEGLOG("SDL audio opened: " << obtained.freq << "Hz, "
-                                 << (int)obtained.channels << " channels");
-  return true;
-#else
-  FFMPEGLOG("SDL2 not available - audio playback disabled");
-  return false;
-#endif
+bool FFmpegPlayer::InitAudioOutput() {
+  // Opens the device only for the first player of the process
+  m_audioAttached = AudioOutput::Get().Attach(&m_audioStream);
+  return m_audioAttached;
 }
 
-void FFmpegPlayer::AudioCallback(void *userdata, uint8_t *stream, int len) {
-#ifdef HAVE_SDL2
-  FFmpegPlayer *player = static_cast<FFmpegPlayer *>(userdata);
-  if (!player || player->m_muted || !player->m_isPlaying) {
-    memset(stream, 0, len);
+void FFmpegPlayer::SetMuted(bool muted) {
+  if (m_muted == muted) {
     return;
   }
+  // Playback position, taken before the clock source changes
+  double position = m_isAudioOnly ? GetClock() : m_currentTime;
+  m_muted = muted;
 
-  std::lock_guard<std::mutex> lock(player->m_audioMutex);
-
-  size_t readPos = player->m_audioBufferReadPos.load();
-  size_t writePos = player->m_audioBufferWritePos.load();
-  size_t available = (writePos >= readPos)
-                         ? (writePos - readPos)
-                         : (AUDIO_BUFFER_SIZE - readPos + writePos);
-
-  size_t toCopy = std::min(available, static_cast<size_t>(len));
-
-  if (toCopy > 0) {
-    size_t firstPart = std::min(toCopy, AUDIO_BUFFER_SIZE - readPos);
-    memcpy(stream, player->m_audioBuffer.data() + readPos, firstPart);
-    if (toCopy > firstPart) {
-      memcpy(stream + firstPart, player->m_audioBuffer.data(),
-             toCopy - firstPart);
+  // Muted audio is not even demuxed, so the decode thread picks audio up
+  // (or drops it) by starting over from there
+  if (m_decodeThread.joinable()) {
+    if (m_duration > 0.0) {
+      position = std::fmod(position, m_duration); // Later passes of a loop
     }
-    player->m_audioBufferReadPos = (readPos + toCopy) % AUDIO_BUFFER_SIZE;
-    player->m_audioBytesPlayed += toCopy;
+    Seek(position);
   }
 
-  // Fill remaining with silence
-  if (toCopy < static_cast<size_t>(len)) {
-    memset(stream + toCopy, 0, len - toCopy);
+  if (m_audioAttached) {
+    AudioOutput::Get().SetPlaying(&m_audioStream, m_isPlaying && !m_muted);
   }
+}
 
-  // Apply volume
-  if (player->m_volume < 1.0) {
-    int16_t *samples = reinterpret_cast<int16_t *>(stream);
-    int numSamples = len / 2;
-    for (int i = 0; i < numSamples; i++) {
-      samples[i] = static_cast<int16_t>(samples[i] * player->m_volume);
-    }
-  }
-#endif
+void FFmpegPlayer::ClearAudio() {
+  AudioOutput::Get().Clear(&m_audioStream);
+  m_resampleBytes = 0;
 }
 
 void FFmpegPlayer::SeekToStart() {
@@ -543,10 +559,19 @@ void FFmpegPlayer::SeekToStart() {
     }
   }
 
+  ClearFrameQueue();
   m_currentFrame = 0;
   m_currentTime = 0.0;
   m_hitEOF = false;
-  m_audioBytesPlayed = 0;
+  m_videoDraining = false;
+  m_audioStream.ResetFramesPlayed();
+  m_audioTimeBase = 0.0;
+  m_decodeFinished = false;
+  m_audioEnded = false;
+  m_audioStream.SetEnded(false);
+  m_lastFrameTime = -1.0;
+  m_loopOffset = 0.0;
+  m_clockBase = 0.0;
 }
 
 void FFmpegPlayer::ReadAndRoutePackets() {
@@ -564,6 +589,10 @@ void FFmpegPlayer::ReadAndRoutePackets() {
     audioQueueSize = m_audioPacketQueue.size();
   }
 
+  // Muted audio is neither decoded nor queued, or it would pile up behind
+  // a silent device
+  bool wantAudio = m_audioStreamIndex >= 0 && m_hasAudio && !m_muted;
+
   // Read packets until both queues have enough data
   int packetsRead = 0;
   const int maxPacketsPerCall = 32;
@@ -573,7 +602,7 @@ void FFmpegPlayer::ReadAndRoutePackets() {
     bool videoNeedsMore =
         (m_videoStreamIndex >= 0 && videoQueueSize < MAX_PACKET_QUEUE_SIZE);
     bool audioNeedsMore =
-        (m_audioStreamIndex >= 0 && audioQueueSize < MAX_PACKET_QUEUE_SIZE);
+        (wantAudio && audioQueueSize < MAX_PACKET_QUEUE_SIZE);
 
     if (!videoNeedsMore && !audioNeedsMore) {
       break;
@@ -597,7 +626,7 @@ void FFmpegPlayer::ReadAndRoutePackets() {
         m_videoPacketQueue.push(pkt);
         videoQueueSize++;
       }
-    } else if (m_packet->stream_index == m_audioStreamIndex) {
+    } else if (wantAudio && m_packet->stream_index == m_audioStreamIndex) {
       AVPacket *pkt = av_packet_clone(m_packet);
       if (pkt) {
         std::lock_guard<std::mutex> lock(m_audioPacketMutex);
@@ -620,6 +649,10 @@ void FFmpegPlayer::Seek(double timeSeconds) {
   if (streamIndex < 0)
     return;
 
+  // The decode thread owns the contexts while it runs
+  bool wasDecoding = m_decodeThread.joinable();
+  StopDecodeThread();
+
   // Convert time to stream timebase
   AVStream *stream = m_formatCtx->streams[streamIndex];
   int64_t timestamp = static_cast<int64_t>(timeSeconds * stream->time_base.den /
@@ -656,19 +689,29 @@ void FFmpegPlayer::Seek(double timeSeconds) {
   // Reset EOF flag so we can read packets again
   m_hitEOF = false;
 
-  // Clear audio buffer so we start fresh
-  m_audioBufferReadPos = 0;
-  m_audioBufferWritePos = 0;
-
-  // Reset bytes played counter based on seek position
-  // 48000 Hz * 2 channels * 2 bytes per sample = 192000 bytes per second
-  m_audioBytesPlayed = static_cast<size_t>(timeSeconds * 192000.0);
+  // Clear audio buffer so we start fresh, counting from the seek position
+  ClearAudio();
+  m_audioStream.ResetFramesPlayed();
+  m_audioTimeBase = timeSeconds;
 
   m_currentTime = timeSeconds;
   m_currentFrame = static_cast<size_t>(timeSeconds * m_frameRate);
+
+  ClearFrameQueue();
+  m_videoDraining = false;
+  m_decodeFinished = false;
+  m_audioEnded = false;
+  m_lastFrameTime = -1.0;
+  m_loopOffset = 0.0;
+  m_clockBase = timeSeconds;
+  m_clockStart = std::chrono::steady_clock::now();
+
+  if (wasDecoding) {
+    StartDecodeThread();
+  }
 }
 
-bool FFmpegPlayer::DecodeNextFrame() {
+bool FFmpegPlayer::DecodeNextFrame(double &frameTime) {
   if (!m_formatCtx || !m_codecCtx || !m_frame) {
     return false;
   }
@@ -697,10 +740,27 @@ bool FFmpegPlayer::DecodeNextFrame() {
     }
 
     if (!havePacket) {
+      // Frames still held by the decoder (reordering, frame threads) only
+      // come out after an empty packet
+      if (m_hitEOF && !m_videoDraining) {
+        m_videoDraining = true;
+        avcodec_send_packet(m_codecCtx, nullptr);
+        ret = avcodec_receive_frame(m_codecCtx, m_frame);
+        if (ret == 0) {
+          goto frame_ready;
+        }
+      }
+
       // No more packets available - check if we hit EOF and should loop
       if (m_hitEOF && m_loop) {
-        // Seek back to start for looping
+        // Seek back to start for looping; the next pass is timed after the
+        // last frame of this one so the clock never runs backwards
+        if (m_lastFrameTime >= 0.0) {
+          m_loopOffset += m_lastFrameTime + 1.0 / m_frameRate;
+          m_lastFrameTime = -1.0;
+        }
         m_hitEOF = false;
+        m_videoDraining = false;
         av_seek_frame(m_formatCtx, m_videoStreamIndex, 0, AVSEEK_FLAG_BACKWARD);
         avcodec_flush_buffers(m_codecCtx);
         if (m_audioCodecCtx) {
@@ -723,8 +783,6 @@ bool FFmpegPlayer::DecodeNextFrame() {
             av_packet_free(&p);
           }
         }
-        m_currentFrame = 0;
-        m_currentTime = 0.0;
         ReadAndRoutePackets();
         continue;
       }
@@ -780,56 +838,102 @@ bool FFmpegPlayer::DecodeNextFrame() {
   }
 
 frame_ready:
-  // Successfully decoded a frame
-  m_currentFrame++;
-
-  // Update current time based on frame PTS
-  if (m_frame->pts != AV_NOPTS_VALUE && m_formatCtx) {
+  // Successfully decoded a frame; time it from its timestamp, or one frame
+  // after the previous one when it has none
+  int64_t pts = m_frame->best_effort_timestamp != AV_NOPTS_VALUE
+                    ? m_frame->best_effort_timestamp
+                    : m_frame->pts;
+  if (pts != AV_NOPTS_VALUE) {
     AVStream *stream = m_formatCtx->streams[m_videoStreamIndex];
-    m_currentTime = m_frame->pts * av_q2d(stream->time_base);
-  } else if (m_frameRate > 0) {
-    m_currentTime = m_currentFrame / m_frameRate;
+    m_lastFrameTime = pts * av_q2d(stream->time_base) - m_startTime;
+  } else {
+    m_lastFrameTime =
+        m_lastFrameTime < 0.0 ? 0.0 : m_lastFrameTime + 1.0 / m_frameRate;
   }
-
-  // Convert frame to bitmap
-  m_currentBitmap = ConvertFrameToBitmap();
+  frameTime = m_loopOffset + m_lastFrameTime;
 
   return true;
 }
 
-wxBitmap FFmpegPlayer::ConvertFrameToBitmap() {
-  if (!m_frame || !m_frameRGB || !m_swsCtx) {
-    return wxBitmap();
+void FFmpegPlayer::ConvertFrame(std::vector<uint8_t> &pixels) {
+  if (!m_frame || !m_swsCtx) {
+    pixels.clear();
+    return;
   }
 
   int outWidth = m_renderWidth > 0 ? m_renderWidth : m_width;
   int outHeight = m_renderHeight > 0 ? m_renderHeight : m_height;
+  int rowBytes = outWidth * wxNativePixelFormat::SizePixel;
+
+  // A recycled buffer already has the size
+  pixels.resize(static_cast<size_t>(rowBytes) * outHeight);
+  uint8_t *dest[4] = {pixels.data(), nullptr, nullptr, nullptr};
+  int destLineSize[4] = {rowBytes, 0, 0, 0};
+  sws_scale(m_swsCtx, m_frame->data, m_frame->linesize, 0, m_height, dest,
+            destLineSize);
+}
 
-  // Convert the frame to RGB
-  sws_scale(m_swsCtx, m_frame->data, m_frame->linesize, 0, m_height,
-            m_frameRGB->data, m_frameRGB->linesize);
+std::vector<uint8_t> FFmpegPlayer::TakeFrameBuffer() {
+  std::lock_guard<std::mutex> lock(m_frameMutex);
+  if (m_freeBuffers.empty()) {
+    return std::vector<uint8_t>();
+  }
+  std::vector<uint8_t> pixels = std::move(m_freeBuffers.back());
+  m_freeBuffers.pop_back();
+  return pixels;
+}
 
-  // Create wxImage from RGB data
-  wxImage image(outWidth, outHeight);
+void FFmpegPlayer::QueueFrame(std::vector<uint8_t> pixels, double time) {
+  DecodedFrame frame;
+  frame.pixels = std::move(pixels);
+  frame.width = m_renderWidth > 0 ? m_renderWidth : m_width;
+  frame.height = m_renderHeight > 0 ? m_renderHeight : m_height;
+  frame.time = time;
 
-  // Copy RGB data to wxImage
-  unsigned char *destData = image.GetData();
-  int srcLineSize = m_frameRGB->linesize[0];
+  std::lock_guard<std::mutex> lock(m_frameMutex);
+  m_frameQueue.push_back(std::move(frame));
+}
 
-  for (int y = 0; y < outHeight; y++) {
-    const uint8_t *srcLine = m_frameRGB->data[0] + y * srcLineSize;
-    unsigned char *destLine = destData + y * outWidth * 3;
-    memcpy(destLine, srcLine, outWidth * 3);
+void FFmpegPlayer::PresentFrame(const DecodedFrame &frame) {
+  size_t rowBytes =
+      static_cast<size_t>(frame.width) * wxNativePixelFormat::SizePixel;
+  if (frame.pixels.size() < rowBytes * frame.height) {
+    return;
   }
 
-  return wxBitmap(image);
+  if (!m_currentBitmap.IsOk() || m_currentBitmap.GetWidth() != frame.width ||
+      m_currentBitmap.GetHeight() != frame.height) {
+    m_currentBitmap.Create(frame.width, frame.height,
+                           wxNativePixelFormat::BitsPerPixel);
+  }
+
+  {
+    wxNativePixelData data(m_currentBitmap);
+    if (!data) {
+      FFMPEGLOG("PresentFrame: no raw access to the frame bitmap");
+      return;
+    }
+    wxNativePixelData::Iterator row(data);
+    const uint8_t *source = frame.pixels.data();
+    for (int y = 0; y < frame.height; y++) {
+      memcpy(&row.Data(), source, rowBytes);
+      source += rowBytes;
+      row.OffsetY(data, 1);
+    }
+  }
+
+  if (m_frameCallback) {
+    m_frameCallback(m_currentBitmap);
+  }
 }
 
 int FFmpegPlayer::GetTimerIntervalMs() const {
+  // Poll at twice the frame rate so a frame goes up within half a frame of
+  // its time
   if (m_frameRate <= 0) {
-    return 33; // ~30 fps default
+    return 16; // ~30 fps default, polled twice per frame
   }
-  return static_cast<int>(1000.0 / m_frameRate);
+  return std::max(5, static_cast<int>(500.0 / m_frameRate));
 }
 
 void FFmpegPlayer::SetRenderSize(int width, int height) {
@@ -837,32 +941,45 @@ void FFmpegPlayer::SetRenderSize(int width, int height) {
     return;
   }
 
+  // If already loaded, we need to recreate the scaling context, which the
+  // decode thread uses
+  bool wasDecoding = m_decodeThread.joinable();
+  StopDecodeThread();
+
   m_renderWidth = width;
   m_renderHeight = height;
 
-  // If already loaded, we need to recreate the scaling context and buffers
   if (m_isLoaded && m_swsCtx) {
     sws_freeContext(m_swsCtx);
 
     int outWidth = m_renderWidth > 0 ? m_renderWidth : m_width;
     int outHeight = m_renderHeight > 0 ? m_renderHeight : m_height;
 
-    // Reallocate RGB buffer
-    if (m_rgbBuffer) {
-      av_free(m_rgbBuffer);
-    }
-    m_rgbBufferSize =
-        av_image_get_buffer_size(AV_PIX_FMT_RGB24, outWidth, outHeight, 1);
-    m_rgbBuffer = (uint8_t *)av_malloc(m_rgbBufferSize);
+    m_swsCtx = sws_getContext(m_width, m_height, m_codecCtx->pix_fmt, outWidth,
+                              outHeight, NativePixelFormat(), SWS_BILINEAR,
+                              nullptr, nullptr, nullptr);
 
-    if (m_rgbBuffer && m_frameRGB) {
-      av_image_fill_arrays(m_frameRGB->data, m_frameRGB->linesize, m_rgbBuffer,
-                           AV_PIX_FMT_RGB24, outWidth, outHeight, 1);
+    // Frames already queued have the old size. The first frame from
+    // LoadFile() is still in m_frame and is redone at the new size
+    bool onlyFirstFrame;
+    double time = 0.0;
+    {
+      std::lock_guard<std::mutex> lock(m_frameMutex);
+      onlyFirstFrame = m_frameQueue.size() == 1 && m_currentFrame == 0;
+      if (onlyFirstFrame) {
+        time = m_frameQueue.front().time;
+      }
+    }
+    ClearFrameQueue();
+    if (onlyFirstFrame && m_swsCtx && m_frame && m_frame->data[0]) {
+      std::vector<uint8_t> pixels = TakeFrameBuffer();
+      ConvertFrame(pixels);
+      QueueFrame(std::move(pixels), time);
     }
+  }
 
-    m_swsCtx = sws_getContext(m_width, m_height, m_codecCtx->pix_fmt, outWidth,
-                              outHeight, AV_PIX_FMT_RGB24, SWS_BILINEAR,
-                              nullptr, nullptr, nullptr);
+  if (wasDecoding) {
+    StartDecodeThread();
   }
 }
 
@@ -871,109 +988,275 @@ bool FFmpegPlayer::AdvanceFrame() {
     return false;
   }
 
-  // For audio-only files, just fill the audio buffer
+  // For audio-only files the decode thread keeps the audio buffer filled;
+  // playback ends once it has run out and SDL has drained the buffer
   if (m_isAudioOnly) {
-    FillAudioBuffer();
+    if (m_decodeFinished && m_audioStream.GetRing().GetReadable() == 0) {
+      m_isPlaying = false;
+      // Lets AudioOutput pause the device instead of mixing silence
+      if (m_audioAttached) {
+        AudioOutput::Get().SetPlaying(&m_audioStream, false);
+      }
+      return false;
+    }
+    return true;
+  }
 
-    // Check if we've reached the end
-    if (m_duration > 0 && m_currentTime >= m_duration) {
-      if (!m_loop) {
-        m_isPlaying = false;
-        return false;
+  // Present the latest frame that is due; earlier due frames are late and
+  // skipped
+  double clock = GetClock();
+  DecodedFrame frame;
+  bool haveFrame = false;
+  bool ended;
+  {
+    std::lock_guard<std::mutex> lock(m_frameMutex);
+    while (!m_frameQueue.empty() && m_frameQueue.front().time <= clock) {
+      if (haveFrame) {
+        m_droppedFrames++;
+        m_freeBuffers.push_back(std::move(frame.pixels));
       }
+      frame = std::move(m_frameQueue.front());
+      m_frameQueue.pop_front();
+      haveFrame = true;
     }
-    return m_isPlaying;
+    // After a bad timestamp the next frame can be far ahead of the wall
+    // clock: show it and move the clock there
+    if (!haveFrame && !IsAudioClock() && !m_frameQueue.empty() &&
+        m_frameQueue.front().time - clock > MAX_FRAME_WAIT) {
+      frame = std::move(m_frameQueue.front());
+      m_frameQueue.pop_front();
+      haveFrame = true;
+      m_clockBase = frame.time;
+      m_clockStart = std::chrono::steady_clock::now();
+    }
+    ended = m_decodeFinished && m_frameQueue.empty();
   }
 
-  // For video files, decode the next video frame
-  bool hasFrame = DecodeNextFrame();
+  if (haveFrame) {
+    m_currentFrame++;
+    m_currentTime = frame.time;
+    PresentFrame(frame);
+    {
+      std::lock_guard<std::mutex> lock(m_frameMutex);
+      m_freeBuffers.push_back(std::move(frame.pixels));
+    }
+    m_frameCond.notify_one();
+  }
 
-  if (hasFrame && m_frameCallback) {
-    m_frameCallback(m_currentBitmap);
+  return !ended || haveFrame;
+}
+
+bool FFmpegPlayer::IsAudioClock() const {
+  // Audio that is heard, until the last of it has left the buffer
+  return m_hasAudio && !m_muted &&
+         !(m_audioEnded && m_audioStream.GetRing().GetReadable() == 0);
+}
+
+double FFmpegPlayer::GetClock() {
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if (IsAudioClock()) {
+    // Video follows what SDL has consumed; the wall clock is kept on it to
+    // carry on from there once the audio stops
+    m_clockBase = GetAudioTime();
+    m_clockStart = now;
+    return m_clockBase;
+  }
+  if (!m_isPlaying) {
+    return m_clockBase;
+  }
+  std::chrono::duration<double> elapsed = now - m_clockStart;
+  return m_clockBase + elapsed.count();
+}
+
+void FFmpegPlayer::StartDecodeThread() {
+  if (m_decodeThread.joinable() || !m_isLoaded) {
+    return;
   }
+  m_stopDecode = false;
+  m_decodeThread = std::thread(&FFmpegPlayer::DecodeLoop, this);
+}
 
-  // Also keep audio buffer filled for video+audio files
-  if (m_hasAudio) {
-    FillAudioBuffer();
+void FFmpegPlayer::StopDecodeThread() {
+  if (!m_decodeThread.joinable()) {
+    return;
   }
+  {
+    std::lock_guard<std::mutex> lock(m_frameMutex);
+    m_stopDecode = true;
+  }
+  m_frameCond.notify_all();
+  m_decodeThread.join();
+}
 
-  return hasFrame;
+void FFmpegPlayer::ClearFrameQueue() {
+  std::lock_guard<std::mutex> lock(m_frameMutex);
+  for (auto &frame : m_frameQueue) {
+    m_freeBuffers.push_back(std::move(frame.pixels));
+  }
+  m_frameQueue.clear();
+}
+
+void FFmpegPlayer::DecodeLoop() {
+  bool videoDone = m_isAudioOnly;
+  bool audioDone = !m_hasAudio || m_muted;
+
+  while (!m_stopDecode && !(videoDone && audioDone)) {
+    if (!audioDone) {
+      // A looping video rewinds the audio along with it
+      bool moreAudio = FillAudioBuffer();
+      m_audioEnded = !moreAudio;
+      m_audioStream.SetEnded(m_audioEnded);
+      if (!moreAudio && (videoDone || !m_loop)) {
+        audioDone = true;
+      }
+    }
+
+    if (videoDone) {
+      // Audio only: top the buffer up again well before SDL drains it
+      std::unique_lock<std::mutex> lock(m_frameMutex);
+      m_frameCond.wait_for(lock, std::chrono::milliseconds(AUDIO_REFILL_MS),
+                           [this] { return m_stopDecode.load(); });
+      continue;
+    }
+
+    {
+      // Wait for room in the frame queue, waking up to refill audio
+      std::unique_lock<std::mutex> lock(m_frameMutex);
+      if (!m_frameCond.wait_for(
+              lock, std::chrono::milliseconds(AUDIO_REFILL_MS), [this] {
+                return m_stopDecode || m_frameQueue.size() < FRAME_QUEUE_SIZE;
+              })) {
+        continue;
+      }
+    }
+    if (m_stopDecode) {
+      break;
+    }
+
+    double frameTime = 0.0;
+    if (!DecodeNextFrame(frameTime)) {
+      videoDone = true;
+      continue;
+    }
+    std::vector<uint8_t> pixels = TakeFrameBuffer();
+    ConvertFrame(pixels);
+    QueueFrame(std::move(pixels), frameTime);
+  }
+
+  if (videoDone && audioDone) {
+    m_decodeFinished = true;
+  }
 }
 
 void FFmpegPlayer::Play() {
   if (!m_isLoaded)
     return;
 
+  m_clockStart = std::chrono::steady_clock::now();
   m_isPlaying = true;
 
-#ifdef HAVE_SDL2
-  // Start SDL audio playback
-  if (m_hasAudio && m_sdlAudioDeviceId > 0) {
-    SDL_PauseAudioDevice(m_sdlAudioDeviceId, 0); // 0 = unpause
+  // Have audio ready before the device asks for it, so that starting is
+  // not counted as an underrun
+  if (m_hasAudio && !m_muted && !m_decodeThread.joinable()) {
+    FillAudioBuffer();
+  }
+  StartDecodeThread();
 
-    // Pre-fill audio buffer for audio-only files
-    if (m_isAudioOnly) {
-      FillAudioBuffer();
-    }
+  if (m_audioAttached) {
+    AudioOutput::Get().SetPlaying(&m_audioStream, !m_muted);
   }
-#endif
 
   FFMPEGLOG("Play started");
 }
 
 void FFmpegPlayer::Stop() {
   m_isPlaying = false;
+  StopDecodeThread();
 
-#ifdef HAVE_SDL2
-  // Stop SDL audio playback
-  if (m_sdlAudioDeviceId > 0) {
-    SDL_PauseAudioDevice(m_sdlAudioDeviceId, 1); // 1 = pause
+  if (m_audioAttached) {
+    AudioOutput::Get().SetPlaying(&m_audioStream, false);
   }
-#endif
 
   if (m_isLoaded) {
     SeekToStart();
   }
 
   // Clear audio buffer
-  m_audioBufferReadPos = 0;
-  m_audioBufferWritePos = 0;
+  ClearAudio();
 
+  if (GetAudioUnderruns() > 0) {
+    FFMPEGLOG("Audio underruns: " << GetAudioUnderruns() << " ("
+                                  << GetAudioUnderrunFrames() << " frames)");
+  }
   FFMPEGLOG("Stop");
 }
 
 void FFmpegPlayer::Pause() {
+  // Freeze the wall clock where it is
+  m_clockBase = GetClock();
   m_isPlaying = false;
+  StopDecodeThread();
 
-#ifdef HAVE_SDL2
-  // Pause SDL audio playback
-  if (m_sdlAudioDeviceId > 0) {
-    SDL_PauseAudioDevice(m_sdlAudioDeviceId, 1); // 1 = pause
+  if (m_audioAttached) {
+    AudioOutput::Get().SetPlaying(&m_audioStream, false);
   }
-#endif
 
   FFMPEGLOG("Pause");
 }
 
-void FFmpegPlayer::FillAudioBuffer() {
+bool FFmpegPlayer::FillAudioBuffer() {
   if (!m_hasAudio || !m_formatCtx || !m_audioCodecCtx || !m_swrCtx) {
-    return;
+    return false;
   }
 
   // Ensure packets are available
   ReadAndRoutePackets();
 
-  // Fill buffer with decoded audio data
-  while (m_isPlaying) {
-    size_t writePos = m_audioBufferWritePos.load();
-    size_t readPos = m_audioBufferReadPos.load();
-    size_t available = (writePos >= readPos)
-                           ? (AUDIO_BUFFER_SIZE - (writePos - readPos) - 1)
-                           : (readPos - writePos - 1);
+  // Decode until AUDIO_LATENCY_BYTES are buffered; the ring itself is
+  // rounded up to a power of two and would hold well over the target. A
+  // frame that does not fit waits in m_resampleBuffer for the next call
+  while (m_isPlaying && !m_stopDecode) {
+    if (m_resampleBytes > 0) {
+      size_t buffered = m_audioStream.GetRing().GetReadable();
+      size_t room =
+          buffered < AUDIO_LATENCY_BYTES ? AUDIO_LATENCY_BYTES - buffered : 0;
+      size_t written = m_audioStream.GetRing().Write(
+          m_resampleBuffer.data() + m_resampleOffset,
+          std::min(m_resampleBytes, room));
+      m_resampleOffset += written;
+      m_resampleBytes -= written;
+      if (m_resampleBytes > 0) {
+        return true;
+      }
+    }
 
-    // Stop if buffer is getting full
-    if (available < 8192) {
-      break;
+    // Drain decoded frames before feeding the decoder more
+    int ret = avcodec_receive_frame(m_audioCodecCtx, m_audioFrame);
+    if (ret == 0) {
+      // Resample audio to output format into the reused buffer
+      int outSamples =
+          av_rescale_rnd(swr_get_delay(m_swrCtx, m_audioCodecCtx->sample_rate) +
+                             m_audioFrame->nb_samples,
+                         AudioOutput::SAMPLE_RATE, m_audioCodecCtx->sample_rate,
+                         AV_ROUND_UP);
+      size_t needed = static_cast<size_t>(outSamples) * AudioOutput::FRAME_BYTES;
+      if (m_resampleBuffer.size() < needed) {
+        m_resampleBuffer.resize(needed);
+      }
+
+      uint8_t *outBuffer = m_resampleBuffer.data();
+      int convertedSamples = swr_convert(
+          m_swrCtx, &outBuffer, outSamples,
+          (const uint8_t **)m_audioFrame->extended_data,
+          m_audioFrame->nb_samples);
+      av_frame_unref(m_audioFrame);
+
+      m_resampleOffset = 0;
+      m_resampleBytes = convertedSamples > 0
+                            ? static_cast<size_t>(convertedSamples) *
+                                  AudioOutput::FRAME_BYTES
+                            : 0;
+      continue;
     }
 
     // Get an audio packet from the queue
@@ -998,70 +1281,15 @@ void FFmpegPlayer::FillAudioBuffer() {
       }
       if (!pkt) {
         // Still no packets - we're at EOF or starving
-        break;
+        return !m_hitEOF;
       }
     }
 
-    // Update current time based on packet PTS (only for audio-only files)
-    if (m_isAudioOnly && pkt->pts != AV_NOPTS_VALUE) {
-      AVStream *stream = m_formatCtx->streams[m_audioStreamIndex];
-      m_currentTime = pkt->pts * av_q2d(stream->time_base);
-    }
-
-    // Send packet to decoder
-    int ret = avcodec_send_packet(m_audioCodecCtx, pkt);
+    // Send packet to decoder; a bad packet is skipped
+    avcodec_send_packet(m_audioCodecCtx, pkt);
     av_packet_free(&pkt);
-
-    if (ret < 0 && ret != AVERROR(EAGAIN)) {
-      continue;
-    }
-
-    // Receive frames from decoder
-    while (true) {
-      ret = avcodec_receive_frame(m_audioCodecCtx, m_audioFrame);
-      if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-        break;
-      }
-      if (ret < 0) {
-        break;
-      }
-
-      // Resample audio to output format
-      int outSamples =
-          av_rescale_rnd(swr_get_delay(m_swrCtx, m_audioCodecCtx->sample_rate) +
-                             m_audioFrame->nb_samples,
-                         48000, m_audioCodecCtx->sample_rate, AV_ROUND_UP);
-
-      // Temporary buffer for resampled audio
-      uint8_t *outBuffer = nullptr;
-      int outBufferSize = av_samples_alloc(&outBuffer, nullptr, 2, outSamples,
-                                           AV_SAMPLE_FMT_S16, 0);
-
-      if (outBufferSize < 0) {
-        av_frame_unref(m_audioFrame);
-        continue;
-      }
-
-      int convertedSamples = swr_convert(m_swrCtx, &outBuffer, outSamples,
-                                         (const uint8_t **)m_audioFrame->data,
-                                         m_audioFrame->nb_samples);
-
-      if (convertedSamples > 0) {
-        int bytesToWrite = convertedSamples * 2 * 2; // stereo, 16-bit
-
-        std::lock_guard<std::mutex> lock(m_audioMutex);
-
-        writePos = m_audioBufferWritePos.load(); // Re-read in case it changed
-        for (int i = 0; i < bytesToWrite; i++) {
-          m_audioBuffer[(writePos + i) % AUDIO_BUFFER_SIZE] = outBuffer[i];
-        }
-        m_audioBufferWritePos = (writePos + bytesToWrite) % AUDIO_BUFFER_SIZE;
-      }
-
-      av_freep(&outBuffer);
-      av_frame_unref(m_audioFrame);
-    }
   }
+  return true;
 }
 
 bool FFmpegPlayer::DecodeAudioFrame() {
@@ -3,6 +3,7 @@
 
 #include <wx/wx.h>
 #include <wx/timer.h>
+#include "AudioOutput.h"
 #include <memory>
 #include <string>
 #include <functional>
@@ -10,11 +11,16 @@
 #include <vector>
 #include <mutex>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <queue>
+#include <thread>
 
 // Forward declarations for FFmpeg types
 extern "C" {
 struct AVFormatContext;
+struct AVCodec;
 struct AVCodecContext;
 struct AVFrame;
 struct AVPacket;
@@ -25,6 +31,17 @@ struct SwrContext;
 // Callback for frame updates
 using FFmpegFrameCallback = std::function<void(const wxBitmap& frame)>;
 
+// Plays video/animation/audio files. While playing, a decode thread demuxes,
+// decodes and converts ahead into a small frame queue and keeps the
+// player's AudioOutput stream filled; AdvanceFrame() on the UI thread only presents the
+// queued frame that is due. The clock is the audio position when audio is
+// heard, otherwise the wall clock since Play().
+//
+// Frames are converted straight into the native bitmap pixel layout, in
+// buffers that go back to a free list once shown, and presented by copying
+// rows into one persistent bitmap: steady playback allocates nothing. The
+// bitmap handed to the frame callback is therefore overwritten in place by
+// the next frame.
 class FFmpegPlayer : public wxEvtHandler
 {
 public:
@@ -50,25 +67,31 @@ public:
     double GetFrameRate() const { return m_frameRate; }
     double GetDuration() const { return m_duration; }
     double GetCurrentTime() const { 
-        // For audio-only files, calculate time from bytes played
-        // 48000 Hz * 2 channels * 2 bytes per sample = 192000 bytes per second
-        if (m_isAudioOnly && m_audioBytesPlayed > 0) {
-            return static_cast<double>(m_audioBytesPlayed) / 192000.0;
+        // For audio-only files, the position of the last frame the device took
+        if (m_isAudioOnly && m_hasAudio) {
+            return GetAudioTime();
         }
         return m_currentTime; 
     }
+
+    // Times the device found the ring short of data mid-stream, and how
+    // many sample frames of silence that cost
+    uint64_t GetAudioUnderruns() const { return m_audioStream.GetUnderruns(); }
+    uint64_t GetAudioUnderrunFrames() const {
+        return m_audioStream.GetUnderrunFrames();
+    }
     
     // Playback control
     void Play();
     void Stop();
     void Pause();
-    bool IsPlaying() const { return m_isPlaying; }
+    bool IsPlaying() const { return m_isPlaying.load(); }
     
     // Seeking
     void Seek(double timeSeconds);
     
-    // Advance to next frame (for external timer control)
-    // Returns true if animation should continue, false if ended
+    // Present the decoded frame that is due, if any (for external timer
+    // control). Returns true if animation should continue, false if ended
     bool AdvanceFrame();
     
     // Set the frame callback - called when a new frame is ready
@@ -76,6 +99,9 @@ public:
     
     // Get current frame number
     size_t GetCurrentFrame() const { return m_currentFrame; }
+
+    // Frames decoded but skipped because a later one was already due
+    size_t GetDroppedFrames() const { return m_droppedFrames; }
     
     // Get timer interval in milliseconds
     int GetTimerIntervalMs() const;
@@ -85,33 +111,64 @@ public:
     bool IsLooping() const { return m_loop; }
     
     // Volume control (0.0 to 1.0) - for future audio support
-    void SetVolume(double volume) { m_volume = volume; }
+    void SetVolume(double volume) {
+        m_volume = volume;
+        m_audioStream.SetVolume(volume);
+    }
     double GetVolume() const { return m_volume; }
     
     // Mute control
-    void SetMuted(bool muted) { m_muted = muted; }
+    void SetMuted(bool muted);
     bool IsMuted() const { return m_muted; }
     
     // Render size (for scaling output)
     void SetRenderSize(int width, int height);
     int GetRenderWidth() const { return m_renderWidth > 0 ? m_renderWidth : m_width; }
     int GetRenderHeight() const { return m_renderHeight > 0 ? m_renderHeight : m_height; }
-    
-    // Audio callback for SDL2 (static because SDL needs C callback)
-    static void AudioCallback(void* userdata, uint8_t* stream, int len);
+
+    // Let the decoder drop detail the render size cannot show (lower
+    // resolution decoding, skipped deblocking) when the source is at least
+    // twice as large. Set before LoadFile(); on by default
+    void SetDecodeForRenderSize(bool enable) { m_decodeForRenderSize = enable; }
     
 private:
     bool InitDecoder();
+    void ConfigureVideoDecoder(const AVCodec* codec);
     bool InitAudioDecoder();
-    bool InitSDLAudio();
+    bool InitAudioOutput();
     void CleanupDecoder();
     void CleanupAudio();
-    bool DecodeNextFrame();
+    bool DecodeNextFrame(double& frameTime);
     bool DecodeAudioFrame();
-    void FillAudioBuffer();
+    bool FillAudioBuffer();  // False once the audio stream is exhausted
+    void ClearAudio();
+    double GetAudioTime() const {
+        return m_audioTimeBase +
+               static_cast<double>(m_audioStream.GetFramesPlayed()) /
+                   AudioOutput::SAMPLE_RATE;
+    }
     void ReadAndRoutePackets();  // Unified demuxer that routes packets to correct queue
-    wxBitmap ConvertFrameToBitmap();
+    // sws_scale into pixels, in the native bitmap layout at render size
+    void ConvertFrame(std::vector<uint8_t>& pixels);
+    std::vector<uint8_t> TakeFrameBuffer();
     void SeekToStart();
+
+    // Decode thread: owns the FFmpeg contexts while it runs
+    void DecodeLoop();
+    void StartDecodeThread();
+    void StopDecodeThread();
+    void ClearFrameQueue();
+    bool IsAudioClock() const;
+    double GetClock();
+
+    struct DecodedFrame {
+        std::vector<uint8_t> pixels;  // Native layout, rows packed
+        int width;
+        int height;
+        double time;  // Presentation time in seconds, continuous across loops
+    };
+    void QueueFrame(std::vector<uint8_t> pixels, double time);
+    void PresentFrame(const DecodedFrame& frame);
     
     // File path
     wxString m_filePath;
@@ -128,15 +185,16 @@ private:
     
     // Playback state
     bool m_isLoaded;
-    bool m_isPlaying;
-    bool m_loop;
+    std::atomic<bool> m_isPlaying;
+    std::atomic<bool> m_loop;  // Read by the decode thread
     bool m_hitEOF;  // Track when we've read all packets from the file
     size_t m_currentFrame;
-    double m_currentTime;  // Current playback position in seconds
+    double m_currentTime;  // Time of the presented frame in seconds
+    size_t m_droppedFrames;
     
     // Audio state
     double m_volume;
-    bool m_muted;
+    std::atomic<bool> m_muted;  // Read by the decode thread
     bool m_isAudioOnly;
     bool m_hasAudio;
     
@@ -144,7 +202,6 @@ private:
     AVFormatContext* m_formatCtx;
     AVCodecContext* m_codecCtx;
     AVFrame* m_frame;
-    AVFrame* m_frameRGB;
     AVPacket* m_packet;
     SwsContext* m_swsCtx;
     
@@ -157,13 +214,21 @@ private:
     int m_videoStreamIndex;
     int m_audioStreamIndex;
     
-    // Audio buffer for SDL
-    std::vector<uint8_t> m_audioBuffer;
-    std::atomic<size_t> m_audioBufferReadPos;
-    std::atomic<size_t> m_audioBufferWritePos;
-    std::atomic<size_t> m_audioBytesPlayed;  // Total bytes played for time tracking
-    std::mutex m_audioMutex;
-    static const size_t AUDIO_BUFFER_SIZE = 192000;  // ~1 second at 48kHz stereo 16-bit
+    // PCM in the shared output format: the decode thread writes the
+    // stream's ring, the AudioOutput mixer reads it
+    AudioOutput::Stream m_audioStream;
+    bool m_audioAttached;
+    std::vector<uint8_t> m_resampleBuffer;  // Last resampled frame, reused
+    size_t m_resampleOffset;
+    size_t m_resampleBytes;  // Not yet written to the ring
+    double m_audioTimeBase;  // Time of the first frame in the ring
+
+    // Decoded audio kept ahead of the device; the decode thread tops it up
+    // every AUDIO_REFILL_MS
+    static const int AUDIO_LATENCY_MS = 200;
+    static const size_t AUDIO_LATENCY_BYTES =
+        static_cast<size_t>(AudioOutput::SAMPLE_RATE) *
+        AudioOutput::FRAME_BYTES * AUDIO_LATENCY_MS / 1000;
     
     // Packet queues to avoid losing packets when demuxing
     std::queue<AVPacket*> m_videoPacketQueue;
@@ -172,15 +237,36 @@ private:
     std::mutex m_audioPacketMutex;
     static const size_t MAX_PACKET_QUEUE_SIZE = 64;
     
-    // SDL audio state
-    bool m_sdlAudioInitialized;
-    uint32_t m_sdlAudioDeviceId;
-    
-    // RGB buffer for conversion
-    uint8_t* m_rgbBuffer;
-    int m_rgbBufferSize;
-    
-    // Current decoded frame as bitmap
+    // Decode thread and the frames it has ready
+    std::thread m_decodeThread;
+    std::atomic<bool> m_stopDecode;
+    std::atomic<bool> m_decodeFinished;  // No more frames/audio will come
+    std::atomic<bool> m_audioEnded;
+    std::deque<DecodedFrame> m_frameQueue;
+    std::vector<std::vector<uint8_t>> m_freeBuffers;  // Shown frames' pixels
+    std::mutex m_frameMutex;
+    std::condition_variable m_frameCond;
+    static const size_t FRAME_QUEUE_SIZE = 4;
+    static const int AUDIO_REFILL_MS = 10;
+    // Longest the next frame may lie ahead of the clock before the clock
+    // is moved to it instead
+    static constexpr double MAX_FRAME_WAIT = 1.0;
+
+    // Decode-side timing: start offset of the stream, time of the last
+    // decoded frame and how much earlier passes of a loop add
+    double m_startTime;
+    double m_lastFrameTime;
+    double m_loopOffset;
+    bool m_videoDraining;  // Empty packet sent at EOF, collecting what is left
+
+    bool m_decodeForRenderSize;
+    static const int MAX_DECODE_THREADS = 4;
+
+    // Wall clock, used when no audio is heard
+    std::chrono::steady_clock::time_point m_clockStart;
+    double m_clockBase;
+
+    // Current presented frame as bitmap, reused while the size holds
     wxBitmap m_currentBitmap;
     
     // Frame callback
@@ -0,0 +1,92 @@
+#include "ImageScaler.h"
+
+#include <cstdlib>
+
+extern "C" {
+#include <libswscale/swscale.h>
+}
+
+namespace {
+
+// One context per plane layout, reused while the sizes repeat (popups of
+// one media type all scale into the same box)
+struct ScalerContexts {
+  SwsContext *rgb = nullptr;
+  SwsContext *alpha = nullptr;
+
+  ~ScalerContexts() {
+    sws_freeContext(rgb);
+    sws_freeContext(alpha);
+  }
+};
+
+thread_local ScalerContexts t_contexts;
+
+bool ScalePlane(SwsContext *&context, AVPixelFormat format, int bytesPerPixel,
+                const unsigned char *source, int sourceWidth, int sourceHeight,
+                unsigned char *target, int width, int height, int flags) {
+  context = sws_getCachedContext(context, sourceWidth, sourceHeight, format,
+                                 width, height, format, flags, nullptr,
+                                 nullptr, nullptr);
+  if (!context) {
+    return false;
+  }
+
+  const uint8_t *sourcePlanes[4] = {source, nullptr, nullptr, nullptr};
+  int sourceStrides[4] = {sourceWidth * bytesPerPixel, 0, 0, 0};
+  uint8_t *targetPlanes[4] = {target, nullptr, nullptr, nullptr};
+  int targetStrides[4] = {width * bytesPerPixel, 0, 0, 0};
+  return sws_scale(context, sourcePlanes, sourceStrides, 0, sourceHeight,
+                   targetPlanes, targetStrides) == height;
+}
+
+} // namespace
+
+wxImage DownscaleImage(const wxImage &source, int width, int height) {
+  if (!source.IsOk() || width <= 0 || height <= 0) {
+    return wxImage();
+  }
+
+  int sourceWidth = source.GetWidth();
+  int sourceHeight = source.GetHeight();
+  if (width == sourceWidth && height == sourceHeight) {
+    return source;
+  }
+  if (width > sourceWidth || height > sourceHeight) {
+    return source.Scale(width, height, wxIMAGE_QUALITY_HIGH);
+  }
+  if (source.HasMask()) {
+    // Masks are a colour key; nearest-neighbour keeps the key colour exact
+    return source.Scale(width, height, wxIMAGE_QUALITY_NEAREST);
+  }
+
+  // Past 2:1 every source pixel should count (box); below that Lanczos
+  // keeps edges sharp
+  bool large = sourceWidth >= width * 2 || sourceHeight >= height * 2;
+  int flags = (large ? SWS_AREA : SWS_LANCZOS) | SWS_ACCURATE_RND;
+
+  // wxImage takes ownership of malloc'd planes
+  unsigned char *rgb = static_cast<unsigned char *>(
+      malloc(static_cast<size_t>(width) * height * 3));
+  if (!rgb ||
+      !ScalePlane(t_contexts.rgb, AV_PIX_FMT_RGB24, 3, source.GetData(),
+                  sourceWidth, sourceHeight, rgb, width, height, flags)) {
+    free(rgb);
+    return source.Scale(width, height, wxIMAGE_QUALITY_HIGH);
+  }
+  wxImage scaled(width, height, rgb);
+
+  if (source.HasAlpha()) {
+    unsigned char *alpha =
+        static_cast<unsigned char *>(malloc(static_cast<size_t>(width) * height));
+    if (!alpha ||
+        !ScalePlane(t_contexts.alpha, AV_PIX_FMT_GRAY8, 1, source.GetAlpha(),
+                    sourceWidth, sourceHeight, alpha, width, height, flags)) {
+      free(alpha);
+      return source.Scale(width, height, wxIMAGE_QUALITY_HIGH);
+    }
+    scaled.SetAlpha(alpha);
+  }
+
+  return scaled;
+}
@@ -0,0 +1,404 @@
+#include "ImageTransformPool.h"
+#include "FileUtils.h"
+
+#include <wx/filename.h>
+#include <wx/image.h>
+#include <wx/wfstream.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#ifdef HAVE_WEBP
+#include <webp/encode.h>
+#endif
+
+wxDEFINE_EVENT(wxEVT_IMAGE_TRANSFORMED, wxThreadEvent);
+
+ImageTransformPool::ImageTransformPool(size_t threadCount) {
+  m_outputDir = wxFileName::GetTempDir() + wxFileName::GetPathSeparator() +
+                wxString::Format("teleliter-upload-%lu", wxGetProcessId());
+  if (!wxFileName::DirExists(m_outputDir)) {
+    wxFileName::Mkdir(m_outputDir, wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL);
+  }
+
+  if (threadCount == 0) {
+    threadCount = std::thread::hardware_concurrency() / 2;
+  }
+  threadCount = std::max<size_t>(1, std::min(threadCount, MAX_THREADS));
+
+  Bind(wxEVT_IMAGE_TRANSFORMED, &ImageTransformPool::OnResultsReady, this);
+
+  for (size_t i = 0; i < threadCount; ++i) {
+    m_workers.emplace_back(&ImageTransformPool::WorkerLoop, this);
+  }
+}
+
+ImageTransformPool::~ImageTransformPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+    m_jobs.clear();
+    m_cancelled.clear();
+  }
+  m_cond.notify_all();
+  for (auto &worker : m_workers) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+
+  for (const auto &output : m_outputs) {
+    wxRemoveFile(output);
+  }
+  wxFileName::Rmdir(m_outputDir);
+}
+
+int ImageTransformPool::Submit(const wxString &path,
+                               const ImageTransformOptions &options) {
+  int jobId = 0;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    jobId = m_nextJobId++;
+    m_jobs.push_back({jobId, path, options});
+  }
+  m_cond.notify_one();
+  return jobId;
+}
+
+void ImageTransformPool::Cancel(int jobId) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto queued = std::find_if(m_jobs.begin(), m_jobs.end(),
+                             [jobId](const Job &job) { return job.id == jobId; });
+  if (queued != m_jobs.end()) {
+    m_jobs.erase(queued);
+    return;
+  }
+  // Only a job whose result is still to come needs remembering; anything
+  // else has been delivered already (or never existed)
+  if (m_running.count(jobId) > 0) {
+    m_cancelled.insert(jobId);
+  }
+}
+
+bool ImageTransformPool::IsCandidate(const wxString &path) {
+  wxString ext = wxFileName(path).GetExt().Lower();
+  if (ext == "webp") {
+    return !IsAnimatedWebP(path);
+  }
+  return ext == "jpg" || ext == "jpeg" || ext == "png" || ext == "bmp" ||
+         ext == "tif" || ext == "tiff";
+}
+
+bool ImageTransformPool::IsAnimatedWebP(const wxString &path) {
+  // "RIFF" size "WEBP" "VP8X" chunk size, then the feature flags byte
+  std::ifstream file(path.ToStdString(), std::ios::binary);
+  unsigned char header[21];
+  if (!file.read(reinterpret_cast<char *>(header), sizeof(header))) {
+    return false;
+  }
+  return std::memcmp(header, "RIFF", 4) == 0 &&
+         std::memcmp(header + 8, "WEBPVP8X", 8) == 0 &&
+         (header[20] & 0x02) != 0;
+}
+
+void ImageTransformPool::WorkerLoop() {
+  while (true) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cond.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+      if (m_stop) {
+        return;
+      }
+      job = std::move(m_jobs.front());
+      m_jobs.pop_front();
+      m_running.insert(job.id);
+    }
+
+    ImageTransformResult result = Transform(job);
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (result.transformed) {
+        m_outputs.push_back(result.outputPath);
+      }
+      m_results.push_back(std::move(result));
+    }
+    wxQueueEvent(this, new wxThreadEvent(wxEVT_IMAGE_TRANSFORMED));
+  }
+}
+
+ImageTransformResult ImageTransformPool::Transform(const Job &job) const {
+  ImageTransformResult result;
+  result.jobId = job.id;
+  result.sourcePath = job.path;
+  result.outputPath = job.path;
+
+  wxULongLong size = wxFileName::GetSize(job.path);
+  result.originalBytes = size == wxInvalidSize
+                             ? 0
+                             : static_cast<int64_t>(size.GetValue());
+  result.outputBytes = result.originalBytes;
+
+  // Image handlers report decode problems through wxLog, which must not pop
+  // up dialogs from a worker thread
+  wxLogNull noLog;
+
+  wxImage image;
+  if (!LoadImageWithWebPSupport(job.path, image) || !image.IsOk()) {
+    result.note = "could not decode image";
+    return result;
+  }
+
+  bool changed = false;
+
+  wxString ext = wxFileName(job.path).GetExt().Lower();
+  if (ext == "jpg" || ext == "jpeg") {
+    int orientation = ReadJpegOrientation(job.path);
+    if (orientation > 1) {
+      ApplyOrientation(image, orientation);
+      changed = true;
+    }
+  }
+
+  int width = image.GetWidth();
+  int height = image.GetHeight();
+  int longest = std::max(width, height);
+  if (longest > job.options.maxDimension && job.options.maxDimension > 0) {
+    double scale = static_cast<double>(job.options.maxDimension) / longest;
+    int newWidth = std::max(1, static_cast<int>(width * scale + 0.5));
+    int newHeight = std::max(1, static_cast<int>(height * scale + 0.5));
+    image.Rescale(newWidth, newHeight, wxIMAGE_QUALITY_HIGH);
+    changed = true;
+  }
+
+  // Photos are opaque - composite transparency onto white rather than letting
+  // the encoder keep whatever RGB hides under alpha 0
+  if (image.HasAlpha()) {
+    unsigned char *rgb = image.GetData();
+    const unsigned char *alpha = image.GetAlpha();
+    size_t pixels = static_cast<size_t>(image.GetWidth()) * image.GetHeight();
+    for (size_t i = 0; i < pixels; ++i) {
+      unsigned int a = alpha[i];
+      for (int c = 0; c < 3; ++c) {
+        unsigned char &v = rgb[i * 3 + c];
+        v = static_cast<unsigned char>((v * a + 255 * (255 - a)) / 255);
+      }
+    }
+    image.ClearAlpha();
+  }
+
+  bool webp = false;
+#ifdef HAVE_WEBP
+  webp = job.options.preferWebP;
+#endif
+
+  wxString outputPath = m_outputDir + wxFileName::GetPathSeparator() +
+                        wxString::Format("%d_%s.%s", job.id,
+                                         wxFileName(job.path).GetName(),
+                                         webp ? "webp" : "jpg");
+
+  bool saved = false;
+#ifdef HAVE_WEBP
+  if (webp) {
+    saved = SaveWebP(image, outputPath, job.options.quality);
+  }
+#endif
+  if (!webp) {
+    saved = SaveJpeg(image, outputPath, job.options.quality);
+  }
+  if (!saved) {
+    wxRemoveFile(outputPath);
+    result.note = "could not encode image";
+    return result;
+  }
+
+  wxULongLong outputSize = wxFileName::GetSize(outputPath);
+  int64_t outputBytes = outputSize == wxInvalidSize
+                            ? 0
+                            : static_cast<int64_t>(outputSize.GetValue());
+
+  // Nothing was resized or rotated and the encoder could not beat the
+  // original - send that instead of a bigger copy
+  if (!changed && outputBytes >= result.originalBytes) {
+    wxRemoveFile(outputPath);
+    result.note = "already compact";
+    return result;
+  }
+
+  result.outputPath = outputPath;
+  result.outputBytes = outputBytes;
+  result.transformed = true;
+  return result;
+}
+
+void ImageTransformPool::OnResultsReady(wxThreadEvent &event) {
+  std::vector<ImageTransformResult> results;
+  std::set<int> cancelled;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    results.swap(m_results);
+    for (const auto &result : results) {
+      m_running.erase(result.jobId);
+      if (m_cancelled.erase(result.jobId) > 0) {
+        cancelled.insert(result.jobId);
+      }
+    }
+  }
+
+  for (const auto &result : results) {
+    if (cancelled.count(result.jobId) > 0) {
+      if (result.transformed) {
+        wxRemoveFile(result.outputPath);
+      }
+      continue;
+    }
+    if (m_resultCallback) {
+      m_resultCallback(result);
+    }
+  }
+}
+
+int ImageTransformPool::ReadJpegOrientation(const wxString &path) {
+  std::ifstream file(path.ToStdString(), std::ios::binary);
+  if (!file) {
+    return 1;
+  }
+
+  auto readByte = [&file]() -> int {
+    char c;
+    return file.get(c) ? static_cast<unsigned char>(c) : -1;
+  };
+
+  if (readByte() != 0xFF || readByte() != 0xD8) {
+    return 1; // Not a JPEG
+  }
+
+  // Walk the marker segments up to the image data looking for APP1/Exif
+  while (file) {
+    int marker = readByte();
+    if (marker != 0xFF) {
+      return 1;
+    }
+    int type = readByte();
+    while (type == 0xFF) {
+      type = readByte(); // Fill bytes
+    }
+    if (type < 0 || type == 0xDA || type == 0xD9) {
+      return 1; // Start of scan / end of image
+    }
+
+    int hi = readByte();
+    int lo = readByte();
+    if (hi < 0 || lo < 0) {
+      return 1;
+    }
+    int length = (hi << 8) | lo;
+    if (length < 2) {
+      return 1;
+    }
+
+    if (type != 0xE1) {
+      file.seekg(length - 2, std::ios::cur);
+      continue;
+    }
+
+    std::vector<unsigned char> data(length - 2);
+    if (!file.read(reinterpret_cast<char *>(data.data()), data.size())) {
+      return 1;
+    }
+    if (data.size() < 14 || std::memcmp(data.data(), "Exif\0\0", 6) != 0) {
+      continue; // XMP or another APP1 payload
+    }
+
+    const unsigned char *tiff = data.data() + 6;
+    size_t tiffSize = data.size() - 6;
+    bool little = tiff[0] == 'I' && tiff[1] == 'I';
+    if (!little && !(tiff[0] == 'M' && tiff[1] == 'M')) {
+      return 1;
+    }
+
+    auto u16 = [&](size_t offset) -> unsigned int {
+      return little ? tiff[offset] | (tiff[offset + 1] << 8)
+                    : (tiff[offset] << 8) | tiff[offset + 1];
+    };
+    auto u32 = [&](size_t offset) -> uint32_t {
+      return little ? static_cast<uint32_t>(u16(offset)) |
+                          (static_cast<uint32_t>(u16(offset + 2)) << 16)
+                    : (static_cast<uint32_t>(u16(offset)) << 16) |
+                          static_cast<uint32_t>(u16(offset + 2));
+    };
+
+    size_t ifd = u32(4);
+    if (ifd + 2 > tiffSize) {
+      return 1;
+    }
+    unsigned int count = u16(ifd);
+    for (unsigned int i = 0; i < count; ++i) {
+      size_t entry = ifd + 2 + i * 12;
+      if (entry + 12 > tiffSize) {
+        break;
+      }
+      if (u16(entry) == 0x0112) { // Orientation, SHORT
+        unsigned int value = u16(entry + 8);
+        return (value >= 1 && value <= 8) ? static_cast<int>(value) : 1;
+      }
+    }
+    return 1;
+  }
+  return 1;
+}
+
+void ImageTransformPool::ApplyOrientation(wxImage &image, int orientation) {
+  switch (orientation) {
+  case 2:
+    image = image.Mirror(true);
+    break;
+  case 3:
+    image = image.Rotate180();
+    break;
+  case 4:
+    image = image.Mirror(false);
+    break;
+  case 5: // Transpose
+    image = image.Rotate90(true).Mirror(true);
+    break;
+  case 6:
+    image = image.Rotate90(true);
+    break;
+  case 7: // Transverse
+    image = image.Rotate90(false).Mirror(true);
+    break;
+  case 8:
+    image = image.Rotate90(false);
+    break;
+  default:
+    break;
+  }
+}
+
+bool ImageTransformPool::SaveJpeg(const wxImage &image, const wxString &path,
+                                  int quality) {
+  wxImage copy = image;
+  copy.SetOption(wxIMAGE_OPTION_QUALITY, quality);
+  return copy.SaveFile(path, wxBITMAP_TYPE_JPEG);
+}
+
+#ifdef HAVE_WEBP
+bool ImageTransformPool::SaveWebP(const wxImage &image, const wxString &path,
+                                  int quality) {
+  uint8_t *output = nullptr;
+  size_t size = WebPEncodeRGB(image.GetData(), image.GetWidth(),
+                              image.GetHeight(), image.GetWidth() * 3,
+                              static_cast<float>(quality), &output);
+  if (size == 0 || !output) {
+    return false;
+  }
+
+  wxFileOutputStream stream(path);
+  bool ok = stream.IsOk() && stream.WriteAll(output, size);
+  WebPFree(output);
+  return ok;
+}
+#endif
@@ -0,0 +1,105 @@
+#ifndef IMAGETRANSFORMPOOL_H
+#define IMAGETRANSFORMPOOL_H
+
+#include <wx/wx.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+// How photos are shrunk before upload
+struct ImageTransformOptions {
+  int maxDimension = 2560; // Longest side; Telegram scales photos down to this
+  int quality = 85;
+  bool preferWebP = false; // Falls back to JPEG without HAVE_WEBP
+};
+
+struct ImageTransformResult {
+  int jobId = 0;
+  wxString sourcePath;
+  wxString outputPath; // == sourcePath when the original is sent as-is
+  int64_t originalBytes = 0;
+  int64_t outputBytes = 0;
+  bool transformed = false;
+  wxString note; // Why the original was kept, if it was
+
+  int64_t GetSavedBytes() const {
+    return transformed ? originalBytes - outputBytes : 0;
+  }
+};
+
+// Worker pool that prepares photos for upload: applies the EXIF orientation,
+// downscales to maxDimension, flattens alpha and re-encodes as JPEG (or WebP),
+// which also drops all metadata (EXIF, GPS, ICC text chunks). The original is
+// kept when the re-encoded file would not be smaller and nothing else had to
+// change.
+//
+// Results are delivered on the main thread through the result callback.
+// Output files live in a private temp directory and are removed when the pool
+// is destroyed.
+class ImageTransformPool : public wxEvtHandler {
+public:
+  using ResultCallback = std::function<void(const ImageTransformResult &)>;
+
+  // threadCount 0 picks half the hardware threads (1..MAX_THREADS)
+  explicit ImageTransformPool(size_t threadCount = 0);
+  ~ImageTransformPool();
+
+  void SetResultCallback(ResultCallback callback) {
+    m_resultCallback = std::move(callback);
+  }
+
+  int Submit(const wxString &path, const ImageTransformOptions &options);
+
+  // Drop a job; its result (if already running) is discarded
+  void Cancel(int jobId);
+
+  // Still images worth re-encoding; GIFs and animated WebPs are skipped so
+  // the animation survives
+  static bool IsCandidate(const wxString &path);
+
+private:
+  struct Job {
+    int id;
+    wxString path;
+    ImageTransformOptions options;
+  };
+
+  void WorkerLoop();
+  ImageTransformResult Transform(const Job &job) const;
+  void OnResultsReady(wxThreadEvent &event);
+
+  // VP8X header with the animation flag set
+  static bool IsAnimatedWebP(const wxString &path);
+  // 1 (upright) .. 8 from the JPEG APP1/EXIF block, 1 when absent
+  static int ReadJpegOrientation(const wxString &path);
+  static void ApplyOrientation(wxImage &image, int orientation);
+  static bool SaveJpeg(const wxImage &image, const wxString &path,
+                       int quality);
+#ifdef HAVE_WEBP
+  static bool SaveWebP(const wxImage &image, const wxString &path,
+                       int quality);
+#endif
+
+  ResultCallback m_resultCallback;
+  wxString m_outputDir;
+  int m_nextJobId = 1;
+
+  std::vector<std::thread> m_workers;
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  std::deque<Job> m_jobs;
+  std::vector<ImageTransformResult> m_results;
+  std::set<int> m_running;   // Taken by a worker, result not delivered yet
+  std::set<int> m_cancelled; // Subset of m_running whose result is unwanted
+  std::vector<wxString> m_outputs; // Files to remove on shutdown
+  bool m_stop = false;
+
+  static constexpr size_t MAX_THREADS = 4;
+};
+
+#endif // IMAGETRANSFORMPOOL_H
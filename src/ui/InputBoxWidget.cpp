@@ -1,4 +1,5 @@
 #include "InputBoxWidget.h"
+#include "../telegram/NickIndex.h"
 #include "../telegram/TelegramClient.h"
 #include "ChatViewWidget.h"
 #include "MainFrame.h"
@@ -7,14 +8,14 @@
 #include <wx/clipbrd.h>
 #include <wx/filedlg.h>
 #include <wx/filename.h>
-#include <wx/listctrl.h>
 #include <wx/stc/stc.h>
 
 InputBoxWidget::InputBoxWidget(wxWindow *parent, MainFrame *mainFrame)
     : wxPanel(parent, wxID_ANY), m_mainFrame(mainFrame), m_chatView(nullptr),
-      m_memberList(nullptr), m_messageFormatter(nullptr),
+      m_nickIndex(nullptr), m_messageFormatter(nullptr),
       m_welcomeChat(nullptr), m_inputBox(nullptr), m_uploadBtn(nullptr),
-      m_historyIndex(0), m_tabCompletionIndex(0), m_tabCompletionActive(false),
+      m_historyIndex(0), m_tabCompletionIndex(0), m_tabCompletionStart(0),
+      m_tabCompletionEnd(0), m_tabCompletionActive(false),
       m_bgColor(wxSystemSettings::GetColour(wxSYS_COLOUR_WINDOW)),
       m_fgColor(wxSystemSettings::GetColour(wxSYS_COLOUR_WINDOWTEXT)),
       m_font(wxFont(12, wxFONTFAMILY_TELETYPE, wxFONTSTYLE_NORMAL, wxFONTWEIGHT_NORMAL)),
@@ -168,18 +169,8 @@ void InputBoxWidget::OnUploadPhoto(wxCommandEvent &event) {
     wxArrayString paths;
     dlg.GetPaths(paths);
 
-    TelegramClient *client = m_mainFrame->GetTelegramClient();
-    if (client && client->IsLoggedIn()) {
-      for (const wxString &path : paths) {
-        client->SendFile(chatId, path);
-
-        if (m_messageFormatter) {
-          wxFileName fn(path);
-          m_messageFormatter->AppendServiceMessage(
-              GetCurrentTimestamp(), "Uploading 📷 " + fn.GetFullName());
-        }
-      }
-    }
+    // Stage like a drop: uploads start now, Enter sends with a caption
+    m_mainFrame->OnFilesDropped(paths);
   }
 }
 
@@ -202,18 +193,8 @@ void InputBoxWidget::OnUploadVideo(wxCommandEvent &event) {
     wxArrayString paths;
     dlg.GetPaths(paths);
 
-    TelegramClient *client = m_mainFrame->GetTelegramClient();
-    if (client && client->IsLoggedIn()) {
-      for (const wxString &path : paths) {
-        client->SendFile(chatId, path);
-
-        if (m_messageFormatter) {
-          wxFileName fn(path);
-          m_messageFormatter->AppendServiceMessage(
-              GetCurrentTimestamp(), "Uploading 🎬 " + fn.GetFullName());
-        }
-      }
-    }
+    // Stage like a drop: uploads start now, Enter sends with a caption
+    m_mainFrame->OnFilesDropped(paths);
   }
 }
 
@@ -243,18 +224,8 @@ void InputBoxWidget::OnUploadFile(wxCommandEvent &event) {
     wxArrayString paths;
     dlg.GetPaths(paths);
 
-    TelegramClient *client = m_mainFrame->GetTelegramClient();
-    if (client && client->IsLoggedIn()) {
-      for (const wxString &path : paths) {
-        client->SendFile(chatId, path);
-
-        if (m_messageFormatter) {
-          wxFileName fn(path);
-          m_messageFormatter->AppendServiceMessage(
-              GetCurrentTimestamp(), "Uploading 📎 " + fn.GetFullName());
-        }
-      }
-    }
+    // Stage like a drop: uploads start now, Enter sends with a caption
+    m_mainFrame->OnFilesDropped(paths);
   }
 }
 
@@ -448,7 +419,7 @@ void InputBoxWidget::ClearHistory() {
 
 void InputBoxWidget::ResetTabCompletion() {
   m_tabCompletionActive = false;
-  m_tabCompletionPrefix.Clear();
+  m_tabCompletionMatches.clear();
   m_tabCompletionIndex = 0;
 }
 
@@ -458,11 +429,23 @@ wxString InputBoxWidget::GetCurrentTimestamp() const {
 }
 
 void InputBoxWidget::OnTextEnter(wxCommandEvent &event) {
-  if (m_showingPlaceholder) {
+  wxString message = m_showingPlaceholder ? wxString() : m_inputBox->GetText();
+
+  // Staged attachments: the input text (possibly empty) is their caption
+  if (m_mainFrame && m_mainFrame->HasPendingAttachments() &&
+      !message.StartsWith("/")) {
+    if (!message.IsEmpty()) {
+      AddToHistory(message);
+    }
+    m_mainFrame->SendPendingAttachments(message);
+    m_inputBox->ClearAll();
+    UpdatePlaceholder();
+    if (m_chatView) {
+      m_chatView->ForceScrollToBottom();
+    }
     return;
   }
 
-  wxString message = m_inputBox->GetText();
   if (message.IsEmpty()) {
     return;
   }
@@ -531,6 +514,13 @@ void InputBoxWidget::OnKeyDown(wxKeyEvent &event) {
     }
   }
 
+  // Esc drops files staged for sending
+  if (keyCode == WXK_ESCAPE && m_mainFrame &&
+      m_mainFrame->HasPendingAttachments()) {
+    m_mainFrame->DiscardPendingAttachments();
+    return;
+  }
+
   // Check for Ctrl+U (upload menu)
   if (event.ControlDown() && !event.ShiftDown() && keyCode == 'U') {
     if (m_uploadBtn && m_uploadBtn->IsEnabled()) {
@@ -615,6 +605,9 @@ bool InputBoxWidget::ProcessCommand(const wxString &command) {
   } else if (cmd == "back") {
     ProcessBackCommand();
     return true;
+  } else if (cmd == "archive") {
+    ProcessArchiveCommand(args);
+    return true;
   } else if (cmd == "help") {
     ProcessHelpCommand();
     return true;
@@ -743,6 +736,21 @@ void InputBoxWidget::ProcessBackCommand() {
   }
 }
 
+void InputBoxWidget::ProcessArchiveCommand(const wxString &args) {
+  if (!m_mainFrame)
+    return;
+
+  // /archive [all|photos|videos|docs|audio|voice|gifs ...] | cancel
+  // MainFrame asks for the target directory and reports progress
+  wxString spec = args;
+  spec.Trim().Trim(false);
+  if (spec.Lower() == "cancel" || spec.Lower() == "stop") {
+    m_mainFrame->CancelMediaExport();
+  } else {
+    m_mainFrame->StartMediaExport(spec);
+  }
+}
+
 void InputBoxWidget::ProcessHelpCommand() {
   if (!m_messageFormatter)
     return;
@@ -755,6 +763,9 @@ void InputBoxWidget::ProcessHelpCommand() {
   helpText += "  /msg <user> <text> - Send private message\n";
   helpText += "  /whois <user>      - View user info\n";
   helpText += "  /leave             - Leave current chat\n";
+  helpText += "  /archive [type]    - Save all media of this chat to disk\n";
+  helpText += "                       (photos videos docs audio voice gifs)\n";
+  helpText += "  /archive cancel    - Stop a running archive\n";
 
   helpText += "  /help              - Show this help";
   
@@ -791,72 +802,59 @@ void InputBoxWidget::NavigateHistoryDown() {
 }
 
 void InputBoxWidget::DoTabCompletion() {
-  if (!m_inputBox || !m_memberList)
+  if (!m_inputBox || !m_nickIndex)
     return;
 
   wxString text = m_inputBox->GetText();
-  long insertionPoint = m_inputBox->GetCurrentPos();
-
-  // Find the word being completed
-  long wordStart = insertionPoint;
-  while (wordStart > 0 && text[wordStart - 1] != ' ') {
-    wordStart--;
-  }
-  wxString prefix = text.Mid(wordStart, insertionPoint - wordStart);
-
-  if (prefix.IsEmpty()) {
-    return;
-  }
+  // Scintilla positions are UTF-8 byte offsets; the wxString is characters
+  long insertionPoint =
+      m_inputBox->CountCharacters(0, m_inputBox->GetCurrentPos());
+
+  // Tab again right after a completion replaces it with the next match
+  // (HexChat style); anything else starts a new completion
+  long replaceStart;
+  if (m_tabCompletionActive && !m_tabCompletionMatches.empty() &&
+      insertionPoint == m_tabCompletionEnd) {
+    replaceStart = m_tabCompletionStart;
+    m_tabCompletionIndex =
+        (m_tabCompletionIndex + 1) % m_tabCompletionMatches.size();
+  } else {
+    // Find the word being completed
+    long wordStart = insertionPoint;
+    while (wordStart > 0 && text[wordStart - 1] != ' ') {
+      wordStart--;
+    }
+    wxString prefix = text.Mid(wordStart, insertionPoint - wordStart);
 
-  // Build list of matching members
-  wxArrayString matches = GetMatchingMembers(prefix);
+    if (prefix.IsEmpty()) {
+      return;
+    }
 
-  if (matches.IsEmpty()) {
-    return;
-  }
+    std::vector<wxString> matches =
+        m_nickIndex->Complete(prefix, MAX_TAB_COMPLETIONS);
+    if (matches.empty()) {
+      return;
+    }
 
-  // Cycle through matches
-  if (!m_tabCompletionActive || m_tabCompletionPrefix != prefix) {
-    m_tabCompletionPrefix = prefix;
+    m_tabCompletionMatches = std::move(matches);
     m_tabCompletionIndex = 0;
+    m_tabCompletionStart = wordStart;
     m_tabCompletionActive = true;
-  } else {
-    m_tabCompletionIndex = (m_tabCompletionIndex + 1) % matches.size();
+    replaceStart = wordStart;
   }
 
-  // Replace the prefix with the match
-  wxString completion = matches[m_tabCompletionIndex];
+  // Replace the prefix (or the previous completion) with the match
+  wxString completion = m_tabCompletionMatches[m_tabCompletionIndex];
   // Add ": " if at start of line (HexChat style)
-  if (wordStart == 0) {
+  if (replaceStart == 0) {
     completion += ": ";
   }
 
   wxString newText =
-      text.Left(wordStart) + completion + text.Mid(insertionPoint);
+      text.Left(replaceStart) + completion + text.Mid(insertionPoint);
+  m_tabCompletionEnd = replaceStart + static_cast<long>(completion.length());
   m_inputBox->SetText(newText);
-  m_inputBox->GotoPos(wordStart + completion.length());
-}
-
-wxArrayString InputBoxWidget::GetMatchingMembers(const wxString &prefix) {
-  wxArrayString matches;
-
-  if (!m_memberList)
-    return matches;
-
-  int memberCount = m_memberList->GetItemCount();
-  for (int i = 0; i < memberCount; i++) {
-    wxString memberName = m_memberList->GetItemText(i);
-    // Remove role suffix if present (e.g., "User (Admin)")
-    int parenPos = memberName.Find(" (");
-    if (parenPos != wxNOT_FOUND) {
-      memberName = memberName.Left(parenPos);
-    }
-    if (memberName.Lower().StartsWith(prefix.Lower())) {
-      matches.Add(memberName);
-    }
-  }
-
-  return matches;
+  m_inputBox->GotoPos(m_inputBox->PositionRelative(0, m_tabCompletionEnd));
 }
 
 void InputBoxWidget::HandleClipboardPaste() {
@@ -12,7 +12,7 @@ class MainFrame;
 class ChatViewWidget;
 class MessageFormatter;
 class WelcomeChat;
-class wxListCtrl;
+class NickIndex;
 
 class InputBoxWidget : public wxPanel
 {
@@ -35,8 +35,11 @@ public:
     // Chat view connection (for scrolling with PageUp/Down)
     void SetChatView(ChatViewWidget* chatView) { m_chatView = chatView; }
     
-    // Member list connection (for tab completion)
-    void SetMemberList(wxListCtrl* memberList) { m_memberList = memberList; }
+    // Names of the current chat (for tab completion); nullptr disables it
+    void SetNickIndex(NickIndex* nickIndex) {
+        m_nickIndex = nickIndex;
+        ResetTabCompletion();
+    }
     
     // Message formatter connection (for service messages)
     void SetMessageFormatter(MessageFormatter* formatter) { m_messageFormatter = formatter; }
@@ -88,6 +91,7 @@ private:
     void ProcessWhoisCommand(const wxString& args);
     void ProcessAwayCommand(const wxString& args);
     void ProcessBackCommand();
+    void ProcessArchiveCommand(const wxString& args);
     void ProcessHelpCommand();
     
     // History navigation
@@ -96,7 +100,6 @@ private:
     
     // Tab completion
     void DoTabCompletion();
-    wxArrayString GetMatchingMembers(const wxString& prefix);
     
     // Clipboard handling
     void HandleClipboardPaste();
@@ -106,7 +109,7 @@ private:
     
     MainFrame* m_mainFrame;
     ChatViewWidget* m_chatView;
-    wxListCtrl* m_memberList;
+    NickIndex* m_nickIndex;
     MessageFormatter* m_messageFormatter;
     WelcomeChat* m_welcomeChat;
     wxStyledTextCtrl* m_inputBox;
@@ -123,9 +126,12 @@ private:
     static const size_t MAX_HISTORY_SIZE = 100;
     
     // Tab completion state
-    wxString m_tabCompletionPrefix;
+    std::vector<wxString> m_tabCompletionMatches;
     size_t m_tabCompletionIndex;
+    long m_tabCompletionStart; // Characters, not Scintilla positions
+    long m_tabCompletionEnd;
     bool m_tabCompletionActive;
+    static const size_t MAX_TAB_COMPLETIONS = 64;
     
     // Colors
     wxColour m_bgColor;
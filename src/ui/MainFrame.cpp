@@ -8,18 +8,25 @@
 #include <windows.h>
 #include <dwmapi.h>
 #endif
+#include "../telegram/MediaExportJob.h"
 #include "../telegram/TelegramClient.h"
 #include "../telegram/Types.h"
 #include "ChatListWidget.h"
 #include "ChatViewWidget.h"
 #include "FileDropTarget.h"
+#include "FileUtils.h"
+#include "ImageTransformPool.h"
 #include "InputBoxWidget.h"
 #include "MediaPopup.h"
+#include "MemberListCtrl.h"
 #include "MessageFormatter.h"
+#include "QuickSwitcher.h"
+#include "SearchDialog.h"
 #include "WelcomeChat.h"
 #include <ctime>
 #include <wx/artprov.h>
 #include <wx/config.h>
+#include <wx/dirdlg.h>
 #include <wx/file.h>
 #include <wx/filename.h>
 #include <wx/fontpicker.h>
@@ -106,6 +113,9 @@ wxBEGIN_EVENT_TABLE(MainFrame, wxFrame) EVT_MENU(
                                                         ID_DOCUMENTATION,
                                                         MainFrame::
                                                             OnDocumentation)
+    EVT_MENU(ID_FIND_IN_CHAT, MainFrame::OnFindInChat)
+    EVT_MENU(ID_JUMP_TO_DATE, MainFrame::OnJumpToDate)
+    EVT_MENU(ID_QUICK_SWITCHER, MainFrame::OnQuickSwitcher)
     EVT_MENU(ID_THEME_LIGHT, MainFrame::OnThemeLight)
     EVT_MENU(ID_THEME_DARK, MainFrame::OnThemeDark)
     EVT_MENU(ID_THEME_SYSTEM, MainFrame::OnThemeSystem)
@@ -167,15 +177,32 @@ wxBEGIN_EVENT_TABLE(MainFrame, wxFrame) EVT_MENU(
     m_welcomeChat->SetTelegramClient(m_telegramClient);
   }
 
+  // Fill the caches from the last session's snapshot so the chat list can
+  // be drawn before TDLib has even opened its database
+  int64_t warmChatId = 0;
+  bool warmStarted = m_telegramClient->LoadWarmSnapshot(&warmChatId);
+
   // Start TDLib immediately in background so it's ready when user wants to
   // login
   m_telegramClient->Start();
 
+  if (warmStarted) {
+    RefreshChatList();
+    if (warmChatId != 0 && m_chatListWidget &&
+        m_chatListWidget->SelectChat(warmChatId)) {
+      // Cached tail now; the server history merges in once authorized
+      OnMessagesLoaded(warmChatId,
+                       m_telegramClient->GetCachedMessages(warmChatId));
+    }
+  }
+
   // Load saved preferences
   wxConfigBase *config = wxConfigBase::Get();
   if (config) {
     bool sendReadReceipts = config->ReadBool("/Privacy/SendReadReceipts", true);
     m_telegramClient->SetSendReadReceipts(sendReadReceipts);
+    m_compressPhotos = config->ReadBool("/Uploads/CompressPhotos", false);
+    m_compressPhotosAsWebP = config->ReadBool("/Uploads/CompressToWebP", false);
   }
 
   // Connect status bar to telegram client
@@ -261,6 +288,10 @@ wxBEGIN_EVENT_TABLE(MainFrame, wxFrame) EVT_MENU(
     }
   }, ID_CHATLIST_REFRESH_TIMER);
 
+  m_prefetchTimer = new wxTimer(this, ID_PREFETCH_TIMER);
+  Bind(wxEVT_TIMER, [this](wxTimerEvent &) { StartPrefetch(); },
+       ID_PREFETCH_TIMER);
+
   // Ensure welcome chat is visible on startup
   if (m_welcomeChat && m_chatPanel) {
     wxSizer *sizer = m_chatPanel->GetSizer();
@@ -281,6 +312,11 @@ MainFrame::~MainFrame() {
     delete m_chatListRefreshTimer;
     m_chatListRefreshTimer = nullptr;
   }
+  if (m_prefetchTimer) {
+    m_prefetchTimer->Stop();
+    delete m_prefetchTimer;
+    m_prefetchTimer = nullptr;
+  }
   if (m_serviceLog) {
     m_serviceLog->Stop();
     delete m_serviceLog;
@@ -299,7 +335,12 @@ MainFrame::~MainFrame() {
     m_refreshTimer = nullptr;
   }
 
+  // Joins the export thread; must go before the client it polls
+  m_mediaExportJob.reset();
+  m_imageTransformPool.reset();
+
   if (m_telegramClient) {
+    m_telegramClient->SaveWarmSnapshot();
     m_telegramClient->Stop();
     delete m_telegramClient;
     m_telegramClient = nullptr;
@@ -514,7 +555,7 @@ void MainFrame::CreateMenuBar() {
   m_menuTelegram->Append(ID_NEW_CHANNEL, "New Channel...");
   m_menuTelegram->AppendSeparator();
   m_menuTelegram->Append(ID_CONTACTS, "Contacts...\tCtrl+Shift+C");
-  m_menuTelegram->Append(ID_SEARCH, "Search...\tCtrl+F");
+  m_menuTelegram->Append(ID_SEARCH, "Search...\tCtrl+Shift+F");
   m_menuTelegram->AppendSeparator();
   m_menuTelegram->Append(ID_SAVED_MESSAGES, "Saved Messages");
   m_menuTelegram->AppendSeparator();
@@ -527,6 +568,8 @@ void MainFrame::CreateMenuBar() {
   m_menuEdit->Append(wxID_COPY, "Copy\tCtrl+C");
   m_menuEdit->Append(wxID_PASTE, "Paste\tCtrl+V");
   m_menuEdit->AppendSeparator();
+  m_menuEdit->Append(ID_FIND_IN_CHAT, "Find in Chat...\tCtrl+F");
+  m_menuEdit->Append(ID_JUMP_TO_DATE, "Jump to Date...\tCtrl+J");
   m_menuEdit->Append(ID_CLEAR_WINDOW, "Clear Chat Window\tCtrl+Shift+L");
   m_menuEdit->AppendSeparator();
   m_menuEdit->Append(ID_PREFERENCES, "Preferences\tCtrl+E");
@@ -571,6 +614,8 @@ void MainFrame::CreateMenuBar() {
   m_menuWindow->Append(ID_NEXT_CHAT, "Next Chat\tCtrl+PgDn");
   m_menuWindow->AppendSeparator();
   m_menuWindow->Append(ID_CLOSE_CHAT, "Close Chat\tCtrl+W");
+  m_menuWindow->AppendSeparator();
+  m_menuWindow->Append(ID_QUICK_SWITCHER, "Quick Switcher...\tCtrl+K");
   // menuBar->Append(m_menuWindow, "&Window");
 
   // Help menu
@@ -728,15 +773,10 @@ void MainFrame::CreateMemberList(wxWindow *parent) {
   wxBoxSizer *sizer = new wxBoxSizer(wxVERTICAL);
 
   // Member list with theme colors
-  m_memberList =
-      new wxListCtrl(parent, ID_MEMBER_LIST, wxDefaultPosition, wxDefaultSize,
-                     wxLC_REPORT | wxLC_SINGLE_SEL | wxLC_NO_HEADER);
+  m_memberList = new MemberListCtrl(parent, ID_MEMBER_LIST);
   m_memberList->SetBackgroundColour(colors.listBg);
   m_memberList->SetForegroundColour(colors.listFg);
 
-  // Single column for usernames
-  m_memberList->InsertColumn(0, "Members", wxLIST_FORMAT_LEFT, 120);
-
   sizer->Add(m_memberList, 1, wxEXPAND);
 
   // Member count at bottom with theme colors
@@ -746,9 +786,7 @@ void MainFrame::CreateMemberList(wxWindow *parent) {
 
   parent->SetSizer(sizer);
 
-  // Now connect the member list to the input box widget for tab completion
   if (m_inputBoxWidget) {
-    m_inputBoxWidget->SetMemberList(m_memberList);
     if (m_chatViewWidget) {
       m_inputBoxWidget->SetMessageFormatter(
           m_chatViewWidget->GetMessageFormatter());
@@ -758,19 +796,21 @@ void MainFrame::CreateMemberList(wxWindow *parent) {
 
 void MainFrame::PopulateDummyData() {
   // Add sample members (for a group chat)
-  long idx = 0;
-  m_memberList->InsertItem(idx++, "Admin (owner)");
-  m_memberList->InsertItem(idx++, "Moderator (admin)");
-  m_memberList->InsertItem(idx++, "Alice");
-  m_memberList->InsertItem(idx++, "Bob");
-  m_memberList->InsertItem(idx++, "Charlie");
-  m_memberList->InsertItem(idx++, "David");
-  m_memberList->InsertItem(idx++, "Eve");
-  m_memberList->InsertItem(idx++, "Frank");
-  m_memberList->InsertItem(idx++, "Grace");
-  m_memberList->InsertItem(idx++, "Henry");
-
-  m_memberCountLabel->SetLabel(wxString::Format("%ld members", idx));
+  wxArrayString dummyMembers;
+  dummyMembers.Add("Admin (owner)");
+  dummyMembers.Add("Moderator (admin)");
+  dummyMembers.Add("Alice");
+  dummyMembers.Add("Bob");
+  dummyMembers.Add("Charlie");
+  dummyMembers.Add("David");
+  dummyMembers.Add("Eve");
+  dummyMembers.Add("Frank");
+  dummyMembers.Add("Grace");
+  dummyMembers.Add("Henry");
+  m_memberList->SetPlaceholderRows(dummyMembers);
+
+  m_memberCountLabel->SetLabel(
+      wxString::Format("%zu members", dummyMembers.GetCount()));
 
   // Set chat info
   m_currentChatTitle = "Test Chat - Media Demo";
@@ -966,28 +1006,180 @@ void MainFrame::OnFilesDropped(const wxArrayString &files) {
     return;
   }
 
+  // Attachments belong to one chat - a drop into another chat replaces them
+  if (m_pendingAttachmentsChatId != m_currentChatId) {
+    DiscardPendingAttachments();
+  }
+  m_pendingAttachmentsChatId = m_currentChatId;
+
+  wxString names;
   for (const auto &file : files) {
-    // Start upload with transfer manager for progress tracking
     wxFile wxf(file);
     int64_t fileSize = wxf.IsOpened() ? wxf.Length() : 0;
     wxf.Close();
-    int transferId = m_transferManager.StartUpload(file, fileSize);
 
-    // Actually send the file via TDLib
-    // TelegramClient::SendFile automatically detects media type based on
-    // extension and sends as photo, video, audio, or document accordingly
-    m_telegramClient->SendFile(m_currentChatId, file, "");
+    wxString fileName = wxFileName(file).GetFullName();
+
+    if (m_compressPhotos && ImageTransformPool::IsCandidate(file)) {
+      // Shrink the photo on the worker pool first; the upload is queued from
+      // OnImageTransformed with whichever file came out smaller
+      if (!m_imageTransformPool) {
+        m_imageTransformPool = std::make_unique<ImageTransformPool>();
+        m_imageTransformPool->SetResultCallback(
+            [this](const ImageTransformResult &result) {
+              OnImageTransformed(result);
+            });
+      }
+
+      ImageTransformOptions options;
+      options.preferWebP = m_compressPhotosAsWebP;
+      int transformId = m_imageTransformPool->Submit(file, options);
+      int transferId = m_transferManager.StartUpload(file, fileSize);
+      m_transferManager.SetPhase(transferId, TransferPhase::Transform);
+
+      TransformingUpload transforming;
+      transforming.transferId = transferId;
+      transforming.fileName = fileName;
+      m_transformingUploads[transformId] = transforming;
+      m_pendingAttachments.push_back({0, transformId, fileName});
+    } else {
+      // Upload in the background while the user writes the caption; the
+      // transfer shows as queued until TelegramClient gives it a slot
+      int uploadId = m_telegramClient->QueueUpload(file);
+      int transferId = m_transferManager.StartUpload(file, fileSize, true);
+      m_uploadToTransferId[uploadId] = transferId;
+      m_pendingAttachments.push_back({uploadId, 0, fileName});
+    }
+
+    if (m_serviceLog) {
+      m_serviceLog->LogUploadStarted(fileName, fileSize);
+    }
+
+    if (!names.IsEmpty()) {
+      names += ", ";
+    }
+    names += fileName;
+  }
+
+  if (m_chatViewWidget && m_chatViewWidget->GetMessageFormatter()) {
+    m_chatViewWidget->GetMessageFormatter()->AppendServiceMessage(
+        wxDateTime::Now().Format("%H:%M:%S"),
+        wxString::Format("Attached %s - type a caption and press Enter to "
+                         "send, Esc to discard",
+                         names));
+    m_chatViewWidget->ScrollToBottom();
+  }
+
+  if (m_inputBoxWidget) {
+    m_inputBoxWidget->SetFocus();
+  }
+}
 
-    // Mark transfer as complete (actual progress tracking would require
-    // hooking into TDLib's updateFile events for uploads)
-    m_transferManager.CompleteTransfer(transferId, file);
+void MainFrame::SendPendingAttachments(const wxString &caption) {
+  if (m_pendingAttachments.empty() || !m_telegramClient) {
+    return;
+  }
+
+  // The caption goes with the first file, like a regular album
+  bool first = true;
+  for (const auto &attachment : m_pendingAttachments) {
+    m_sendQueue.push_back({m_pendingAttachmentsChatId, attachment.uploadId,
+                           attachment.transformId,
+                           first ? caption : wxString()});
+    first = false;
   }
+  m_pendingAttachments.clear();
+  FlushSendQueue();
 
   if (m_chatViewWidget) {
     m_chatViewWidget->ScrollToBottom();
   }
 }
 
+void MainFrame::FlushSendQueue() {
+  // Files still compressing hold back the ones after them;
+  // OnImageTransformed flushes again once they are ready
+  while (!m_sendQueue.empty() && m_sendQueue.front().uploadId != 0) {
+    const QueuedSend &send = m_sendQueue.front();
+    if (m_telegramClient) {
+      m_telegramClient->SendUploadedFile(send.chatId, send.uploadId,
+                                         send.caption);
+    }
+    m_sendQueue.pop_front();
+  }
+}
+
+void MainFrame::DiscardPendingAttachments() {
+  if (m_pendingAttachments.empty()) {
+    return;
+  }
+
+  for (const auto &attachment : m_pendingAttachments) {
+    if (attachment.uploadId == 0) {
+      auto it = m_transformingUploads.find(attachment.transformId);
+      if (it != m_transformingUploads.end()) {
+        m_transferManager.CancelTransfer(it->second.transferId);
+        m_transformingUploads.erase(it);
+      }
+      if (m_imageTransformPool) {
+        m_imageTransformPool->Cancel(attachment.transformId);
+      }
+    } else if (m_telegramClient) {
+      m_telegramClient->CancelUpload(attachment.uploadId);
+    }
+  }
+  size_t count = m_pendingAttachments.size();
+  m_pendingAttachments.clear();
+
+  if (m_chatViewWidget && m_chatViewWidget->GetMessageFormatter()) {
+    m_chatViewWidget->GetMessageFormatter()->AppendServiceMessage(
+        wxDateTime::Now().Format("%H:%M:%S"),
+        wxString::Format("Discarded %zu attachment%s", count,
+                         count == 1 ? "" : "s"));
+  }
+}
+
+void MainFrame::OnImageTransformed(const ImageTransformResult &result) {
+  auto it = m_transformingUploads.find(result.jobId);
+  if (it == m_transformingUploads.end() || !m_telegramClient) {
+    return; // Discarded while compressing
+  }
+  TransformingUpload transforming = it->second;
+  m_transformingUploads.erase(it);
+
+  int uploadId = m_telegramClient->QueueUpload(result.outputPath);
+  m_uploadToTransferId[uploadId] = transforming.transferId;
+  m_transferManager.SetPhase(transforming.transferId, TransferPhase::Transfer,
+                             result.outputBytes, result.GetSavedBytes());
+
+  if (result.transformed && m_chatViewWidget &&
+      m_chatViewWidget->GetMessageFormatter()) {
+    m_chatViewWidget->GetMessageFormatter()->AppendServiceMessage(
+        wxDateTime::Now().Format("%H:%M:%S"),
+        wxString::Format(
+            "Compressed %s: %s -> %s (saved %s)", transforming.fileName,
+            FormatFileSize(static_cast<wxULongLong_t>(result.originalBytes)),
+            FormatFileSize(static_cast<wxULongLong_t>(result.outputBytes)),
+            FormatFileSize(
+                static_cast<wxULongLong_t>(result.GetSavedBytes()))));
+  }
+
+  for (auto &send : m_sendQueue) {
+    if (send.transformId == result.jobId) {
+      send.uploadId = uploadId;
+      FlushSendQueue();
+      return;
+    }
+  }
+
+  for (auto &attachment : m_pendingAttachments) {
+    if (attachment.transformId == result.jobId) {
+      attachment.uploadId = uploadId;
+      break;
+    }
+  }
+}
+
 void MainFrame::OnUploadFile(wxCommandEvent &event) {
   wxFileDialog dialog(
       this, "Select file to upload", "", "",
@@ -1244,46 +1436,152 @@ void MainFrame::OnSearch(wxCommandEvent &event) {
     return;
   }
 
-  wxDialog dialog(this, wxID_ANY, "Search", wxDefaultPosition,
-                  wxSize(500, 400));
-  wxBoxSizer *sizer = new wxBoxSizer(wxVERTICAL);
+  SearchDialog dialog(this, m_telegramClient, m_currentChatId,
+                      m_currentChatTitle);
+  dialog.ShowModal();
+}
 
-  wxBoxSizer *searchSizer = new wxBoxSizer(wxHORIZONTAL);
-  wxSearchCtrl *searchBox = new wxSearchCtrl(
-      &dialog, wxID_ANY, "", wxDefaultPosition, wxSize(400, -1));
-  searchBox->SetHint("Search chats and messages...");
-  searchSizer->Add(searchBox, 1, wxRIGHT, 5);
-  wxButton *searchBtn = new wxButton(&dialog, wxID_FIND, "Search");
-  searchSizer->Add(searchBtn, 0);
-  sizer->Add(searchSizer, 0, wxALL | wxEXPAND, 10);
-
-  wxListCtrl *resultList =
-      new wxListCtrl(&dialog, wxID_ANY, wxDefaultPosition, wxSize(460, 250),
-                     wxLC_REPORT | wxLC_SINGLE_SEL);
-  resultList->AppendColumn("Chat", wxLIST_FORMAT_LEFT, 150);
-  resultList->AppendColumn("Message", wxLIST_FORMAT_LEFT, 290);
-  sizer->Add(resultList, 1, wxALL | wxEXPAND, 10);
+void MainFrame::OnFindInChat(wxCommandEvent &event) {
+  if (m_currentChatId == 0 || !m_chatViewWidget ||
+      !m_chatViewWidget->IsShown()) {
+    return;
+  }
+  m_chatViewWidget->ShowFindBar();
+}
 
-  wxButton *closeBtn = new wxButton(&dialog, wxID_CANCEL, "Close");
-  sizer->Add(closeBtn, 0, wxALIGN_CENTER | wxBOTTOM, 10);
+void MainFrame::OnJumpToDate(wxCommandEvent &event) {
+  if (m_currentChatId == 0 || !m_telegramClient || !m_chatViewWidget ||
+      !m_chatViewWidget->IsShown()) {
+    return;
+  }
 
-  dialog.SetSizer(sizer);
+  wxString input =
+      wxGetTextFromUser("Jump to messages from (YYYY-MM-DD):",
+                        "Jump to Date",
+                        wxDateTime::Today().FormatISODate(), this);
+  input.Trim(true).Trim(false);
+  if (input.IsEmpty()) {
+    return;
+  }
 
-  // Filter chats as user types
-  if (m_telegramClient) {
-    auto chats = m_telegramClient->GetChats();
-    for (const auto &pair : chats) {
-      resultList->InsertItem(resultList->GetItemCount(), pair.second.title);
-      if (!pair.second.lastMessage.IsEmpty()) {
-        wxString preview = pair.second.lastMessage;
-        if (preview.Length() > 50)
-          preview = preview.Left(47) + "...";
-        resultList->SetItem(resultList->GetItemCount() - 1, 1, preview);
-      }
+  wxDateTime date;
+  if (!date.ParseISODate(input)) {
+    ShowStatusError("Invalid date: " + input + " (expected YYYY-MM-DD)");
+    return;
+  }
+
+  // Midnight local time: the window centres on the last message before the
+  // day, so the day's first messages sit right below it
+  m_pendingJumpChatId = 0;
+  m_pendingJumpMessageId = 0;
+  m_telegramClient->LoadMessagesAroundDate(m_currentChatId, date.GetTicks());
+}
+
+void MainFrame::OnQuickSwitcher(wxCommandEvent &event) {
+  if (!m_isLoggedIn || !m_telegramClient) {
+    return;
+  }
+
+  uint64_t version = m_telegramClient->GetDirectoryVersion();
+  if (!m_quickSwitchIndexBuilt || version != m_quickSwitchVersion) {
+    m_quickSwitchIndex.Build(m_telegramClient->GetChats(),
+                             m_telegramClient->GetUsers());
+    m_quickSwitchVersion = version;
+    m_quickSwitchIndexBuilt = true;
+  }
+
+  QuickSwitcherDialog dialog(this, m_quickSwitchIndex);
+  if (dialog.ShowModal() != wxID_OK) {
+    return;
+  }
+  const QuickSwitchEntry *entry = dialog.GetSelectedEntry();
+  if (!entry) {
+    return;
+  }
+
+  if (entry->chatId != 0) {
+    SwitchToChat(entry->chatId);
+    return;
+  }
+
+  // A user we have never talked to - open the private chat first
+  wxString name = entry->title;
+  m_telegramClient->CreatePrivateChat(
+      entry->userId,
+      [this, name](bool success, int64_t chatId, const wxString &error) {
+        if (success) {
+          SwitchToChat(chatId);
+        } else if (m_chatViewWidget &&
+                   m_chatViewWidget->GetMessageFormatter()) {
+          m_chatViewWidget->GetMessageFormatter()->AppendServiceMessage(
+              wxDateTime::Now().Format("%H:%M:%S"),
+              "Could not open chat with " + name + ": " + error);
+        }
+      });
+}
+
+void MainFrame::SwitchToChat(int64_t chatId) {
+  if (!m_chatListWidget || chatId == 0) {
+    return;
+  }
+  if (m_chatListWidget->SelectChat(chatId)) {
+    return;
+  }
+  // Hidden by the chat list filter, or not in the tree yet
+  m_chatListWidget->ClearSearch();
+  if (!m_chatListWidget->SelectChat(chatId)) {
+    m_pendingSwitchChatId = chatId;
+    ScheduleChatListRefresh();
+  }
+}
+
+void MainFrame::JumpToMessage(int64_t chatId, int64_t messageId) {
+  if (chatId == 0) {
+    return;
+  }
+
+  m_pendingJumpChatId = messageId != 0 ? chatId : 0;
+  m_pendingJumpMessageId = messageId;
+
+  if (chatId != m_currentChatId) {
+    // Opening the chat loads its history; the jump resolves from there
+    if (m_chatListWidget) {
+      m_chatListWidget->SelectChat(chatId);
     }
+    return;
   }
+  ResolvePendingJump();
+}
 
-  dialog.ShowModal();
+void MainFrame::ResolvePendingJump() {
+  if (m_pendingJumpMessageId == 0 || m_pendingJumpChatId != m_currentChatId ||
+      !m_chatViewWidget) {
+    return;
+  }
+
+  if (m_chatViewWidget->ScrollToMessage(m_pendingJumpMessageId)) {
+    m_pendingJumpChatId = 0;
+    m_pendingJumpMessageId = 0;
+    return;
+  }
+
+  // Not on screen - load a window around it instead of paging the whole
+  // history in between. OnHistoryWindowLoaded finishes the jump.
+  if (m_telegramClient) {
+    m_telegramClient->LoadMessagesAround(m_currentChatId,
+                                         m_pendingJumpMessageId);
+  }
+}
+
+void MainFrame::JumpToLatest() {
+  if (m_currentChatId == 0 || !m_telegramClient || !m_chatViewWidget) {
+    return;
+  }
+  m_pendingJumpChatId = 0;
+  m_pendingJumpMessageId = 0;
+  m_chatViewWidget->ClearMessages();
+  m_chatViewWidget->SetHasMoreMessages(true);
+  m_telegramClient->OpenChatAndLoadMessages(m_currentChatId);
 }
 
 void MainFrame::OnSavedMessages(wxCommandEvent &event) {
@@ -1403,6 +1701,30 @@ void MainFrame::OnPreferences(wxCommandEvent &event) {
 
   mainSizer->Add(privacySizer, 0, wxEXPAND | wxLEFT | wxRIGHT | wxBOTTOM, 10);
 
+  // Uploads section
+  wxStaticBoxSizer *uploadsSizer =
+      new wxStaticBoxSizer(wxVERTICAL, &dialog, "Uploads");
+
+  // Off unless chosen: it re-encodes the user's photos
+  wxCheckBox *compressPhotosCheckbox = new wxCheckBox(
+      &dialog, wxID_ANY,
+      "Compress and resize photos before sending (re-encodes them and "
+      "strips metadata)");
+  compressPhotosCheckbox->SetValue(m_compressPhotos);
+  uploadsSizer->Add(compressPhotosCheckbox, 0, wxLEFT | wxRIGHT | wxTOP, 10);
+
+  wxCheckBox *webpCheckbox =
+      new wxCheckBox(&dialog, wxID_ANY, "Encode compressed photos as WebP");
+  webpCheckbox->SetValue(m_compressPhotosAsWebP && HasWebPSupport());
+  webpCheckbox->Enable(m_compressPhotos && HasWebPSupport());
+  compressPhotosCheckbox->Bind(
+      wxEVT_CHECKBOX, [webpCheckbox](wxCommandEvent &event) {
+        webpCheckbox->Enable(event.IsChecked() && HasWebPSupport());
+      });
+  uploadsSizer->Add(webpCheckbox, 0, wxALL, 10);
+
+  mainSizer->Add(uploadsSizer, 0, wxEXPAND | wxLEFT | wxRIGHT | wxBOTTOM, 10);
+
   // Buttons
   wxBoxSizer *buttonSizer = new wxBoxSizer(wxHORIZONTAL);
   wxButton *okButton = new wxButton(&dialog, wxID_OK, "OK");
@@ -1417,6 +1739,8 @@ void MainFrame::OnPreferences(wxCommandEvent &event) {
 
   if (dialog.ShowModal() == wxID_OK) {
     bool sendReadReceipts = readReceiptsCheckbox->GetValue();
+    m_compressPhotos = compressPhotosCheckbox->GetValue();
+    m_compressPhotosAsWebP = webpCheckbox->GetValue();
 
     if (m_telegramClient) {
       m_telegramClient->SetSendReadReceipts(sendReadReceipts);
@@ -1481,6 +1805,8 @@ void MainFrame::OnPreferences(wxCommandEvent &event) {
     wxConfigBase *config = wxConfigBase::Get();
     if (config) {
       config->Write("/Privacy/SendReadReceipts", sendReadReceipts);
+      config->Write("/Uploads/CompressPhotos", m_compressPhotos);
+      config->Write("/Uploads/CompressToWebP", m_compressPhotosAsWebP);
 
       // Save fonts
       if (m_chatFont.IsOk()) {
@@ -1873,7 +2199,10 @@ void MainFrame::OnDocumentation(wxCommandEvent &event) {
                     "Ctrl+L        Login\n"
                     "Ctrl+N        New Private Chat\n"
                     "Ctrl+G        New Group\n"
-                    "Ctrl+F        Search\n"
+                    "Ctrl+F        Find in Chat\n"
+                    "Ctrl+J        Jump to Date\n"
+                    "Ctrl+Shift+F  Search\n"
+                    "Ctrl+K        Quick Switcher\n"
                     "Ctrl+U        Upload File\n"
                     "Ctrl+E        Preferences\n"
                     "Ctrl+W        Close Current Chat\n"
@@ -1891,6 +2220,7 @@ void MainFrame::OnDocumentation(wxCommandEvent &event) {
                     "/query <user>    Open private chat\n"
                     "/whois <user>    View user info\n"
                     "/leave           Leave current chat\n"
+                    "/archive [type]  Save all media of a chat to disk\n"
                     "/help            Show available commands\n\n"
                     "PHILOSOPHY\n"
                     "----------\n"
@@ -1921,6 +2251,23 @@ void MainFrame::OnDocumentation(wxCommandEvent &event) {
 void MainFrame::OnCharHook(wxKeyEvent &event) {
   if (event.GetKeyCode() == WXK_ESCAPE && IsFullScreen()) {
     ShowFullScreen(false);
+  } else if (event.ControlDown() && !event.AltDown() &&
+             event.GetKeyCode() == 'F') {
+    // The menus are popups, so their accelerators are handled here
+    wxCommandEvent evt;
+    if (event.ShiftDown()) {
+      OnSearch(evt);
+    } else {
+      OnFindInChat(evt);
+    }
+  } else if (event.ControlDown() && !event.AltDown() && !event.ShiftDown() &&
+             event.GetKeyCode() == 'K') {
+    wxCommandEvent evt;
+    OnQuickSwitcher(evt);
+  } else if (event.ControlDown() && !event.AltDown() && !event.ShiftDown() &&
+             event.GetKeyCode() == 'J') {
+    wxCommandEvent evt;
+    OnJumpToDate(evt);
   } else {
     event.Skip();
   }
@@ -1947,6 +2294,7 @@ void MainFrame::OnChatTreeSelectionChanged(wxTreeEvent &event) {
 
     // Check if Teleliter (welcome) is selected
     if (m_chatListWidget->IsTeleliterSelected()) {
+      DiscardPendingAttachments();
       m_currentChatId = 0;
       // Clear topic bar when going to welcome screen
       if (m_chatViewWidget) {
@@ -1962,7 +2310,7 @@ void MainFrame::OnChatTreeSelectionChanged(wxTreeEvent &event) {
 
       // Clear member panel when on welcome screen
       if (m_memberList) {
-        m_memberList->DeleteAllItems();
+        m_memberList->ClearMembers();
       }
       if (m_memberCountLabel) {
         m_memberCountLabel->SetLabel("");
@@ -1978,6 +2326,7 @@ void MainFrame::OnChatTreeSelectionChanged(wxTreeEvent &event) {
       // Disable upload buttons when no chat selected
       if (m_inputBoxWidget) {
         m_inputBoxWidget->EnableUploadButtons(false);
+        m_inputBoxWidget->SetNickIndex(nullptr);
       }
       return;
     }
@@ -1995,9 +2344,22 @@ void MainFrame::OnChatTreeSelectionChanged(wxTreeEvent &event) {
     int64_t chatId = m_chatListWidget->GetChatIdFromTreeItem(item);
     DBGLOG("Chat ID from tree item: " << chatId);
     if (chatId != 0) {
+      // Staged attachments never follow the user into another chat
+      if (chatId != m_pendingAttachmentsChatId) {
+        DiscardPendingAttachments();
+      }
+      // Nor does a jump meant for another chat
+      if (chatId != m_pendingJumpChatId) {
+        m_pendingJumpChatId = 0;
+        m_pendingJumpMessageId = 0;
+      }
+
       // Update current chat
       m_currentChatId = chatId;
       m_currentChatTitle = chatName;
+      if (m_prefetchTimer) {
+        m_prefetchTimer->Stop();
+      }
 
       // Remove unread indicator from title
       int parenPos = chatName.Find('(');
@@ -2036,6 +2398,12 @@ void MainFrame::OnChatTreeSelectionChanged(wxTreeEvent &event) {
       // Mark chat as read
       m_chatsWithUnread.erase(chatId);
 
+      // Tab completes names from this chat's index, filled as members and
+      // senders arrive
+      if (m_inputBoxWidget) {
+        m_inputBoxWidget->SetNickIndex(&GetNickIndex(chatId));
+      }
+
       // Update member list for this chat
       UpdateMemberList(chatId);
 
@@ -2115,6 +2483,12 @@ void MainFrame::OnChatTreeSelectionChanged(wxTreeEvent &event) {
             }
           }
         });
+        m_chatViewWidget->SetLoadNewerCallback([this,
+                                                chatId](int64_t newestMsgId) {
+          if (m_telegramClient) {
+            m_telegramClient->LoadNewerMessages(chatId, newestMsgId, 50);
+          }
+        });
         m_chatViewWidget->SetHasMoreMessages(true);
         m_chatViewWidget->SetIsLoadingOlder(false);
 
@@ -2181,14 +2555,7 @@ void MainFrame::OnChatTreeItemActivated(wxTreeEvent &event) {
 }
 
 void MainFrame::OnMemberListItemActivated(wxListEvent &event) {
-  long index = event.GetIndex();
-  wxString username = m_memberList->GetItemText(index);
-
-  // Remove role suffix if present
-  int parenPos = username.Find(" (");
-  if (parenPos != wxNOT_FOUND) {
-    username = username.Left(parenPos);
-  }
+  wxString username = m_memberList->GetDisplayName(event.GetIndex());
 
   if (m_chatViewWidget && m_chatViewWidget->GetMessageFormatter()) {
     m_chatViewWidget->GetMessageFormatter()->AppendServiceMessage(
@@ -2281,6 +2648,11 @@ void MainFrame::OnLoggedOut() {
   m_isLoggedIn = false;
   m_currentUser.Clear();
   m_currentChatId = 0;
+  if (m_inputBoxWidget) {
+    m_inputBoxWidget->SetNickIndex(nullptr);
+  }
+  m_nickIndexes.clear();
+  m_nickIndexOrder.clear();
 
   // Log to service message log
   if (m_serviceLog) {
@@ -2381,6 +2753,36 @@ void MainFrame::DoChatListRefresh() {
   RefreshChatList();
 }
 
+void MainFrame::OnWarmSnapshotDiscarded() {
+  // The session needs a new login; nothing from the snapshot may stay on
+  // screen
+  m_currentChatId = 0;
+  if (m_inputBoxWidget) {
+    m_inputBoxWidget->SetNickIndex(nullptr);
+  }
+  m_nickIndexes.clear();
+  m_nickIndexOrder.clear();
+  if (m_chatViewWidget) {
+    m_chatViewWidget->ClearMessages();
+  }
+  if (m_memberList) {
+    m_memberList->ClearMembers();
+  }
+  if (m_chatListWidget) {
+    m_chatListWidget->ClearAllChats();
+  }
+
+  wxSizer *sizer = m_chatPanel->GetSizer();
+  if (sizer) {
+    sizer->Show(m_welcomeChat, true);
+    sizer->Show(m_chatViewWidget, false);
+  }
+  m_chatPanel->Layout();
+  if (m_chatListWidget) {
+    m_chatListWidget->SelectTeleliter();
+  }
+}
+
 void MainFrame::RefreshChatList() {
   if (!m_telegramClient || !m_chatListWidget)
     return;
@@ -2476,6 +2878,11 @@ void MainFrame::RefreshChatList() {
       chatTree->Expand(m_chatListWidget->GetBots());
     }
   }
+
+  if (m_pendingSwitchChatId != 0 &&
+      m_chatListWidget->SelectChat(m_pendingSwitchChatId)) {
+    m_pendingSwitchChatId = 0;
+  }
 }
 
 void MainFrame::OnMessagesLoaded(int64_t chatId,
@@ -2497,6 +2904,11 @@ void MainFrame::OnMessagesLoaded(int64_t chatId,
   // Clear reloading state now that we have fresh messages
   m_chatViewWidget->SetReloading(false);
 
+  NickIndex &nicks = GetNickIndex(chatId);
+  for (const auto &msg : messages) {
+    nicks.AddSender(msg);
+  }
+
   // NOTE: Don't call ClearMessages here - it's already called in
   // OnChatTreeSelectionChanged Calling it again would clear messages that might
   // have arrived via reactive updates
@@ -2520,24 +2932,8 @@ void MainFrame::OnMessagesLoaded(int64_t chatId,
   m_chatViewWidget->DisplayMessages(messages);
   m_chatViewWidget->ForceScrollToBottom();
 
-  // LAZY LOADING: Only download thumbnails (small, ~10KB each)
-  // Full media is downloaded on-demand when user hovers/clicks
-  if (m_telegramClient) {
-    for (const auto &msg : messages) {
-      // Only download thumbnails - they're small and needed for preview
-      if (msg.mediaThumbnailFileId != 0 && msg.mediaThumbnailPath.IsEmpty()) {
-        m_telegramClient->DownloadFile(msg.mediaThumbnailFileId, 8, "Thumbnail",
-                                       0);
-      }
-      // For stickers without thumbnails, download the sticker itself (usually
-      // small)
-      if (msg.hasSticker && msg.mediaFileId != 0 &&
-          msg.mediaLocalPath.IsEmpty() && msg.mediaThumbnailFileId == 0) {
-        m_telegramClient->DownloadFile(msg.mediaFileId, 10, "Sticker",
-                                       msg.mediaFileSize);
-      }
-    }
-  }
+  RequestThumbnails(messages);
+  SchedulePrefetch();
 
   // Mark the chat as read now that messages are loaded and displayed
   if (m_telegramClient && !messages.empty()) {
@@ -2557,6 +2953,12 @@ void MainFrame::OnMessagesLoaded(int64_t chatId,
     }
   }
 
+  // A search hit is waiting for this chat - show it instead of the bottom
+  if (m_pendingJumpMessageId != 0 && m_pendingJumpChatId == chatId) {
+    ResolvePendingJump();
+    return;
+  }
+
   // Final aggressive scroll after ALL operations complete
   // This catches edge cases where layout still wasn't ready
   if (m_chatViewWidget) {
@@ -2574,7 +2976,9 @@ void MainFrame::OnMessagesLoaded(int64_t chatId,
     for (int delay : {100, 300, 600, 1000}) {
       wxTimer *timer = new wxTimer();
       timer->Bind(wxEVT_TIMER, [this, timer](wxTimerEvent &) {
-        if (m_chatViewWidget) {
+        // A jump to a search hit started meanwhile owns the scroll position
+        if (m_chatViewWidget && m_pendingJumpMessageId == 0 &&
+            !m_chatViewWidget->HasNewerMessages()) {
           m_chatViewWidget->ScrollToBottomAggressive();
         }
         timer->Stop();
@@ -2587,6 +2991,186 @@ void MainFrame::OnMessagesLoaded(int64_t chatId,
   DBGLOG("Finished displaying messages, scrolled to bottom");
 }
 
+void MainFrame::OnMessagesMerged(int64_t chatId,
+                                 const std::vector<MessageInfo> &messages,
+                                 bool replace) {
+  // A jump replaced the view meanwhile; the page stays in the cache
+  if (chatId != m_currentChatId || !m_chatViewWidget ||
+      m_chatViewWidget->HasNewerMessages()) {
+    return;
+  }
+
+  if (replace) {
+    m_chatViewWidget->ClearMessages();
+    OnMessagesLoaded(chatId, messages);
+    return;
+  }
+
+  NickIndex &nicks = GetNickIndex(chatId);
+  for (const auto &msg : messages) {
+    nicks.AddSender(msg);
+  }
+
+  // The local page is already on screen; only the gap it missed goes in
+  m_chatViewWidget->MergeMessages(messages);
+  RequestThumbnails(messages);
+
+  int64_t lastMsgId = 0;
+  for (const auto &msg : messages) {
+    lastMsgId = std::max(lastMsgId, msg.id);
+  }
+  if (m_telegramClient && lastMsgId > 0) {
+    MarkMessageAsRead(chatId, lastMsgId);
+    m_telegramClient->MarkChatAsRead(chatId);
+  }
+}
+
+void MainFrame::OnHistoryWindowLoaded(int64_t chatId, int64_t anchorId,
+                                      const std::vector<MessageInfo> &messages,
+                                      bool atNewest) {
+  if (chatId != m_currentChatId || !m_chatViewWidget) {
+    return;
+  }
+
+  bool hasAnchor = std::any_of(
+      messages.begin(), messages.end(),
+      [anchorId](const MessageInfo &msg) { return msg.id == anchorId; });
+  if (m_pendingJumpChatId == chatId && m_pendingJumpMessageId == anchorId) {
+    m_pendingJumpChatId = 0;
+    m_pendingJumpMessageId = 0;
+  }
+  if (messages.empty()) {
+    ShowStatusError("Could not load the messages around that point");
+    return;
+  }
+
+  NickIndex &nicks = GetNickIndex(chatId);
+  for (const auto &msg : messages) {
+    nicks.AddSender(msg);
+  }
+
+  m_chatViewWidget->DisplayHistoryWindow(messages, anchorId, !atNewest);
+  RequestThumbnails(messages);
+
+  if (!hasAnchor) {
+    ShowStatusError("The message is no longer available");
+  }
+}
+
+void MainFrame::OnNewerMessagesLoaded(int64_t chatId,
+                                      const std::vector<MessageInfo> &messages,
+                                      bool atNewest) {
+  if (chatId != m_currentChatId || !m_chatViewWidget ||
+      !m_chatViewWidget->HasNewerMessages()) {
+    return;
+  }
+
+  if (!messages.empty()) {
+    NickIndex &nicks = GetNickIndex(chatId);
+    for (const auto &msg : messages) {
+      nicks.AddSender(msg);
+    }
+    // Rendered at the end; the window above is not re-rendered
+    m_chatViewWidget->AppendMessages(messages);
+    RequestThumbnails(messages);
+  }
+  m_chatViewWidget->SetIsLoadingNewer(false);
+  m_chatViewWidget->SetHasNewerMessages(!atNewest);
+
+  if (atNewest && m_telegramClient) {
+    // Caught up: the window is the live end of the chat again
+    MarkMessageAsRead(chatId, m_chatViewWidget->GetNewestMessageId());
+    m_telegramClient->MarkChatAsRead(chatId);
+  }
+}
+
+void MainFrame::SchedulePrefetch() {
+  // Restarted by every load: prefetch only once the user has settled
+  if (m_prefetchTimer) {
+    m_prefetchTimer->StartOnce(PREFETCH_IDLE_DELAY_MS);
+  }
+}
+
+void MainFrame::StartPrefetch() {
+  if (!m_telegramClient || !m_isLoggedIn || m_currentChatId == 0) {
+    return;
+  }
+  if (m_telegramClient->IsLoadingMessages()) {
+    SchedulePrefetch(); // Not idle yet
+    return;
+  }
+
+  std::vector<int64_t> chatIds;
+  auto add = [this, &chatIds](int64_t chatId) {
+    if (chatId != 0 && chatId != -1 && chatId != m_currentChatId &&
+        chatIds.size() < PREFETCH_MAX_CHATS &&
+        std::find(chatIds.begin(), chatIds.end(), chatId) == chatIds.end()) {
+      chatIds.push_back(chatId);
+    }
+  };
+
+  // Prev/Next Chat targets first, then where the user has just been, then
+  // chats with something new to read
+  if (m_chatListWidget) {
+    for (int64_t chatId : m_chatListWidget->GetNeighbourChatIds(
+             m_currentChatId, PREFETCH_NEIGHBOUR_RADIUS)) {
+      add(chatId);
+    }
+  }
+  size_t taken = 0;
+  for (int64_t chatId : m_telegramClient->GetRecentChatIds()) {
+    if (taken++ >= PREFETCH_PER_SOURCE) {
+      break;
+    }
+    add(chatId);
+  }
+  // Unread chats in chat-list order, so the ones at the top go first
+  std::vector<std::pair<int64_t, int64_t>> unread; // (order, chat id)
+  for (int64_t chatId : m_chatsWithUnread) {
+    bool found = false;
+    ChatInfo chat = m_telegramClient->GetChat(chatId, &found);
+    if (found) {
+      unread.emplace_back(chat.order, chatId);
+    }
+  }
+  std::sort(unread.begin(), unread.end(),
+            [](const auto &a, const auto &b) { return a.first > b.first; });
+  taken = 0;
+  for (const auto &[order, chatId] : unread) {
+    if (taken++ >= PREFETCH_PER_SOURCE) {
+      break;
+    }
+    add(chatId);
+  }
+
+  m_telegramClient->PrefetchHistory(chatIds);
+}
+
+void MainFrame::RequestThumbnails(const std::vector<MessageInfo> &messages) {
+  // LAZY LOADING: Only download thumbnails (small, ~10KB each)
+  // Full media is downloaded on-demand when user hovers/clicks
+  if (!m_telegramClient) {
+    return;
+  }
+  for (const auto &msg : messages) {
+    // Only download thumbnails - they're small and needed for preview.
+    // Media with an inline minithumbnail already has one; the popup shows it
+    // while the file itself downloads
+    if (msg.mediaThumbnailFileId != 0 && msg.mediaThumbnailPath.IsEmpty() &&
+        msg.mediaMinithumbnail.empty()) {
+      m_telegramClient->DownloadFile(msg.mediaThumbnailFileId, 8, "Thumbnail",
+                                     0);
+    }
+    // For stickers without thumbnails, download the sticker itself (usually
+    // small)
+    if (msg.hasSticker && msg.mediaFileId != 0 &&
+        msg.mediaLocalPath.IsEmpty() && msg.mediaThumbnailFileId == 0) {
+      m_telegramClient->DownloadFile(msg.mediaFileId, 10, "Sticker",
+                                     msg.mediaFileSize);
+    }
+  }
+}
+
 void MainFrame::OnOlderMessagesLoaded(
     int64_t chatId, const std::vector<MessageInfo> &messages) {
   DBGLOG("OnOlderMessagesLoaded called: chatId="
@@ -2598,14 +3182,26 @@ void MainFrame::OnOlderMessagesLoaded(
     return;
   }
 
-  if (!m_chatViewWidget || messages.empty()) {
+  if (!m_chatViewWidget) {
+    return;
+  }
+  if (messages.empty()) {
+    // Reached the start of the history
+    m_chatViewWidget->SetIsLoadingOlder(false);
+    if (m_telegramClient) {
+      m_chatViewWidget->SetHasMoreMessages(
+          m_telegramClient->HasMoreMessages(chatId));
+    }
+    ResolvePendingJump();
     return;
   }
 
   // Add older messages without clearing existing ones
   // The ChatViewWidget will merge and re-sort
+  NickIndex &nicks = GetNickIndex(chatId);
   for (const auto &msg : messages) {
     m_chatViewWidget->AddMessage(msg);
+    nicks.AddSender(msg);
   }
 
   // IMPORTANT: Keep m_isLoadingOlder TRUE during the refresh so anchor
@@ -2639,10 +3235,40 @@ void MainFrame::OnOlderMessagesLoaded(
     }
   }
 
+  ResolvePendingJump();
+
   DBGLOG("Finished adding older messages");
 }
 
+NickIndex &MainFrame::GetNickIndex(int64_t chatId) {
+  auto it = std::find(m_nickIndexOrder.begin(), m_nickIndexOrder.end(),
+                      chatId);
+  if (it != m_nickIndexOrder.end()) {
+    m_nickIndexOrder.erase(it);
+  }
+  m_nickIndexOrder.push_front(chatId);
+
+  // The input box holds a pointer into the current chat's index
+  while (m_nickIndexOrder.size() > MAX_NICK_INDEXES) {
+    auto victim = std::find_if(
+        m_nickIndexOrder.rbegin(), m_nickIndexOrder.rend(),
+        [this](int64_t id) { return id != m_currentChatId; });
+    if (victim == m_nickIndexOrder.rend()) {
+      break;
+    }
+    m_nickIndexes.erase(*victim);
+    m_nickIndexOrder.erase(std::next(victim).base());
+  }
+  return m_nickIndexes[chatId];
+}
+
 void MainFrame::OnNewMessage(const MessageInfo &message) {
+  // Only chats that were opened have a name index to keep current
+  auto nicks = m_nickIndexes.find(message.chatId);
+  if (nicks != m_nickIndexes.end()) {
+    nicks->second.AddSender(message);
+  }
+
   if (message.chatId != m_currentChatId) {
     // Update unread count in tree - HexChat style
     m_chatsWithUnread.insert(message.chatId);
@@ -2700,6 +3326,13 @@ void MainFrame::OnNewMessage(const MessageInfo &message) {
     }
   }
 
+  // Viewing a window further back: the message waits in the cache until
+  // the window catches up or the user jumps to the latest
+  if (m_chatViewWidget && m_chatViewWidget->HasNewerMessages()) {
+    m_chatViewWidget->ShowNewMessageIndicator();
+    return;
+  }
+
   // Display the new message - ChatViewWidget now handles ordering automatically
   // Messages are stored in a sorted vector and re-rendered in correct order
   DisplayMessage(message);
@@ -2873,6 +3506,20 @@ void MainFrame::OnDownloadFailed(int32_t fileId, const wxString &error) {
   }
 }
 
+void MainFrame::OnDownloadCancelled(int32_t fileId) {
+  // Dropped on purpose (scrolled out of view) - not an error worth logging
+  auto it = m_fileToTransferId.find(fileId);
+  if (it != m_fileToTransferId.end()) {
+    m_transferManager.CancelTransfer(it->second);
+    m_fileToTransferId.erase(it);
+  }
+
+  // Allow the chat view to request it again when it comes back into view
+  if (m_chatViewWidget && m_chatViewWidget->HasPendingDownload(fileId)) {
+    m_chatViewWidget->RemovePendingDownload(fileId);
+  }
+}
+
 void MainFrame::OnDownloadRetrying(int32_t fileId, int retryCount) {
   // Update transfer status to show retry
   auto it = m_fileToTransferId.find(fileId);
@@ -2941,7 +3588,15 @@ void MainFrame::OnUserStatusChanged(int64_t userId, bool isOnline,
 }
 
 void MainFrame::OnMembersLoaded(int64_t chatId,
-                                const std::vector<UserInfo> &members) {
+                                const std::vector<UserInfo> &members,
+                                bool replace, bool complete,
+                                int32_t totalCount) {
+  // Tab completion indexes every member, even for chats no longer shown
+  auto nicks = m_nickIndexes.find(chatId);
+  if (nicks != m_nickIndexes.end()) {
+    nicks->second.AddMembers(members);
+  }
+
   // Only update if this is still the current chat
   if (chatId != m_currentChatId) {
     return;
@@ -2951,43 +3606,155 @@ void MainFrame::OnMembersLoaded(int64_t chatId,
     return;
   }
 
-  // Clear existing members
-  m_memberList->DeleteAllItems();
+  int64_t selfId = m_telegramClient ? m_telegramClient->GetCurrentUser().id : 0;
+  if (replace) {
+    m_memberList->SetMembers(members, selfId);
+  } else {
+    m_memberList->AddMembers(members, selfId);
+  }
 
-  long idx = 0;
-  for (const auto &member : members) {
-    wxString displayName = member.GetDisplayName();
-    if (displayName.IsEmpty()) {
-      displayName = wxString::Format("User %lld", member.id);
-    }
+  // Update member count label
+  size_t shown = m_memberList->GetMemberCount();
+  if (!complete && totalCount > 0) {
+    m_memberCountLabel->SetLabel(
+        wxString::Format("%zu of %d members (loading...)", shown, totalCount));
+  } else if (complete && totalCount > static_cast<int32_t>(shown)) {
+    // Big groups only list their most recent members
+    m_memberCountLabel->SetLabel(
+        wxString::Format("%zu of %d members", shown, totalCount));
+  } else if (shown > 0) {
+    m_memberCountLabel->SetLabel(
+        wxString::Format("%zu member%s", shown, shown == 1 ? "" : "s"));
+  } else {
+    m_memberCountLabel->SetLabel(complete ? "No members" : "Loading members...");
+  }
 
-    // Mark current user
-    if (member.isSelf ||
-        member.id ==
-            (m_telegramClient ? m_telegramClient->GetCurrentUser().id : 0)) {
-      displayName += " (you)";
-    }
+  DBGLOG("OnMembersLoaded: " << members.size() << " members for chat "
+                             << chatId << ", " << shown << " shown");
+}
+
+void MainFrame::ShowStatusError(const wxString &error) {
+  // Shown in the chat view like the other client notices, so a failed
+  // action is visible where the user is looking
+  if (m_chatViewWidget && m_chatViewWidget->GetMessageFormatter()) {
+    m_chatViewWidget->GetMessageFormatter()->AppendServiceMessage(
+        wxDateTime::Now().Format("%H:%M:%S"), error);
+    m_chatViewWidget->ScrollToBottom();
+  } else {
+    wxLogWarning("%s", error);
+  }
+}
+
+void MainFrame::StartMediaExport(const wxString &filterSpec) {
+  if (!m_telegramClient || !m_isLoggedIn || m_currentChatId == 0) {
+    ReportMediaExport("Open a chat first to archive its media");
+    return;
+  }
+
+  if (IsMediaExportRunning()) {
+    ReportMediaExport("An archive is already running - use /archive cancel "
+                      "to stop it");
+    return;
+  }
+
+  std::vector<SearchMediaFilter> filters;
+  if (!MediaExportJob::ParseFilters(filterSpec, filters)) {
+    ReportMediaExport("Usage: /archive [all|photos|videos|docs|audio|voice|"
+                      "gifs ...] or /archive cancel");
+    return;
+  }
+
+  wxConfigBase *config = wxConfigBase::Get();
+  wxString baseDir;
+  if (config) {
+    baseDir = config->Read("/Export/LastDirectory", "");
+  }
+  if (baseDir.IsEmpty()) {
+    baseDir = wxStandardPaths::Get().GetDocumentsDir();
+  }
+
+  wxDirDialog dialog(this, "Archive media of " + m_currentChatTitle + " into",
+                     baseDir, wxDD_DEFAULT_STYLE);
+  if (dialog.ShowModal() != wxID_OK) {
+    return;
+  }
+  baseDir = dialog.GetPath();
+  if (config) {
+    config->Write("/Export/LastDirectory", baseDir);
+  }
+
+  // One folder per chat, so picking the same base directory again resumes
+  wxString folder = MediaExportJob::SanitizeFileName(m_currentChatTitle);
+  folder += wxString::Format("_%lld", (long long)m_currentChatId);
+  wxString targetDir = wxFileName(baseDir, folder).GetFullPath();
+
+  m_mediaExportJob.reset();
+  m_mediaExportJob = std::make_unique<MediaExportJob>(
+      m_telegramClient, m_currentChatId, m_currentChatTitle, targetDir,
+      filters);
+  m_mediaExportJob->SetProgressCallback(
+      [this](const MediaExportProgress &progress) {
+        OnMediaExportProgress(progress);
+      });
+
+  ReportMediaExport("Archiving media of " + m_currentChatTitle + " to " +
+                    targetDir);
+  if (m_serviceLog) {
+    m_serviceLog->LogSystem("Archive started: " + m_currentChatTitle + " -> " +
+                            targetDir);
+  }
 
-    // Mark bots
-    if (member.isBot) {
-      displayName += " [bot]";
+  m_mediaExportJob->Start();
+}
+
+void MainFrame::CancelMediaExport() {
+  if (!IsMediaExportRunning()) {
+    ReportMediaExport("No archive is running");
+    return;
+  }
+  m_mediaExportJob->Cancel(); // Reports through OnMediaExportProgress
+}
+
+bool MainFrame::IsMediaExportRunning() const {
+  return m_mediaExportJob && !m_mediaExportJob->IsFinished();
+}
+
+void MainFrame::OnMediaExportProgress(const MediaExportProgress &progress) {
+  if (!progress.finished) {
+    if (m_statusBar) {
+      m_statusBar->SetExportProgress(progress.chatTitle, progress.GetDone(),
+                                     progress.found, progress.scanning);
     }
+    return;
+  }
 
-    m_memberList->InsertItem(idx++, displayName);
+  if (m_statusBar) {
+    m_statusBar->ClearExportProgress();
   }
 
-  // Update member count label
-  if (idx > 0) {
-    m_memberCountLabel->SetLabel(
-        wxString::Format("%ld member%s", idx, idx == 1 ? "" : "s"));
-  } else {
-    m_memberCountLabel->SetLabel("No members");
+  wxString size =
+      FormatFileSize(static_cast<wxULongLong_t>(progress.bytesExported));
+  wxString summary = wxString::Format(
+      "Archive of %s %s: %d exported (%s), %d already archived, %d failed",
+      progress.chatTitle, progress.cancelled ? "cancelled" : "finished",
+      progress.exported, size, progress.skipped, progress.failed);
+  if (!progress.lastError.IsEmpty()) {
+    summary += " - last error: " + progress.lastError;
   }
 
-  DBGLOG("OnMembersLoaded: loaded " << idx << " members for chat " << chatId);
+  ReportMediaExport(summary);
+  if (m_serviceLog) {
+    m_serviceLog->LogSystem(summary);
+  }
 }
 
-void MainFrame::ShowStatusError(const wxString &error) {}
+void MainFrame::ReportMediaExport(const wxString &text) {
+  if (m_chatViewWidget && m_chatViewWidget->GetMessageFormatter()) {
+    m_chatViewWidget->GetMessageFormatter()->AppendServiceMessage(
+        wxDateTime::Now().Format("%H:%M:%S"), text);
+    m_chatViewWidget->ScrollToBottomIfAtBottom();
+  }
+}
 
 void MainFrame::UpdateMemberList(int64_t chatId) {
   DBGLOG("UpdateMemberList called: chatId=" << chatId);
@@ -2997,30 +3764,29 @@ void MainFrame::UpdateMemberList(int64_t chatId) {
     return;
   }
 
-  // Clear existing members
-  m_memberList->DeleteAllItems();
-  DBGLOG("UpdateMemberList: cleared existing items");
-
   // Handle test chat
   if (chatId == -1) {
     // Populate with dummy members for test chat
-    long idx = 0;
-    m_memberList->InsertItem(idx++, "Admin (owner)");
-    m_memberList->InsertItem(idx++, "Alice");
-    m_memberList->InsertItem(idx++, "Bob");
-    m_memberList->InsertItem(idx++, "Charlie");
-    m_memberList->InsertItem(idx++, "David");
-    m_memberList->InsertItem(idx++, "Eve");
-    m_memberList->InsertItem(idx++, "Frank");
-    m_memberList->InsertItem(idx++, "Grace");
-    m_memberList->InsertItem(idx++, "Henry");
-    m_memberCountLabel->SetLabel(wxString::Format("%ld members", idx));
+    wxArrayString dummyMembers;
+    dummyMembers.Add("Admin (owner)");
+    dummyMembers.Add("Alice");
+    dummyMembers.Add("Bob");
+    dummyMembers.Add("Charlie");
+    dummyMembers.Add("David");
+    dummyMembers.Add("Eve");
+    dummyMembers.Add("Frank");
+    dummyMembers.Add("Grace");
+    dummyMembers.Add("Henry");
+    m_memberList->SetPlaceholderRows(dummyMembers);
+    m_memberCountLabel->SetLabel(
+        wxString::Format("%zu members", dummyMembers.GetCount()));
 
     return;
   }
 
   if (!m_telegramClient) {
     DBGLOG("UpdateMemberList: m_telegramClient is null");
+    m_memberList->ClearMembers();
     return;
   }
 
@@ -3031,59 +3797,23 @@ void MainFrame::UpdateMemberList(int64_t chatId) {
                                             << chat.title.ToStdString());
   if (!found) {
     DBGLOG("UpdateMemberList: chat not found, returning");
+    m_memberList->ClearMembers();
     return;
   }
 
-  // For private chats (1-1), show just the two participants
-  DBGLOG("UpdateMemberList: isPrivate=" << chat.isPrivate
-                                        << " isBot=" << chat.isBot
-                                        << " isGroup=" << chat.isGroup);
-  if (chat.isPrivate) {
-    long idx = 0;
-
-    // Add current user (you)
-    if (!m_currentUser.IsEmpty()) {
-      m_memberList->InsertItem(idx++, m_currentUser + " (you)");
-    } else {
-      m_memberList->InsertItem(idx++, "You");
-    }
-
-    // Add the other user (the chat title is usually their name)
-    m_memberList->InsertItem(idx++, chat.title);
-
-    m_memberCountLabel->SetLabel("2 members");
-    DBGLOG("UpdateMemberList: private chat - added 2 members");
-    return;
+  // Start from just ourselves; private chats add the other side and groups
+  // stream their members in (a cached list arrives before the next paint)
+  UserInfo self = m_telegramClient->GetCurrentUser();
+  std::vector<UserInfo> initial;
+  if (self.id != 0) {
+    initial.push_back(self);
   }
+  m_memberList->SetMembers(initial, self.id);
 
-  // For bot chats, show just you and the bot
-  if (chat.isBot) {
-    long idx = 0;
-
-    if (!m_currentUser.IsEmpty()) {
-      m_memberList->InsertItem(idx++, m_currentUser + " (you)");
-    } else {
-      m_memberList->InsertItem(idx++, "You");
-    }
-
-    m_memberList->InsertItem(idx++, chat.title + " [bot]");
-
+  if (chat.isPrivate || chat.isBot) {
     m_memberCountLabel->SetLabel("2 members");
-
-    DBGLOG("UpdateMemberList: bot chat - added 2 members");
-    return;
-  }
-
-  // For groups and channels, load members from TDLib
-  DBGLOG("UpdateMemberList: group/channel chat - loading members from TDLib");
-
-  // Show placeholder while loading
-  if (!m_currentUser.IsEmpty()) {
-    m_memberList->InsertItem(0, m_currentUser + " (you)");
-  }
-
-  // Show member count from chat info while we load details
-  if (chat.memberCount > 0) {
+  } else if (chat.memberCount > 0) {
+    // Show member count from chat info while we load details
     m_memberCountLabel->SetLabel(
         wxString::Format("%d members (loading...)", chat.memberCount));
   } else {
@@ -3286,6 +4016,8 @@ void MainFrame::ReactiveRefresh() {
     for (const auto &result : completedDownloads) {
       if (result.success) {
         OnFileDownloaded(result.fileId, result.localPath);
+      } else if (result.cancelled) {
+        OnDownloadCancelled(result.fileId);
       } else {
         OnDownloadFailed(result.fileId, result.error);
       }
@@ -3303,6 +4035,48 @@ void MainFrame::ReactiveRefresh() {
     }
   }
 
+  // Handle pre-upload progress
+  if ((flags & DirtyFlag::Uploads) != DirtyFlag::None) {
+    auto uploadUpdates = m_telegramClient->GetUploadUpdates();
+    for (const auto &update : uploadUpdates) {
+      auto it = m_uploadToTransferId.find(update.uploadId);
+      if (it == m_uploadToTransferId.end()) {
+        continue;
+      }
+
+      int transferId = it->second;
+      TransferInfo *info = m_transferManager.GetTransfer(transferId);
+      wxString fileName = info ? info->fileName : wxString();
+
+      switch (update.state) {
+      case UploadState::Queued:
+        break;
+      case UploadState::Uploading:
+        m_transferManager.UpdateProgress(transferId, update.uploadedSize,
+                                         update.totalSize);
+        break;
+      case UploadState::Completed:
+        m_transferManager.CompleteTransfer(transferId);
+        if (m_serviceLog) {
+          m_serviceLog->LogUploadComplete(fileName);
+        }
+        m_uploadToTransferId.erase(it);
+        break;
+      case UploadState::Failed:
+        m_transferManager.FailTransfer(transferId, update.error);
+        if (m_serviceLog) {
+          m_serviceLog->LogUploadFailed(fileName, update.error);
+        }
+        m_uploadToTransferId.erase(it);
+        break;
+      case UploadState::Cancelled:
+        m_transferManager.CancelTransfer(transferId);
+        m_uploadToTransferId.erase(it);
+        break;
+      }
+    }
+  }
+
   // Handle user status updates (also used for typing indicators)
   if ((flags & DirtyFlag::UserStatus) != DirtyFlag::None) {
     // Refresh online indicators in chat list
@@ -3310,9 +4084,17 @@ void MainFrame::ReactiveRefresh() {
       m_chatListWidget->RefreshOnlineIndicators();
     }
 
+    auto statusChanges = m_telegramClient->GetUserStatusChanges();
+
+    // Move changed members between the online and offline parts of the list
+    if (m_memberList) {
+      for (const auto &[userId, isOnline, lastSeenTime] : statusChanges) {
+        m_memberList->UpdateUserStatus(userId, isOnline);
+      }
+    }
+
     // Log ALL user status changes to service log
-    if (m_serviceLog && m_telegramClient) {
-      auto statusChanges = m_telegramClient->GetUserStatusChanges();
+    if (m_serviceLog) {
       for (const auto &[userId, isOnline, lastSeenTime] : statusChanges) {
         bool userFound = false;
         UserInfo user = m_telegramClient->GetUser(userId, &userFound);
@@ -2,7 +2,9 @@
 #define MAINFRAME_H
 
 #include <atomic>
+#include <deque>
 #include <map>
+#include <memory>
 #include <set>
 #include <vector>
 #include <wx/clipbrd.h>
@@ -16,6 +18,8 @@
 #include <wx/treectrl.h>
 #include <wx/wx.h>
 
+#include "../telegram/NickIndex.h"
+#include "../telegram/QuickSwitchIndex.h"
 #include "../telegram/TransferManager.h"
 #include "MediaTypes.h"
 #include "MenuIds.h"
@@ -31,6 +35,11 @@ class ChatViewWidget;
 class InputBoxWidget;
 class MediaPopup;
 class MessageFormatter;
+class ImageTransformPool;
+class MediaExportJob;
+class MemberListCtrl;
+struct ImageTransformResult;
+struct MediaExportProgress;
 struct MessageInfo;
 struct ChatInfo;
 struct UserInfo;
@@ -46,11 +55,26 @@ public:
   void OnConnected();
   void OnLoginSuccess(const wxString &userName);
   void OnLoggedOut();
+  // Snapshot chats belonged to a session that is gone
+  void OnWarmSnapshotDiscarded();
   void RefreshChatList();
   void OnMessagesLoaded(int64_t chatId,
                         const std::vector<MessageInfo> &messages);
+  // Network page that followed a local one: only messages not yet shown,
+  // or, with replace, a page too far ahead of the local one to join it
+  void OnMessagesMerged(int64_t chatId,
+                        const std::vector<MessageInfo> &messages,
+                        bool replace);
   void OnOlderMessagesLoaded(int64_t chatId,
                              const std::vector<MessageInfo> &messages);
+  // A page centred on anchorId replaces the view (jumps); atNewest tells
+  // whether it already reaches the newest message
+  void OnHistoryWindowLoaded(int64_t chatId, int64_t anchorId,
+                             const std::vector<MessageInfo> &messages,
+                             bool atNewest);
+  void OnNewerMessagesLoaded(int64_t chatId,
+                             const std::vector<MessageInfo> &messages,
+                             bool atNewest);
   void OnNewMessage(const MessageInfo &message);
   void OnMessageUpdated(int64_t chatId, const MessageInfo &message);
   void OnMessageEdited(int64_t chatId, int64_t messageId,
@@ -61,11 +85,32 @@ public:
   void OnDownloadStarted(int32_t fileId, const wxString &fileName,
                          int64_t totalSize);
   void OnDownloadFailed(int32_t fileId, const wxString &error);
+  void OnDownloadCancelled(int32_t fileId);
   void OnDownloadRetrying(int32_t fileId, int retryCount);
   void OnUserStatusChanged(int64_t userId, bool isOnline, int64_t lastSeenTime);
-  void OnMembersLoaded(int64_t chatId, const std::vector<UserInfo> &members);
+  // A page (replace = false) or the whole list of a chat's members
+  void OnMembersLoaded(int64_t chatId, const std::vector<UserInfo> &members,
+                       bool replace, bool complete, int32_t totalCount);
   void ShowStatusError(const wxString &error);
 
+  // Bulk media export of the current chat (/archive, chat context menu).
+  // filterSpec is e.g. "all" or "photos videos" - see MediaExportJob.
+  void StartMediaExport(const wxString &filterSpec);
+  void CancelMediaExport();
+  bool IsMediaExportRunning() const;
+
+  // Dropped/selected files start uploading right away and wait here until
+  // the user sends them (Enter, with the input text as caption) or discards
+  // them (Esc). Sending then only references the uploaded file.
+  bool HasPendingAttachments() const { return !m_pendingAttachments.empty(); }
+  void SendPendingAttachments(const wxString &caption);
+  void DiscardPendingAttachments();
+
+  // Open a chat and scroll to a message in it (0 just opens the chat)
+  void JumpToMessage(int64_t chatId, int64_t messageId);
+  // Leave a jumped-to window and reload the newest history
+  void JumpToLatest();
+
   // Reactive MVC - called when TelegramClient has dirty flags
   void ReactiveRefresh();
   void UpdateMemberList(int64_t chatId);
@@ -92,7 +137,7 @@ public:
   ChatListWidget *GetChatListWidget() { return m_chatListWidget; }
   ChatViewWidget *GetChatViewWidget() { return m_chatViewWidget; }
   InputBoxWidget *GetInputBoxWidget() { return m_inputBoxWidget; }
-  wxListCtrl *GetMemberList() { return m_memberList; }
+  MemberListCtrl *GetMemberList() { return m_memberList; }
   StatusBarManager *GetStatusBarManager() { return m_statusBar; }
   ServiceMessageLog *GetServiceMessageLog() { return m_serviceLog; }
 
@@ -101,6 +146,9 @@ private:
   void CreateMenuBar();
   void UpdateCustomMenuBar(); // Updates colors of custom menu bar
   void CreateMainLayout();
+
+  // Preview-size media for freshly loaded messages
+  void RequestThumbnails(const std::vector<MessageInfo> &messages);
   
   // Custom Menu Bar Members
   wxPanel* m_menuBarPanel;
@@ -150,6 +198,9 @@ private:
   void OnNewChannel(wxCommandEvent &event);
   void OnContacts(wxCommandEvent &event);
   void OnSearch(wxCommandEvent &event);
+  void OnFindInChat(wxCommandEvent &event);
+  void OnJumpToDate(wxCommandEvent &event);
+  void OnQuickSwitcher(wxCommandEvent &event);
   void OnSavedMessages(wxCommandEvent &event);
   void OnUploadFile(wxCommandEvent &event);
   void OnPreferences(wxCommandEvent &event);
@@ -181,6 +232,16 @@ private:
   void OnMemberListRightClick(wxListEvent &event);
   void OnCharHook(wxKeyEvent &event);
 
+  // Media export
+  void OnMediaExportProgress(const MediaExportProgress &progress);
+  void ReportMediaExport(const wxString &text);
+
+  // Photo recompression before upload
+  void OnImageTransformed(const ImageTransformResult &result);
+
+  // Search hit navigation
+  void ResolvePendingJump();
+
   // Welcome chat
   void ForwardInputToWelcomeChat(const wxString &input);
   bool IsWelcomeChatActive() const;
@@ -195,6 +256,43 @@ private:
   // Mapping from TDLib fileId to TransferManager transferId
   std::map<int32_t, int> m_fileToTransferId;
 
+  // Mapping from TelegramClient upload id to TransferManager transferId
+  std::map<int, int> m_uploadToTransferId;
+
+  // Uploads staged for the next send, in drop order
+  struct PendingAttachment {
+    int uploadId;    // 0 while the photo is still being recompressed
+    int transformId; // ImageTransformPool job, 0 if uploaded as-is
+    wxString fileName;
+  };
+  std::vector<PendingAttachment> m_pendingAttachments;
+  int64_t m_pendingAttachmentsChatId = 0;
+
+  // Photos in the transform stage
+  struct TransformingUpload {
+    int transferId = 0;
+    wxString fileName;
+  };
+  std::map<int, TransformingUpload> m_transformingUploads;
+
+  // Attachments the user has sent, in drop order. Sending stops at the
+  // first one still being recompressed so that the files, and the caption
+  // on the first of them, reach the chat in the order they were dropped
+  struct QueuedSend {
+    int64_t chatId;
+    int uploadId;    // 0 while the photo is still being recompressed
+    int transformId;
+    wxString caption;
+  };
+  std::deque<QueuedSend> m_sendQueue;
+  void FlushSendQueue();
+  std::unique_ptr<ImageTransformPool> m_imageTransformPool; // Created lazily
+  bool m_compressPhotos = false; // Opt-in: photos are re-encoded
+  bool m_compressPhotosAsWebP = false;
+
+  // At most one bulk export at a time; kept after finishing until replaced
+  std::unique_ptr<MediaExportJob> m_mediaExportJob;
+
   // Unread message tracking (chatId -> last read message ID)
   std::map<int64_t, int64_t> m_lastReadMessages;
   std::set<int64_t> m_chatsWithUnread;
@@ -215,7 +313,7 @@ private:
 
   // Right panel - Member list
   wxPanel *m_rightPanel;
-  wxListCtrl *m_memberList;
+  MemberListCtrl *m_memberList;
   wxStaticText *m_memberCountLabel;
 
   // Status bar manager
@@ -257,10 +355,40 @@ private:
   static constexpr int CHAT_LIST_REFRESH_DELAY_MS = 100;     // Normal delay
   static constexpr int CHAT_LIST_REFRESH_DELAY_SYNC_MS = 500; // Delay during sync
 
+  // Jump to a search hit once its chat history is loaded far enough back
+  int64_t m_pendingJumpChatId = 0;
+  int64_t m_pendingJumpMessageId = 0;
+
+  // Quick switcher index, rebuilt when the client's chats or users change
+  QuickSwitchIndex m_quickSwitchIndex;
+  uint64_t m_quickSwitchVersion = 0;
+  bool m_quickSwitchIndexBuilt = false;
+  // Chat picked in the switcher that the chat list does not show yet
+  int64_t m_pendingSwitchChatId = 0;
+  void SwitchToChat(int64_t chatId);
+
+  // Tab completion names per opened chat, fed by member loads and senders.
+  // Only the most recently opened few are kept; a member index of a large
+  // supergroup runs to megabytes
+  std::map<int64_t, NickIndex> m_nickIndexes;
+  std::deque<int64_t> m_nickIndexOrder; // Most recently used first
+  static constexpr size_t MAX_NICK_INDEXES = 8;
+  NickIndex &GetNickIndex(int64_t chatId);
+
+  // Idle history prefetch of the chats likely to be opened next
+  wxTimer *m_prefetchTimer = nullptr;
+  void SchedulePrefetch();
+  void StartPrefetch();
+  static constexpr int PREFETCH_IDLE_DELAY_MS = 2000;
+  static constexpr size_t PREFETCH_NEIGHBOUR_RADIUS = 2;
+  static constexpr size_t PREFETCH_PER_SOURCE = 4;
+  static constexpr size_t PREFETCH_MAX_CHATS = 10;
+
   // Timer IDs
   static const int ID_REFRESH_TIMER = wxID_HIGHEST + 200;
   static const int ID_STATUS_TIMER = wxID_HIGHEST + 201;
   static const int ID_CHATLIST_REFRESH_TIMER = wxID_HIGHEST + 202;
+  static const int ID_PREFETCH_TIMER = wxID_HIGHEST + 203;
 
   wxDECLARE_EVENT_TABLE();
 };
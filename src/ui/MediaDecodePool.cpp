@@ -0,0 +1,162 @@
+#include "MediaDecodePool.h"
+
+#include <algorithm>
+#include <iterator>
+
+wxDEFINE_EVENT(wxEVT_MEDIA_DECODED, wxThreadEvent);
+
+MediaDecodePool &MediaDecodePool::Get() {
+  static MediaDecodePool instance;
+  return instance;
+}
+
+MediaDecodePool::MediaDecodePool() {
+  Bind(wxEVT_MEDIA_DECODED, &MediaDecodePool::OnResultsReady, this);
+}
+
+MediaDecodePool::~MediaDecodePool() { Shutdown(); }
+
+void MediaDecodePool::StartWorkersLocked() {
+  // Started on first use; one per core, leaving the rest of the app room
+  size_t threadCount = std::thread::hardware_concurrency();
+  threadCount = std::max<size_t>(1, std::min(threadCount, MAX_THREADS));
+  for (size_t i = 0; i < threadCount; ++i) {
+    m_workers.emplace_back(&MediaDecodePool::WorkerLoop, this);
+  }
+}
+
+uint64_t MediaDecodePool::Submit(const void *owner, Work work) {
+  std::vector<Job> superseded;
+  uint64_t jobId = 0;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_stop) {
+      return 0;
+    }
+    if (m_workers.empty()) {
+      StartWorkersLocked();
+    }
+
+    // Queued jobs of this owner would only produce results nobody wants
+    auto keep = std::stable_partition(
+        m_jobs.begin(), m_jobs.end(),
+        [owner](const Job &job) { return job.owner != owner; });
+    std::move(keep, m_jobs.end(), std::back_inserter(superseded));
+    m_jobs.erase(keep, m_jobs.end());
+
+    jobId = m_nextJobId++;
+    m_latestJob[owner] = jobId;
+    m_jobs.push_back({jobId, owner, std::move(work)});
+  }
+  m_cond.notify_one();
+  // superseded is destroyed here, outside the lock
+  return jobId;
+}
+
+void MediaDecodePool::Cancel(const void *owner) {
+  std::vector<Job> dropped;
+  std::vector<Result> discarded;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_latestJob.erase(owner);
+    for (auto it = m_jobs.begin(); it != m_jobs.end();) {
+      if (it->owner == owner) {
+        dropped.push_back(std::move(*it));
+        it = m_jobs.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    for (auto it = m_results.begin(); it != m_results.end();) {
+      if (it->owner == owner) {
+        discarded.push_back(std::move(*it));
+        it = m_results.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  // Continuations may hold decoded players; free them outside the lock
+}
+
+void MediaDecodePool::Shutdown() {
+  std::vector<std::thread> workers;
+  std::deque<Job> jobs;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+    jobs.swap(m_jobs);
+    workers.swap(m_workers);
+  }
+  m_cond.notify_all();
+  for (auto &worker : workers) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+
+  // Anything the workers finished meanwhile is freed here, not on a worker
+  std::vector<Result> results;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    results.swap(m_results);
+    m_eventPending = false;
+    m_latestJob.clear();
+  }
+}
+
+void MediaDecodePool::WorkerLoop() {
+  while (true) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cond.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+      if (m_stop) {
+        return;
+      }
+      job = std::move(m_jobs.front());
+      m_jobs.pop_front();
+    }
+
+    Continuation continuation = job.work ? job.work() : Continuation();
+
+    // Superseded results go to the main thread too: continuations hold
+    // players and wx objects that must not be destroyed on a worker.
+    // OnResultsReady drops them unrun
+    bool notify = false;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (continuation) {
+        // After Shutdown() the results are cleared by the joining thread
+        m_results.push_back({job.id, job.owner, std::move(continuation)});
+        notify = !m_eventPending && !m_stop;
+        m_eventPending = true;
+      }
+    }
+    if (notify) {
+      wxQueueEvent(this, new wxThreadEvent(wxEVT_MEDIA_DECODED));
+    }
+  }
+}
+
+void MediaDecodePool::OnResultsReady(wxThreadEvent &event) {
+  std::vector<Result> results;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    results.swap(m_results);
+    m_eventPending = false;
+  }
+
+  for (auto &result : results) {
+    // A continuation may submit or cancel, so check under the lock per job
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      auto latest = m_latestJob.find(result.owner);
+      if (latest == m_latestJob.end() || latest->second != result.id) {
+        continue; // Superseded; freed with results below
+      }
+      m_latestJob.erase(latest);
+    }
+    result.continuation();
+  }
+}
@@ -0,0 +1,75 @@
+#ifndef MEDIADECODEPOOL_H
+#define MEDIADECODEPOOL_H
+
+#include <wx/wx.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Shared worker pool for decoding media off the UI thread (popup images,
+// FFmpeg and Lottie player setup). Jobs belong to an owner, normally the
+// window that will show the result, and a newer job from the same owner
+// supersedes the older ones: queued jobs are dropped before they start and
+// the result of one already running is discarded. Sweeping the mouse over a
+// row of photos therefore decodes the one the pointer settles on, not all
+// of them.
+//
+// A job runs its work on a worker and returns the continuation that applies
+// the result; continuations run on the main thread, batched behind a single
+// pending event however many jobs finish in between.
+class MediaDecodePool : public wxEvtHandler {
+public:
+  using Continuation = std::function<void()>;
+  using Work = std::function<Continuation()>;
+
+  static MediaDecodePool &Get();
+
+  // Returns the job id; supersedes the owner's earlier jobs
+  uint64_t Submit(const void *owner, Work work);
+
+  // Drop all of the owner's jobs; call before the owner goes away
+  void Cancel(const void *owner);
+
+  // Stops and joins the workers; further submissions are ignored
+  void Shutdown();
+
+private:
+  MediaDecodePool();
+  ~MediaDecodePool();
+
+  struct Job {
+    uint64_t id = 0;
+    const void *owner = nullptr;
+    Work work;
+  };
+
+  struct Result {
+    uint64_t id = 0;
+    const void *owner = nullptr;
+    Continuation continuation;
+  };
+
+  void StartWorkersLocked();
+  void WorkerLoop();
+  void OnResultsReady(wxThreadEvent &event);
+
+  std::vector<std::thread> m_workers;
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  std::deque<Job> m_jobs;
+  std::vector<Result> m_results;
+  std::map<const void *, uint64_t> m_latestJob; // Owner -> only wanted job
+  uint64_t m_nextJobId = 1;
+  bool m_eventPending = false; // One wakeup covers all queued results
+  bool m_stop = false;
+
+  static constexpr size_t MAX_THREADS = 4;
+};
+
+#endif // MEDIADECODEPOOL_H
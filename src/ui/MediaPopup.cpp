@@ -2,22 +2,22 @@
 #ifdef __GNUC__
 #include <execinfo.h>
 #endif
+#include "BitmapCache.h"
 #include "FFmpegPlayer.h"
 #include "FileUtils.h"
+#include "ImageScaler.h"
 #include "LottiePlayer.h"
+#include "MediaDecodePool.h"
+#include "PreviewCache.h"
 #include <iostream>
-#include <thread>
 #include <unordered_map>
 #include <wx/display.h>
 #include <wx/filename.h>
+#include <wx/mstream.h>
 #include <wx/settings.h>
 
-wxDEFINE_EVENT(wxEVT_IMAGE_LOADED, wxThreadEvent);
-
 #define MPLOG(msg) std::cerr << "[MediaPopup] " << msg << std::endl
 
-#include <thread>
-
 // Cached file existence check to reduce disk I/O
 // Cache entries expire after 500ms to balance performance with freshness
 static bool CachedFileExists(const wxString &path) {
@@ -138,11 +138,12 @@ wxBEGIN_EVENT_TABLE(MediaPopup, wxPopupWindow) EVT_PAINT(MediaPopup::OnPaint)
   Bind(wxEVT_TIMER, &MediaPopup::OnAsyncLoadTimer, this, ASYNC_LOAD_TIMER_ID);
   Bind(wxEVT_TIMER, &MediaPopup::OnVoiceProgressTimer, this,
        VOICE_PROGRESS_TIMER_ID);
-  Bind(wxEVT_IMAGE_LOADED, &MediaPopup::OnImageLoaded, this);
   Bind(wxEVT_LEFT_DOWN, &MediaPopup::OnLeftDown, this);
 }
 
 MediaPopup::~MediaPopup() {
+  // Decodes still queued or running must not call back into this window
+  CancelPendingLoads();
   StopAllPlayback();
   m_loadingTimer.Stop();
   m_asyncLoadTimer.Stop();
@@ -181,6 +182,12 @@ void MediaPopup::StopAllPlayback() {
   m_pendingImagePath.Clear();
 }
 
+void MediaPopup::CancelPendingLoads() {
+  MediaDecodePool::Get().Cancel(this);
+  m_videoLoadPending = false;
+  m_pendingImagePath.Clear();
+}
+
 void MediaPopup::ApplyHexChatStyle() {
   m_bgColor = wxSystemSettings::GetColour(wxSYS_COLOUR_WINDOW);
   // Use a more visible border - darker than the window text for contrast
@@ -334,6 +341,10 @@ void MediaPopup::ShowMedia(const MediaInfo &info, const wxPoint &pos) {
     // Use LOADING_MIN dimensions to fit spinner + text while image loads
     ApplySizeAndPosition(LOADING_MIN_WIDTH, LOADING_MIN_HEIGHT);
     LoadImageAsync(info.localPath);
+    // Still decoding: something better than a spinner in the meantime
+    if (m_isLoading) {
+      ShowMinithumbnail();
+    }
     Refresh();
     return;
   }
@@ -346,6 +357,9 @@ void MediaPopup::ShowMedia(const MediaInfo &info, const wxPoint &pos) {
 
   // Show loading/placeholder if file needs download
   if (info.fileId != 0 && (!hasLocalFile)) {
+    if (ShowMinithumbnail()) {
+      return;
+    }
     m_isLoading = true;
     m_loadingFrame = 0;
     m_loadingTimer.Start(150);
@@ -402,11 +416,12 @@ void MediaPopup::PlayVideo(const wxString &path, bool loop, bool muted) {
   Refresh();
   Update();
 
-  // Load asynchronously in a separate thread to prevent UI blocking
-  // Capture media type before thread since m_mediaInfo could change
+  // Load on the shared decode pool to prevent UI blocking; this supersedes
+  // whatever the popup was loading before. Capture media type before
+  // submitting since m_mediaInfo could change
   MediaType mediaType = m_mediaInfo.type;
 
-  std::thread([this, path, loop, muted, mediaType]() {
+  MediaDecodePool::Get().Submit(this, [this, path, loop, muted, mediaType]() {
     // Create a new player in the background thread
     auto ffmpegPlayer = std::make_unique<FFmpegPlayer>();
 
@@ -425,15 +440,20 @@ void MediaPopup::PlayVideo(const wxString &path, bool loop, bool muted) {
     ffmpegPlayer->SetMuted(muted);
 
     bool loadSuccess = ffmpegPlayer->LoadFile(path);
+    if (!loadSuccess) {
+      ffmpegPlayer.reset();
+    }
 
-    // Store result and notify main thread
-    // Use raw pointer transfer since CallAfter copies the lambda
-    FFmpegPlayer *playerPtr = loadSuccess ? ffmpegPlayer.release() : nullptr;
+    // Continuations are copyable std::functions, so the player travels in
+    // a shared holder; a superseded result frees it with the holder
+    auto holder = std::make_shared<std::unique_ptr<FFmpegPlayer>>(
+        std::move(ffmpegPlayer));
 
-    // Switch back to main thread for UI updates
-    CallAfter([this, path, loop, muted, loadSuccess, playerPtr]() {
+    // Runs on the main thread for UI updates
+    return MediaDecodePool::Continuation([this, path, loop, muted,
+                                          loadSuccess, holder]() {
       // Take ownership of the player (may be null on failure)
-      std::unique_ptr<FFmpegPlayer> player(playerPtr);
+      std::unique_ptr<FFmpegPlayer> player = std::move(*holder);
 
       if (!m_videoLoadPending || m_videoPath != path) {
         // User moved on to different media, discard this result
@@ -452,7 +472,7 @@ void MediaPopup::PlayVideo(const wxString &path, bool loop, bool muted) {
       m_ffmpegPlayer = std::move(player);
       FinishFFmpegPlayback(path, loop, muted);
     });
-  }).detach();
+  });
 }
 
 void MediaPopup::FinishFFmpegPlayback(const wxString &path, bool loop,
@@ -595,8 +615,8 @@ void MediaPopup::PlayLottie(const wxString &path, bool loop) {
   Refresh();
   Update();
 
-  // Load asynchronously in a separate thread to prevent UI blocking
-  std::thread([this, path, loop]() {
+  // Load on the shared decode pool to prevent UI blocking
+  MediaDecodePool::Get().Submit(this, [this, path, loop]() {
     // Do the heavy Lottie initialization in background thread
     auto lottiePlayer = std::make_unique<LottiePlayer>();
 
@@ -608,15 +628,17 @@ void MediaPopup::PlayLottie(const wxString &path, bool loop) {
     lottiePlayer->SetLoop(loop);
 
     bool loadSuccess = lottiePlayer->LoadFile(path);
+    if (!loadSuccess) {
+      lottiePlayer.reset();
+    }
+    auto holder = std::make_shared<std::unique_ptr<LottiePlayer>>(
+        std::move(lottiePlayer));
 
-    // Store result and notify main thread
-    // Use raw pointer transfer since CallAfter copies the lambda
-    LottiePlayer *playerPtr = loadSuccess ? lottiePlayer.release() : nullptr;
-
-    // Switch back to main thread for UI updates
-    CallAfter([this, path, loop, loadSuccess, playerPtr]() {
+    // Runs on the main thread for UI updates
+    return MediaDecodePool::Continuation([this, path, loop, loadSuccess,
+                                          holder]() {
       // Take ownership of the player (may be null on failure)
-      std::unique_ptr<LottiePlayer> player(playerPtr);
+      std::unique_ptr<LottiePlayer> player = std::move(*holder);
 
       if (m_lottiePath != path) {
         // User moved on to different media, discard this result
@@ -636,7 +658,7 @@ void MediaPopup::PlayLottie(const wxString &path, bool loop) {
       m_lottiePlayer = std::move(player);
       FinishLottiePlayback(path, loop);
     });
-  }).detach();
+  });
 }
 
 void MediaPopup::FinishLottiePlayback(const wxString &path, bool loop) {
@@ -788,6 +810,10 @@ void MediaPopup::FallbackToThumbnail() {
     }
   }
 
+  if (ShowMinithumbnail()) {
+    return;
+  }
+
   if (!m_mediaInfo.emoji.IsEmpty()) {
     m_hasError = false;
     m_errorMessage.Clear();
@@ -803,37 +829,70 @@ void MediaPopup::FallbackToThumbnail() {
   }
 }
 
-void MediaPopup::SetImage(const wxImage &image) {
-  if (!image.IsOk() || image.GetWidth() <= 0 || image.GetHeight() <= 0) {
-    m_hasImage = false;
-    return;
+bool MediaPopup::ShowMinithumbnail() {
+  const std::string &data = m_mediaInfo.minithumbnail;
+  if (data.empty()) {
+    return false;
   }
 
-  StopAllPlayback();
-  m_isLoading = false;
+  int maxWidth, maxHeight;
+  GetImageBox(maxWidth, maxHeight);
+
+  // Decoded once per media and box; without a file id it is cheap enough
+  // to decode again
+  wxString key = m_mediaInfo.fileId != 0
+                     ? wxString::Format("minithumb:%d", m_mediaInfo.fileId)
+                     : wxString();
+  wxBitmap bitmap;
+  if (!BitmapCache::Get().LookupKey(key, maxWidth, maxHeight, bitmap)) {
+    wxLogNull noLog;
+    wxMemoryInputStream stream(data.data(), data.size());
+    wxImage image;
+    if (!image.LoadFile(stream, wxBITMAP_TYPE_JPEG) || !image.IsOk()) {
+      MPLOG("ShowMinithumbnail: failed to decode " << data.size()
+                                                   << " bytes");
+      return false;
+    }
 
-  bool needsDownload =
+    // The real size has the exact aspect ratio and caps the stand-in at what
+    // the real picture will take; the minithumbnail alone is scaled to fill
+    // the box
+    wxSize size;
+    if (m_mediaInfo.width > 0 && m_mediaInfo.height > 0) {
+      size = PreviewCache::FitWithin(m_mediaInfo.width, m_mediaInfo.height,
+                                     maxWidth, maxHeight);
+    } else {
+      double scale = std::min((double)maxWidth / image.GetWidth(),
+                              (double)maxHeight / image.GetHeight());
+      size = wxSize(std::max(1, (int)(image.GetWidth() * scale)),
+                    std::max(1, (int)(image.GetHeight() * scale)));
+    }
+
+    image = image.Scale(size.GetWidth(), size.GetHeight(),
+                        wxIMAGE_QUALITY_BILINEAR)
+                .Blur(MINITHUMB_BLUR_RADIUS);
+    bitmap = wxBitmap(image);
+    BitmapCache::Get().StoreKey(key, maxWidth, maxHeight, bitmap);
+  }
+
+  ShowBitmap(bitmap);
+
+  // Spinner overlay until the file is here
+  bool mainFileNeedsDownload =
       m_mediaInfo.fileId != 0 && (m_mediaInfo.localPath.IsEmpty() ||
                                   !CachedFileExists(m_mediaInfo.localPath));
+  m_isDownloadingMedia = mainFileNeedsDownload;
+  return true;
+}
 
-  if (!m_isDownloadingMedia && !needsDownload) {
-    m_loadingTimer.Stop();
-  } else if (!m_loadingTimer.IsRunning()) {
-    m_loadingTimer.Start(150);
+void MediaPopup::SetImage(const wxImage &image) {
+  if (!image.IsOk() || image.GetWidth() <= 0 || image.GetHeight() <= 0) {
+    m_hasImage = false;
+    return;
   }
 
-  m_hasError = false;
-
   int maxWidth, maxHeight;
-  if (m_mediaInfo.type == MediaType::Photo ||
-      m_mediaInfo.type == MediaType::Video ||
-      m_mediaInfo.type == MediaType::GIF) {
-    maxWidth = PHOTO_MAX_WIDTH;
-    maxHeight = PHOTO_MAX_HEIGHT;
-  } else {
-    maxWidth = STICKER_MAX_WIDTH;
-    maxHeight = STICKER_MAX_HEIGHT;
-  }
+  GetImageBox(maxWidth, maxHeight);
 
   int imgWidth = image.GetWidth();
   int imgHeight = image.GetHeight();
@@ -852,13 +911,48 @@ void MediaPopup::SetImage(const wxImage &image) {
     return;
   }
 
-  wxImage scaled = image.Scale(imgWidth, imgHeight, wxIMAGE_QUALITY_HIGH);
+  // Previews from the decode pool already fit
+  wxImage scaled = image;
+  if (imgWidth != image.GetWidth() || imgHeight != image.GetHeight()) {
+    scaled = DownscaleImage(image, imgWidth, imgHeight);
+  }
   if (!scaled.IsOk()) {
     m_hasImage = false;
     return;
   }
 
-  m_bitmap = wxBitmap(scaled);
+  ShowBitmap(wxBitmap(scaled));
+}
+
+void MediaPopup::GetImageBox(int &maxWidth, int &maxHeight) const {
+  if (m_mediaInfo.type == MediaType::Photo ||
+      m_mediaInfo.type == MediaType::Video ||
+      m_mediaInfo.type == MediaType::GIF) {
+    maxWidth = PHOTO_MAX_WIDTH;
+    maxHeight = PHOTO_MAX_HEIGHT;
+  } else {
+    maxWidth = STICKER_MAX_WIDTH;
+    maxHeight = STICKER_MAX_HEIGHT;
+  }
+}
+
+void MediaPopup::ShowBitmap(const wxBitmap &bitmap) {
+  StopAllPlayback();
+  m_isLoading = false;
+
+  bool needsDownload =
+      m_mediaInfo.fileId != 0 && (m_mediaInfo.localPath.IsEmpty() ||
+                                  !CachedFileExists(m_mediaInfo.localPath));
+
+  if (!m_isDownloadingMedia && !needsDownload) {
+    m_loadingTimer.Stop();
+  } else if (!m_loadingTimer.IsRunning()) {
+    m_loadingTimer.Start(150);
+  }
+
+  m_hasError = false;
+
+  m_bitmap = bitmap;
   m_hasImage = true;
 
   int width = m_bitmap.GetWidth() + (PADDING * 2) + (BORDER_WIDTH * 2);
@@ -868,9 +962,20 @@ void MediaPopup::SetImage(const wxImage &image) {
 }
 
 void MediaPopup::SetImage(const wxString &path) {
+  int maxWidth, maxHeight;
+  GetImageBox(maxWidth, maxHeight);
+  wxBitmap cached;
+  if (BitmapCache::Get().Lookup(path, maxWidth, maxHeight, cached)) {
+    ShowBitmap(cached);
+    return;
+  }
+
   wxImage image;
   if (LoadImageWithWebPSupport(path, image)) {
     SetImage(image);
+    if (m_hasImage) {
+      BitmapCache::Get().Store(path, maxWidth, maxHeight, m_bitmap);
+    }
   } else {
     m_hasImage = false;
   }
@@ -1400,36 +1505,48 @@ void MediaPopup::LoadImageAsync(const wxString &path) {
     return;
   }
 
-  m_pendingImagePath = path;
-
-  std::thread([this, path]() {
-    wxImage image;
-    bool success = LoadImageWithWebPSupport(path, image) && image.IsOk();
+  // Shown a moment ago: no decode, no rescale
+  int maxWidth, maxHeight;
+  GetImageBox(maxWidth, maxHeight);
+  wxBitmap cached;
+  if (BitmapCache::Get().Lookup(path, maxWidth, maxHeight, cached)) {
+    MediaDecodePool::Get().Cancel(this);
+    m_pendingImagePath.Clear();
+    ShowBitmap(cached);
+    return;
+  }
 
-    wxThreadEvent *event = new wxThreadEvent(wxEVT_IMAGE_LOADED);
-    event->SetString(path);
+  m_pendingImagePath = path;
 
-    if (success) {
-      event->SetPayload(image);
-      event->SetInt(1);
-    } else {
-      event->SetInt(0);
-    }
+  // Only the media file itself has a stable TDLib id; thumbnails go by path
+  int32_t fileId = path == m_mediaInfo.localPath ? m_mediaInfo.fileId : 0;
 
-    wxQueueEvent(this, event);
-  }).detach();
+  MediaDecodePool::Get().Submit(this, [this, path, fileId, maxWidth,
+                                       maxHeight]() {
+    // Reads the small on-disk preview when there is one, and leaves one
+    // behind after decoding a large original; arrives scaled to the box
+    wxImage image;
+    bool success =
+        PreviewCache::Load(path, fileId, maxWidth, maxHeight, image) &&
+        image.IsOk();
+    return MediaDecodePool::Continuation(
+        [this, path, success, image]() { OnImageLoaded(path, success, image); });
+  });
 }
 
-void MediaPopup::OnImageLoaded(wxThreadEvent &event) {
-  wxString path = event.GetString();
-
+void MediaPopup::OnImageLoaded(const wxString &path, bool success,
+                               const wxImage &image) {
   if (!m_pendingImagePath.IsEmpty() && path != m_pendingImagePath) {
     return;
   }
 
-  if (event.GetInt() == 1) {
-    wxImage image = event.GetPayload<wxImage>();
+  if (success) {
     SetImage(image);
+    if (m_hasImage) {
+      int maxWidth, maxHeight;
+      GetImageBox(maxWidth, maxHeight);
+      BitmapCache::Get().Store(path, maxWidth, maxHeight, m_bitmap);
+    }
   } else {
     MPLOG("OnImageLoaded: failed to load image: " << path.ToStdString());
     MarkLoadFailed(path);
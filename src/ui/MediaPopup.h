@@ -36,6 +36,8 @@ public:
     // Font control - uses UI font from preferences
     void SetUIFont(const wxFont& font) { m_uiFont = font; }
     void SetImage(const wxImage& image);
+    // An image already scaled to fit (see BitmapCache)
+    void ShowBitmap(const wxBitmap& bitmap);
     void SetImage(const wxString& path);
     void ShowLoading();
     void ShowError(const wxString& message);
@@ -58,6 +60,8 @@ public:
 
     // Stop all playback - call before switching media or hiding
     void StopAllPlayback();
+    // Drop decodes still queued for this popup (see MediaDecodePool)
+    void CancelPendingLoads();
     
     // Voice note specific controls
     void PlayVoiceNote(const wxString& path);
@@ -86,12 +90,17 @@ protected:
 
 private:
     void UpdateSize();
+    // Largest bitmap the popup shows for the current media type
+    void GetImageBox(int& maxWidth, int& maxHeight) const;
     void AdjustPositionToScreen(const wxPoint& pos);
     void ApplySizeAndPosition(int width, int height);
     void ApplyHexChatStyle();
     wxString GetMediaLabel() const;
     wxString GetMediaIcon() const;
     void FallbackToThumbnail();
+    // Blurred, upscaled TDLib minithumbnail as a stand-in while the real
+    // picture downloads or decodes; false if the media has none
+    bool ShowMinithumbnail();
     void PlayMediaWithFFmpeg(const wxString& path, bool loop, bool muted);
     void DrawMediaLabel(wxDC& dc, const wxSize& size);
     void DrawVoiceWaveform(wxDC& dc, const wxSize& size);
@@ -102,7 +111,7 @@ private:
     // Async image loading to prevent UI blocking
     void LoadImageAsync(const wxString& path);
     void OnAsyncLoadTimer(wxTimerEvent& event);
-    void OnImageLoaded(wxThreadEvent& event);
+    void OnImageLoaded(const wxString& path, bool success, const wxImage& image);
 
     // Track failed loads to avoid repeated attempts
     bool HasFailedRecently(const wxString& path) const;
@@ -132,7 +141,7 @@ private:
     // FFmpeg player for all video/animation
     std::unique_ptr<FFmpegPlayer> m_ffmpegPlayer;
     bool m_isPlayingFFmpeg;
-    bool m_videoLoadPending;  // True while waiting for CallAfter to start playback
+    bool m_videoLoadPending;  // True while the decode pool loads the video
     wxTimer m_ffmpegAnimTimer;
     wxString m_videoPath;
     bool m_loopVideo;
@@ -180,6 +189,9 @@ private:
     // Size constraints for photos/videos (compact preview)
     static constexpr int PHOTO_MAX_WIDTH = 300;
     static constexpr int PHOTO_MAX_HEIGHT = 240;
+
+    // Minithumbnails are ~40px; blurring hides the upscaling blocks
+    static constexpr int MINITHUMB_BLUR_RADIUS = 4;
     
     // Size constraints for voice notes
     static constexpr int VOICE_WIDTH = 280;
@@ -2,6 +2,7 @@
 #define MEDIATYPES_H
 
 #include <cstdint>
+#include <string>
 #include <vector>
 #include <wx/wx.h>
 
@@ -36,6 +37,9 @@ struct MediaInfo {
   int32_t thumbnailFileId;
   wxString thumbnailPath;
 
+  // Inline JPEG bytes from TDLib, displayed blurred while downloading
+  std::string minithumbnail;
+
   // For voice/video notes - duration and waveform
   int32_t duration;              // Duration in seconds
   std::vector<uint8_t> waveform; // Waveform data (5-bit values packed)
@@ -83,4 +87,13 @@ struct LinkSpan {
   bool Contains(long pos) const { return pos >= startPos && pos <= endPos; }
 };
 
+// Tracks clickable reply previews ("re: ...") that jump to the quoted message
+struct ReplySpan {
+  long startPos;          // Start of the reply preview line
+  long endPos;            // End of the reply preview line
+  int64_t replyToMessageId;
+
+  bool Contains(long pos) const { return pos >= startPos && pos <= endPos; }
+};
+
 #endif // MEDIATYPES_H
\ No newline at end of file
@@ -0,0 +1,188 @@
+#include "MemberListCtrl.h"
+#include "../telegram/QuickSwitchIndex.h"
+#include "../telegram/Types.h"
+#include "Theme.h"
+
+#include <algorithm>
+
+MemberListCtrl::MemberListCtrl(wxWindow *parent, wxWindowID id)
+    : wxListCtrl(parent, id, wxDefaultPosition, wxDefaultSize,
+                 wxLC_REPORT | wxLC_VIRTUAL | wxLC_SINGLE_SEL |
+                     wxLC_NO_HEADER) {
+  // Single column for usernames
+  InsertColumn(0, "Members", wxLIST_FORMAT_LEFT, 120);
+}
+
+bool MemberListCtrl::Before(uint32_t a, uint32_t b) const {
+  const Member &left = m_members[a];
+  const Member &right = m_members[b];
+  if (left.isOnline != right.isOnline) {
+    return left.isOnline;
+  }
+  if (left.sortKey != right.sortKey) {
+    return left.sortKey < right.sortKey;
+  }
+  return left.userId < right.userId;
+}
+
+void MemberListCtrl::Link(uint32_t index) {
+  auto pos = std::upper_bound(
+      m_order.begin(), m_order.end(), index,
+      [this](uint32_t a, uint32_t b) { return Before(a, b); });
+  m_order.insert(pos, index);
+}
+
+void MemberListCtrl::Unlink(uint32_t index) {
+  auto pos = std::lower_bound(
+      m_order.begin(), m_order.end(), index,
+      [this](uint32_t a, uint32_t b) { return Before(a, b); });
+  if (pos != m_order.end() && *pos == index) {
+    m_order.erase(pos);
+  }
+}
+
+void MemberListCtrl::Upsert(const UserInfo &user, int64_t selfId,
+                            std::vector<uint32_t> &added) {
+  Member member;
+  member.userId = user.id;
+  member.displayName = user.GetDisplayName();
+  member.label = member.displayName;
+  if (user.isSelf || user.id == selfId) {
+    member.label += " (you)";
+  }
+  if (user.isBot) {
+    member.label += " [bot]";
+  }
+  member.sortKey = QuickSwitchIndex::Fold(member.displayName);
+  member.isOnline = user.IsCurrentlyOnline();
+
+  auto found = m_memberById.find(user.id);
+  if (found == m_memberById.end()) {
+    uint32_t index = static_cast<uint32_t>(m_members.size());
+    m_members.push_back(std::move(member));
+    m_memberById[user.id] = index;
+    added.push_back(index);
+    return;
+  }
+
+  Member &existing = m_members[found->second];
+  if (existing.label == member.label &&
+      existing.isOnline == member.isOnline) {
+    return;
+  }
+  // Listed twice in this batch: not in m_order yet, the merge places it
+  if (!added.empty() && found->second >= added.front()) {
+    existing = std::move(member);
+    return;
+  }
+  Unlink(found->second);
+  existing = std::move(member);
+  Link(found->second);
+}
+
+void MemberListCtrl::SetMembers(const std::vector<UserInfo> &members,
+                                int64_t selfId) {
+  m_members.clear();
+  m_order.clear();
+  m_memberById.clear();
+  AddMembers(members, selfId);
+}
+
+void MemberListCtrl::AddMembers(const std::vector<UserInfo> &members,
+                                int64_t selfId) {
+  std::vector<uint32_t> added;
+  added.reserve(members.size());
+  m_members.reserve(m_members.size() + members.size());
+  for (const auto &user : members) {
+    if (user.id != 0) {
+      Upsert(user, selfId, added);
+    }
+  }
+
+  // Sort the page on its own and merge it into the existing order
+  auto before = [this](uint32_t a, uint32_t b) { return Before(a, b); };
+  std::sort(added.begin(), added.end(), before);
+  size_t middle = m_order.size();
+  m_order.insert(m_order.end(), added.begin(), added.end());
+  std::inplace_merge(m_order.begin(), m_order.begin() + middle, m_order.end(),
+                     before);
+  Sync();
+}
+
+void MemberListCtrl::SetPlaceholderRows(const wxArrayString &labels) {
+  m_members.clear();
+  m_order.clear();
+  m_memberById.clear();
+  for (const auto &label : labels) {
+    Member member;
+    member.displayName = label;
+    member.label = label;
+    member.isOnline = true;
+    m_order.push_back(static_cast<uint32_t>(m_members.size()));
+    m_members.push_back(std::move(member));
+  }
+  Sync();
+}
+
+void MemberListCtrl::ClearMembers() {
+  m_members.clear();
+  m_order.clear();
+  m_memberById.clear();
+  Sync();
+}
+
+bool MemberListCtrl::UpdateUserStatus(int64_t userId, bool isOnline) {
+  auto found = m_memberById.find(userId);
+  if (found == m_memberById.end()) {
+    return false;
+  }
+  Member &member = m_members[found->second];
+  if (member.isOnline != isOnline) {
+    Unlink(found->second);
+    member.isOnline = isOnline;
+    Link(found->second);
+    Sync();
+  }
+  return true;
+}
+
+int64_t MemberListCtrl::GetUserId(long row) const {
+  if (row < 0 || static_cast<size_t>(row) >= m_order.size()) {
+    return 0;
+  }
+  return m_members[m_order[row]].userId;
+}
+
+wxString MemberListCtrl::GetDisplayName(long row) const {
+  if (row < 0 || static_cast<size_t>(row) >= m_order.size()) {
+    return wxString();
+  }
+  return m_members[m_order[row]].displayName;
+}
+
+void MemberListCtrl::Sync() {
+  long count = static_cast<long>(m_order.size());
+  SetItemCount(count);
+  if (count > 0) {
+    RefreshItems(0, count - 1);
+  } else {
+    Refresh();
+  }
+}
+
+wxString MemberListCtrl::OnGetItemText(long item, long column) const {
+  if (item < 0 || static_cast<size_t>(item) >= m_order.size()) {
+    return wxString();
+  }
+  return m_members[m_order[item]].label;
+}
+
+wxListItemAttr *MemberListCtrl::OnGetItemAttr(long item) const {
+  if (item < 0 || static_cast<size_t>(item) >= m_order.size() ||
+      m_members[m_order[item]].isOnline) {
+    return nullptr;
+  }
+  // Offline members are dimmed; read per call so theme switches apply
+  m_offlineAttr.SetTextColour(ThemeManager::Get().GetColors().mutedText);
+  return &m_offlineAttr;
+}
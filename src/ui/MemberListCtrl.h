@@ -0,0 +1,65 @@
+#ifndef MEMBERLISTCTRL_H
+#define MEMBERLISTCTRL_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <wx/listctrl.h>
+#include <wx/wx.h>
+
+struct UserInfo;
+
+// Member panel list. A virtual wxListCtrl: rows live here and are only
+// formatted when painted, so a 10k member page costs no native items.
+//
+// Rows stay sorted online-first, then by folded name. Pages are merged into
+// the order, and a status change moves one row with two binary searches
+// instead of resorting the list.
+class MemberListCtrl : public wxListCtrl {
+public:
+  MemberListCtrl(wxWindow *parent, wxWindowID id);
+
+  // Replace all rows
+  void SetMembers(const std::vector<UserInfo> &members, int64_t selfId);
+  // Merge a page; members already listed are refreshed in place
+  void AddMembers(const std::vector<UserInfo> &members, int64_t selfId);
+  // Fixed rows without users behind them (test chat)
+  void SetPlaceholderRows(const wxArrayString &labels);
+  void ClearMembers();
+
+  // False if the user is not listed
+  bool UpdateUserStatus(int64_t userId, bool isOnline);
+
+  size_t GetMemberCount() const { return m_order.size(); }
+  int64_t GetUserId(long row) const;
+  // Display name without the "(you)" / "[bot]" markers
+  wxString GetDisplayName(long row) const;
+
+protected:
+  wxString OnGetItemText(long item, long column) const override;
+  wxListItemAttr *OnGetItemAttr(long item) const override;
+
+private:
+  struct Member {
+    int64_t userId = 0;
+    wxString displayName;
+    wxString label;
+    std::wstring sortKey;
+    bool isOnline = false;
+  };
+
+  bool Before(uint32_t a, uint32_t b) const;
+  void Upsert(const UserInfo &user, int64_t selfId,
+              std::vector<uint32_t> &added);
+  void Unlink(uint32_t index);
+  void Link(uint32_t index);
+  void Sync();
+
+  std::vector<Member> m_members;
+  std::vector<uint32_t> m_order; // Sorted indexes into m_members
+  std::unordered_map<int64_t, uint32_t> m_memberById;
+  mutable wxListItemAttr m_offlineAttr;
+};
+
+#endif // MEMBERLISTCTRL_H
@@ -20,6 +20,8 @@ enum {
     ID_UPLOAD_FILE,
     
     // Edit menu
+    ID_FIND_IN_CHAT,
+    ID_JUMP_TO_DATE,
     ID_CLEAR_WINDOW,
     ID_PREFERENCES,
     
@@ -40,6 +42,7 @@ enum {
     ID_PREV_CHAT,
     ID_NEXT_CHAT,
     ID_CLOSE_CHAT,
+    ID_QUICK_SWITCHER,
     
     // Help menu
     ID_DOCUMENTATION,
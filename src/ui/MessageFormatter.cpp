@@ -894,11 +894,11 @@ void MessageFormatter::AppendMediaMessage(
   m_chatArea->WriteText("\n");
 }
 
-void MessageFormatter::AppendReplyMessage(
+long MessageFormatter::AppendReplyMessage(
     const wxString &timestamp, const wxString &sender, const wxString &replyTo,
     const wxString &message, MessageStatus status, bool statusHighlight) {
   if (!m_chatArea)
-    return;
+    return 0;
 
   m_chatArea->ResetStyles();
   m_chatArea->WriteTimestamp(timestamp);
@@ -920,6 +920,7 @@ void MessageFormatter::AppendReplyMessage(
   indent += wxString(' ', m_usernameWidth + 3); // Username column
 
   m_chatArea->WriteText(indent);
+  long replyStart = m_chatArea->GetLastPosition();
   m_chatArea->BeginTextColour(m_replyColor);
   m_chatArea->WriteText(wxString::FromUTF8("↳ re: \""));
 
@@ -936,6 +937,7 @@ void MessageFormatter::AppendReplyMessage(
 
   m_chatArea->ResetStyles();
   m_chatArea->WriteText("\n");
+  return replyStart;
 }
 
 void MessageFormatter::AppendForwardMessage(const wxString &timestamp,
@@ -52,7 +52,8 @@ public:
                           const MediaInfo &media, const wxString &caption = "",
                           MessageStatus status = MessageStatus::None,
                           bool statusHighlight = false);
-  void AppendReplyMessage(const wxString &timestamp, const wxString &sender,
+  // Returns where the reply preview line starts (it ends the message)
+  long AppendReplyMessage(const wxString &timestamp, const wxString &sender,
                           const wxString &replyTo, const wxString &message,
                           MessageStatus status = MessageStatus::None,
                           bool statusHighlight = false);
@@ -0,0 +1,167 @@
+#include "PreviewCache.h"
+#include "FileUtils.h"
+#include "ImageScaler.h"
+
+#include <wx/dir.h>
+#include <wx/filename.h>
+
+#include <algorithm>
+#include <vector>
+
+std::atomic<int> PreviewCache::s_writesSinceTrim{0};
+
+wxString PreviewCache::GetDir() {
+  return wxGetHomeDir() + "/.teleliter/previews";
+}
+
+wxString PreviewCache::GetPreviewPath(const wxString &source, int32_t fileId,
+                                      int maxWidth, int maxHeight) {
+  wxULongLong size = wxFileName::GetSize(source);
+  if (size == wxInvalidSize) {
+    return wxString();
+  }
+
+  wxString name;
+  if (fileId != 0) {
+    name = wxString::Format("f%d", fileId);
+  } else {
+    // FNV-1a of the path; the size below catches a different file there
+    uint64_t hash = 1469598103934665603ULL;
+    for (wxString::const_iterator it = source.begin(); it != source.end();
+         ++it) {
+      hash ^= static_cast<uint64_t>((*it).GetValue());
+      hash *= 1099511628211ULL;
+    }
+    name = wxString::Format("h%016llx", (unsigned long long)hash);
+  }
+
+  return GetDir() + wxFileName::GetPathSeparator() +
+         wxString::Format("%s_%llu_%dx%d", name,
+                          (unsigned long long)size.GetValue(), maxWidth,
+                          maxHeight);
+}
+
+wxSize PreviewCache::FitWithin(int width, int height, int maxWidth,
+                               int maxHeight) {
+  if (width <= maxWidth && height <= maxHeight) {
+    return wxSize(width, height);
+  }
+  double scale = std::min((double)maxWidth / width, (double)maxHeight / height);
+  return wxSize(std::max(1, (int)(width * scale)),
+                std::max(1, (int)(height * scale)));
+}
+
+bool PreviewCache::Load(const wxString &source, int32_t fileId, int maxWidth,
+                        int maxHeight, wxImage &image) {
+  // Image handlers report decode problems through wxLog, which must not pop
+  // up dialogs from a worker thread
+  wxLogNull noLog;
+
+  wxString preview = GetPreviewPath(source, fileId, maxWidth, maxHeight);
+  if (preview.IsEmpty()) {
+    return false;
+  }
+
+  // Alpha previews are PNG, everything else JPEG
+  for (const char *ext : {".jpg", ".png"}) {
+    wxString path = preview + ext;
+    if (wxFileExists(path) && image.LoadFile(path) && image.IsOk()) {
+      wxFileName(path).Touch(); // Most recently used for Trim()
+      return true;
+    }
+  }
+
+  if (!LoadImageWithWebPSupport(source, image) || !image.IsOk()) {
+    return false;
+  }
+
+  wxSize fitted =
+      FitWithin(image.GetWidth(), image.GetHeight(), maxWidth, maxHeight);
+  bool worthPreview =
+      image.GetWidth() >= fitted.GetWidth() * MIN_SCALE_FACTOR ||
+      image.GetHeight() >= fitted.GetHeight() * MIN_SCALE_FACTOR;
+  if (fitted != image.GetSize()) {
+    image = DownscaleImage(image, fitted.GetWidth(), fitted.GetHeight());
+  }
+
+  if (worthPreview &&
+      Save(image, preview + (image.HasAlpha() ? ".png" : ".jpg")) &&
+      ++s_writesSinceTrim >= TRIM_EVERY_WRITES) {
+    s_writesSinceTrim = 0;
+    Trim();
+  }
+  return true;
+}
+
+bool PreviewCache::Save(const wxImage &image, const wxString &path) {
+  wxString dir = GetDir();
+  if (!wxFileName::DirExists(dir)) {
+    wxFileName::Mkdir(dir, wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL);
+  }
+
+  // The extension picks the handler; write beside the target, then rename
+  wxString tempPath =
+      path + wxString::Format(".%lu.tmp", (unsigned long)wxThread::GetCurrentId());
+  wxImage copy = image;
+  bool saved;
+  if (image.HasAlpha()) {
+    saved = copy.SaveFile(tempPath, wxBITMAP_TYPE_PNG);
+  } else {
+    copy.SetOption(wxIMAGE_OPTION_QUALITY, JPEG_QUALITY);
+    saved = copy.SaveFile(tempPath, wxBITMAP_TYPE_JPEG);
+  }
+  if (!saved || !wxRenameFile(tempPath, path, true)) {
+    wxRemoveFile(tempPath);
+    return false;
+  }
+  return true;
+}
+
+void PreviewCache::Trim() {
+  wxLogNull noLog;
+
+  wxDir dir(GetDir());
+  if (!dir.IsOpened()) {
+    return;
+  }
+
+  struct Preview {
+    wxString path;
+    time_t mtime;
+    int64_t bytes;
+  };
+  std::vector<Preview> previews;
+  int64_t total = 0;
+  time_t cutoff = wxDateTime::Now().GetTicks() - MAX_AGE_DAYS * 24 * 60 * 60;
+
+  wxString name;
+  for (bool more = dir.GetFirst(&name, wxEmptyString, wxDIR_FILES); more;
+       more = dir.GetNext(&name)) {
+    wxString path = dir.GetNameWithSep() + name;
+    time_t mtime = wxFileModificationTime(path);
+    wxULongLong size = wxFileName::GetSize(path);
+    if (mtime == static_cast<time_t>(-1) || size == wxInvalidSize) {
+      continue;
+    }
+    if (mtime < cutoff) {
+      wxRemoveFile(path);
+      continue;
+    }
+    previews.push_back({path, mtime, static_cast<int64_t>(size.GetValue())});
+    total += previews.back().bytes;
+  }
+
+  if (total <= BUDGET_BYTES) {
+    return;
+  }
+  std::sort(previews.begin(), previews.end(),
+            [](const Preview &a, const Preview &b) { return a.mtime < b.mtime; });
+  for (const auto &preview : previews) {
+    if (total <= BUDGET_BYTES) {
+      break;
+    }
+    if (wxRemoveFile(preview.path)) {
+      total -= preview.bytes;
+    }
+  }
+}
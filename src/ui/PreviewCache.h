@@ -0,0 +1,55 @@
+#ifndef PREVIEWCACHE_H
+#define PREVIEWCACHE_H
+
+#include <wx/wx.h>
+#include <wx/image.h>
+
+#include <atomic>
+#include <cstdint>
+
+// Small pre-scaled copies of photos and stickers in ~/.teleliter/previews,
+// so that showing a 20 MP camera photo in a 300x240 popup reads a few
+// kilobytes instead of decoding the original every time.
+//
+// A preview is named after the TDLib file id when there is one, otherwise
+// after a hash of the source path, and in both cases after the source size
+// and the preview box, so a different file never matches. Reading a preview
+// refreshes its mtime; Trim() drops previews unused for MAX_AGE_DAYS and
+// then the least recently used ones until the directory fits the budget.
+//
+// Thread-safe: meant to run on the decode pool (see MediaDecodePool).
+// Previews are written to a temp file and renamed into place.
+class PreviewCache {
+public:
+  static wxString GetDir();
+
+  // Where the preview of source fitted into maxWidth x maxHeight lives;
+  // empty if source does not exist
+  static wxString GetPreviewPath(const wxString &source, int32_t fileId,
+                                 int maxWidth, int maxHeight);
+
+  // Decodes the preview if present, else the source, which is then scaled
+  // to fit and stored as its preview when that saves work next time.
+  // image is scaled to fit the box either way.
+  static bool Load(const wxString &source, int32_t fileId, int maxWidth,
+                   int maxHeight, wxImage &image);
+
+  // Size of w x h scaled down (never up) to fit maxWidth x maxHeight
+  static wxSize FitWithin(int width, int height, int maxWidth, int maxHeight);
+
+  static void Trim();
+
+private:
+  static bool Save(const wxImage &image, const wxString &path);
+
+  static std::atomic<int> s_writesSinceTrim;
+
+  // Originals at most this much larger than the box are not worth a preview
+  static constexpr int MIN_SCALE_FACTOR = 2;
+  static constexpr int JPEG_QUALITY = 85;
+  static constexpr int64_t BUDGET_BYTES = 128LL * 1024 * 1024;
+  static constexpr int MAX_AGE_DAYS = 30;
+  static constexpr int TRIM_EVERY_WRITES = 64;
+};
+
+#endif // PREVIEWCACHE_H
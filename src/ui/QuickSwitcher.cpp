@@ -0,0 +1,130 @@
+#include "QuickSwitcher.h"
+
+#include <algorithm>
+
+QuickSwitcherDialog::QuickSwitcherDialog(wxWindow *parent,
+                                         const QuickSwitchIndex &index)
+    : wxDialog(parent, wxID_ANY, "Switch to Chat", wxDefaultPosition,
+               wxSize(460, 400), wxDEFAULT_DIALOG_STYLE | wxRESIZE_BORDER),
+      m_index(index) {
+  wxBoxSizer *sizer = new wxBoxSizer(wxVERTICAL);
+
+  m_queryInput = new wxTextCtrl(this, wxID_ANY, "", wxDefaultPosition,
+                                wxDefaultSize, wxTE_PROCESS_ENTER);
+  m_queryInput->SetHint("Chat, name or @username...");
+  sizer->Add(m_queryInput, 0, wxALL | wxEXPAND, 10);
+
+  m_resultList = new wxListBox(this, wxID_ANY, wxDefaultPosition,
+                               wxDefaultSize, 0, nullptr, wxLB_SINGLE);
+  sizer->Add(m_resultList, 1, wxLEFT | wxRIGHT | wxEXPAND, 10);
+
+  m_summaryLabel = new wxStaticText(this, wxID_ANY, "");
+  sizer->Add(m_summaryLabel, 0, wxALL | wxEXPAND, 10);
+
+  SetSizer(sizer);
+
+  m_queryInput->Bind(wxEVT_TEXT, &QuickSwitcherDialog::OnQueryChanged, this);
+  m_queryInput->Bind(wxEVT_KEY_DOWN, &QuickSwitcherDialog::OnQueryKeyDown,
+                     this);
+  m_resultList->Bind(wxEVT_LISTBOX_DCLICK,
+                     &QuickSwitcherDialog::OnResultActivated, this);
+
+  RunQuery();
+  m_queryInput->SetFocus();
+}
+
+const QuickSwitchEntry *QuickSwitcherDialog::GetSelectedEntry() const {
+  int selection = m_resultList->GetSelection();
+  if (selection == wxNOT_FOUND ||
+      static_cast<size_t>(selection) >= m_hits.size()) {
+    return nullptr;
+  }
+  return &m_index.GetEntry(m_hits[selection].index);
+}
+
+void QuickSwitcherDialog::OnQueryChanged(wxCommandEvent &event) {
+  RunQuery();
+}
+
+void QuickSwitcherDialog::OnQueryKeyDown(wxKeyEvent &event) {
+  // Focus stays in the query box; the arrows drive the list
+  switch (event.GetKeyCode()) {
+  case WXK_DOWN:
+    MoveSelection(1);
+    return;
+  case WXK_UP:
+    MoveSelection(-1);
+    return;
+  case WXK_PAGEDOWN:
+    MoveSelection(10);
+    return;
+  case WXK_PAGEUP:
+    MoveSelection(-10);
+    return;
+  case WXK_RETURN:
+  case WXK_NUMPAD_ENTER:
+    if (GetSelectedEntry()) {
+      EndModal(wxID_OK);
+    }
+    return;
+  case WXK_ESCAPE:
+    EndModal(wxID_CANCEL);
+    return;
+  default:
+    event.Skip();
+  }
+}
+
+void QuickSwitcherDialog::OnResultActivated(wxCommandEvent &event) {
+  if (GetSelectedEntry()) {
+    EndModal(wxID_OK);
+  }
+}
+
+void QuickSwitcherDialog::RunQuery() {
+  m_hits = m_index.Search(m_queryInput->GetValue(), MAX_RESULTS,
+                          wxGetUTCTime());
+
+  wxArrayString rows;
+  rows.Alloc(m_hits.size());
+  for (const auto &hit : m_hits) {
+    rows.Add(FormatEntry(m_index.GetEntry(hit.index)));
+  }
+
+  m_resultList->Freeze();
+  m_resultList->Set(rows);
+  if (!m_hits.empty()) {
+    m_resultList->SetSelection(0);
+  }
+  m_resultList->Thaw();
+
+  m_summaryLabel->SetLabel(wxString::Format("%zu shown of %zu chats and users",
+                                            m_hits.size(), m_index.GetSize()));
+}
+
+void QuickSwitcherDialog::MoveSelection(int delta) {
+  int count = static_cast<int>(m_resultList->GetCount());
+  if (count == 0) {
+    return;
+  }
+  int selection = m_resultList->GetSelection();
+  if (selection == wxNOT_FOUND) {
+    selection = 0;
+  } else {
+    selection = std::max(0, std::min(count - 1, selection + delta));
+  }
+  m_resultList->SetSelection(selection);
+  m_resultList->EnsureVisible(selection);
+}
+
+wxString QuickSwitcherDialog::FormatEntry(const QuickSwitchEntry &entry) const {
+  wxString text = entry.title;
+  if (!entry.username.IsEmpty()) {
+    text += "  @" + entry.username;
+  }
+  text += "  [" + entry.kind + "]";
+  if (entry.unreadCount > 0) {
+    text += wxString::Format("  (%d unread)", entry.unreadCount);
+  }
+  return text;
+}
@@ -0,0 +1,37 @@
+#ifndef QUICKSWITCHER_H
+#define QUICKSWITCHER_H
+
+#include <wx/wx.h>
+
+#include <vector>
+
+#include "../telegram/QuickSwitchIndex.h"
+
+// Quick switcher (Ctrl+K): type part of a chat title or @username, pick a
+// result with Up/Down and Enter. Every keystroke re-ranks the prebuilt
+// index; the dialog itself holds no chat data.
+class QuickSwitcherDialog : public wxDialog {
+public:
+  QuickSwitcherDialog(wxWindow *parent, const QuickSwitchIndex &index);
+
+  // The chosen entry after ShowModal() returned wxID_OK
+  const QuickSwitchEntry *GetSelectedEntry() const;
+
+private:
+  void OnQueryChanged(wxCommandEvent &event);
+  void OnQueryKeyDown(wxKeyEvent &event);
+  void OnResultActivated(wxCommandEvent &event);
+  void RunQuery();
+  void MoveSelection(int delta);
+  wxString FormatEntry(const QuickSwitchEntry &entry) const;
+
+  const QuickSwitchIndex &m_index;
+  wxTextCtrl *m_queryInput;
+  wxListBox *m_resultList;
+  wxStaticText *m_summaryLabel;
+  std::vector<QuickSwitchHit> m_hits;
+
+  static constexpr size_t MAX_RESULTS = 50;
+};
+
+#endif // QUICKSWITCHER_H
@@ -0,0 +1,339 @@
+#include "SearchDialog.h"
+#include "../telegram/TelegramClient.h"
+#include "MainFrame.h"
+
+#include <wx/datetime.h>
+
+SearchResultList::SearchResultList(SearchDialog *dialog, wxWindow *parent)
+    : wxListCtrl(parent, wxID_ANY, wxDefaultPosition, wxSize(620, 320),
+                 wxLC_REPORT | wxLC_SINGLE_SEL | wxLC_VIRTUAL),
+      m_dialog(dialog) {
+  AppendColumn("Chat", wxLIST_FORMAT_LEFT, 140);
+  AppendColumn("Date", wxLIST_FORMAT_LEFT, 110);
+  AppendColumn("Message", wxLIST_FORMAT_LEFT, 350);
+}
+
+wxString SearchResultList::OnGetItemText(long item, long column) const {
+  m_dialog->OnRowRequested(item);
+  return m_dialog->GetRowText(item, column);
+}
+
+SearchDialog::SearchDialog(MainFrame *mainFrame, TelegramClient *client,
+                           int64_t currentChatId,
+                           const wxString &currentChatTitle)
+    : wxDialog(mainFrame, wxID_ANY, "Search", wxDefaultPosition,
+               wxSize(660, 480), wxDEFAULT_DIALOG_STYLE | wxRESIZE_BORDER),
+      m_mainFrame(mainFrame), m_client(client),
+      m_currentChatId(currentChatId), m_serverTimer(this),
+      m_alive(std::make_shared<bool>(true)) {
+  wxBoxSizer *sizer = new wxBoxSizer(wxVERTICAL);
+
+  wxBoxSizer *searchSizer = new wxBoxSizer(wxHORIZONTAL);
+  m_searchBox = new wxSearchCtrl(this, wxID_ANY, "", wxDefaultPosition,
+                                 wxSize(400, -1));
+  m_searchBox->SetHint("Search chats and messages...");
+  searchSizer->Add(m_searchBox, 1, wxRIGHT, 5);
+
+  m_scopeChoice = new wxChoice(this, wxID_ANY);
+  m_scopeChoice->Append("All chats");
+  if (m_currentChatId != 0) {
+    m_scopeChoice->Append("In " + currentChatTitle);
+  }
+  m_scopeChoice->SetSelection(0);
+  searchSizer->Add(m_scopeChoice, 0);
+  sizer->Add(searchSizer, 0, wxALL | wxEXPAND, 10);
+
+  m_resultList = new SearchResultList(this, this);
+  sizer->Add(m_resultList, 1, wxLEFT | wxRIGHT | wxEXPAND, 10);
+
+  m_summaryLabel = new wxStaticText(this, wxID_ANY, "");
+  sizer->Add(m_summaryLabel, 0, wxALL | wxEXPAND, 10);
+
+  wxButton *closeBtn = new wxButton(this, wxID_CANCEL, "Close");
+  sizer->Add(closeBtn, 0, wxALIGN_CENTER | wxBOTTOM, 10);
+
+  SetSizer(sizer);
+
+  if (m_client) {
+    for (const auto &[chatId, chat] : m_client->GetChats()) {
+      m_chatTitles[chatId] = chat.title;
+    }
+  }
+
+  m_searchBox->Bind(wxEVT_TEXT, &SearchDialog::OnQueryChanged, this);
+  m_searchBox->Bind(wxEVT_SEARCHCTRL_SEARCH_BTN,
+                    &SearchDialog::OnQueryChanged, this);
+  m_scopeChoice->Bind(wxEVT_CHOICE, &SearchDialog::OnScopeChanged, this);
+  m_resultList->Bind(wxEVT_LIST_ITEM_ACTIVATED, &SearchDialog::OnItemActivated,
+                     this);
+  Bind(wxEVT_TIMER, &SearchDialog::OnServerTimer, this,
+       m_serverTimer.GetId());
+
+  RunLocalSearch();
+  m_searchBox->SetFocus();
+}
+
+SearchDialog::~SearchDialog() {
+  m_serverTimer.Stop();
+  *m_alive = false;
+}
+
+wxString SearchDialog::GetRowText(long item, long column) const {
+  if (item < 0 || static_cast<size_t>(item) >= m_rows.size()) {
+    return wxString();
+  }
+  const Row &row = m_rows[item];
+  switch (column) {
+  case 0:
+    return row.chatTitle;
+  case 1:
+    return row.date > 0
+               ? wxDateTime(static_cast<time_t>(row.date))
+                     .Format("%Y-%m-%d %H:%M")
+               : wxString();
+  default:
+    return row.text;
+  }
+}
+
+void SearchDialog::OnRowRequested(long item) {
+  if (m_serverPending || m_pageRequestQueued || m_serverExhausted ||
+      m_query.IsEmpty()) {
+    return;
+  }
+  if (item + PREFETCH_ROWS >= static_cast<long>(m_rows.size())) {
+    // Painting is no place to mutate the list - fetch from the event loop.
+    // Every cell painted near the end gets here; one request covers them
+    m_pageRequestQueued = true;
+    std::weak_ptr<bool> alive = m_alive;
+    CallAfter([this, alive]() {
+      if (alive.lock()) {
+        m_pageRequestQueued = false;
+        RequestServerPage();
+      }
+    });
+  }
+}
+
+void SearchDialog::OnQueryChanged(wxCommandEvent &event) {
+  RunLocalSearch();
+  StartServerSearch();
+}
+
+void SearchDialog::OnScopeChanged(wxCommandEvent &event) {
+  RunLocalSearch();
+  StartServerSearch();
+}
+
+bool SearchDialog::IsChatScope() const {
+  return m_currentChatId != 0 && m_scopeChoice->GetSelection() == 1;
+}
+
+wxString SearchDialog::GetChatTitle(int64_t chatId) {
+  auto it = m_chatTitles.find(chatId);
+  if (it != m_chatTitles.end()) {
+    return it->second;
+  }
+  // Hits may come from chats that are not in the loaded chat list
+  wxString title = wxString::Format("%lld", static_cast<long long>(chatId));
+  if (m_client) {
+    bool found = false;
+    ChatInfo chat = m_client->GetChat(chatId, &found);
+    if (found) {
+      title = chat.title;
+    }
+  }
+  m_chatTitles[chatId] = title;
+  return title;
+}
+
+void SearchDialog::RunLocalSearch() {
+  wxString query = m_searchBox->GetValue();
+  wxString trimmed = query;
+  trimmed.Trim(true).Trim(false);
+  m_query = trimmed;
+
+  m_rows.clear();
+  m_shownMessages.clear();
+  bool chatScope = IsChatScope();
+
+  // Chat titles first (all chats when the query is empty)
+  if (!chatScope) {
+    wxString lowerQuery = trimmed.Lower();
+    for (const auto &[chatId, title] : m_chatTitles) {
+      if (!lowerQuery.IsEmpty() && !title.Lower().Contains(lowerQuery)) {
+        continue;
+      }
+      m_rows.push_back({RowSource::Chat, chatId, 0, 0, title, wxString()});
+      if (!lowerQuery.IsEmpty() && m_rows.size() >= MAX_CHAT_ROWS) {
+        break;
+      }
+    }
+  }
+  m_chatRowCount = m_rows.size();
+
+  // Local index hits - answered in milliseconds, no round trip
+  if (!trimmed.IsEmpty() && m_client) {
+    auto hits = m_client->GetSearchIndex().Search(
+        query, MAX_LOCAL_ROWS, chatScope ? m_currentChatId : 0);
+    for (const auto &hit : hits) {
+      m_rows.push_back({RowSource::Local, hit.chatId, hit.messageId, hit.date,
+                        GetChatTitle(hit.chatId), hit.preview});
+      m_shownMessages.insert({hit.chatId, hit.messageId});
+    }
+  }
+  m_localRowCount = m_rows.size() - m_chatRowCount;
+
+  m_resultList->SetItemCount(static_cast<long>(m_rows.size()));
+  m_resultList->Refresh();
+  UpdateSummary();
+}
+
+void SearchDialog::StartServerSearch() {
+  // Supersede whatever is in flight - its replies no longer match
+  m_generation++;
+  m_serverPending = false;
+  m_serverExhausted = m_query.IsEmpty();
+  m_nextOffset.clear();
+  m_nextFromMessageId = 0;
+  m_serverTotal = -1;
+  m_serverError.clear();
+
+  m_serverTimer.Stop();
+  if (!m_serverExhausted) {
+    // Wait for a typing pause instead of hitting the server per keystroke
+    m_serverTimer.StartOnce(SERVER_DEBOUNCE_MS);
+  }
+  UpdateSummary();
+}
+
+void SearchDialog::OnServerTimer(wxTimerEvent &event) { RequestServerPage(); }
+
+void SearchDialog::RequestServerPage() {
+  if (!m_client || m_serverPending || m_serverExhausted ||
+      m_query.IsEmpty()) {
+    return;
+  }
+  m_serverPending = true;
+  UpdateSummary();
+
+  uint64_t generation = m_generation;
+  std::weak_ptr<bool> alive = m_alive;
+
+  if (IsChatScope()) {
+    m_client->SearchChatMessages(
+        m_currentChatId, m_query, SearchMediaFilter::None, m_nextFromMessageId,
+        SERVER_PAGE_SIZE,
+        [this, alive, generation](bool success,
+                                  const std::vector<MessageInfo> &messages,
+                                  int64_t nextFromMessageId,
+                                  const wxString &error) {
+          if (!alive.lock()) {
+            return;
+          }
+          if (generation == m_generation) {
+            m_nextFromMessageId = nextFromMessageId;
+          }
+          OnServerPage(generation, success, messages, nextFromMessageId != 0,
+                       -1, error);
+        });
+  } else {
+    m_client->SearchMessages(
+        m_query, m_nextOffset, SERVER_PAGE_SIZE,
+        [this, alive, generation](bool success,
+                                  const std::vector<MessageInfo> &messages,
+                                  const wxString &nextOffset, int totalCount,
+                                  const wxString &error) {
+          if (!alive.lock()) {
+            return;
+          }
+          if (generation == m_generation) {
+            m_nextOffset = nextOffset;
+          }
+          OnServerPage(generation, success, messages, !nextOffset.IsEmpty(),
+                       totalCount, error);
+        });
+  }
+}
+
+void SearchDialog::OnServerPage(uint64_t generation, bool success,
+                                const std::vector<MessageInfo> &messages,
+                                bool hasMore, int totalCount,
+                                const wxString &error) {
+  if (generation != m_generation) {
+    return; // Superseded by a newer query
+  }
+  m_serverPending = false;
+
+  if (!success) {
+    m_serverError = error;
+    m_serverExhausted = true;
+    UpdateSummary();
+    return;
+  }
+
+  if (totalCount >= 0) {
+    m_serverTotal = totalCount;
+  }
+  m_serverExhausted = !hasMore || messages.empty();
+  AppendServerRows(messages);
+  UpdateSummary();
+}
+
+void SearchDialog::AppendServerRows(const std::vector<MessageInfo> &messages) {
+  size_t before = m_rows.size();
+  for (const auto &msg : messages) {
+    if (!m_shownMessages.insert({msg.chatId, msg.id}).second) {
+      continue; // Already listed from the local index
+    }
+    wxString text = msg.text.IsEmpty() ? msg.mediaCaption : msg.text;
+    if (text.IsEmpty()) {
+      text = msg.mediaFileName;
+    }
+    text.Replace("\n", " ");
+    m_rows.push_back({RowSource::Server, msg.chatId, msg.id, msg.date,
+                      GetChatTitle(msg.chatId), text});
+  }
+
+  if (m_rows.size() != before) {
+    // SetItemCount keeps the selection and scroll position of a virtual list
+    m_resultList->SetItemCount(static_cast<long>(m_rows.size()));
+    m_resultList->RefreshItems(static_cast<long>(before),
+                               static_cast<long>(m_rows.size()) - 1);
+  }
+}
+
+void SearchDialog::UpdateSummary() {
+  if (m_query.IsEmpty()) {
+    m_summaryLabel->SetLabel("");
+    return;
+  }
+
+  size_t serverRows = m_rows.size() - m_chatRowCount - m_localRowCount;
+  wxString summary =
+      wxString::Format("%zu chats, %zu local, %zu from server", m_chatRowCount,
+                       m_localRowCount, serverRows);
+  if (m_serverTotal >= 0) {
+    summary += wxString::Format(" of ~%d", m_serverTotal);
+  }
+  if (m_serverPending || m_serverTimer.IsRunning()) {
+    summary += " - searching...";
+  } else if (!m_serverError.IsEmpty()) {
+    summary += " - server error: " + m_serverError;
+  } else if (!m_serverExhausted) {
+    summary += " - scroll for more";
+  }
+  m_summaryLabel->SetLabel(summary);
+}
+
+void SearchDialog::OnItemActivated(wxListEvent &event) {
+  long item = event.GetIndex();
+  if (item < 0 || static_cast<size_t>(item) >= m_rows.size()) {
+    return;
+  }
+  Row row = m_rows[item];
+  EndModal(wxID_OK);
+  if (m_mainFrame) {
+    m_mainFrame->JumpToMessage(row.chatId, row.messageId);
+  }
+}
@@ -0,0 +1,119 @@
+#ifndef SEARCHDIALOG_H
+#define SEARCHDIALOG_H
+
+#include <wx/listctrl.h>
+#include <wx/srchctrl.h>
+#include <wx/timer.h>
+#include <wx/wx.h>
+
+#include <map>
+#include <memory>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "../telegram/Types.h"
+
+class MainFrame;
+class TelegramClient;
+class SearchDialog;
+
+// Virtual report list - rows are pulled from the dialog on paint, so tens of
+// thousands of hits cost no per-row allocation in the control
+class SearchResultList : public wxListCtrl {
+public:
+  SearchResultList(SearchDialog *dialog, wxWindow *parent);
+
+protected:
+  wxString OnGetItemText(long item, long column) const override;
+
+private:
+  SearchDialog *m_dialog;
+};
+
+// Search dialog (Telegram > Search). Every keystroke re-queries the local
+// message index; after a short pause the server is searched as well, either
+// globally (searchMessages) or in the current chat (searchChatMessages).
+// Server pages stream into the list and further pages are fetched as the user
+// scrolls towards the end. A newer query supersedes the running one - TDLib
+// requests cannot be aborted, so stale replies are dropped by generation.
+// Activating a hit jumps to the message.
+class SearchDialog : public wxDialog {
+public:
+  SearchDialog(MainFrame *mainFrame, TelegramClient *client,
+               int64_t currentChatId, const wxString &currentChatTitle);
+  ~SearchDialog();
+
+private:
+  friend class SearchResultList;
+
+  enum class RowSource { Chat, Local, Server };
+
+  struct Row {
+    RowSource source;
+    int64_t chatId;
+    int64_t messageId; // 0 for a chat-title match
+    int64_t date;
+    wxString chatTitle;
+    wxString text;
+  };
+
+  wxString GetRowText(long item, long column) const;
+  // A row near the end is being painted - time for the next server page
+  void OnRowRequested(long item);
+
+  void OnQueryChanged(wxCommandEvent &event);
+  void OnScopeChanged(wxCommandEvent &event);
+  void OnServerTimer(wxTimerEvent &event);
+  void OnItemActivated(wxListEvent &event);
+
+  void RunLocalSearch();
+  void StartServerSearch();
+  void RequestServerPage();
+  void OnServerPage(uint64_t generation, bool success,
+                    const std::vector<MessageInfo> &messages,
+                    bool hasMore, int totalCount, const wxString &error);
+  void AppendServerRows(const std::vector<MessageInfo> &messages);
+  void UpdateSummary();
+  wxString GetChatTitle(int64_t chatId);
+  bool IsChatScope() const;
+
+  MainFrame *m_mainFrame;
+  TelegramClient *m_client;
+  int64_t m_currentChatId;
+
+  wxSearchCtrl *m_searchBox;
+  wxChoice *m_scopeChoice;
+  SearchResultList *m_resultList;
+  wxStaticText *m_summaryLabel;
+  wxTimer m_serverTimer;
+
+  wxString m_query;
+  std::vector<Row> m_rows;
+  std::set<std::pair<int64_t, int64_t>> m_shownMessages; // Dedup local/server
+  std::map<int64_t, wxString> m_chatTitles;
+  size_t m_chatRowCount = 0;
+  size_t m_localRowCount = 0;
+
+  // Server paging state for the current generation
+  uint64_t m_generation = 0;
+  bool m_serverPending = false;
+  bool m_pageRequestQueued = false; // A CallAfter for the next page is out
+  bool m_serverExhausted = true;
+  wxString m_nextOffset;         // searchMessages
+  int64_t m_nextFromMessageId = 0; // searchChatMessages
+  int m_serverTotal = -1;
+  wxString m_serverError;
+
+  // Replies may arrive after the dialog is gone
+  std::shared_ptr<bool> m_alive;
+
+  static constexpr size_t MAX_CHAT_ROWS = 20;
+  static constexpr size_t MAX_LOCAL_ROWS = 1000;
+  static constexpr int SERVER_PAGE_SIZE = 100;
+  static constexpr int SERVER_DEBOUNCE_MS = 350;
+  // Fetch the next server page when painting gets this close to the end
+  static constexpr long PREFETCH_ROWS = 50;
+};
+
+#endif // SEARCHDIALOG_H
@@ -1,6 +1,7 @@
 #include "StatusBarManager.h"
 #include "../telegram/TelegramClient.h"
 #include "../telegram/Types.h"
+#include "FileUtils.h"
 #include "Theme.h"
 #include <wx/settings.h>
 
@@ -12,7 +13,9 @@ StatusBarManager::StatusBarManager(wxFrame *parent)
       m_typingLabel(nullptr), m_progressGauge(nullptr),
       m_progressLabel(nullptr), m_transferAnimFrame(0),
       m_lastTransferredBytes(0), m_currentSpeed(0.0),
-      m_hasActiveTransfers(false), m_activeTransferCount(0), m_isOnline(false),
+      m_hasActiveTransfers(false), m_activeTransferCount(0),
+      m_hasExportProgress(false), m_exportDone(0), m_exportFound(0),
+      m_exportScanning(false), m_isOnline(false),
       m_isLoggedIn(false), m_currentChatId(0), m_currentChatMemberCount(0),
       m_totalChats(0), m_unreadChats(0),
       m_bgColor(wxSystemSettings::GetColour(wxSYS_COLOUR_BTNFACE)),
@@ -195,6 +198,7 @@ void StatusBarManager::UpdateStatusBar() {
     } else {
       chatInfo = "Not logged in";
     }
+    chatInfo += BuildExportSegment();
     if (m_mainLabel) {
       m_mainLabel->SetLabel(chatInfo);
       m_mainLabel->Show();
@@ -323,14 +327,24 @@ void StatusBarManager::UpdateTransferProgress(const TransferInfo &info) {
   }
 
   // Build final label: "[|] v file.jpg [######----] 45% 1.2MB/s ~5s"
-  wxString label = spinner + " " + dirSymbol + " " + fileName + " [" +
-                   progressBar + "] " + wxString::Format("%d%%", percent);
+  wxString label;
+  if (info.phase == TransferPhase::Transform &&
+      info.status == TransferStatus::InProgress) {
+    // Local recompression before the upload: "[|] ^ file.png compressing"
+    label = spinner + " " + dirSymbol + " " + fileName + " compressing";
+  } else if (info.status == TransferStatus::Pending) {
+    // Waiting for a transfer slot: "[|] ^ file.jpg queued"
+    label = spinner + " " + dirSymbol + " " + fileName + " queued";
+  } else {
+    label = spinner + " " + dirSymbol + " " + fileName + " [" + progressBar +
+            "] " + wxString::Format("%d%%", percent);
 
-  if (!speedStr.IsEmpty()) {
-    label += " " + speedStr;
-  }
-  if (!etaStr.IsEmpty()) {
-    label += etaStr;
+    if (!speedStr.IsEmpty()) {
+      label += " " + speedStr;
+    }
+    if (!etaStr.IsEmpty()) {
+      label += etaStr;
+    }
   }
 
   // If multiple transfers, append count
@@ -339,8 +353,9 @@ void StatusBarManager::UpdateTransferProgress(const TransferInfo &info) {
   }
 
   // Update the main status label with transfer progress
+  m_transferLabel = label;
   if (m_mainLabel) {
-    m_mainLabel->SetLabel(label);
+    m_mainLabel->SetLabel(label + BuildExportSegment());
     m_mainLabel->Show();
   }
   if (m_typingLabel) {
@@ -363,6 +378,10 @@ void StatusBarManager::OnTransferComplete(const TransferInfo &info) {
   // Show completion with checkmark
   wxString label =
       "[OK] " + dirSymbol + " " + info.fileName + " [==========] Done!";
+  if (info.savedBytes > 0) {
+    label += " (saved " +
+             FormatFileSize(static_cast<wxULongLong_t>(info.savedBytes)) + ")";
+  }
   if (m_mainLabel) {
     m_mainLabel->SetLabel(label);
   }
@@ -392,6 +411,48 @@ void StatusBarManager::HideTransferProgress() {
   // The next UpdateStatusBar() call will restore the chat info
 }
 
+void StatusBarManager::SetExportProgress(const wxString &chatTitle, int done,
+                                         int found, bool scanning) {
+  m_hasExportProgress = true;
+  m_exportChatTitle = chatTitle;
+  m_exportDone = done;
+  m_exportFound = found;
+  m_exportScanning = scanning;
+
+  // Transfer text is only rebuilt on transfer progress - refresh it here so
+  // the export counter doesn't stall behind a slow download
+  if (m_hasActiveTransfers && m_mainLabel && !m_transferLabel.IsEmpty() &&
+      m_overrideStatusText.IsEmpty()) {
+    m_mainLabel->SetLabel(m_transferLabel + BuildExportSegment());
+  } else {
+    UpdateStatusBar();
+  }
+}
+
+void StatusBarManager::ClearExportProgress() {
+  m_hasExportProgress = false;
+  UpdateStatusBar();
+}
+
+wxString StatusBarManager::BuildExportSegment() const {
+  if (!m_hasExportProgress)
+    return "";
+
+  wxString title = m_exportChatTitle;
+  if (title.length() > 20) {
+    title = title.Left(17) + "...";
+  }
+
+  // "| Archive chat 120/4000+ [#---------] 3%" - '+' while still scanning
+  int percent =
+      m_exportFound > 0
+          ? static_cast<int>((m_exportDone * 100LL) / m_exportFound)
+          : 0;
+  return wxString::Format(" | Archive %s %d/%d%s [", title, m_exportDone,
+                          m_exportFound, m_exportScanning ? "+" : "") +
+         BuildProgressBar(percent, 10) + wxString::Format("] %d%%", percent);
+}
+
 wxString StatusBarManager::FormatSpeed(double bytesPerSecond) const {
   if (bytesPerSecond >= 1024.0 * 1024.0) {
     return wxString::Format("%.1fMB/s", bytesPerSecond / (1024.0 * 1024.0));
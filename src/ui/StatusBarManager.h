@@ -52,6 +52,13 @@ public:
   // Get active transfer count (for external display)
   void SetActiveTransferCount(int count) { m_activeTransferCount = count; }
 
+  // Bulk media export - shown after the chat info / transfer text in field 0
+  // while a job runs. found keeps growing while scanning is true.
+  void SetExportProgress(const wxString &chatTitle, int done, int found,
+                         bool scanning);
+  void ClearExportProgress();
+  bool HasExportProgress() const { return m_hasExportProgress; }
+
   // Override status functionality (for service messages)
   void SetOverrideStatus(const wxString &text) {
     m_serviceMessageText = text;
@@ -116,6 +123,14 @@ private:
   double m_currentSpeed;
   bool m_hasActiveTransfers;
   int m_activeTransferCount;
+  wxString m_transferLabel; // Last transfer text, without the export row
+
+  // Bulk export state
+  bool m_hasExportProgress;
+  wxString m_exportChatTitle;
+  int m_exportDone;
+  int m_exportFound;
+  bool m_exportScanning;
 
   // Session timer
   wxStopWatch m_sessionTimer;
@@ -149,6 +164,7 @@ private:
   wxString FormatSizeProgress(int64_t transferred, int64_t total) const;
   wxString FormatETA(int64_t remaining, double speed) const;
   wxString BuildProgressBar(int percent, int width = 10) const;
+  wxString BuildExportSegment() const;
 
   // Layout helpers
   void RepositionWidgets();
@@ -1,5 +1,7 @@
 #include "UserInfoPopup.h"
 #include "../telegram/TelegramClient.h"
+#include "BitmapCache.h"
+#include "ImageScaler.h"
 #include <wx/graphics.h>
 #include <wx/rawbmp.h>
 #include <wx/tokenzr.h>
@@ -102,6 +104,12 @@ void UserInfoPopup::LoadProfilePhoto(const wxString& path)
     if (path.IsEmpty() || !wxFileExists(path)) {
         return;
     }
+
+    // The cached bitmap is already cropped and made circular
+    if (BitmapCache::Get().Lookup(path, PHOTO_SIZE, PHOTO_SIZE, m_profilePhoto)) {
+        m_hasPhoto = true;
+        return;
+    }
     
     wxImage image;
     if (image.LoadFile(path)) {
@@ -121,7 +129,7 @@ void UserInfoPopup::LoadProfilePhoto(const wxString& path)
                 newH = (origH * size) / origW;
             }
             
-            image.Rescale(newW, newH, wxIMAGE_QUALITY_HIGH);
+            image = DownscaleImage(image, newW, newH);
             
             // Crop to center
             int cropX = (newW - size) / 2;
@@ -131,6 +139,7 @@ void UserInfoPopup::LoadProfilePhoto(const wxString& path)
         
         m_profilePhoto = CreateCircularBitmap(wxBitmap(image), size);
         m_hasPhoto = true;
+        BitmapCache::Get().Store(path, PHOTO_SIZE, PHOTO_SIZE, m_profilePhoto);
     }
 }
 